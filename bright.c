@@ -29,7 +29,28 @@ computing sky background brightnesses in 'vislimit.cpp'.  That code
 currently computes brightness from the sun,  moon,  airglow,  and
 various other sources,  but not from the sky background.  It's
 also now in use in Find_Orb for computing a 'galactic confusion'
-estimate.  */
+estimate.
+
+   The equirectangular map badly oversamples the sky near the poles,
+and its pixels vary in area as cos(dec).  The '-h' option causes an
+equal-area HEALPix map to be built in the same pass through the data,
+written to 'bright.hpx'.  '-h9',  for example,  would give nside=2^9=512,
+with 3145728 pixels of about 6.9 arcminutes;  coarser levels,  down to
+the twelve base pixels,  are derived from that and stored in the same
+file (see 'healpix.h' for the format).  A star only lands in the map
+when its zone is read,  so the HEALPix map is only written if all 180
+zones were processed in this run.
+
+   Reading all of Gaia takes hours,  and used to mean rewriting all of
+'bright.zq' after each zone.  Now,  only the ten rows of the map
+covering that zone are written,  and 'bright.ckp' records which zones
+are done,  along with the size and modification time of the zone file
+each was made from.  On the next run,  zones that are already done from
+an unchanged file are skipped.  So an interrupted run just picks up
+where it left off,  and after replacing a few zone files,  only those
+zones get re-read.  '-f' forces all zones in the '-z' range to be
+re-read.  Building a HEALPix map requires reading every star,  so no
+zones are skipped when '-h' is used.  */
 
 #include <stdio.h>
 #include <assert.h>
@@ -37,18 +58,26 @@ estimate.  */
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <sys/stat.h>
 #include "gaia32.h"
+#include "healpix.h"
 
 #define XSIZE 3600
 #define YSIZE 1800
+#define PI 3.1415926535897932384626433832795028841971693993751058209749445923
+
+static void get_zone_filename( char *filename, const int zone)
+{
+   assert( zone >= 0 && zone < 180);
+   sprintf( filename, "/home/phred/gaia2/%03d.cat", zone);
+}
 
 static FILE *get_zone_file( const int zone)
 {
    char filename[80];
    FILE *rval;
 
-   assert( zone >= 0 && zone < 180);
-   sprintf( filename, "/home/phred/gaia2/%03d.cat", zone);
+   get_zone_filename( filename, zone);
    rval = fopen( filename, "rb");
    if( !rval)
       {
@@ -80,16 +109,137 @@ static void show_histo( const int32_t *map)
    printf( "\n");
 }
 
+/* Coarser levels are derived from the finest one,  four pixels at a time,
+and the whole pyramid is written to 'bright.hpx'. */
+
+static void write_healpix_map( int32_t *hpx, const int order, const int counting)
+{
+   FILE *ofp = fopen( "bright.hpx", "wb");
+   int32_t header[4];
+   int level;
+
+   assert( ofp);
+   header[0] = HEALPIX_MAP_MAGIC;
+   header[1] = order;
+   header[2] = order + 1;
+   header[3] = (counting ? HEALPIX_MAP_STAR_COUNTS : 0);
+   fwrite( header, sizeof( int32_t), 4, ofp);
+   for( level = order; level >= 0; level--)
+      {
+      const int64_t n_pixels = healpix_n_pixels( level);
+
+      if( level < order)
+         healpix_degrade_nest( hpx, hpx, level + 1, header[3]);
+      fwrite( hpx, sizeof( int32_t), (size_t)n_pixels, ofp);
+      }
+   fclose( ofp);
+   printf( "HEALPix map written for orders %d to 0\n", order);
+}
+
 #define BUFF_SIZE 10000
 #define MAG_LIMIT 22000
 
+/* 'bright.ckp' is a text file.  The first line gives the map dimensions,
+magnitude limit,  and counting flag;  if any of those don't match the
+current run,  the checkpoint is ignored.  Each following line gives a
+completed zone and the size and mtime of the file it was read from.  */
+
+typedef struct
+   {
+   int done;
+   long long size, mtime;
+   } zone_checkpoint_t;
+
+static const char *checkpoint_name = "bright.ckp";
+
+static void load_checkpoint( zone_checkpoint_t *ckp, const int counting)
+{
+   FILE *ifile = fopen( checkpoint_name, "rb");
+   char buff[100];
+   int xsize, ysize, mag_limit, counting_flag, zone;
+
+   memset( ckp, 0, 180 * sizeof( zone_checkpoint_t));
+   if( !ifile)
+      return;
+   if( fgets( buff, sizeof( buff), ifile)
+         && 4 == sscanf( buff, "%d %d %d %d", &xsize, &ysize,
+                                  &mag_limit, &counting_flag)
+         && xsize == XSIZE && ysize == YSIZE && mag_limit == MAG_LIMIT
+         && counting_flag == counting)
+      while( fgets( buff, sizeof( buff), ifile))
+         {
+         long long size, mtime;
+
+         if( 3 == sscanf( buff, "%d %lld %lld", &zone, &size, &mtime)
+                     && zone >= 0 && zone < 180)
+            {
+            ckp[zone].done = 1;
+            ckp[zone].size = size;
+            ckp[zone].mtime = mtime;
+            }
+         }
+   fclose( ifile);
+}
+
+/* The checkpoint is written to a temporary file,  then renamed,  so that
+an interruption while writing it can't leave us with a garbled one. */
+
+static void save_checkpoint( const zone_checkpoint_t *ckp, const int counting)
+{
+   const char *temp_name = "bright.ck~";
+   FILE *ofile = fopen( temp_name, "wb");
+   int zone;
+
+   assert( ofile);
+   fprintf( ofile, "%d %d %d %d\n", XSIZE, YSIZE, MAG_LIMIT, counting);
+   for( zone = 0; zone < 180; zone++)
+      if( ckp[zone].done)
+         fprintf( ofile, "%d %lld %lld\n", zone, ckp[zone].size,
+                                                 ckp[zone].mtime);
+   fclose( ofile);
+   remove( checkpoint_name);         /* rename() fails on Windows if */
+   rename( temp_name, checkpoint_name);    /* the target exists */
+}
+
+static void get_zone_file_identity( zone_checkpoint_t *ident, const int zone)
+{
+   char filename[80];
+   struct stat file_info;
+
+   get_zone_filename( filename, zone);
+   memset( ident, 0, sizeof( zone_checkpoint_t));
+   if( !stat( filename, &file_info))
+      {
+      ident->size = (long long)file_info.st_size;
+      ident->mtime = (long long)file_info.st_mtime;
+      }
+}
+
+/* Writes out just the ten rows of the map covered by a given zone. */
+
+static void write_zone_strip( FILE *ofile, const int32_t *map, const int zone)
+{
+   const long strip_size = XSIZE * 10L;
+   size_t n_written;
+
+   fseek( ofile, zone * strip_size * (long)sizeof( int32_t), SEEK_SET);
+   n_written = fwrite( map + zone * strip_size, sizeof( int32_t),
+                                    (size_t)strip_size, ofile);
+   assert( n_written == (size_t)strip_size);
+   fflush( ofile);
+}
+
 int main( const int argc, const char **argv)
 {
    int32_t *remap = (int32_t *)calloc( MAG_LIMIT, sizeof( int32_t));
    int32_t *map = (int32_t *)calloc( XSIZE * YSIZE, sizeof( int32_t));
-   int i, zone0 = 0, zone1 = 179, zone, counting = 0;
+   int32_t *hpx = NULL;
+   int i, zone0 = 0, zone1 = 179, zone, counting = 0, hpx_order = -1;
+   int force = 0;
    const char *map_name = "bright.zq";
-   FILE *fp;
+   const double mas_to_radians = PI / (180. * 3600. * 1000.);
+   FILE *fp, *map_file;
+   zone_checkpoint_t ckp[180];
    GAIA32_STAR *stars = (GAIA32_STAR *)calloc( BUFF_SIZE, sizeof( GAIA32_STAR));
 
    for( i = 0; i < argc; i++)
@@ -102,25 +252,58 @@ int main( const int argc, const char **argv)
             case 'c':
                counting = 1;
                break;
+            case 'f':
+               force = 1;
+               break;
+            case 'h':
+               hpx_order = (argv[i][2] ? atoi( argv[i] + 2) : 9);
+               if( hpx_order < 0 || hpx_order > HEALPIX_MAX_ORDER)
+                  {
+                  printf( "HEALPix order must be 0 to %d\n", HEALPIX_MAX_ORDER);
+                  return( -1);
+                  }
+               break;
             default:
                printf( "Unrecognized option '%s'\n", argv[i]);
                return( -1);
             }
 
+   if( hpx_order >= 0)
+      {
+      hpx = (int32_t *)calloc( (size_t)healpix_n_pixels( hpx_order),
+                               sizeof( int32_t));
+      assert( hpx);
+      }
    for( i = 0; i < MAG_LIMIT; i++)
       remap[i] = pow( 100., (double)( 20000 - i) / 5000.);
-   fp = fopen( map_name, "rb");
-   if( fp)
+   load_checkpoint( ckp, counting);
+   map_file = fopen( map_name, "r+b");
+   if( map_file)
       {
-      const size_t n_read = fread( map, sizeof( int32_t), XSIZE * YSIZE, fp);
+      const size_t n_read = fread( map, sizeof( int32_t), XSIZE * YSIZE, map_file);
 
-      fclose( fp);
       assert( n_read == XSIZE * YSIZE);
       }
+   else        /* no map yet;  start a blank one,  and ignore any checkpoint */
+      {
+      memset( ckp, 0, sizeof( ckp));
+      map_file = fopen( map_name, "w+b");
+      assert( map_file);
+      fwrite( map, sizeof( int32_t), XSIZE * YSIZE, map_file);
+      }
    for( zone = zone0; zone <= zone1; zone++)
       {
       size_t n_read, n_total = 0;
+      zone_checkpoint_t ident;
 
+      get_zone_file_identity( &ident, zone);
+      if( !force && !hpx && ckp[zone].done && ident.size == ckp[zone].size
+                  && ident.mtime == ckp[zone].mtime)
+         {
+         printf( "Zone %d: already done\n", zone);
+         continue;
+         }
+      ckp[zone].done = 0;
       fp = get_zone_file( zone);
       memset( map + XSIZE * zone * 10, 0, sizeof( int32_t) * XSIZE * 10);
       while( (n_read = fread( stars, sizeof( GAIA32_STAR), BUFF_SIZE, fp)) > 0)
@@ -137,10 +320,13 @@ int main( const int argc, const char **argv)
             assert( stars[i].mag > 0);
             if( stars[i].mag < MAG_LIMIT)
                {
-               if( counting)
-                  map[x + y * XSIZE]++;
-               else
-                  map[x + y * XSIZE] += remap[stars[i].mag];
+               const int32_t delta = (counting ? 1 : remap[stars[i].mag]);
+
+               map[x + y * XSIZE] += delta;
+               if( hpx)
+                  hpx[healpix_ang2pix_nest( hpx_order,
+                           (double)stars[i].ra * mas_to_radians,
+                           (double)stars[i].dec * mas_to_radians)] += delta;
                }
             }
          n_total += n_read;
@@ -148,10 +334,20 @@ int main( const int argc, const char **argv)
       fclose( fp);
       printf( "Zone %d: %ld read\n", zone, (long)n_total);
       show_histo( map);
-      fp = fopen( map_name, "wb");
-      assert( fp);
-      fwrite( map, XSIZE * YSIZE, sizeof( int32_t), fp);
-      fclose( fp);
+      write_zone_strip( map_file, map, zone);
+      ckp[zone] = ident;
+      ckp[zone].done = 1;
+      save_checkpoint( ckp, counting);
+      }
+   fclose( map_file);
+   if( hpx)
+      {
+      if( zone0 == 0 && zone1 == 179)
+         write_healpix_map( hpx, hpx_order, counting);
+      else
+         printf( "Only zones %d to %d were read;  HEALPix map not written\n",
+                     zone0, zone1);
+      free( hpx);
       }
    return( 0);
 }
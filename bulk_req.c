@@ -0,0 +1,108 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bulk_req.h"
+
+/* See 'bulk_req.h' for what this does and why.  */
+
+typedef struct
+   {
+   int zone;
+   long offset;
+   size_t idx;
+   } bulk_request_t;
+
+static int compare_bulk_requests( const void *a, const void *b)
+{
+   const bulk_request_t *a1 = (const bulk_request_t *)a;
+   const bulk_request_t *b1 = (const bulk_request_t *)b;
+
+   if( a1->zone != b1->zone)
+      return( a1->zone > b1->zone ? 1 : -1);
+   if( a1->offset != b1->offset)
+      return( a1->offset > b1->offset ? 1 : -1);
+   return( 0);
+}
+
+int run_bulk_requests( const size_t n_requests, const int *zones,
+                  const long *offsets, void *stars, const size_t star_size,
+                  int *rvals, const int past_end_err,
+                  void *context, bulk_read_fn read_fn)
+{
+   bulk_request_t *req = (bulk_request_t *)malloc(
+                                 n_requests * sizeof( bulk_request_t) + 1);
+   char *buff = (char *)malloc( BULK_SPAN * star_size);
+   size_t i, j;
+   int n_found = 0;
+
+   if( !req || !buff)
+      {
+      free( req);
+      free( buff);
+      return( BULK_REQ_ALLOC_FAILED);
+      }
+   for( i = 0; i < n_requests; i++)
+      {
+      req[i].zone = zones[i];
+      req[i].offset = offsets[i];
+      req[i].idx = i;
+      }
+   qsort( req, n_requests, sizeof( bulk_request_t), compare_bulk_requests);
+   for( i = 0; i < n_requests; i = j)
+      {
+      const int zone = req[i].zone;
+      const long first = req[i].offset;
+      long n_read;
+      int err = 0;
+
+      j = i + 1;        /* find requests we can get in the same read */
+      if( first >= 1)   /* (a bad offset gets a 'read' of its own) */
+         while( j < n_requests && req[j].zone == zone
+                         && req[j].offset - first < BULK_SPAN)
+            j++;
+      n_read = read_fn( context, zone, first,
+                        (size_t)( req[j - 1].offset - first + 1), buff);
+      if( n_read < 0)
+         err = (int)n_read;
+      while( i < j)
+         {
+         const long loc = req[i].offset - first;
+         char *star = (char *)stars + req[i].idx * star_size;
+
+         if( !err && loc >= n_read)    /* past end of zone */
+            err = past_end_err;
+         if( err)
+            memset( star, 0, star_size);
+         else
+            {
+            memcpy( star, buff + loc * star_size, star_size);
+            n_found++;
+            }
+         if( rvals)
+            rvals[req[i].idx] = err;
+         i++;
+         }
+      }
+   free( req);
+   free( buff);
+   return( n_found);
+}
+
+int run_zone_loop( const int zone, const size_t star_size,
+                  void *read_context, bulk_read_fn read_fn,
+                  void *star_context, zone_star_fn star_fn,
+                  const int alloc_err)
+{
+   char *buff = (char *)malloc( ZONE_LOOP_CHUNK * star_size);
+   long offset = 0, n_read = 0, i;
+   int keep_going = 1;
+
+   if( !buff)
+      return( alloc_err);
+   while( keep_going && (n_read = read_fn( read_context, zone, offset + 1,
+                                       ZONE_LOOP_CHUNK, buff)) > 0)
+      for( i = 0; i < n_read && keep_going; i++, offset++)
+         if( star_fn( star_context, zone, offset, buff + i * star_size))
+            keep_going = 0;
+   free( buff);
+   return( n_read < 0 && !offset ? (int)n_read : (int)offset);
+}
@@ -0,0 +1,82 @@
+#ifndef BULK_REQ_H_INCLUDED
+#define BULK_REQ_H_INCLUDED
+
+/* Looks up many stars at once,  given their zones and (one-based)
+offsets within the zones.  Doing them one at a time means a seek and read
+(and,  for catalogs without a handle,  opening and closing the zone file)
+for each star.  Instead,  the requests are sorted by zone and offset,  so
+each zone file is read through once,  in order;  and requests within
+BULK_SPAN stars of each other are satisfied with a single read of the
+stars between them.
+
+   The catalog-specific part is 'read_fn',  which is asked for 'n_stars'
+stars starting at 'offset' in 'zone'.  It should read them into 'buff'
+(byte-flipped to native order,  if need be) and return the number read,
+or a negative error code if the zone number is bad,  the file can't be
+found,  the offset is less than one,  and so on.  Zones are asked for in
+increasing order,  so a reader that opens one zone file at a time need
+only close the old one when the zone changes.
+
+   Results go into 'stars' (an array of 'n_requests' records of
+'star_size' bytes) in the order asked for.  If 'rvals' isn't NULL,  it
+gets zero for each star found,  the error code from 'read_fn',  or
+'past_end_err' if the offset was beyond the end of the zone.  Stars that
+couldn't be read are zeroed.  Returns the number of stars found,  or
+BULK_REQ_ALLOC_FAILED if memory ran out.
+
+   The extract_*_info_bulk() functions in 'ucac2.h',  'ucac3.h',
+'ucac4.h' and 'urat1.h' are this plus a 'read_fn' for that catalog;  the
+error codes in 'rvals' are those of the corresponding single-star lookup.
+UCAC4's catalog handle keeps its zone files open anyway.  The others
+keep the one zone file being read in a 'bulk_reader_t',  closing it when
+the zone changes and once run_bulk_requests() returns.  Public domain. */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#define BULK_SPAN                   256
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+typedef struct
+   {
+   const char *path;
+   FILE *ifile;
+   int zone;
+   } bulk_reader_t;
+
+typedef long (*bulk_read_fn)( void *context, const int zone,
+                  const long offset, const size_t n_stars, void *buff);
+
+int run_bulk_requests( const size_t n_requests, const int *zones,
+                  const long *offsets, void *stars, const size_t star_size,
+                  int *rvals, const int past_end_err,
+                  void *context, bulk_read_fn read_fn);
+
+/* The same 'read_fn' serves to walk through every star in a zone,  in
+order,  ZONE_LOOP_CHUNK stars at a time.  Each is handed to 'star_fn'
+(with the zero-based offset within the zone) until the zone runs out or
+'star_fn' returns non-zero.  Returns the number of stars handed over;
+a read error ends the loop,  and its code is returned if no stars had
+been read yet,  or 'alloc_err' if memory ran out.  This is what the for_each_*_star_in_zone() functions
+use;  they get 'read_fn' from their bulk lookup code.  */
+
+#define ZONE_LOOP_CHUNK            4096
+
+typedef int (*zone_star_fn)( void *context, const int zone,
+                  const long offset, const void *star);
+
+int run_zone_loop( const int zone, const size_t star_size,
+                  void *read_context, bulk_read_fn read_fn,
+                  void *star_context, zone_star_fn star_fn,
+                  const int alloc_err);
+
+#define BULK_REQ_ALLOC_FAILED      -1
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef BULK_REQ_H_INCLUDED */
@@ -1,7 +1,9 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdint.h>
 #include "cmc1x.h"
+#include "fmt_num.h"
 
 /*
 Quite a few CMC-1x fields are of the form 'nn.nnn';  magnitudes,  for
@@ -43,6 +45,8 @@ static inline int16_t get_two_digit_number( const char *tptr)
 
 int cmc1x_ascii_to_struct( CMC1x_REC *rec, const char *buff)
 {
+   char sigma_mag[7];
+
    rec->ra = (int32_t)( extract_number_from_rec( buff + 22)  /* .0001 secs */
                     + 600000L * atol( buff + 19)       /* minutes */
                   + 36000000L * atol( buff + 16));     /* hours */
@@ -57,8 +61,12 @@ int cmc1x_ascii_to_struct( CMC1x_REC *rec, const char *buff)
    rec->n_photo = get_two_digit_number( buff + 55);
    rec->sigma_ra = (int16_t)extract_number_from_rec( buff + 57);
    rec->sigma_dec = (int16_t)extract_number_from_rec( buff + 63);
-   rec->sigma_mag = (int16_t)extract_number_from_rec( buff + 69);
-   rec->epoch = (int16_t)atol( buff + 76);
+            /* Epochs past 9999 days run right up against sigma_mag, */
+            /* so we only look at the six bytes of the latter:        */
+   memcpy( sigma_mag, buff + 69, 6);
+   sigma_mag[6] = '\0';
+   rec->sigma_mag = (int16_t)extract_number_from_rec( sigma_mag);
+   rec->epoch = (int32_t)atol( buff + 75);
    rec->mag_j  = (int16_t)extract_number_from_rec( buff + 81);
    rec->mag_h  = (int16_t)extract_number_from_rec( buff + 88);
    rec->mag_ks = (int16_t)extract_number_from_rec( buff + 95);
@@ -71,24 +79,50 @@ This function will output values given in thousandths,  with decimal
 place intact and in a fixed six-character field,  replicating the
 original CMC-1x record. */
 
+/* Fields are written at fixed offsets,  each followed by a '\0' as
+sprintf() would have done;  the '\0's are turned into spaces at the
+end.  (So a field that overflows is overwritten by the next field,
+just as it always was.)  */
+
 static void put_three_digits( char *buff, const int ival)
 {
-   sprintf( buff, "%2d.%03d", ival / 1000, ival % 1000);
+   buff = fmt_int( buff, ival / 1000, 2);
+   *buff++ = '.';
+   fmt_end( fmt_int0( buff, ival % 1000, 3));
+}
+
+static void put_int( char *buff, const int ival, const int width)
+{
+   fmt_end( fmt_int( buff, ival, width));
 }
 
 int cmc1x_struct_to_ascii( char *buff, const CMC1x_REC *rec)
 {
    const long abs_dec = abs( rec->dec);
+   char *optr;
    int i, j;
 
    for( i = 0; i < CMC1x_ASCII_RECORD_SIZE; i++)
       buff[i] = ' ';
-   sprintf( buff + 16, "%02ld %02ld %02ld.%04ld ",
-            rec->ra / 36000000L, (rec->ra / 600000L) % 60L,
-            (rec->ra / 10000L) % 60L, rec->ra % 10000L);
-   sprintf( buff + 29, "  %02ld %02ld %02ld.%03ld ",
-            abs_dec / 3600000L, (abs_dec / 60000L) % 60L,
-            (abs_dec / 1000L) % 60L, abs_dec % 1000L);
+   optr = fmt_int0( buff + 16, rec->ra / 36000000L, 2);
+   *optr++ = ' ';
+   optr = fmt_int0( optr, (rec->ra / 600000L) % 60L, 2);
+   *optr++ = ' ';
+   optr = fmt_int0( optr, (rec->ra / 10000L) % 60L, 2);
+   *optr++ = '.';
+   optr = fmt_int0( optr, rec->ra % 10000L, 4);
+   *optr++ = ' ';
+   fmt_end( optr);
+   optr = fmt_spaces( buff + 29, 2);
+   optr = fmt_int0( optr, abs_dec / 3600000L, 2);
+   *optr++ = ' ';
+   optr = fmt_int0( optr, (abs_dec / 60000L) % 60L, 2);
+   *optr++ = ' ';
+   optr = fmt_int0( optr, (abs_dec / 1000L) % 60L, 2);
+   *optr++ = '.';
+   optr = fmt_int0( optr, abs_dec % 1000L, 3);
+   *optr++ = ' ';
+   fmt_end( optr);
    buff[30] = (rec->dec >= 0L ? '+' : '-');
                /* assemble identifier from RA/dec string: */
    for( i = 0, j = 16; j < 39; j++)
@@ -97,11 +131,13 @@ int cmc1x_struct_to_ascii( char *buff, const CMC1x_REC *rec)
    if( buff[30] == '+')
       buff[30] = ' ';
    put_three_digits( buff + 44, rec->mag_r);
-   sprintf( buff + 50, "%3d%2d%2d", rec->n_total, rec->n_astro, rec->n_photo);
+   optr = fmt_int( buff + 50, rec->n_total, 3);
+   optr = fmt_int( optr, rec->n_astro, 2);
+   fmt_end( fmt_int( optr, rec->n_photo, 2));
    put_three_digits( buff + 57, rec->sigma_ra);
    put_three_digits( buff + 63, rec->sigma_dec);
    put_three_digits( buff + 69, rec->sigma_mag);
-   sprintf( buff + 75, "%5d", rec->epoch);
+   put_int( buff + 75, rec->epoch, 5);
    put_three_digits( buff + 81, rec->mag_j);
    put_three_digits( buff + 88, rec->mag_h);
    put_three_digits( buff + 95, rec->mag_ks);
@@ -209,11 +245,18 @@ store n_total - 26.
 
    Further compression is quite possible,  especially if fixed-length
 records are abandoned,  but I didn't have a tremendous need to make the
-data much smaller.              */
+data much smaller.  (See below for the 'version 2' format,  which does
+abandon them,  and which also handles epochs past 2026.)
+
+   Epochs outside the 0 to 9999 day range can't be stored in this
+format;  for those,  we return -1 and nothing is written. */
 
 int cmc1x_struct_to_binary_rec( char *buff, const CMC1x_REC *rec)
 {
-   put_int32( buff, rec->ra + ((rec->epoch / 2500) << 30));
+   if( rec->epoch < 0 || rec->epoch >= 10000)
+      return( -1);
+   put_int32( buff, (int32_t)( (uint32_t)rec->ra
+                             + ((uint32_t)( rec->epoch / 2500) << 30)));
    put_int32( buff + 4, rec->dec + (rec->n_total >= 26 ? 180 * 3600 * 1000 : 0));
    put_int16( buff + 8, rec->mag_r);
    put_int16( buff + 10, (int16_t)
@@ -240,8 +283,8 @@ int cmc1x_binary_rec_to_struct( CMC1x_REC *rec, const char *buff)
    rec->sigma_ra = get_int16( buff + 10);
    rec->sigma_dec = get_int16( buff + 12);
    rec->sigma_mag = get_int16( buff + 14);
-   rec->epoch = (int16_t)( packed_epoch_n_total % 2500u);
-   rec->epoch += (int16_t)( ((uint32_t)rec->ra >> 30) * 2500);
+   rec->epoch = (int32_t)( packed_epoch_n_total % 2500u);
+   rec->epoch += (int32_t)( ((uint32_t)rec->ra >> 30) * 2500);
    rec->ra &= 0x3fffffff;
    rec->mag_j = get_int16( buff + 18);
    rec->mag_h = get_int16( buff + 20);
@@ -267,3 +310,323 @@ int cmc1x_binary_rec_to_struct( CMC1x_REC *rec, const char *buff)
    rec->photometric_flag = (rec->n_photo == 0);
    return( 0);
 }
+
+/* When searching and filtering,  all we usually want is the RA/dec,  in
+the same units as in the structure.  Getting them straight from the
+binary record (masking off the epoch bits in the RA,  and undoing the
+n_total >= 26 trick in the dec) saves unpacking everything else. */
+
+void cmc1x_binary_rec_ra_dec( long *ra, long *dec, const char *buff)
+{
+   if( ra)
+      *ra = (long)( get_int32( buff) & 0x3fffffff);
+   if( dec)
+      {
+      *dec = (long)get_int32( buff + 4);
+      if( *dec > 90 * 3600 * 1000)
+         *dec -= 180 * 3600 * 1000;
+      }
+}
+
+/* The 'version 2' binary format (.cm2 files) stores records in blocks
+of up to CMC2_BLOCK_RECS stars,  in RA order.  Within a block,  each
+field is stored as an offset from the smallest value of that field in
+the block,  using just enough bits for the largest such offset.  For RA,
+the field stored is the difference from the previous star's RA.  Since
+stars within a block are close together in RA,  that takes far fewer
+bits than the RA itself.  Other fields get some benefit from the fact
+that (say) sigmas and observation counts have a small range within a
+block.  The epoch is stored in full,  so (unlike the 25-byte format)
+there's no limit short of 2^31 days.
+
+   Each block starts with the RA of its first star,  then (for each of
+the CMC2_N_FIELDS fields) the four-byte base value and a one-byte bit
+width;  that's CMC2_BLOCK_HEADER_SIZE bytes.  After that come the bits
+for each star,  one field after another,  low bits first.  Everything is
+little-endian on all platforms.  The file layout (header and block
+table) is described in 'cmc1x.h'. */
+
+static void get_cmc2_fields( int32_t *fields, const CMC1x_REC *rec,
+                                        const int32_t prev_ra)
+{
+   fields[0] = rec->ra - prev_ra;
+   fields[1] = rec->dec;
+   fields[2] = rec->mag_r;
+   fields[3] = rec->epoch;
+   fields[4] = rec->n_total;
+   fields[5] = rec->n_astro;
+   fields[6] = rec->n_photo;
+   fields[7] = rec->sigma_ra;
+   fields[8] = rec->sigma_dec;
+   fields[9] = rec->sigma_mag;
+   fields[10] = rec->mag_j;
+   fields[11] = rec->mag_h;
+   fields[12] = rec->mag_ks;
+}
+
+static void put_cmc2_fields( CMC1x_REC *rec, const int32_t *fields,
+                                        const int32_t prev_ra)
+{
+   rec->ra = prev_ra + fields[0];
+   rec->dec = fields[1];
+   rec->mag_r = (int16_t)fields[2];
+   rec->epoch = fields[3];
+   rec->n_total = (int16_t)fields[4];
+   rec->n_astro = (int16_t)fields[5];
+   rec->n_photo = (int16_t)fields[6];
+   rec->sigma_ra = (int16_t)fields[7];
+   rec->sigma_dec = (int16_t)fields[8];
+   rec->sigma_mag = (int16_t)fields[9];
+   rec->mag_j = (int16_t)fields[10];
+   rec->mag_h = (int16_t)fields[11];
+   rec->mag_ks = (int16_t)fields[12];
+   rec->photometric_flag = (rec->n_photo == 0);
+}
+
+static void put_le32( unsigned char *buff, const uint32_t ival)
+{
+   buff[0] = (unsigned char)ival;
+   buff[1] = (unsigned char)( ival >> 8);
+   buff[2] = (unsigned char)( ival >> 16);
+   buff[3] = (unsigned char)( ival >> 24);
+}
+
+static uint32_t get_le32( const unsigned char *buff)
+{
+   return( (uint32_t)buff[0] | ((uint32_t)buff[1] << 8)
+                | ((uint32_t)buff[2] << 16) | ((uint32_t)buff[3] << 24));
+}
+
+/* Returns the number of bytes written to 'obuff',  which is at most
+CMC2_MAX_BLOCK_SIZE.  */
+
+int cmc2_encode_block( unsigned char *obuff, const CMC1x_REC *recs,
+                                       const int n_recs)
+{
+   int32_t fields[CMC2_N_FIELDS], min_val[CMC2_N_FIELDS];
+   int32_t max_val[CMC2_N_FIELDS];
+   int width[CMC2_N_FIELDS], i, j, n_bits = 0;
+   unsigned char *optr = obuff + CMC2_BLOCK_HEADER_SIZE;
+   uint64_t bits = 0;
+
+   for( i = 0; i < n_recs; i++)
+      {
+      get_cmc2_fields( fields, recs + i, (i ? recs[i - 1].ra : recs[0].ra));
+      for( j = 0; j < CMC2_N_FIELDS; j++)
+         if( !i)
+            min_val[j] = max_val[j] = fields[j];
+         else if( min_val[j] > fields[j])
+            min_val[j] = fields[j];
+         else if( max_val[j] < fields[j])
+            max_val[j] = fields[j];
+      }
+   put_le32( obuff, (uint32_t)( n_recs ? recs[0].ra : 0));
+   for( j = 0; j < CMC2_N_FIELDS; j++)
+      {
+      const uint32_t range = (n_recs ?
+                     (uint32_t)max_val[j] - (uint32_t)min_val[j] : 0);
+
+      width[j] = 0;
+      while( width[j] < 32 && (range >> width[j]))
+         width[j]++;
+      put_le32( obuff + 4 + j * 5, (uint32_t)( n_recs ? min_val[j] : 0));
+      obuff[8 + j * 5] = (unsigned char)width[j];
+      }
+   for( i = 0; i < n_recs; i++)
+      {
+      get_cmc2_fields( fields, recs + i, (i ? recs[i - 1].ra : recs[0].ra));
+      for( j = 0; j < CMC2_N_FIELDS; j++)
+         {
+         bits |= (uint64_t)( (uint32_t)fields[j] - (uint32_t)min_val[j])
+                                             << n_bits;
+         n_bits += width[j];
+         while( n_bits >= 8)
+            {
+            *optr++ = (unsigned char)bits;
+            bits >>= 8;
+            n_bits -= 8;
+            }
+         }
+      }
+   if( n_bits)
+      *optr++ = (unsigned char)bits;
+   return( (int)( optr - obuff));
+}
+
+/* Reads the block header,  getting the base value and bit width of each
+field,  and where each field starts within a star's bits.  Returns the
+number of bytes the block should have,  or -1 if it's too short for the
+stars it's supposed to hold (i.e.,  is corrupted.)  Checking that up
+front means the decoding needn't look for running off the end.  */
+
+typedef struct
+   {
+   int32_t first_ra, base[CMC2_N_FIELDS];
+   int width[CMC2_N_FIELDS], bit_offset[CMC2_N_FIELDS], bits_per_rec;
+   } cmc2_block_header_t;
+
+static int get_cmc2_block_header( cmc2_block_header_t *h,
+      const unsigned char *buff, const int n_recs, const int block_size)
+{
+   long n_bytes;
+   int j;
+
+   if( block_size < CMC2_BLOCK_HEADER_SIZE)
+      return( -1);
+   h->first_ra = (int32_t)get_le32( buff);
+   h->bits_per_rec = 0;
+   for( j = 0; j < CMC2_N_FIELDS; j++)
+      {
+      h->base[j] = (int32_t)get_le32( buff + 4 + j * 5);
+      h->width[j] = buff[8 + j * 5];
+      if( h->width[j] > 32)
+         return( -1);
+      h->bit_offset[j] = h->bits_per_rec;
+      h->bits_per_rec += h->width[j];
+      }
+   n_bytes = CMC2_BLOCK_HEADER_SIZE + ((long)h->bits_per_rec * n_recs + 7) / 8;
+   return( n_bytes > block_size ? -1 : (int)n_bytes);
+}
+
+/* Gets 'width' bits starting 'bit_pos' bits into 'buff'.  That spans at
+most five bytes,  and we read only the bytes actually spanned,  so we
+never go past the end of the block. */
+
+static uint32_t get_bits( const unsigned char *buff, const long bit_pos,
+                                    const int width)
+{
+   const unsigned char *iptr = buff + (bit_pos >> 3);
+   const int shift = (int)( bit_pos & 7);
+   const int n_bytes = (shift + width + 7) >> 3;
+   uint64_t bits = 0;
+   int i;
+
+   for( i = 0; i < n_bytes; i++)
+      bits |= (uint64_t)iptr[i] << (i * 8);
+   return( (uint32_t)( (bits >> shift) & (((uint64_t)1 << width) - 1)));
+}
+
+/* Decodes 'n_recs' stars from a block of 'block_size' bytes.  Returns
+the number of bytes actually used,  or -1 if the block is corrupted.  */
+
+int cmc2_decode_block( CMC1x_REC *recs, const unsigned char *buff,
+                  const int n_recs, const int block_size)
+{
+   cmc2_block_header_t h;
+   int32_t fields[CMC2_N_FIELDS], prev_ra;
+   int i, j, n_bits = 0;
+   const int rval = get_cmc2_block_header( &h, buff, n_recs, block_size);
+   const unsigned char *iptr = buff + CMC2_BLOCK_HEADER_SIZE;
+   uint64_t bits = 0;
+
+   if( rval < 0)
+      return( -1);
+   prev_ra = h.first_ra;
+   for( i = 0; i < n_recs; i++)
+      {
+      for( j = 0; j < CMC2_N_FIELDS; j++)
+         {
+         while( n_bits < h.width[j])
+            {
+            bits |= (uint64_t)*iptr++ << n_bits;
+            n_bits += 8;
+            }
+         fields[j] = (int32_t)( (uint32_t)h.base[j] +
+                  (uint32_t)( bits & (((uint64_t)1 << h.width[j]) - 1)));
+         bits >>= h.width[j];
+         n_bits -= h.width[j];
+         }
+      put_cmc2_fields( recs + i, fields, prev_ra);
+      prev_ra = recs[i].ra;
+      }
+   return( rval);
+}
+
+/* When searching and filtering,  we only need the RA/dec of each star.
+Every star in a block takes the same number of bits,  so we can get at
+those two fields without unpacking the rest.  Then cmc2_decode_record()
+can unpack just the stars we actually want.  Returns -1 if the block is
+corrupted. */
+
+int cmc2_decode_ra_dec( int32_t *ra, int32_t *dec, const unsigned char *buff,
+                  const int n_recs, const int block_size)
+{
+   cmc2_block_header_t h;
+   const unsigned char *bits = buff + CMC2_BLOCK_HEADER_SIZE;
+   long bit_pos = 0;
+   int32_t curr_ra;
+   int i;
+
+   if( get_cmc2_block_header( &h, buff, n_recs, block_size) < 0)
+      return( -1);
+   curr_ra = h.first_ra;
+   for( i = 0; i < n_recs; i++, bit_pos += h.bits_per_rec)
+      {
+      curr_ra += (int32_t)( (uint32_t)h.base[0] +
+                            get_bits( bits, bit_pos, h.width[0]));
+      ra[i] = curr_ra;
+      dec[i] = (int32_t)( (uint32_t)h.base[1] +
+                  get_bits( bits, bit_pos + h.bit_offset[1], h.width[1]));
+      }
+   return( 0);
+}
+
+/* Unpacks star 'rec_no' of a block.  Its RA (which,  being delta-coded,
+depends on all stars before it) must have come from cmc2_decode_ra_dec().
+The block is assumed to have passed the checks in that function. */
+
+void cmc2_decode_record( CMC1x_REC *rec, const unsigned char *buff,
+                  const int rec_no, const int32_t ra)
+{
+   cmc2_block_header_t h;
+   int32_t fields[CMC2_N_FIELDS];
+   long bit_pos;
+   int j;
+
+   get_cmc2_block_header( &h, buff, 0, CMC2_MAX_BLOCK_SIZE);
+   bit_pos = (long)rec_no * (long)h.bits_per_rec;
+   for( j = 0; j < CMC2_N_FIELDS; j++)
+      fields[j] = (int32_t)( (uint32_t)h.base[j] + get_bits(
+                  buff + CMC2_BLOCK_HEADER_SIZE,
+                  bit_pos + h.bit_offset[j], h.width[j]));
+   fields[0] = 0;
+   put_cmc2_fields( rec, fields, ra);
+}
+
+/* The file header and block table are read and written with these,  so
+the byte order is right everywhere: */
+
+void cmc2_put_header( unsigned char *buff, const uint32_t n_recs,
+                                        const uint32_t n_blocks)
+{
+   memcpy( buff, CMC2_MAGIC, 4);
+   put_le32( buff + 4, n_recs);
+   put_le32( buff + 8, n_blocks);
+   put_le32( buff + 12, CMC2_BLOCK_RECS);
+}
+
+int cmc2_get_header( const unsigned char *buff, uint32_t *n_recs,
+                                        uint32_t *n_blocks)
+{
+   if( memcmp( buff, CMC2_MAGIC, 4) || get_le32( buff + 12) != CMC2_BLOCK_RECS)
+      return( -1);
+   *n_recs = get_le32( buff + 4);
+   *n_blocks = get_le32( buff + 8);
+   if( *n_blocks != (*n_recs + CMC2_BLOCK_RECS - 1) / CMC2_BLOCK_RECS)
+      return( -1);
+   return( 0);
+}
+
+void cmc2_put_table_entry( unsigned char *buff, const uint32_t offset,
+                                        const int32_t first_ra)
+{
+   put_le32( buff, offset);
+   put_le32( buff + 4, (uint32_t)first_ra);
+}
+
+void cmc2_get_table_entry( const unsigned char *buff, uint32_t *offset,
+                                        int32_t *first_ra)
+{
+   *offset = get_le32( buff);
+   *first_ra = (int32_t)get_le32( buff + 4);
+}
@@ -1,10 +1,44 @@
 #ifndef CMC_1x_H_INCLUDED
 #define CMC_1x_H_INCLUDED
 
+#include "out_sink.h"
+
 #define CMC1x_REC struct cmc1x_rec
 #define CMC1x_ASCII_RECORD_SIZE 102
 #define CMC1x_BINARY_RECORD_SIZE 25
 
+/* 'cmc_xvt -i' can make an index for each zone,  with the same name as
+the zone file but extension .idx.  It's CMC1x_INDEX_RA_BINS + 1 four-byte
+little-endian integers.  Entry n is the record number of the first star
+with RA at or past n minutes of RA;  the last is the number of records.
+Record numbers are the same in the .dat and .cmc versions of a zone,  so
+the index works with either. */
+
+#define CMC1x_INDEX_RA_BINS 1440
+#define CMC1x_INDEX_BIN_SIZE 600000L     /* one minute,  in .0001 seconds */
+
+/* 'Version 2' binary files (extension .cm2,  made with 'cmc_xvt -2')
+start with a CMC2_HEADER_SIZE byte header:  the four bytes 'CMC2',  then
+the number of records,  the number of blocks,  and the number of records
+per block (CMC2_BLOCK_RECS;  the last block may have fewer),  all as
+four-byte little-endian integers.  Then comes a table with,  for each
+block,  its offset from the start of the file and the RA of its first
+star (four bytes each).  That's the seek index:  to find a given RA, you
+search the table,  then read and decode blocks from there.  The blocks
+themselves are described in 'cmc.c'.  A block is at most
+CMC2_MAX_BLOCK_SIZE bytes.  */
+
+#define CMC2_MAGIC "CMC2"
+#define CMC2_HEADER_SIZE 16
+#define CMC2_TABLE_ENTRY_SIZE 8
+#define CMC2_BLOCK_RECS 256
+#define CMC2_N_FIELDS 13
+         /* first RA,  then a base value and bit width for each field : */
+#define CMC2_BLOCK_HEADER_SIZE (4 + CMC2_N_FIELDS * 5)
+         /* block header,  plus each field at up to 32 bits per star : */
+#define CMC2_MAX_BLOCK_SIZE (CMC2_BLOCK_HEADER_SIZE \
+                                + CMC2_BLOCK_RECS * CMC2_N_FIELDS * 4)
+
 /* CMC-14 and CMC-15 are nearly identical in terms of data format.
 CMC-15 goes deeper and extends the coverage southward from dec=-30
 to dec=-40,  and adds a lot of stars and newer data to the original
@@ -15,7 +49,7 @@ CMC1x_REC
    {
    int32_t ra, dec;        /* in .0001 seconds & milliarcseconds */
    int16_t mag_r;         /* All magnitudes are in .001 mags */
-   int16_t epoch;         /* in days from 26 Mar 1999 */
+   int32_t epoch;         /* in days from 26 Mar 1999 */
    int16_t n_total;       /* total number of observations,  incl. bad ones */
    int16_t n_astro;       /* number accepted astrometric obs */
    int16_t n_photo;       /* number accepted photometric obs */
@@ -34,11 +68,39 @@ int cmc1x_ascii_to_struct( CMC1x_REC *rec, const char *buff);
 int cmc1x_struct_to_ascii( char *buff, const CMC1x_REC *rec);
 int cmc1x_binary_rec_to_struct( CMC1x_REC *rec, const char *buff);
 int cmc1x_struct_to_binary_rec( char *buff, const CMC1x_REC *rec);
+         /* Gets just the RA (.0001 seconds) and dec (milliarcseconds)  */
+         /* from a binary record,  without unpacking the rest.  Either  */
+         /* pointer can be NULL.                                        */
+void cmc1x_binary_rec_ra_dec( long *ra, long *dec, const char *buff);
+int cmc2_encode_block( unsigned char *obuff, const CMC1x_REC *recs,
+                                       const int n_recs);
+int cmc2_decode_block( CMC1x_REC *recs, const unsigned char *buff,
+                  const int n_recs, const int block_size);
+int cmc2_decode_ra_dec( int32_t *ra, int32_t *dec, const unsigned char *buff,
+                  const int n_recs, const int block_size);
+void cmc2_decode_record( CMC1x_REC *rec, const unsigned char *buff,
+                  const int rec_no, const int32_t ra);
+void cmc2_put_header( unsigned char *buff, const uint32_t n_recs,
+                                        const uint32_t n_blocks);
+int cmc2_get_header( const unsigned char *buff, uint32_t *n_recs,
+                                        uint32_t *n_blocks);
+void cmc2_put_table_entry( unsigned char *buff, const uint32_t offset,
+                                        const int32_t first_ra);
+void cmc2_get_table_entry( const unsigned char *buff, uint32_t *offset,
+                                        int32_t *first_ra);
 int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
                   const double dec_in_degrees,
                   const double width_in_degrees,
                   const double height_in_degrees,
                   const char *path, const int rejected);
+         /* Same,  except output goes to an 'out_sink_t' ('out_sink.h'), */
+         /* which can write to a file descriptor,  memory,  or callback. */
+int extract_cmc1x_stars_to_sink( out_sink_t *sink,
+                  const double ra_in_degrees,
+                  const double dec_in_degrees,
+                  const double width_in_degrees,
+                  const double height_in_degrees,
+                  const char *path, const int rejected);
 
 #ifdef __cplusplus
 }
@@ -40,19 +40,315 @@ static unsigned fix_60_problem( char *buff)
    return( rval);
 }
 
+/* With '-i',  we also build an RA index for the zone (see 'cmc1x.h'),
+giving the first record at or past each minute of RA.  Records are in
+RA order,  so we just note where each new bin starts as we go through
+them.  Bins with no stars get the record number of the next star. */
+
+static void add_to_index( uint32_t *index, int *next_bin, const long ra,
+                                 const uint32_t rec_no)
+{
+   while( *next_bin <= CMC1x_INDEX_RA_BINS
+                     && *next_bin * CMC1x_INDEX_BIN_SIZE <= ra)
+      index[(*next_bin)++] = rec_no;
+}
+
+/* Entries are written as little-endian bytes,  so the index is the same
+on any platform. */
+
+static int write_index( const char *base_name, uint32_t *index,
+                  int next_bin, const uint32_t n_recs)
+{
+   char filename[200];
+   unsigned char obuff[(CMC1x_INDEX_RA_BINS + 1) * 4];
+   FILE *ofile;
+   int i;
+
+   while( next_bin <= CMC1x_INDEX_RA_BINS)
+      index[next_bin++] = n_recs;
+   for( i = 0; i <= CMC1x_INDEX_RA_BINS; i++)
+      {
+      obuff[i * 4] = (unsigned char)index[i];
+      obuff[i * 4 + 1] = (unsigned char)( index[i] >> 8);
+      obuff[i * 4 + 2] = (unsigned char)( index[i] >> 16);
+      obuff[i * 4 + 3] = (unsigned char)( index[i] >> 24);
+      }
+   snprintf( filename, sizeof( filename), "%s.idx", base_name);
+   ofile = fopen( filename, "wb");
+   if( !ofile)
+      {
+      printf( "%s not opened\n", filename);
+      return( -1);
+      }
+   fwrite( obuff, sizeof( obuff), 1, ofile);
+   fclose( ofile);
+   printf( "\nIndex written to %s\n", filename);
+   return( 0);
+}
+
+/* If you have only the binary .cmc file,  'cmc_xvt -i' can still make
+the index from that. */
+
+static int index_binary_file( const char *base_name)
+{
+   char filename[200], buff[CMC1x_BINARY_RECORD_SIZE];
+   uint32_t index[CMC1x_INDEX_RA_BINS + 1], n_recs = 0;
+   int next_bin = 0;
+   FILE *ifile;
+
+   snprintf( filename, sizeof( filename), "%s.cmc", base_name);
+   ifile = fopen( filename, "rb");
+   if( !ifile)
+      {
+      printf( "Neither %s.dat nor %s opened\n", base_name, filename);
+      return( -1);
+      }
+   while( fread( buff, CMC1x_BINARY_RECORD_SIZE, 1, ifile))
+      {
+      long ra;
+
+      cmc1x_binary_rec_ra_dec( &ra, NULL, buff);
+      add_to_index( index, &next_bin, ra, n_recs++);
+      }
+   fclose( ifile);
+   printf( "%lu stars in %s\n", (unsigned long)n_recs, filename);
+   return( write_index( base_name, index, next_bin, n_recs));
+}
+
+/* The result of compressing,  then decompressing a record should match
+the original ASCII record.  This checks that it does,  returning the
+number of "60-problems" found (see above),  or -1 if the records don't
+match.  */
+
+static int check_record( char *buff, const CMC1x_REC *rec, const int line)
+{
+   char obuff[200];
+   int rval = 0;
+
+   memset( obuff, 0, sizeof( obuff));
+   cmc1x_struct_to_ascii( obuff, rec);
+               /* In CMC15,  the seconds and arcseconds places */
+               /* lack leading zeroes.  If there's a zero in either */
+               /* place,  we need to convert it to a space. */
+   if( obuff[22] == '0')
+      obuff[22] = ' ';
+   if( obuff[37] == '0')
+      obuff[37] = ' ';
+   if( memcmp( obuff, buff, CMC1x_ASCII_RECORD_SIZE))
+      {
+      rval = fix_60_problem( buff);
+      if( memcmp( obuff, buff, CMC1x_ASCII_RECORD_SIZE))
+         {
+         printf( "Problem at line %d\n", line);
+         printf( "%.101s\n%.101s\n", buff, obuff);
+         rval = -1;
+         }
+      }
+   return( rval);
+}
+
+/* With '-2',  we write a 'version 2' .cm2 file (see 'cmc1x.h' and
+'cmc.c') instead of a .cmc one.  Records are gathered into blocks of
+CMC2_BLOCK_RECS.  Each block is written out,  then decoded and checked
+against the ASCII records it came from. */
+
+typedef struct
+   {
+   FILE *ofile;
+   unsigned char *table;
+   uint32_t n_blocks;
+   int n_recs;                /* number in the current block */
+   int first_line;            /* line number of the block's first record */
+   unsigned n_mismatches;     /* records that didn't decode correctly */
+   CMC1x_REC recs[CMC2_BLOCK_RECS], decoded[CMC2_BLOCK_RECS];
+   char ascii[CMC2_BLOCK_RECS][CMC1x_ASCII_RECORD_SIZE];
+   unsigned char block[CMC2_MAX_BLOCK_SIZE];
+   } cmc2_writer_t;
+
+static unsigned write_cmc2_block( cmc2_writer_t *w)
+{
+   const int n_bytes = cmc2_encode_block( w->block, w->recs, w->n_recs);
+   unsigned rval = 0;
+   int i;
+
+   cmc2_put_table_entry( w->table + w->n_blocks * CMC2_TABLE_ENTRY_SIZE,
+                     (uint32_t)ftell( w->ofile), w->recs[0].ra);
+   fwrite( w->block, n_bytes, 1, w->ofile);
+   w->n_blocks++;
+   memset( w->decoded, 0, sizeof( w->decoded));
+   if( cmc2_decode_block( w->decoded, w->block, w->n_recs, n_bytes) != n_bytes)
+      {
+      printf( "Block starting at line %d didn't decode\n", w->first_line);
+      w->n_mismatches += w->n_recs;
+      }
+   else for( i = 0; i < w->n_recs; i++)
+      {
+      const int n_60_problems = check_record( w->ascii[i], w->decoded + i,
+                                              w->first_line + i);
+
+      if( n_60_problems < 0)
+         w->n_mismatches++;
+      else
+         rval += (unsigned)n_60_problems;
+      }
+   w->first_line += w->n_recs;
+   w->n_recs = 0;
+   return( rval);
+}
+
+/* 'cmc_xvt -d' goes the other way,  from a .cm2 file to ASCII.  If the
+ASCII .dat file is already there,  it's not overwritten;  instead,  each
+decoded record is checked against it.  */
+
+static int decode_cmc2_file( const char *base_name)
+{
+   char filename[200], buff[200];
+   unsigned char header[CMC2_HEADER_SIZE], *table, *block;
+   uint32_t n_recs, n_blocks, i, end_offset;
+   CMC1x_REC recs[CMC2_BLOCK_RECS];
+   FILE *ifile, *ascii_file;
+   int line = 0, verifying = 0, j, n_errors = 0, n_mismatches = 0;
+
+   snprintf( filename, sizeof( filename), "%s.cm2", base_name);
+   ifile = fopen( filename, "rb");
+   if( !ifile)
+      {
+      printf( "%s not opened\n", filename);
+      return( -1);
+      }
+   if( !fread( header, CMC2_HEADER_SIZE, 1, ifile)
+                || cmc2_get_header( header, &n_recs, &n_blocks))
+      {
+      printf( "%s isn't a valid .cm2 file\n", filename);
+      fclose( ifile);
+      return( -2);
+      }
+   table = (unsigned char *)malloc( n_blocks * CMC2_TABLE_ENTRY_SIZE
+                                           + CMC2_MAX_BLOCK_SIZE);
+   if( !table || fread( table, CMC2_TABLE_ENTRY_SIZE, n_blocks, ifile)
+                                           != n_blocks)
+      {
+      printf( "Couldn't read the block table\n");
+      fclose( ifile);
+      free( table);
+      return( -3);
+      }
+   block = table + n_blocks * CMC2_TABLE_ENTRY_SIZE;
+   snprintf( filename, sizeof( filename), "%s.dat", base_name);
+   ascii_file = fopen( filename, "rb");
+   if( ascii_file)
+      {
+      verifying = 1;
+      printf( "Checking against %s\n", filename);
+      }
+   else
+      ascii_file = fopen( filename, "wb");
+   if( !ascii_file)
+      {
+      printf( "%s not opened\n", filename);
+      fclose( ifile);
+      free( table);
+      return( -4);
+      }
+   fseek( ifile, 0L, SEEK_END);
+   end_offset = (uint32_t)ftell( ifile);
+   for( i = 0; i < n_blocks && !n_errors; i++)
+      {
+      const int n_in_block = (i == n_blocks - 1 ?
+                  (int)( n_recs - i * CMC2_BLOCK_RECS) : CMC2_BLOCK_RECS);
+      uint32_t offset, next_offset = end_offset;
+      int32_t first_ra;
+      int block_size;
+
+      cmc2_get_table_entry( table + i * CMC2_TABLE_ENTRY_SIZE,
+                                           &offset, &first_ra);
+      if( i < n_blocks - 1)
+         cmc2_get_table_entry( table + (i + 1) * CMC2_TABLE_ENTRY_SIZE,
+                                           &next_offset, &first_ra);
+      block_size = (int)( next_offset - offset);
+      if( block_size < 0 || block_size > CMC2_MAX_BLOCK_SIZE
+               || fseek( ifile, (long)offset, SEEK_SET)
+               || !fread( block, block_size, 1, ifile)
+               || cmc2_decode_block( recs, block, n_in_block, block_size) < 0)
+         {
+         printf( "Block %lu is bad\n", (unsigned long)i);
+         n_errors++;
+         }
+      else for( j = 0; j < n_in_block; j++)
+         {
+         line++;
+         if( verifying)
+            {
+            if( !fread( buff, CMC1x_ASCII_RECORD_SIZE, 1, ascii_file))
+               {
+               printf( "%s is shorter than the .cm2 file\n", filename);
+               n_errors++;
+               break;
+               }
+            if( check_record( buff, recs + j, line) < 0)
+               n_mismatches++;
+            }
+         else
+            {
+            cmc1x_struct_to_ascii( buff, recs + j);
+            if( buff[22] == '0')
+               buff[22] = ' ';
+            if( buff[37] == '0')
+               buff[37] = ' ';
+            fwrite( buff, CMC1x_ASCII_RECORD_SIZE, 1, ascii_file);
+            }
+         }
+      }
+   printf( "%d of %lu records %s\n", line, (unsigned long)n_recs,
+               (verifying ? "checked" : "written"));
+   if( n_mismatches)
+      printf( "%d records didn't match\n", n_mismatches);
+   fclose( ascii_file);
+   fclose( ifile);
+   free( table);
+   return( n_errors || n_mismatches ? -5 : 0);
+}
+
 /* Main program to read in an ASCII CMC-1x file and write out its binary
 counterpart,  resulting in about a 4:1 compression (to be exact,  each
-ASCII 102-byte record becomes a binary 25-byte one.)  */
+ASCII 102-byte record becomes a binary 25-byte one.)  With '-2',  the
+'version 2' format is written instead.  */
 
 int main( int argc, char **argv)
 {
    FILE *ifile, *ofile;
-   char buff[200];
+   char buff[200], ofilename[200];
    int line = 0, n_recs, output_freq = 128;
    int output_counter = 0;
-   unsigned n_60_problems_found = 0;
+   unsigned n_60_problems_found = 0, n_mismatches = 0;
    double prev_t = 0.;
+   int build_index = 0, next_bin = 0, i, j, version = 1;
+   uint32_t index[CMC1x_INDEX_RA_BINS + 1];
+   cmc2_writer_t *cmc2 = NULL;
 
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-')
+         {
+         switch( argv[i][1])
+            {
+            case 'i': case 'I':
+               build_index = 1;
+               break;
+            case '2':
+               version = 2;
+               break;
+            case 'd': case 'D':
+               version = -2;
+               break;
+            default:
+               printf( "%s is an unrecognized option\n", argv[i]);
+               break;
+            }
+         for( j = i; j < argc - 1; j++)      /* remove this argument */
+            argv[j] = argv[j + 1];
+         i--;
+         argc--;
+         }
    if( argc != 2)
       {
       printf( "'cmc_xvt' takes the name of an ASCII CMC-14 or CMC-15 file as a command\n");
@@ -62,13 +358,24 @@ int main( int argc, char **argv)
       printf( "build the binary file 'cmc14s5.cmc'.  As the records are compressed,\n");
       printf( "they are decompressed and compared with the original to ensure no\n");
       printf( "compression errors occur.\n");
+      printf( "\nWith '-i',  an RA index (cmc14s5.idx in the above case) is\n");
+      printf( "also made,  which speeds up extraction from either file.  If\n");
+      printf( "only the binary file is available,  the index is made from it.\n");
+      printf( "\nWith '-2',  the more compact 'version 2' file 'cmc14s5.cm2' is\n");
+      printf( "made instead (this also handles epochs past 2026 Aug 11).  With\n");
+      printf( "'-d',  'cmc14s5.cm2' is decoded to 'cmc14s5.dat';  or,  if that\n");
+      printf( "file already exists,  the decoded records are checked against it.\n");
       exit( -1);
       }
+   if( version == -2)
+      return( decode_cmc2_file( argv[1]));
                   /* Open ASCII file first,  exiting if it's not found: */
    sprintf( buff, "%s.dat", argv[1]);
    ifile = fopen( buff, "rb");
    if( !ifile)
       ifile = fopen( argv[1], "rb");
+   if( !ifile && build_index)
+      return( index_binary_file( argv[1]));
    if( !ifile)
       {
       printf( "%s not opened\n", buff);
@@ -81,47 +388,77 @@ int main( int argc, char **argv)
    printf( "%ld stars in file\n", (long)n_recs);
    fseek( ifile, 0L, SEEK_SET);
                   /* Open the output binary file:  */
-   sprintf( buff, "%s.cmc", argv[1]);
-   ofile = fopen( buff, "wb");
+   snprintf( ofilename, sizeof( ofilename),
+                     (version == 2 ? "%s.cm2" : "%s.cmc"), argv[1]);
+   ofile = fopen( ofilename, "wb");
    if( !ofile)
       {
-      printf( "%s not opened\n", buff);
+      printf( "%s not opened\n", ofilename);
       exit( -1);
+      }
+   if( version == 2)
+      {                 /* leave room for the header and block table; */
+                        /* they're filled in at the end               */
+      const uint32_t n_blocks =
+                  ((uint32_t)n_recs + CMC2_BLOCK_RECS - 1) / CMC2_BLOCK_RECS;
+
+      cmc2 = (cmc2_writer_t *)calloc( 1, sizeof( cmc2_writer_t));
+      if( cmc2)
+         cmc2->table = (unsigned char *)calloc( n_blocks + 1,
+                                      CMC2_TABLE_ENTRY_SIZE);
+      if( !cmc2 || !cmc2->table)
+         {
+         printf( "Out of memory\n");
+         exit( -1);
+         }
+      cmc2->ofile = ofile;
+      cmc2->first_line = 1;
+      fseek( ofile, CMC2_HEADER_SIZE + n_blocks * CMC2_TABLE_ENTRY_SIZE,
+                                           SEEK_SET);
       }
                   /* Read in all records from the input ASCII file: */
    while( fread( buff, CMC1x_ASCII_RECORD_SIZE, 1, ifile))
       {
-      char obuff[200], compressed[CMC1x_BINARY_RECORD_SIZE];
+      char compressed[CMC1x_BINARY_RECORD_SIZE];
       CMC1x_REC irec;
 
       line++;
                    /* Compress the input record and write it out: */
       cmc1x_ascii_to_struct( &irec, buff);
-      cmc1x_struct_to_binary_rec( compressed, &irec);
-      fwrite( compressed, CMC1x_BINARY_RECORD_SIZE, 1, ofile);
-                  /* The result of compressing,  then decompressing a */
-                  /* record should match the original record:         */
-      memset( obuff, 0, sizeof( obuff));
-      memset( &irec, 0, sizeof( CMC1x_REC));
-      cmc1x_binary_rec_to_struct( &irec, compressed);
-      cmc1x_struct_to_ascii( obuff, &irec);
-               /* In CMC15,  the seconds and arcseconds places */
-               /* lack leading zeroes.  If there's a zero in either */
-               /* place,  we need to convert it to a space. */
-      if( obuff[22] == '0')
-         obuff[22] = ' ';
-      if( obuff[37] == '0')
-         obuff[37] = ' ';
-      if( memcmp( obuff, buff, CMC1x_ASCII_RECORD_SIZE))
+      if( build_index)
+         add_to_index( index, &next_bin, (long)irec.ra, (uint32_t)line - 1);
+      if( cmc2)
+         {
+         cmc2->recs[cmc2->n_recs] = irec;
+         memcpy( cmc2->ascii[cmc2->n_recs], buff, CMC1x_ASCII_RECORD_SIZE);
+         if( ++cmc2->n_recs == CMC2_BLOCK_RECS)
+            n_60_problems_found += write_cmc2_block( cmc2);
+         }
+      else
          {
-         n_60_problems_found += fix_60_problem( buff);
-         if( memcmp( obuff, buff, CMC1x_ASCII_RECORD_SIZE))
+         int n_60_problems;
+
+         if( cmc1x_struct_to_binary_rec( compressed, &irec))
             {
-            printf( "Problem at line %d\n", line);
-            printf( "%s\n%s\n", buff, obuff);
+            printf( "\nLine %d has epoch %ld,  past 2026 Aug 11;  that can't\n"
+                    "be stored in a .cmc file.  Use '-2' to make a .cm2 file"
+                    " instead.\n", line, (long)irec.epoch);
+            fclose( ofile);
+            fclose( ifile);
+            remove( ofilename);
+            exit( -1);
             }
+         fwrite( compressed, CMC1x_BINARY_RECORD_SIZE, 1, ofile);
+                  /* The result of compressing,  then decompressing a */
+                  /* record should match the original record:         */
+         memset( &irec, 0, sizeof( CMC1x_REC));
+         cmc1x_binary_rec_to_struct( &irec, compressed);
+         n_60_problems = check_record( buff, &irec, line);
+         if( n_60_problems < 0)
+            n_mismatches++;
+         else
+            n_60_problems_found += (unsigned)n_60_problems;
          }
-//    fwrite( compressed, CMC1x_BINARY_RECORD_SIZE, 1, ofile);
       output_counter++;
       if( output_counter == output_freq)
          {
@@ -138,8 +475,31 @@ int main( int argc, char **argv)
          output_counter = 0;
          }
       }
+   if( cmc2)
+      {
+      unsigned char header[CMC2_HEADER_SIZE];
+
+      if( cmc2->n_recs)
+         n_60_problems_found += write_cmc2_block( cmc2);
+      n_mismatches = cmc2->n_mismatches;
+      printf( "\n%ld bytes written\n", ftell( ofile));
+      cmc2_put_header( header, (uint32_t)line, cmc2->n_blocks);
+      fseek( ofile, 0L, SEEK_SET);
+      fwrite( header, CMC2_HEADER_SIZE, 1, ofile);
+      fwrite( cmc2->table, CMC2_TABLE_ENTRY_SIZE, cmc2->n_blocks, ofile);
+      free( cmc2->table);
+      free( cmc2);
+      }
+   fclose( ofile);
+   fclose( ifile);
    if( n_60_problems_found)
       printf( "\n%u 60-problems found (and handled)\n", n_60_problems_found);
+   if( n_mismatches)
+      {
+      printf( "\n%u records didn't decode correctly\n", n_mismatches);
+      return( -2);
+      }
+   if( build_index)
+      return( write_index( argv[1], index, next_bin, (uint32_t)line));
    return( 0);
 }
-
@@ -0,0 +1,124 @@
+#include <stdint.h>
+#include "fmt_num.h"
+
+/* See 'fmt_num.h' for what these do and why.  All of them work by
+putting the digits into a small buffer,  least significant first,
+then copying them out after whatever padding and sign are needed. */
+
+static int get_digits( char *buff, uint64_t value, const int base)
+{
+   int n = 0;
+
+   do
+      {
+      buff[n++] = "0123456789abcdef"[value % (uint64_t)base];
+      value /= (uint64_t)base;
+      }
+      while( value);
+   return( n);
+}
+
+static uint64_t abs_value( const int64_t value)
+{
+   return( value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value);
+}
+
+static char *output_padded( char *optr, const char sign, const char *digits,
+                  int n_digits, const int width, const char pad)
+{
+   int n_pad = width - n_digits - (sign ? 1 : 0);
+
+   if( pad == ' ')
+      while( n_pad-- > 0)
+         *optr++ = ' ';
+   if( sign)
+      *optr++ = sign;
+   while( n_pad-- > 0)
+      *optr++ = pad;
+   while( n_digits--)
+      *optr++ = digits[n_digits];
+   return( optr);
+}
+
+char *fmt_int( char *optr, const int64_t value, const int width)
+{
+   char buff[24];
+   const int n_digits = get_digits( buff, abs_value( value), 10);
+
+   return( output_padded( optr, (value < 0 ? '-' : '\0'), buff, n_digits,
+                              width, ' '));
+}
+
+char *fmt_int0( char *optr, const int64_t value, const int width)
+{
+   char buff[24];
+   const int n_digits = get_digits( buff, abs_value( value), 10);
+
+   return( output_padded( optr, (value < 0 ? '-' : '\0'), buff, n_digits,
+                              width, '0'));
+}
+
+char *fmt_hex0( char *optr, const uint32_t value, const int width)
+{
+   char buff[24];
+   const int n_digits = get_digits( buff, (uint64_t)value, 16);
+
+   return( output_padded( optr, '\0', buff, n_digits, width, '0'));
+}
+
+/* For fmt_fixed(),  the digits buffer gets the decimal places,  then
+the decimal point,  then the integer part (backwards,  remember).  */
+
+char *fmt_fixed( char *optr, const int64_t scaled, const int n_decimals,
+                                    const int width, const int flags)
+{
+   char buff[48];
+   uint64_t mag = abs_value( scaled);
+   int n_digits = 0, i;
+   char sign = '\0';
+
+   if( scaled < 0)
+      sign = '-';
+   else if( flags & FMT_FORCE_SIGN)
+      sign = '+';
+   if( n_decimals > 0)
+      {
+      for( i = 0; i < n_decimals; i++)
+         {
+         buff[n_digits++] = (char)( '0' + mag % 10);
+         mag /= 10;
+         }
+      buff[n_digits++] = '.';
+      }
+   n_digits += get_digits( buff + n_digits, mag, 10);
+   return( output_padded( optr, sign, buff, n_digits, width,
+                   ((flags & FMT_ZERO_PAD) ? '0' : ' ')));
+}
+
+char *fmt_mas_as_degrees( char *optr, const int64_t mas, const int width,
+                                    const int flags)
+{
+   const int64_t e8 = (int64_t)( (abs_value( mas) * 250 + 4) / 9);
+
+   return( fmt_fixed( optr, (mas < 0 ? -e8 : e8), 8, width, flags));
+}
+
+char *fmt_str( char *optr, const char *str)
+{
+   while( *str)
+      *optr++ = *str++;
+   return( optr);
+}
+
+char *fmt_spaces( char *optr, int n_spaces)
+{
+   while( n_spaces-- > 0)
+      *optr++ = ' ';
+   return( optr);
+}
+
+char *fmt_end( char *optr)
+{
+   *optr = '\0';
+   return( optr);
+}
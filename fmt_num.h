@@ -0,0 +1,52 @@
+#ifndef FMT_NUM_H_INCLUDED
+#define FMT_NUM_H_INCLUDED
+
+/* Fixed-width number formatting,  for writing out catalog records in
+ASCII.  These do the same thing as the sprintf() formats noted,  but
+without parsing a format string each time,  and return a pointer to the
+end of what was written,  so that a line can be built up without the
+usual sprintf( obuff + strlen( obuff), ...) rescanning.  Nothing is
+null-terminated until you call fmt_end().  Public domain.  Please
+contact pluto (at) projectpluto.com with comments/bug fixes.
+
+   As with sprintf(),  a value too big for its field simply makes the
+field wider.   */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+char *fmt_int( char *optr, const int64_t value, const int width);  /* %*d */
+char *fmt_int0( char *optr, const int64_t value, const int width); /* %0*d */
+char *fmt_hex0( char *optr, const uint32_t value, const int width); /* %0*x */
+
+         /* Writes 'scaled' / 10^n_decimals with n_decimals places,  as */
+         /* %*.*f would (i.e.,  the value is in units of the last digit */
+         /* shown).  'flags' can include the following :               */
+char *fmt_fixed( char *optr, const int64_t scaled, const int n_decimals,
+                                    const int width, const int flags);
+
+#define FMT_FORCE_SIGN     1        /* %+f */
+#define FMT_ZERO_PAD       2        /* %0f */
+
+         /* Writes mas/3600000 as degrees with eight places,  i.e.,     */
+         /* the same as "%*.8f" of ( (double)mas / 3600000.).  This is */
+         /* exact:  mas * 250/9 is never halfway between integers,  so  */
+         /* rounding it to the nearest integer matches what printf()   */
+         /* does with the (very slightly inexact) double value.         */
+char *fmt_mas_as_degrees( char *optr, const int64_t mas, const int width,
+                                    const int flags);
+
+char *fmt_str( char *optr, const char *str);
+char *fmt_spaces( char *optr, const int n_spaces);
+
+         /* Null-terminates the string,  returning a pointer to the '\0' */
+char *fmt_end( char *optr);
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef FMT_NUM_H_INCLUDED */
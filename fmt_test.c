@@ -0,0 +1,628 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "ucac4.h"
+#include "urat1.h"
+#include "gaia32.h"
+#include "cmc1x.h"
+
+/* Checks that the 'fmt_num.c' versions of the ASCII output functions
+for UCAC4,  URAT1,  Gaia32 and CMC-1x produce exactly the same bytes as
+the sprintf()-based versions they replaced (copied below,  with 'ref_'
+prefixed to their names),  then shows how many lines per second each
+version can produce.  Run as
+
+./fmt_test (number of random records;  default 1000000)
+
+   Half the records are realistic;  the other half are random bytes,
+to make sure odd values (negative magnitudes,  fields too wide for
+their columns,  etc.) come out the same way.  Each record is written
+with each combination of output flags.  The return value is the number
+of mismatches found,  so zero means all is well.  */
+
+/* The original functions follow.  */
+
+static int ref_write_ucac4_star_fortran_style( char *obuff, const UCAC4_STAR *star)
+{
+/*
+          WRITE (line,'(2i10,2i6,i3,i2,i3,2i4,3i3,2i6,2i7,2i4
+     .                ,i11,3i6,6i3,5i6,5i4,i2,9i2,2i3,i10,i4,i7)')
+
+ 451313731,   544918,16176,16187,12,0, 0, 58, 76, 4, 4, 2, 9762, 9709,   -47,   121,139,140, 863323727,13612,12869,12680, 5, 5, 5, 3, 3, 3,20000,20000,20000,20000,20000,  0,  0,  0,  0,  0,4,0,0,0,0,0,0,0,0,1, 0, 0,  1000284,  0,     0
+
+*/
+   int i;
+   char *tptr;
+
+   sprintf( obuff, "%10d%10d%6d%6d%3d%2d%3d%4d%4d%3d%3d%3d%6d%6d%7d%7d%4d%4d",
+        star->ra, star->spd, star->mag1, star->mag2,
+        star->mag_sigma, star->obj_type, star->double_star_flag,
+        star->ra_sigma + 128, star->dec_sigma + 128, star->n_ucac_total,
+        star->n_ucac_used, star->n_cats_used,
+        star->epoch_ra, star->epoch_dec,
+        get_actual_proper_motion( star, 0),
+        get_actual_proper_motion( star, 1),
+        get_actual_proper_motion_sigma( star->pm_ra_sigma),
+        get_actual_proper_motion_sigma( star->pm_dec_sigma));
+   sprintf( obuff + strlen( obuff), "%11d%6d%6d%6d%3d%3d%3d%3d%3d%3d",
+        star->twomass_id, star->mag_j, star->mag_h, star->mag_k,
+        star->icq_flag[0], star->icq_flag[1], star->icq_flag[2],
+        star->e2mpho[0], star->e2mpho[1], star->e2mpho[2]);
+   for( i = 0; i < 5; i++)
+      sprintf( obuff + strlen( obuff), "%6d", star->apass_mag[i]);
+   for( i = 0; i < 5; i++)
+      sprintf( obuff + strlen( obuff), "%4d", star->apass_mag_sigma[i]);
+   sprintf( obuff + strlen( obuff), "%2d ", star->yale_gc_flags);
+               /* Show catalog flags as separate digits: */
+   tptr = obuff + strlen( obuff);
+   sprintf( tptr, "%09d", star->catalog_flags);
+   for( i = 8; i >= 0; i--)
+      {
+      tptr[i + i] = tptr[i];
+      tptr[i + i + 1] = ' ';
+      }
+   tptr[17] = '\0';
+   sprintf( obuff + strlen( obuff), "%3d%3d%10d%4d%7d\n",
+       star->leda_flag, star->twomass_ext_flag,
+       star->id_number, star->ucac2_zone, star->ucac2_number);
+   return( 0);
+}
+
+static int ref_write_ucac4_star( const int zone, const long offset, char *obuff,
+                     const UCAC4_STAR *star, const int output_format)
+{
+   const long epoch_ra  = 190000 + star->epoch_ra;
+   const long epoch_dec = 190000 + star->epoch_dec;
+   int i;
+
+   if( output_format & UCAC4_FORTRAN_STYLE)
+      return( ref_write_ucac4_star_fortran_style( obuff, star));
+
+   sprintf( obuff, "%03d-%06ld %12.8lf %12.8lf %2d.%03d %2d.%03d %3d ",
+               zone, offset,
+               (double)star->ra / 3600000., (double)star->spd / 3600000. - 90.,
+               star->mag1 / 1000, abs( star->mag1 % 1000),
+               star->mag2 / 1000, abs( star->mag2 % 1000),
+               star->mag_sigma);
+
+   sprintf( obuff + strlen( obuff), "%2d %2d ",
+               star->obj_type, star->double_star_flag);
+
+   sprintf( obuff + strlen( obuff), "%4d.%02d %4d.%02d ",
+               (int)epoch_ra / 100, (int)epoch_ra % 100,
+               (int)epoch_dec / 100, (int)epoch_dec % 100);
+
+   sprintf( obuff + strlen( obuff),
+            "%3d %3d %2d %2d %2d ",
+            star->ra_sigma + 128, star->dec_sigma + 128,
+            (int)star->n_ucac_total, (int)star->n_ucac_used,
+            (int)star->n_cats_used);
+
+   if( star->pm_ra || star->pm_dec || !(output_format & UCAC4_WRITE_SPACES))
+      sprintf( obuff + strlen( obuff), "%6d %6d %3d %3d ",
+            get_actual_proper_motion( star, 0),
+            get_actual_proper_motion( star, 1),
+            get_actual_proper_motion_sigma( star->pm_ra_sigma),
+            get_actual_proper_motion_sigma( star->pm_dec_sigma));
+   else        /* no proper motion given,  keep these fields blank */
+      strcat( obuff, "                      ");
+
+   if( star->twomass_id || !(output_format & UCAC4_WRITE_SPACES))
+      {
+      sprintf( obuff + strlen( obuff),
+            "%10ld %2d.%03d %2d.%03d %2d.%03d ",
+            (long)star->twomass_id,
+            star->mag_j / 1000, abs( star->mag_j % 1000),
+            star->mag_h / 1000, abs( star->mag_h % 1000),
+            star->mag_k / 1000, abs( star->mag_k % 1000));
+
+      sprintf( obuff + strlen( obuff), "%03d %03d %03d %02d %02d %02d ",
+            star->e2mpho[0], star->e2mpho[1], star->e2mpho[2],
+            star->icq_flag[0], star->icq_flag[1], star->icq_flag[2]);
+      }
+   else        /* no 2MASS data given;  keep these fields blank */
+      {
+      memset( obuff + 116, ' ', 53);
+      obuff[169] = '\0';
+      }
+
+   for( i = 0; i < 5; i++)
+      if( (star->apass_mag[i] && star->apass_mag[i] != 20000)
+                   || !(output_format & UCAC4_WRITE_SPACES))
+         sprintf( obuff + strlen( obuff), "%2d.%03d ",
+                star->apass_mag[i] / 1000, star->apass_mag[i] % 1000);
+         else
+            strcat( obuff, "       ");
+   for( i = 0; i < 5; i++)
+      if( star->apass_mag_sigma[i] != 99
+                          || !(output_format & UCAC4_WRITE_SPACES))
+         sprintf( obuff + strlen( obuff), "%c%d.%02d ",
+                   (star->apass_mag_sigma[i] < 0 ? '-' : ' '),
+                   abs( star->apass_mag_sigma[i]) / 100,
+                   abs( star->apass_mag_sigma[i]) % 100);
+      else
+         strcat( obuff, "      ");
+
+   sprintf( obuff + strlen( obuff), "%09d", star->catalog_flags);
+   sprintf( obuff + strlen( obuff),
+            " %2d %03d %03d %9d", star->yale_gc_flags,
+            star->leda_flag, star->twomass_ext_flag, star->id_number);
+   if( star->ucac2_zone || !(output_format & UCAC4_WRITE_SPACES))
+      sprintf( obuff + strlen( obuff), " %03d-%06d\n",
+               star->ucac2_zone, star->ucac2_number);
+   else
+      strcat( obuff, "           \n");
+   return( 0);
+}
+
+static int ref_write_urat1_star_fortran_style( const int zone, const long offset,
+               char *obuff, const URAT1_STAR *star, const int output_format)
+{
+   sprintf( obuff, "%10d%10d%4d%4d%3d%4d%6d%6d%4d%3d%2d%4d%4d%4d%4d%6d%6d%4d",
+            star->ra, star->spd, star->sigs, star->sigm,    /* 10 10 4 4;  1 11 21 25 */
+            star->nst, star->nsu, star->epoc, star->mmag,   /*  3  4 6 6; 29 32 36 42 */
+            star->sigp, star->nsm, star->ref,               /*  4  3 2  ; 48 52 55 */
+            star->nit, star->niu, star->ngt, star->ngu,     /*  4  4 4 4; 57 61 65 69 */
+            star->pmr, star->pmd, star->pme);               /*  6  6 4  ; 73 79 85 */
+
+
+   sprintf( obuff + strlen( obuff),
+            "%3d%3d%11d%6d%6d%6d%5d%5d%5d%2d%2d%2d%2d%2d%2d",
+            star->mfm, star->mfa, star->id2,                /*  3  3 11; 89 92 95 */
+            star->twomass_mag[0], star->twomass_mag[1],     /* 6 6 6; 106 112 118 */
+            star->twomass_mag[2],
+            star->twomass_mag_sigma[0],                     /* 5 5 5; 124 129 134 */
+            star->twomass_mag_sigma[1],
+            star->twomass_mag_sigma[2],
+            star->icc_flag[0], star->icc_flag[1], star->icc_flag[2], /* 2 2 2: 139 141 143 */
+            star->photo_flag[0], star->photo_flag[1], star->photo_flag[2]);
+                                                                     /* 2 2 2: 145 147 149 */
+   sprintf( obuff + strlen( obuff),
+               "%6d%6d%6d%6d%6d%5d%5d%5d%5d%5d%4d%4d",
+            star->apass_mag[0],        /* 6 6 6 6 6: 151 157 163 169 175 */
+            star->apass_mag[1],
+            star->apass_mag[2],
+            star->apass_mag[3],
+            star->apass_mag[4],
+            star->apass_mag_sigma[0],  /* 5 5 5 5 5: 181 186 191 196 201 */
+            star->apass_mag_sigma[1],
+            star->apass_mag_sigma[2],
+            star->apass_mag_sigma[3],
+            star->apass_mag_sigma[4],
+            star->ann, star->ano);     /* 4 4: 206 210 (ending at 214) */
+   if( output_format & 0x8)
+      sprintf( obuff + strlen( obuff), " %03d-%06ld", zone, offset);
+
+   strcat( obuff, "\n");
+   return( 0);
+}
+
+static int ref_write_urat1_star( const int zone, const long offset, char *obuff,
+                     const URAT1_STAR *star, const int output_format)
+{
+   size_t i;
+
+   if( output_format & URAT1_FORTRAN_STYLE)
+      return( ref_write_urat1_star_fortran_style( zone, offset, obuff, star,
+                     output_format));
+
+   sprintf( obuff, "%03d-%06ld %12.8f %12.8f",
+               zone, offset,
+               (double)star->ra / 3600000., (double)star->spd / 3600000. - 90.);
+
+   sprintf( obuff + strlen( obuff), " %3d %3d %2d %2d %4d.%03d %2d.%03d %3d",
+               star->sigs, star->sigm,    /* two different posn sigmas */
+               star->nst, star->nsu,      /* total sets/n of sets used */
+               2000 + star->epoc / 1000, star->epoc % 1000,
+               star->mmag / 1000, abs( star->mmag % 1000),
+               star->sigp);
+
+   sprintf( obuff + strlen( obuff), " %2d %2d %3d %3d %2d %2d",
+               star->nsm,   /*  number of sets used for URAT magnitude  */
+               star->ref,   /*  largest reference star flag             */
+               star->nit,   /*  total number of images (observations)   */
+               star->niu,   /*  number of images used for mean position */
+               star->ngt,   /*  total number of 1st order grating obs.  */
+               star->ngu);  /*  number of 1st order grating pairs used  */
+
+   sprintf( obuff + strlen( obuff), " %5d %5d %4d %2d %2d %10d",
+        star->pmr,   /* proper motion RA*cosDec (from 2MASS)    */
+        star->pmd,   /* proper motion Dec                       */
+        star->pme,   /* proper motion error per coordinate      */
+        star->mfm,   /* match flag URAT with 2MASS              */
+        star->mfa,   /* match flag URAT with APASS              */
+        star->id2);  /* unique 2MASS star identification number */
+
+   for( i = 0; i < 3; i++)
+      sprintf( obuff + strlen( obuff), " %2u.%03u %4d %02x %02x",
+               star->twomass_mag[i] / 1000,
+               star->twomass_mag[i] % 1000,
+               star->twomass_mag_sigma[i],
+               star->icc_flag[i],
+               star->photo_flag[i]);
+
+   for( i = 0; i < 5; i++)
+      sprintf( obuff + strlen( obuff), " %2u.%03u %4d",
+               star->apass_mag[i] / 1000,
+               star->apass_mag[i] % 1000,
+               star->apass_mag_sigma[i]);
+
+   sprintf( obuff + strlen( obuff), "%2d %2d\n",
+            star->ann, star->ano);
+
+   if( output_format & URAT1_WRITE_SPACES)
+      {
+      char *tptr;
+
+      while( (tptr = strstr( obuff + 124, " 30.000 9000 00 00 ")) != NULL)
+         memset( tptr, ' ', 19);
+      while( (tptr = strstr( obuff + 124, " 30.000 9000 ")) != NULL)
+         memset( tptr, ' ', 12);
+      }
+   return( 0);
+}
+
+static int ref_write_gaia32_star( const int zone, const long offset, char *obuff,
+                     const GAIA32_STAR *star, const int output_format)
+{
+   const long epoch  = 2000000 + star->epoch;
+
+   sprintf( obuff, "%03d-%08ld ", zone, offset);
+   if( output_format & GAIA32_BASE_60)
+      {
+      const int64_t ra = (int64_t)( star->ra * 100. / 15. + .5);
+      const long dec = (long)abs( star->dec);
+
+      sprintf( obuff + 13, "%02d %02d %02d.%05d %c%02ld %02ld %02ld.%03ld",
+               (int)( ra / (int64_t)360000000),
+               (int)( ra / (int64_t)  6000000) % 60,
+               (int)( ra / (int64_t)   100000) % 60,
+               (int)( ra % (int64_t)   100000),
+               (star->dec > 0. ? '+' : '-'),
+               dec / 3600000L, (dec / 60000L) % 60L,
+               (dec / 1000L) % 60L, dec % 1000L);
+      }
+  else         /* output RA/decs in decimal degrees */
+      sprintf( obuff + 13, "%12.8lf %+012.8lf",
+               (double)star->ra / 3600000., (double)star->dec / 3600000.);
+
+   sprintf( obuff + strlen( obuff), " %2d.%03d %3d %4d.%03d %3d %3d ",
+               star->mag / 1000, abs( star->mag % 1000),
+               star->mag_sigma,
+               (int)epoch / 1000, (int)epoch % 1000,
+               star->ra_sigma + 128, star->dec_sigma + 128);
+
+   if( star->pm_ra || star->pm_dec || !(output_format & GAIA32_WRITE_SPACES))
+      sprintf( obuff + strlen( obuff), "%8d %8d %5u %5u",
+            (int)star->pm_ra, (int)star->pm_dec,
+            (unsigned)star->pm_ra_sigma, (unsigned)star->pm_dec_sigma);
+   else        /* no proper motion given,  keep these fields blank */
+      strcat( obuff, "                             ");
+
+   strcat( obuff, "\n");
+   return( 0);
+}
+
+static void ref_put_three_digits( char *buff, const int ival)
+{
+   sprintf( buff, "%2d.%03d", ival / 1000, ival % 1000);
+}
+
+static int ref_cmc1x_struct_to_ascii( char *buff, const CMC1x_REC *rec)
+{
+   const long abs_dec = abs( rec->dec);
+   int i, j;
+
+   for( i = 0; i < CMC1x_ASCII_RECORD_SIZE; i++)
+      buff[i] = ' ';
+   sprintf( buff + 16, "%02ld %02ld %02ld.%04ld ",
+            rec->ra / 36000000L, (rec->ra / 600000L) % 60L,
+            (rec->ra / 10000L) % 60L, rec->ra % 10000L);
+   sprintf( buff + 29, "  %02ld %02ld %02ld.%03ld ",
+            abs_dec / 3600000L, (abs_dec / 60000L) % 60L,
+            (abs_dec / 1000L) % 60L, abs_dec % 1000L);
+   buff[30] = (rec->dec >= 0L ? '+' : '-');
+               /* assemble identifier from RA/dec string: */
+   for( i = 0, j = 16; j < 39; j++)
+      if( buff[j] != ' ' && (j < 26 || j > 28))
+         buff[i++] = buff[j];
+   if( buff[30] == '+')
+      buff[30] = ' ';
+   ref_put_three_digits( buff + 44, rec->mag_r);
+   sprintf( buff + 50, "%3d%2d%2d", rec->n_total, rec->n_astro, rec->n_photo);
+   ref_put_three_digits( buff + 57, rec->sigma_ra);
+   ref_put_three_digits( buff + 63, rec->sigma_dec);
+   ref_put_three_digits( buff + 69, rec->sigma_mag);
+   sprintf( buff + 75, "%5d", rec->epoch);
+   ref_put_three_digits( buff + 81, rec->mag_j);
+   ref_put_three_digits( buff + 88, rec->mag_h);
+   ref_put_three_digits( buff + 95, rec->mag_ks);
+
+   for( i = 0; i < CMC1x_ASCII_RECORD_SIZE; i++)
+      if( !buff[i])
+         buff[i] = ' ';
+   if( rec->photometric_flag)
+      buff[50] = ':';
+   buff[CMC1x_ASCII_RECORD_SIZE - 1] = 10;    /* record terminates in a LF */
+   return( 0);
+}
+
+static unsigned long rand_state = 31415926;
+
+static uint32_t rand32( void)
+{
+   rand_state = rand_state * 1103515245UL + 12345UL;
+   rand_state &= 0xffffffffUL;
+   return( (uint32_t)( rand_state >> 16)
+                 ^ ((uint32_t)rand_state << 16));
+}
+
+static void random_bytes( void *data, size_t n_bytes)
+{
+   char *cptr = (char *)data;
+
+   while( n_bytes--)
+      *cptr++ = (char)rand32( );
+}
+
+static int rand_int( const int low, const int high)
+{
+   return( low + (int)( rand32( ) % (uint32_t)( high - low + 1)));
+}
+
+static void random_ucac4_star( UCAC4_STAR *star, const int realistic)
+{
+   int i;
+
+   random_bytes( star, sizeof( UCAC4_STAR));
+   if( star->pm_ra == 32767)          /* would mean a high-PM star,  but */
+      star->pm_ra = 0;                /* not one we'd find in the table */
+   if( star->pm_dec == 32767)
+      star->pm_dec = 0;
+   if( !realistic)
+      return;
+   star->ra = rand_int( 0, 360 * 3600000 - 1);
+   star->spd = rand_int( 0, 180 * 3600000);
+   star->mag1 = (uint16_t)rand_int( 7000, 20000);
+   star->mag2 = (uint16_t)rand_int( 7000, 20000);
+   star->mag_sigma = (uint8_t)rand_int( 0, 99);
+   star->obj_type = (uint8_t)rand_int( 0, 9);
+   star->double_star_flag = (uint8_t)rand_int( 0, 9);
+   star->epoch_ra = (uint16_t)rand_int( 9000, 11300);
+   star->epoch_dec = (uint16_t)rand_int( 9000, 11300);
+   if( rand32( ) & 1)
+      star->pm_ra = star->pm_dec = 0;
+   if( rand32( ) & 1)
+      star->twomass_id = 0;
+   else
+      star->twomass_id = (uint32_t)rand_int( 0, 1400000000);
+   for( i = 0; i < 3; i++)
+      {
+      star->icq_flag[i] = (uint8_t)rand_int( 0, 6);
+      star->e2mpho[i] = (uint8_t)rand_int( 0, 99);
+      }
+   for( i = 0; i < 5; i++)
+      {
+      star->apass_mag[i] = (uint16_t)( (rand32( ) & 1) ? 20000
+                                    : rand_int( 0, 19999));
+      star->apass_mag_sigma[i] = (int8_t)( (rand32( ) & 1) ? 99
+                                    : rand_int( -99, 98));
+      }
+   star->yale_gc_flags = (uint8_t)rand_int( 0, 99);
+   star->catalog_flags = (uint32_t)rand_int( 0, 999999999);
+   star->leda_flag = (uint8_t)rand_int( 0, 3);
+   star->twomass_ext_flag = (uint8_t)rand_int( 0, 9);
+   star->id_number = (uint32_t)rand_int( 1, 113780093);
+   if( rand32( ) & 1)
+      star->ucac2_zone = 0;
+   else
+      star->ucac2_zone = (uint16_t)rand_int( 1, 288);
+   star->ucac2_number = (uint32_t)rand_int( 0, 999999);
+}
+
+static void random_urat1_star( URAT1_STAR *star, const int realistic)
+{
+   int i;
+
+   random_bytes( star, sizeof( URAT1_STAR));
+   if( !realistic)
+      return;
+   star->ra = rand_int( 0, 360 * 3600000 - 1);
+   star->spd = rand_int( 0, 120 * 3600000);
+   star->sigs = (int16_t)rand_int( 0, 999);
+   star->sigm = (int16_t)rand_int( 0, 999);
+   star->epoc = (int16_t)rand_int( 12000, 15000);
+   star->mmag = (uint16_t)rand_int( 3000, 18500);
+   for( i = 0; i < 3; i++)
+      if( rand32( ) & 1)
+         {
+         star->twomass_mag[i] = 30000;
+         star->twomass_mag_sigma[i] = 9000;
+         star->icc_flag[i] = star->photo_flag[i] = 0;
+         }
+      else
+         {
+         star->twomass_mag[i] = (uint16_t)rand_int( 3000, 18000);
+         star->twomass_mag_sigma[i] = (int16_t)rand_int( 0, 999);
+         }
+   for( i = 0; i < 5; i++)
+      if( rand32( ) & 1)
+         {
+         star->apass_mag[i] = 30000;
+         star->apass_mag_sigma[i] = 9000;
+         }
+}
+
+static void random_gaia32_star( GAIA32_STAR *star, const int realistic)
+{
+   random_bytes( star, sizeof( GAIA32_STAR));
+   if( !realistic)
+      return;
+   star->ra = rand_int( 0, 360 * 3600000 - 1);
+   star->dec = rand_int( -90 * 3600000, 90 * 3600000);
+   star->epoch = (int16_t)rand_int( 14000, 16000);
+   star->mag = (uint16_t)rand_int( 3000, 21000);
+   if( rand32( ) & 1)
+      star->pm_ra = star->pm_dec = 0;
+}
+
+static void random_cmc1x_rec( CMC1x_REC *rec, const int realistic)
+{
+   random_bytes( rec, sizeof( CMC1x_REC));
+   if( !realistic)
+      return;
+   rec->ra = rand_int( 0, 24 * 36000000 - 1);
+   rec->dec = rand_int( -40 * 3600000, 50 * 3600000);
+   rec->mag_r = (int16_t)rand_int( 9000, 17000);
+   rec->epoch = (int16_t)rand_int( 0, 9000);
+   rec->n_total = (int16_t)rand_int( 0, 99);
+   rec->n_astro = (int16_t)rand_int( 0, 9);
+   rec->n_photo = (int16_t)rand_int( 0, 9);
+   rec->sigma_ra = (int16_t)rand_int( 0, 9999);
+   rec->sigma_dec = (int16_t)rand_int( 0, 9999);
+   rec->sigma_mag = (int16_t)rand_int( 0, 9999);
+   rec->mag_j = (int16_t)rand_int( 5000, 17000);
+   rec->mag_h = (int16_t)rand_int( 5000, 17000);
+   rec->mag_ks = (int16_t)rand_int( 5000, 17000);
+   rec->photometric_flag = (int8_t)( rec->n_photo == 0);
+}
+
+static int n_mismatches = 0;
+
+static void compare( const char *catalog, const int output_format,
+                     const char *ref_buff, const char *buff, const size_t len)
+{
+   if( memcmp( ref_buff, buff, len))
+      {
+      if( n_mismatches++ < 10)
+         printf( "%s mismatch (output format %d):\n%s\n%s\n",
+                 catalog, output_format, ref_buff, buff);
+      }
+}
+
+static double current_time( void)
+{
+   return( (double)clock( ) / (double)CLOCKS_PER_SEC);
+}
+
+static void show_rate( const char *catalog, const int n_lines,
+                          const double old_time, const double new_time)
+{
+   printf( "%-8s %10.0f lines/s with sprintf(),  %10.0f with fmt_num "
+           "(%.1fx)\n", catalog, (double)n_lines / old_time,
+           (double)n_lines / new_time, old_time / new_time);
+}
+
+#define N_BENCH_RECORDS 1000
+
+int main( const int argc, const char **argv)
+{
+   const int n_records = (argc > 1 ? atoi( argv[1]) : 1000000);
+   char buff[400], ref_buff[400];
+   int i, j, format;
+   double t0, old_time, new_time;
+   UCAC4_STAR *u4 = (UCAC4_STAR *)malloc( N_BENCH_RECORDS * sizeof( UCAC4_STAR));
+   URAT1_STAR *u1 = (URAT1_STAR *)malloc( N_BENCH_RECORDS * sizeof( URAT1_STAR));
+   GAIA32_STAR *g32 = (GAIA32_STAR *)malloc( N_BENCH_RECORDS * sizeof( GAIA32_STAR));
+   CMC1x_REC *cmc = (CMC1x_REC *)malloc( N_BENCH_RECORDS * sizeof( CMC1x_REC));
+
+   for( i = 0; i < n_records; i++)
+      {
+      UCAC4_STAR u4star;
+      URAT1_STAR u1star;
+      GAIA32_STAR gstar;
+      CMC1x_REC crec;
+      const int realistic = (i & 1);
+      const int zone = rand_int( 1, 900);
+      const long offset = (long)rand_int( 1, 999999);
+
+      random_ucac4_star( &u4star, realistic);
+      for( format = 0; format <= UCAC4_FORTRAN_STYLE; format += 2)
+         {
+         memset( ref_buff, 1, sizeof( ref_buff));
+         memset( buff, 1, sizeof( buff));
+         ref_write_ucac4_star( zone, offset, ref_buff, &u4star, format);
+         write_ucac4_star( zone, offset, buff, &u4star, format);
+         compare( "UCAC4", format, ref_buff, buff, strlen( ref_buff) + 1);
+         }
+      random_urat1_star( &u1star, realistic);
+      for( format = 0; format < 16; format += 2)
+         {
+         ref_write_urat1_star( zone, offset, ref_buff, &u1star, format);
+         write_urat1_star( zone, offset, buff, &u1star, format);
+         compare( "URAT1", format, ref_buff, buff, strlen( ref_buff) + 1);
+         }
+      random_gaia32_star( &gstar, realistic);
+      for( format = 0; format < 16; format += 2)
+         {
+         ref_write_gaia32_star( zone, offset, ref_buff, &gstar, format);
+         write_gaia32_star( zone, offset, buff, &gstar, format);
+         compare( "Gaia32", format, ref_buff, buff, strlen( ref_buff) + 1);
+         }
+      random_cmc1x_rec( &crec, realistic);
+      ref_cmc1x_struct_to_ascii( ref_buff, &crec);
+      cmc1x_struct_to_ascii( buff, &crec);
+      compare( "CMC-1x", 0, ref_buff, buff, CMC1x_ASCII_RECORD_SIZE);
+      }
+   printf( "%d records checked;  %d mismatches\n", n_records, n_mismatches);
+
+               /* Now for speed tests,  using realistic records : */
+   for( i = 0; i < N_BENCH_RECORDS; i++)
+      {
+      random_ucac4_star( u4 + i, 1);
+      random_urat1_star( u1 + i, 1);
+      random_gaia32_star( g32 + i, 1);
+      random_cmc1x_rec( cmc + i, 1);
+      }
+   for( format = 0; format <= UCAC4_FORTRAN_STYLE; format += UCAC4_FORTRAN_STYLE)
+      {
+      t0 = current_time( );
+      for( j = 0; j < n_records; j++)
+         ref_write_ucac4_star( 1, j, buff, u4 + j % N_BENCH_RECORDS, format);
+      old_time = current_time( ) - t0;
+      t0 = current_time( );
+      for( j = 0; j < n_records; j++)
+         write_ucac4_star( 1, j, buff, u4 + j % N_BENCH_RECORDS, format);
+      new_time = current_time( ) - t0;
+      show_rate( (format ? "UCAC4(F)" : "UCAC4"), n_records,
+                                          old_time, new_time);
+      }
+
+   t0 = current_time( );
+   for( j = 0; j < n_records; j++)
+      ref_write_urat1_star( 1, j, buff, u1 + j % N_BENCH_RECORDS, 0);
+   old_time = current_time( ) - t0;
+   t0 = current_time( );
+   for( j = 0; j < n_records; j++)
+      write_urat1_star( 1, j, buff, u1 + j % N_BENCH_RECORDS, 0);
+   new_time = current_time( ) - t0;
+   show_rate( "URAT1", n_records, old_time, new_time);
+
+   t0 = current_time( );
+   for( j = 0; j < n_records; j++)
+      ref_write_gaia32_star( 1, j, buff, g32 + j % N_BENCH_RECORDS, 0);
+   old_time = current_time( ) - t0;
+   t0 = current_time( );
+   for( j = 0; j < n_records; j++)
+      write_gaia32_star( 1, j, buff, g32 + j % N_BENCH_RECORDS, 0);
+   new_time = current_time( ) - t0;
+   show_rate( "Gaia32", n_records, old_time, new_time);
+
+   t0 = current_time( );
+   for( j = 0; j < n_records; j++)
+      ref_cmc1x_struct_to_ascii( buff, cmc + j % N_BENCH_RECORDS);
+   old_time = current_time( ) - t0;
+   t0 = current_time( );
+   for( j = 0; j < n_records; j++)
+      cmc1x_struct_to_ascii( buff, cmc + j % N_BENCH_RECORDS);
+   new_time = current_time( ) - t0;
+   show_rate( "CMC-1x", n_records, old_time, new_time);
+
+   free( u4);
+   free( u1);
+   free( g32);
+   free( cmc);
+   return( n_mismatches);
+}
@@ -3,6 +3,8 @@
 #include <assert.h>
 #include <stdlib.h>
 #include "gaia32.h"
+#include "fmt_num.h"
+#include "out_sink.h"
 
 /* Basic access functions for Dave Tholen's Gaia32 data.  Please
 contact pluto (at) projectpluto.com with comments/bug fixes.
@@ -55,40 +57,74 @@ int write_gaia32_star( const int zone, const long offset, char *obuff,
                      const GAIA32_STAR *star, const int output_format)
 {
    const long epoch  = 2000000 + star->epoch;
+   char *optr = obuff;
 
-   sprintf( obuff, "%03d-%08ld ", zone, offset);
+   optr = fmt_int0( optr, zone, 3);
+   *optr++ = '-';
+   optr = fmt_int0( optr, offset, 8);
+   *optr++ = ' ';
+   optr = obuff + 13;      /* RA/dec always start in column 13 */
    if( output_format & GAIA32_BASE_60)
       {
       const int64_t ra = (int64_t)( star->ra * 100. / 15. + .5);
       const long dec = (long)abs( star->dec);
 
-      sprintf( obuff + 13, "%02d %02d %02d.%05d %c%02ld %02ld %02ld.%03ld",
-               (int)( ra / (int64_t)360000000),
-               (int)( ra / (int64_t)  6000000) % 60,
-               (int)( ra / (int64_t)   100000) % 60,
-               (int)( ra % (int64_t)   100000),
-               (star->dec > 0. ? '+' : '-'),
-               dec / 3600000L, (dec / 60000L) % 60L,
-               (dec / 1000L) % 60L, dec % 1000L);
+      optr = fmt_int0( optr, (int)( ra / (int64_t)360000000), 2);
+      *optr++ = ' ';
+      optr = fmt_int0( optr, (int)( ra / (int64_t)  6000000) % 60, 2);
+      *optr++ = ' ';
+      optr = fmt_int0( optr, (int)( ra / (int64_t)   100000) % 60, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, (int)( ra % (int64_t)   100000), 5);
+      *optr++ = ' ';
+      *optr++ = (star->dec > 0. ? '+' : '-');
+      optr = fmt_int0( optr, dec / 3600000L, 2);
+      *optr++ = ' ';
+      optr = fmt_int0( optr, (dec / 60000L) % 60L, 2);
+      *optr++ = ' ';
+      optr = fmt_int0( optr, (dec / 1000L) % 60L, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, dec % 1000L, 3);
       }
   else         /* output RA/decs in decimal degrees */
-      sprintf( obuff + 13, "%12.8lf %+012.8lf",
-               (double)star->ra / 3600000., (double)star->dec / 3600000.);
+      {
+      optr = fmt_mas_as_degrees( optr, star->ra, 12, 0);
+      *optr++ = ' ';
+      optr = fmt_mas_as_degrees( optr, star->dec, 12,
+                                  FMT_FORCE_SIGN | FMT_ZERO_PAD);
+      }
 
-   sprintf( obuff + strlen( obuff), " %2d.%03d %3d %4d.%03d %3d %3d ",
-               star->mag / 1000, abs( star->mag % 1000),
-               star->mag_sigma,
-               (int)epoch / 1000, (int)epoch % 1000,
-               star->ra_sigma + 128, star->dec_sigma + 128);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mag / 1000, 2);
+   *optr++ = '.';
+   optr = fmt_int0( optr, abs( star->mag % 1000), 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mag_sigma, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, (int)epoch / 1000, 4);
+   *optr++ = '.';
+   optr = fmt_int0( optr, (int)epoch % 1000, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->ra_sigma + 128, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->dec_sigma + 128, 3);
+   *optr++ = ' ';
 
    if( star->pm_ra || star->pm_dec || !(output_format & GAIA32_WRITE_SPACES))
-      sprintf( obuff + strlen( obuff), "%8d %8d %5u %5u",
-            (int)star->pm_ra, (int)star->pm_dec,
-            (unsigned)star->pm_ra_sigma, (unsigned)star->pm_dec_sigma);
+      {
+      optr = fmt_int( optr, star->pm_ra, 8);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->pm_dec, 8);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->pm_ra_sigma, 5);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->pm_dec_sigma, 5);
+      }
    else        /* no proper motion given,  keep these fields blank */
-      strcat( obuff, "                             ");
+      optr = fmt_spaces( optr, 29);
 
-   strcat( obuff, "\n");
+   *optr++ = '\n';
+   fmt_end( optr);
    return( 0);
 }
 
@@ -308,39 +344,71 @@ int extract_gaia32_stars_callback( void *context,
 
 typedef struct
    {
-   FILE *ofile;
+   out_sink_t *sink;
    int output_format;
-   } file_output_t;
+   int err;
+   } sink_output_t;
+
+/* Once the sink fails,  further stars are dropped,  and we return its
+(sticky) error;  flush_sink() of a failed sink just returns that. */
 
 static int output_a_gaia32_star( void *context, const int zone,
                const uint32_t offset, GAIA32_STAR *star)
 {
-   file_output_t *f = (file_output_t *)context;
+   sink_output_t *f = (sink_output_t *)context;
 
-   if( f->ofile)
+   if( f->sink)
       {
       if( f->output_format & GAIA32_RAW_BINARY)
-         fwrite( star, 1, sizeof( GAIA32_STAR), f->ofile);
+         f->err = sink_write( f->sink, star, sizeof( GAIA32_STAR));
       else
          {
-         char buff[GAIA32_ASCII_SIZE];
+         char *buff = sink_reserve( f->sink, GAIA32_ASCII_SIZE);
 
-         write_gaia32_star( zone, offset + 1, buff, star,
-                                       f->output_format);
-         fwrite( buff, 1, strlen( buff), f->ofile);
+         if( buff)
+            {
+            write_gaia32_star( zone, offset + 1, buff, star,
+                                          f->output_format);
+            sink_commit( f->sink, strlen( buff));
+            }
+         else
+            f->err = flush_sink( f->sink);
          }
       }
-   return( 0);
+   return( f->err);
+}
+
+int extract_gaia32_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int output_format)
+{
+   sink_output_t f;
+   int rval;
+
+   f.sink = sink;
+   f.output_format = output_format;
+   f.err = 0;
+   rval = extract_gaia32_stars_callback( &f, output_a_gaia32_star,
+                             ra, dec, width, height, path);
+   return( f.err ? f.err : rval);
 }
 
 int extract_gaia32_stars( FILE *ofile, const double ra, const double dec,
                   const double width, const double height, const char *path,
                   const int output_format)
 {
-   file_output_t f;
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = GAIA32_ALLOC_FAILED;
 
-   f.ofile = ofile;
-   f.output_format = output_format;
-   return( extract_gaia32_stars_callback( &f, output_a_gaia32_star,
-                             ra, dec, width, height, path));
+   if( sink || !ofile)
+      rval = extract_gaia32_stars_to_sink( sink, ra, dec, width, height,
+                                           path, output_format);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
+      }
+   return( rval);
 }
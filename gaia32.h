@@ -6,6 +6,7 @@ Public domain.  Please contact pluto (at) projectpluto.com with
 comments/bug fixes.  */
 
 #include <stdint.h>
+#include "out_sink.h"
 
       /* Raw structures are read herein,  so the following structure  */
       /* must be packed on byte boundaries:                           */
@@ -57,6 +58,12 @@ int extract_gaia32_stars_callback( void *context,
                   const double ra, const double dec,
                   const double width, const double height, const char *path);
 
+         /* Same,  except output goes to an 'out_sink_t' ('out_sink.h'), */
+         /* which can write to a file descriptor,  memory,  or callback. */
+int extract_gaia32_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int output_format);
+
 int extract_gaia32_info( const int zone, const long offset, GAIA32_STAR *star,
                      const char *path);
 int write_gaia32_star_fortran_style( char *obuff, const GAIA32_STAR *star);
@@ -25,25 +25,163 @@ static void get_cmc1x_ra_dec( long *ra, long *dec, const char *buff)
 }
 
 /* extract_cmc1x_stars( ),  shown below,  handles both ASCII and binary
-cmc-1x records.  If the input record is binary,  xvt_record( ) converts it
-back to ASCII.   */
+cmc-1x records.  For searching and filtering,  we only need the RA/dec,
+which we can get straight from a binary record.  Only records we're
+actually going to output are converted back to ASCII,  by ascii_record(). */
 
-static void xvt_record( char *tbuff, const int record_size)
+static void get_record_ra_dec( long *ra, long *dec, const char *buff,
+                                       const int record_size)
+{
+   if( record_size == CMC1x_BINARY_RECORD_SIZE)
+      cmc1x_binary_rec_ra_dec( ra, dec, buff);
+   else
+      get_cmc1x_ra_dec( ra, dec, buff);
+}
+
+static const char *ascii_record( char *obuff, const char *buff,
+                                       const int record_size)
 {
    if( record_size == CMC1x_BINARY_RECORD_SIZE)
       {
       CMC1x_REC star;
 
-      cmc1x_binary_rec_to_struct( &star, tbuff);
-      cmc1x_struct_to_ascii( tbuff, &star);
+      cmc1x_binary_rec_to_struct( &star, buff);
+      cmc1x_struct_to_ascii( obuff, &star);
+      return( obuff);
+      }
+   return( buff);
+}
+
+#define CMC1x_BUFFSIZE 400      /* read this many records at a try */
+
+/* If the zone has an index (see 'cmc1x.h'),  we can get the range of
+records covering the RA bin containing 'ra_start',  and only search
+within that.  The index has the same name as the zone file,  but with
+extension .idx.  If there's no index,  or it doesn't look right,  we
+return -1 and search the whole zone,  as we always used to.  */
+
+static int get_index_range( const char *zone_filename, const long ra_start,
+                  const int n_recs, int *loc, int *end_loc)
+{
+   char filename[180];
+   unsigned char buff[8];
+   const size_t len = strlen( zone_filename);
+   long bin = ra_start / CMC1x_INDEX_BIN_SIZE;
+   int rval = -1;
+   FILE *ifile;
+
+   if( bin >= CMC1x_INDEX_RA_BINS)
+      bin = CMC1x_INDEX_RA_BINS - 1;
+   if( len < 4 || len >= sizeof( filename))
+      return( -1);
+   strcpy( filename, zone_filename);
+   strcpy( filename + len - 4, ".idx");
+   ifile = fopen( filename, "rb");
+   if( ifile)
+      {
+      if( !fseek( ifile, bin * 4L, SEEK_SET) && fread( buff, 8, 1, ifile))
+         {           /* entries are little-endian on all platforms */
+         *loc = (int)( buff[0] | (buff[1] << 8) | (buff[2] << 16)
+                                  | ((uint32_t)buff[3] << 24));
+         *end_loc = (int)( buff[4] | (buff[5] << 8) | (buff[6] << 16)
+                                  | ((uint32_t)buff[7] << 24));
+         if( *loc >= 0 && *loc <= *end_loc && *end_loc <= n_recs)
+            rval = 0;
+         }
+      fclose( ifile);
       }
+   return( rval);
+}
+
+/* 'Version 2' (.cm2) files are read a block at a time.  The block
+table gives the RA of the first star in each block,  so we search that
+for the last block starting before 'ra_start' (in case stars at exactly
+that RA spill back into it),  then decode blocks from there until we're
+past 'ra_end'.  As with the other formats,  a bad or unreadable file
+just gives no stars.  */
+
+static int extract_cmc2_zone( FILE *ifile, out_sink_t *sink,
+                  const long ra_start, const long ra_end,
+                  const long dec_start, const long dec_end)
+{
+   unsigned char header[CMC2_HEADER_SIZE], *table, *block;
+   uint32_t n_recs, n_blocks, lo = 0, hi, end_offset;
+   int32_t ra[CMC2_BLOCK_RECS], dec[CMC2_BLOCK_RECS];
+   int rval = 0, done = 0;
+
+   if( !fread( header, CMC2_HEADER_SIZE, 1, ifile)
+               || cmc2_get_header( header, &n_recs, &n_blocks) || !n_blocks)
+      return( 0);
+   table = (unsigned char *)malloc( n_blocks * CMC2_TABLE_ENTRY_SIZE
+                                          + CMC2_MAX_BLOCK_SIZE);
+   if( !table || fread( table, CMC2_TABLE_ENTRY_SIZE, n_blocks,
+                                          ifile) != n_blocks)
+      done = 1;
+   block = table + n_blocks * CMC2_TABLE_ENTRY_SIZE;
+   fseek( ifile, 0L, SEEK_END);
+   end_offset = (uint32_t)ftell( ifile);
+   hi = n_blocks;
+   while( !done && hi - lo > 1)
+      {
+      const uint32_t mid = (lo + hi) / 2;
+      uint32_t offset;
+      int32_t first_ra;
+
+      cmc2_get_table_entry( table + mid * CMC2_TABLE_ENTRY_SIZE,
+                                          &offset, &first_ra);
+      if( first_ra < ra_start)
+         lo = mid;
+      else
+         hi = mid;
+      }
+   while( !done && lo < n_blocks)
+      {
+      const int n_in_block = (lo == n_blocks - 1 ?
+                  (int)( n_recs - lo * CMC2_BLOCK_RECS) : CMC2_BLOCK_RECS);
+      uint32_t offset, next_offset = end_offset;
+      int32_t first_ra;
+      int block_size, i;
+
+      cmc2_get_table_entry( table + lo * CMC2_TABLE_ENTRY_SIZE,
+                                          &offset, &first_ra);
+      if( lo < n_blocks - 1)
+         cmc2_get_table_entry( table + (lo + 1) * CMC2_TABLE_ENTRY_SIZE,
+                                          &next_offset, &first_ra);
+      block_size = (int)( next_offset - offset);
+      if( block_size < 0 || block_size > CMC2_MAX_BLOCK_SIZE
+               || fseek( ifile, (long)offset, SEEK_SET)
+               || !fread( block, block_size, 1, ifile)
+               || cmc2_decode_ra_dec( ra, dec, block, n_in_block, block_size))
+         done = 1;
+      for( i = 0; !done && i < n_in_block; i++)
+         if( ra[i] >= ra_end)
+            done = 1;
+         else if( ra[i] >= ra_start && dec[i] > dec_start
+                                    && dec[i] < dec_end)
+            {        /* This record falls in the RA/dec rectangle: */
+            if( sink)
+               {
+               char tbuff[103];
+               CMC1x_REC rec;
+
+               cmc2_decode_record( &rec, block, i, ra[i]);
+               cmc1x_struct_to_ascii( tbuff, &rec);
+               sink_write( sink, tbuff, CMC1x_ASCII_RECORD_SIZE);
+               }
+            rval++;
+            }
+      lo++;
+      }
+   free( table);
+   return( rval);
 }
 
 /* extract_cmc1x_stars() finds all CMC-1x stars within the specified RA/dec
 rectangle,  and writes out the ASCII records for them to the specified
-output file.  It will do this from either the ASCII or binary files;
-in either case,  the ASCII record is written out.  It defaults to looking
-for the cmc1x*.dat or cmc1x*.cmc files in the current directory,  then
+output file.  It will do this from either the ASCII or binary files
+(including the 'version 2' .cm2 ones);  in any case,  the ASCII record is
+written out.  It defaults to looking for the cmc1x*.cm2,  cmc1x*.cmc,
+or cmc1x*.dat files in the current directory,  then
 looks for them in the directory specified by 'path'.  If the 'rejected'
 flag is TRUE,  then it will search the 'rejected star' files instead of
 the main catalog files.
@@ -68,7 +206,8 @@ projects past RA=0 or RA=24 hours=360 degrees.  If so,  recurse with a
 suitably shifted RA.
 */
 
-int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
+int extract_cmc1x_stars_to_sink( out_sink_t *sink,
+                  const double ra_in_degrees,
                   const double dec_in_degrees,
                   const double width_in_degrees,
                   const double height_in_degrees,
@@ -88,10 +227,14 @@ int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
    const long dec_start = (long)( dec1 * 1000. * 3600);
    const long dec_end = (long)( dec2 * 1000. * 3600);
    char tbuff[103];
+   char *buff = (char *)malloc( CMC1x_BUFFSIZE * CMC1x_ASCII_RECORD_SIZE);
    int record_size = 0;
    int rval = 0, pass;
+   char filename[180];
    const char *path_separator = "/", *read_only_permits = "r";
 
+   if( !buff)
+      return( -1);
    if( zone < 0)
       zone = 0;
    if( ra_start < 0)
@@ -107,22 +250,19 @@ int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
          sprintf( base_name, "cmc15n%x", zone - 19);
       if( rejected)
          strcat( base_name, "r");
-                  /* Look for eight different possible incarnations of the */
-                  /* CMC-14 and CMC-15 data:                               */
-                  /* (1) CMC-15,  binary,  current path;                   */
-                  /* (2) CMC-15,  ASCII,  current path;                    */
-                  /* (3) CMC-15,  binary,  path specified in 'path' param; */
-                  /* (4) CMC-15,  ASCII,  path specified in 'path' param;  */
-                  /* (5) CMC-14,  binary,  current path;                   */
-                  /* (6) CMC-14,  ASCII,  current path;                    */
-                  /* (7) CMC-14,  binary,  path specified in 'path' param; */
-                  /* (8) CMC-14,  ASCII,  path specified in 'path' param.  */
-      for( pass = 0; !ifile && pass < 8; pass++)
+                  /* Look for twelve different possible incarnations of */
+                  /* the CMC-14 and CMC-15 data:                         */
+                  /* (1) CMC-15,  version 2 binary,  current path;       */
+                  /* (2) CMC-15,  binary,  current path;                 */
+                  /* (3) CMC-15,  ASCII,  current path;                  */
+                  /* (4-6) same,  path specified in 'path' param;        */
+                  /* (7-12) same as 1-6,  but for CMC-14.                */
+      for( pass = 0; !ifile && pass < 12; pass++)
          {
-         char filename[180];
+         const int file_type = pass % 3;
 
-         base_name[4] = ((pass & 4) ? '4' : '5');  /* select CMC-15 vs. 14 */
-         if( (pass & 3) < 2 || !path)     /* search local path */
+         base_name[4] = ((pass >= 6) ? '4' : '5');  /* select CMC-15 vs. 14 */
+         if( !((pass / 3) & 1) || !path)  /* search local path */
             *filename = '\0';
          else                             /* search specified path */
             {
@@ -132,60 +272,81 @@ int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
             }
          strcat( filename, base_name);
                   /* ASCII files are assumed to have extension .dat.    */
-                  /* Binary files are assumed to have extension .cmc.   */
-         strcat( filename, (pass & 1) ? ".cmc" : ".dat");
+                  /* Binary files are assumed to have extension .cmc,   */
+                  /* or .cm2 for the 'version 2' format.                */
+         strcat( filename, file_type == 0 ? ".cm2" :
+                          (file_type == 1 ? ".cmc" : ".dat"));
          ifile = fopen( filename, read_only_permits);
          if( ifile)
-            record_size = ((pass & 1) ? CMC1x_BINARY_RECORD_SIZE :
-                                        CMC1x_ASCII_RECORD_SIZE);
+            record_size = (file_type == 0 ? 0 :
+                              (file_type == 1 ? CMC1x_BINARY_RECORD_SIZE :
+                                                CMC1x_ASCII_RECORD_SIZE));
          }
                   /* Failure to find a file is _not_ an error condition. */
                   /* Could be,  for example,  we're outside the CMC-1x   */
                   /* coverage area (decs -30 to +50).                    */
-      if( ifile)
+      if( ifile && !record_size)      /* 'version 2' file */
+         {
+         rval += extract_cmc2_zone( ifile, sink, ra_start, ra_end,
+                                          dec_start, dec_end);
+         fclose( ifile);
+         }
+      else if( ifile)
          {
-         int n_recs, loc = 0, loc1, step;
+         int n_recs, loc = 0, end_loc, loc1, step, n_read, i;
          long ra, dec;
 
          fseek( ifile, 0L, SEEK_END);
          n_recs = ftell( ifile) / record_size;
-                        /* Do a binary search on the zone file,  to find  */
-                        /* the first record with ra >= ra_start.          */
+         if( get_index_range( filename, ra_start, n_recs, &loc, &end_loc))
+            {
+            loc = 0;
+            end_loc = n_recs;
+            }
+                        /* Do a binary search on the zone file (or the   */
+                        /* part of it the index says to look in) to find */
+                        /* the first record with ra >= ra_start.         */
          for( step = 0x8000000; step; step >>= 1)
-            if( (loc1 = loc + step) < n_recs)
+            if( (loc1 = loc + step) < end_loc)
                {
                fseek( ifile, loc1 * record_size, SEEK_SET);
                if( fread( tbuff, record_size, 1, ifile) != 1)
                   {
                   fclose( ifile);
+                  free( buff);
                   return( 0);
                   }
-               xvt_record( tbuff, record_size);
-               get_cmc1x_ra_dec( &ra, NULL, tbuff);
+               get_record_ra_dec( &ra, NULL, tbuff, record_size);
                if( ra < ra_start)
                   loc = loc1;
                }
                      /* Now seek to that record,  and start reading records */
-                     /* until we've gone past the RA region of interest.    */
-                     /* If the records fall within the RA/dec rectangle,    */
-                     /* write out the result to 'ofile'.                    */
+                     /* (CMC1x_BUFFSIZE at a time) until we've gone past    */
+                     /* the RA region of interest.  If the records fall     */
+                     /* within the RA/dec rectangle,  write out the result  */
+                     /* to 'ofile'.                                         */
          fseek( ifile, loc * record_size, SEEK_SET);
          ra = 0;
-         while( ra < ra_end &&
-                         fread( tbuff, record_size, 1, ifile))
-            {
-            xvt_record( tbuff, record_size);
-            get_cmc1x_ra_dec( &ra, &dec, tbuff);
-            if( ra >= ra_start && ra < ra_end && dec > dec_start && dec < dec_end)
-               {        /* This record falls in the RA/dec rectangle: */
-               fwrite( tbuff, CMC1x_ASCII_RECORD_SIZE, 1, ofile);
-               rval++;
+         while( ra < ra_end && (n_read = (int)fread( buff, record_size,
+                                            CMC1x_BUFFSIZE, ifile)) > 0)
+            for( i = 0; i < n_read && ra < ra_end; i++)
+               {
+               const char *rec = buff + i * record_size;
+
+               get_record_ra_dec( &ra, &dec, rec, record_size);
+               if( ra >= ra_start && ra < ra_end && dec > dec_start && dec < dec_end)
+                  {        /* This record falls in the RA/dec rectangle: */
+                  if( sink)
+                     sink_write( sink, ascii_record( tbuff, rec, record_size),
+                                       CMC1x_ASCII_RECORD_SIZE);
+                  rval++;
+                  }
                }
-            }
          fclose( ifile);
          }
       zone++;
       }
+   free( buff);
 
             /* If the area to be extracted crosses RA=0 or RA=24,  we */
             /* recurse to pick up the data on the "other side" of the */
@@ -193,14 +354,38 @@ int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
    if( rval >= 0 && ra_in_degrees > 0. && ra_in_degrees < 360.)
       {
       if( ra1 < 0.)      /* left side crosses over RA=0h */
-         rval += extract_cmc1x_stars( ofile, ra_in_degrees+360., dec_in_degrees,
+         rval += extract_cmc1x_stars_to_sink( sink, ra_in_degrees+360.,
+                                    dec_in_degrees,
                                     width_in_degrees, height_in_degrees,
                                     path, rejected);
       if( ra2 > 360.)    /* right side crosses over RA=24h */
-         rval += extract_cmc1x_stars( ofile, ra_in_degrees-360., dec_in_degrees,
+         rval += extract_cmc1x_stars_to_sink( sink, ra_in_degrees-360.,
+                                    dec_in_degrees,
                                     width_in_degrees, height_in_degrees,
                                     path, rejected);
       }
    return( rval);
 }
 
+int extract_cmc1x_stars( FILE *ofile, const double ra_in_degrees,
+                  const double dec_in_degrees,
+                  const double width_in_degrees,
+                  const double height_in_degrees,
+                  const char *path, const int rejected)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = -1;
+
+   if( sink || !ofile)
+      rval = extract_cmc1x_stars_to_sink( sink, ra_in_degrees,
+                  dec_in_degrees, width_in_degrees, height_in_degrees,
+                  path, rejected);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
+      }
+   return( rval);
+}
@@ -0,0 +1,102 @@
+#include <math.h>
+#include <assert.h>
+#include "healpix.h"
+
+/* Basic HEALPix functions,  following the algorithms of Gorski et al.,
+2005,  ApJ 622, 759 (and the HEALPix C++ library).  Only the NESTED
+scheme,  and only what's needed to bin stars into pixels,  are here. */
+
+#define PI 3.1415926535897932384626433832795028841971693993751058209749445923
+
+int64_t healpix_n_pixels( const int order)
+{
+   return( (int64_t)12 << (2 * order));
+}
+
+/* Interleaves the bits of an x or y coordinate within a base pixel;
+i.e.,  bit n of 'ival' becomes bit 2n of the return value. */
+
+static int64_t spread_bits( const int32_t ival)
+{
+   int64_t rval = 0, bit = 1;
+   int i;
+
+   for( i = 0; i < 30; i++, bit <<= 2)
+      if( (ival >> i) & 1)
+         rval |= bit;
+   return( rval);
+}
+
+static int64_t xyf2nest( const int order, const int32_t ix,
+                           const int32_t iy, const int face_num)
+{
+   return( ((int64_t)face_num << (2 * order))
+                  + spread_bits( ix) + (spread_bits( iy) << 1));
+}
+
+int64_t healpix_zphi2pix_nest( const int order, const double z,
+                                                const double phi)
+{
+   const int32_t nside = (int32_t)1 << order;
+   const double za = fabs( z);
+   double tt = fmod( phi * 2. / PI, 4.);    /* in [0,4) */
+
+   assert( order >= 0 && order <= HEALPIX_MAX_ORDER);
+   if( tt < 0.)
+      tt += 4.;
+   if( za <= 2. / 3.)         /* equatorial region */
+      {
+      const double temp1 = nside * (.5 + tt);
+      const double temp2 = nside * z * .75;
+      const int32_t jp = (int32_t)( temp1 - temp2);  /* ascending edge line */
+      const int32_t jm = (int32_t)( temp1 + temp2);  /* descending edge line */
+      const int32_t ifp = jp >> order, ifm = jm >> order;
+      const int face_num = (ifp == ifm ? (ifp | 4) :
+                                 (ifp < ifm ? ifp : ifm + 8));
+
+      return( xyf2nest( order, jm & (nside - 1),
+                        nside - (jp & (nside - 1)) - 1, face_num));
+      }
+   else                       /* polar caps */
+      {
+      const int ntt = (tt >= 3. ? 3 : (int)tt);
+      const double tp = tt - (double)ntt;
+      const double tmp = (double)nside * sqrt( 3. * (1. - za));
+      int32_t jp = (int32_t)( tp * tmp);
+      int32_t jm = (int32_t)( (1. - tp) * tmp);
+
+      if( jp >= nside)
+         jp = nside - 1;
+      if( jm >= nside)
+         jm = nside - 1;
+      if( z >= 0.)
+         return( xyf2nest( order, nside - jm - 1, nside - jp - 1, ntt));
+      else
+         return( xyf2nest( order, jp, jm, ntt + 8));
+      }
+}
+
+int64_t healpix_ang2pix_nest( const int order, const double ra,
+                                               const double dec)
+{
+   return( healpix_zphi2pix_nest( order, sin( dec), ra));
+}
+
+void healpix_degrade_nest( int32_t *coarse, const int32_t *fine,
+                                 const int fine_order, const int flags)
+{
+   int64_t i;
+   const int64_t n_coarse = healpix_n_pixels( fine_order - 1);
+
+   assert( fine_order > 0);
+   for( i = 0; i < n_coarse; i++, fine += 4)
+      {
+      const int64_t sum = (int64_t)fine[0] + (int64_t)fine[1]
+                            + (int64_t)fine[2] + (int64_t)fine[3];
+
+      if( !(flags & HEALPIX_MAP_STAR_COUNTS))
+         coarse[i] = (int32_t)( (sum + 2) / 4);
+      else        /* counts can't realistically overflow,  but just in case: */
+         coarse[i] = (int32_t)( sum > INT32_MAX ? INT32_MAX : sum);
+      }
+}
@@ -0,0 +1,62 @@
+#ifndef HEALPIX_H_INCLUDED
+#define HEALPIX_H_INCLUDED
+
+/* Just enough HEALPix to bin the sky into equal-area pixels in the
+NESTED scheme,  which is what 'bright.c' uses for its multi-resolution
+sky maps.  Public domain.  Please contact pluto (at) projectpluto.com
+with comments/bug fixes.
+
+   HEALPix divides the sky into twelve base pixels,  each of which is
+divided into nside x nside pixels,  for 12 * nside^2 pixels of equal
+area.  Herein,  nside is always a power of two,  nside = 2^order.  In
+the NESTED scheme,  the four pixels at order n+1 that make up pixel p
+at order n are numbered 4p through 4p+3.  So going to a coarser level
+is just a matter of shifting the pixel index right by two bits,  and
+building the coarser levels of a map is simply a matter of combining
+each four consecutive pixels.  */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+#define HEALPIX_MAX_ORDER 13
+
+int64_t healpix_n_pixels( const int order);
+
+         /* RA and dec are in radians.  The 'zphi' version takes      */
+         /* z = sin( dec) and phi = RA (radians),  for callers who've */
+         /* already computed the sine.                                */
+int64_t healpix_ang2pix_nest( const int order, const double ra,
+                                               const double dec);
+int64_t healpix_zphi2pix_nest( const int order, const double z,
+                                               const double phi);
+
+         /* Fills in the order-1 map from the order map.  If 'flags'  */
+         /* includes HEALPIX_MAP_STAR_COUNTS,  each coarse pixel is the */
+         /* sum of its four children,  so it's still a star count.     */
+         /* Otherwise it's their mean,  so all levels are in the same  */
+         /* units (i.e.,  per finest-level pixel area).  'coarse' and   */
+         /* 'fine' may be the same array.                              */
+void healpix_degrade_nest( int32_t *coarse, const int32_t *fine,
+                                 const int fine_order, const int flags);
+
+/* HEALPix map files ('bright.hpx',  written by 'bright.c') consist of
+a header of four 32-bit integers:  HEALPIX_MAP_MAGIC;  the finest order
+in the file;  the number of levels stored;  and flags (currently only
+HEALPIX_MAP_STAR_COUNTS,  set if stars were counted rather than having
+their brightnesses summed.)  The levels follow,  finest first,  each
+being healpix_n_pixels( order) 32-bit integers in NESTED order.  Coarser
+levels are made with healpix_degrade_nest(),  so star counts are true
+counts at every level,  while brightnesses are per finest-level pixel.  */
+
+#define HEALPIX_MAP_MAGIC          0x68707831
+#define HEALPIX_MAP_STAR_COUNTS    1
+#define HEALPIX_MAP_HEADER_SIZE    (4 * sizeof( int32_t))
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef HEALPIX_H_INCLUDED */
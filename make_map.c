@@ -3,6 +3,7 @@
 #include <stdint.h>
 #include <assert.h>
 #include <math.h>
+#include "smooth.h"
 
 /* This reads in the sky brightness map created from Gaia-DR2 data
 using 'bright.c' (q.v.),  and writes out a .pbm (portable bitmap)
@@ -13,65 +14,70 @@ image from it. Run,  e.g.,
 to get a visually interesting result.  This is used to make the
 'bright2.pgm' image used by Find_Orb to estimate galactic confusion. The
 same result could also be used (and,  I expect,  will eventually get
-used) in computing the background sky brightness in 'vislimit.cpp'.  */
+used) in computing the background sky brightness in 'vislimit.cpp'.
+
+   An optional third argument gives a number of passes of a [1 2 1]/4
+blur,  as before.  '-g(sigma)' or '-b(radius)' select a Gaussian or box
+blur instead,  with sizes in pixels (and can't be combined with a number
+of passes);  '-t(n)' runs the smoothing in n threads.  See 'smooth.c'
+for details.  */
 
 #define XSIZE 3600
 #define YSIZE 1800
 #define PI 3.1415926535897932384626433832795028841971693993751058209749445923
 
-/* Thought it might help to 'blur' the image with a low-pass filter.
-I'm no longer so sure of this.  */
-
-static void low_pass_horizontal( int32_t *iline, const int len)
-{
-   const int32_t new_start = (iline[0] * 2 + iline[1] + iline[len - 1]) >> 2;
-   const int32_t new_end = (iline[len - 1] * 2 + iline[0] + iline[len - 2]) >> 2;
-   int i;
-   int32_t saved_value = *iline;
-
-   for( i = 1; i < len; i++)
-      {
-      const int32_t new_value =
-               (iline[i] * 2 + iline[i - 1] + saved_value) >> 2;
-
-      saved_value = iline[i];
-      iline[i] = new_value;
-      }
-   iline[0] = new_start;
-   iline[len - 1] = new_end;
-}
-
-static void low_pass_vertical( int32_t *iline, const int xsize, const int ysize)
-{
-   int32_t *last = iline + xsize * (ysize - 1);
-   const int32_t new_start = (*iline * 2 + iline[xsize] + *last) >> 2;
-   const int32_t new_end = (*last * 2 + last[-xsize] * *iline) >> 2;
-   int i;
-   int32_t saved_value = *iline;
-
-   for( i = 1; i < ysize; i++)
-      {
-      const int32_t new_value =
-               (iline[i * xsize] * 2 + iline[(i - 1) * xsize] + saved_value) >> 2;
-
-      saved_value = iline[i * xsize];
-      iline[i * xsize] = new_value;
-      }
-   iline[0] = new_start;
-   *last = new_end;
-}
-
 int main( const int argc, const char **argv)
 {
    FILE *ifile = fopen( "bright.zq", "rb");
    int32_t *ivals = (int32_t *)calloc( XSIZE * YSIZE, sizeof( int32_t));
-   int i, y;
-   const int scale = atoi( argv[1]);
-   const int offset = atoi( argv[2]);
+   int i, y, n_args = 0, n_threads = 1;
+   int kernel_type = SMOOTH_BINOMIAL;
+   double kernel_size = 0.;
+   const char *args[3];
+   int scale, offset;
    size_t n_read;
-   FILE *ofile = fopen( "bright.pgm", "wb");
+   FILE *ofile;
    int n_high = 0, n_low = 0;
 
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] > '9')
+         switch( argv[i][1])
+            {
+            case 'g':
+               kernel_type = SMOOTH_GAUSSIAN;
+               kernel_size = atof( argv[i] + 2);
+               break;
+            case 'b':
+               kernel_type = SMOOTH_BOX;
+               kernel_size = atof( argv[i] + 2);
+               break;
+            case 't':
+               n_threads = atoi( argv[i] + 2);
+               break;
+            default:
+               printf( "%s is an unrecognized option\n", argv[i]);
+               return( -1);
+            }
+      else if( n_args < 3)
+         args[n_args++] = argv[i];
+   if( n_args < 2)
+      {
+      printf( "Usage:  make_map (scale) (offset) [passes] [-g(sigma)]"
+                        " [-b(radius)] [-t(threads)]\n");
+      return( -1);
+      }
+   scale = atoi( args[0]);
+   offset = atoi( args[1]);
+   if( n_args > 2)
+      {
+      if( kernel_type != SMOOTH_BINOMIAL)
+         {
+         printf( "Give either a number of passes or -g/-b,  not both\n");
+         return( -1);
+         }
+      kernel_size = atof( args[2]);
+      }
+   ofile = fopen( "bright.pgm", "wb");
    assert( ifile);
    assert( ofile);
    assert( ivals);
@@ -79,14 +85,17 @@ int main( const int argc, const char **argv)
    assert( n_read == XSIZE * YSIZE);
    fclose( ifile);
 
-   if( argc > 3)
-      for( i = 0; i < atoi( argv[3]); i++)
+   if( kernel_size > 0.)
+      {
+      const int err = smooth_map( ivals, XSIZE, YSIZE, kernel_type,
+                                    kernel_size, n_threads);
+
+      if( err)
          {
-         for( y = 0; y < YSIZE; y++)
-            low_pass_horizontal( ivals + y * XSIZE, XSIZE);
-         for( i = 0; i < XSIZE; i++)
-            low_pass_vertical( ivals + i, XSIZE, YSIZE);
+         printf( "Smoothing failed : error %d\n", err);
+         return( -1);
          }
+      }
 
    fprintf( ofile, "P5\n%d %d\n255\n", XSIZE, YSIZE);
    for( y = YSIZE - 1; y >= 0; y--)
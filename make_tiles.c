@@ -0,0 +1,286 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include <pthread.h>
+
+/* Makes an image pyramid from the sky brightness map 'bright.zq' (see
+'bright.c'),  for the benefit of chart software that wants to show only
+part of the sky at a time.  Run as,  e.g.,
+
+./make_tiles 20 200
+
+   The two arguments are the same scale and offset used by 'make_map',
+and the full-resolution level of the pyramid is (to within rounding) the
+image 'make_map' would produce without blurring :  north up,  RA
+increasing to the left.  Each following level is half the size of the
+one before it,  each pixel being the average of a 2x2 block of pixels in
+the level above.  Levels are made until the whole sky fits in a single
+tile.
+
+   Each level is cut into (by default) 256x256 tiles,  written as
+'tile_Z_ROW_COL.pgm',  where Z=0 is the coarsest level and row 0 is
+the northernmost.  Tiles at the right and bottom edges may be smaller.
+Options are :
+
+   -p(prefix)  Use (prefix) instead of 'tile' in file names.  This can
+               include a directory,  e.g.,  '-ptiles/sky'.
+   -s(size)    Use tiles of (size) x (size) pixels.
+   -t(n)       Write tiles using n threads (default 4).
+
+   The levels are kept as floats,  and only rounded when written out,
+so that rounding errors don't pile up as we go down the pyramid.   */
+
+#define XSIZE 3600
+#define YSIZE 1800
+#define PI 3.1415926535897932384626433832795028841971693993751058209749445923
+
+typedef struct
+   {
+   float *pixels;
+   int xsize, ysize;
+   } level_t;
+
+typedef struct
+   {
+   const level_t *levels;
+   int n_levels;
+   int tile_size;
+   const char *prefix;
+   pthread_mutex_t mutex;
+   int next_tile, n_tiles, n_failed;
+   } tile_job_t;
+
+/* Halves an image,  averaging 2x2 blocks.  If a dimension is odd,  the
+last row/column is made from the pixels that exist. */
+
+static int downsample( level_t *out, const level_t *in)
+{
+   int x, y;
+
+   out->xsize = (in->xsize + 1) / 2;
+   out->ysize = (in->ysize + 1) / 2;
+   out->pixels = (float *)malloc( (size_t)out->xsize * (size_t)out->ysize
+                                       * sizeof( float));
+   if( !out->pixels)
+      return( -1);
+   for( y = 0; y < out->ysize; y++)
+      {
+      const float *row0 = in->pixels + (size_t)( 2 * y) * in->xsize;
+      const float *row1 = (2 * y + 1 < in->ysize ? row0 + in->xsize : row0);
+      float *optr = out->pixels + (size_t)y * out->xsize;
+
+      for( x = 0; x < in->xsize / 2; x++)
+         optr[x] = .25f * (row0[2 * x] + row0[2 * x + 1]
+                         + row1[2 * x] + row1[2 * x + 1]);
+      if( in->xsize & 1)
+         optr[x] = .5f * (row0[2 * x] + row1[2 * x]);
+      }
+   return( 0);
+}
+
+/* Writes one tile.  'tile_idx' counts tiles over all levels,  starting
+with the full-resolution one,  so we first find the level/row/column. */
+
+static int write_tile( const tile_job_t *job, int tile_idx)
+{
+   const int tile_size = job->tile_size;
+   const level_t *level = job->levels;
+   int z = 0, n_across, n_down, row, col, x, y, xsize, ysize;
+   char filename[256];
+   uint8_t *obuff;
+   FILE *ofile;
+
+   for( ;;)
+      {
+      n_across = (level->xsize + tile_size - 1) / tile_size;
+      n_down   = (level->ysize + tile_size - 1) / tile_size;
+      if( tile_idx < n_across * n_down)
+         break;
+      tile_idx -= n_across * n_down;
+      level++;
+      z++;
+      }
+   row = tile_idx / n_across;
+   col = tile_idx % n_across;
+   xsize = level->xsize - col * tile_size;
+   ysize = level->ysize - row * tile_size;
+   if( xsize > tile_size)
+      xsize = tile_size;
+   if( ysize > tile_size)
+      ysize = tile_size;
+   snprintf( filename, sizeof( filename), "%s_%d_%d_%d.pgm", job->prefix,
+                  job->n_levels - 1 - z, row, col);
+   ofile = fopen( filename, "wb");
+   if( !ofile)
+      return( -1);
+   obuff = (uint8_t *)malloc( xsize);
+   if( !obuff)
+      {
+      fprintf( stderr, "Out of memory\n");
+      exit( -3);
+      }
+   fprintf( ofile, "P5\n%d %d\n255\n", xsize, ysize);
+   for( y = 0; y < ysize; y++)
+      {
+      const float *iptr = level->pixels
+                  + (size_t)( row * tile_size + y) * level->xsize
+                  + col * tile_size;
+
+      for( x = 0; x < xsize; x++)
+         obuff[x] = (uint8_t)( iptr[x] + .5f);
+      fwrite( obuff, 1, xsize, ofile);
+      }
+   free( obuff);
+   fclose( ofile);
+   return( 0);
+}
+
+static void *tile_thread( void *arg)
+{
+   tile_job_t *job = (tile_job_t *)arg;
+
+   for( ;;)
+      {
+      int tile_idx, err;
+
+      pthread_mutex_lock( &job->mutex);
+      tile_idx = job->next_tile++;
+      pthread_mutex_unlock( &job->mutex);
+      if( tile_idx >= job->n_tiles)
+         return( NULL);
+      err = write_tile( job, tile_idx);
+      if( err)
+         {
+         pthread_mutex_lock( &job->mutex);
+         job->n_failed++;
+         pthread_mutex_unlock( &job->mutex);
+         }
+      }
+}
+
+#define MAX_LEVELS 20
+#define MAX_THREADS 64
+
+int main( const int argc, const char **argv)
+{
+   FILE *ifile = fopen( "bright.zq", "rb");
+   int32_t *ivals;
+   level_t levels[MAX_LEVELS];
+   pthread_t threads[MAX_THREADS];
+   tile_job_t job;
+   int i, x, y, n_args = 0, n_threads = 4, n_levels = 1;
+   const char *args[2];
+   double scale, offset;
+
+   job.tile_size = 256;
+   job.prefix = "tile";
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] > '9')
+         switch( argv[i][1])
+            {
+            case 'p':
+               job.prefix = argv[i] + 2;
+               break;
+            case 's':
+               job.tile_size = atoi( argv[i] + 2);
+               break;
+            case 't':
+               n_threads = atoi( argv[i] + 2);
+               break;
+            default:
+               printf( "%s is an unrecognized option\n", argv[i]);
+               return( -1);
+            }
+      else if( n_args < 2)
+         args[n_args++] = argv[i];
+   if( n_args < 2 || job.tile_size < 1)
+      {
+      fprintf( stderr, "Usage : make_tiles (scale) (offset) [-p(prefix)]"
+                       " [-s(tile size)] [-t(threads)]\n");
+      return( -1);
+      }
+   if( !ifile)
+      {
+      fprintf( stderr, "Couldn't open 'bright.zq'\n");
+      return( -2);
+      }
+   if( n_threads < 1)
+      n_threads = 1;
+   if( n_threads > MAX_THREADS)
+      n_threads = MAX_THREADS;
+   scale = atof( args[0]);
+   offset = atof( args[1]);
+   ivals = (int32_t *)malloc( XSIZE * YSIZE * sizeof( int32_t));
+   levels[0].xsize = XSIZE;
+   levels[0].ysize = YSIZE;
+   levels[0].pixels = (float *)malloc( XSIZE * YSIZE * sizeof( float));
+   if( !ivals || !levels[0].pixels)
+      {
+      fprintf( stderr, "Out of memory\n");
+      return( -3);
+      }
+   if( fread( ivals, sizeof( int32_t), XSIZE * YSIZE, ifile) != XSIZE * YSIZE)
+      {
+      fprintf( stderr, "'bright.zq' is too short\n");
+      return( -2);
+      }
+   fclose( ifile);
+            /* Same stretch as in 'make_map',  flipped so north is up */
+            /* and RA increases to the left :                        */
+   for( y = 0; y < YSIZE; y++)
+      {
+      const int32_t *tptr = ivals + (YSIZE - 1 - y) * XSIZE;
+      const double dec = (double)( (YSIZE / 2 - 1 - y) + .5) * PI
+                                                   / (double)YSIZE;
+      const double cos_dec = cos( dec);
+      float *optr = levels[0].pixels + y * XSIZE;
+
+      for( x = 0; x < XSIZE; x++)
+         {
+         double oval = 255. * (double)(tptr[XSIZE - 1 - x] - offset)
+                                                  / (scale * cos_dec);
+
+         if( oval > 255.)
+            oval = 255.;
+         else if( oval < 0.)
+            oval = 0.;
+         optr[x] = (float)oval;
+         }
+      }
+   free( ivals);
+   job.n_tiles = 1;
+   while( levels[n_levels - 1].xsize > job.tile_size
+               || levels[n_levels - 1].ysize > job.tile_size)
+      {
+      const level_t *prev = levels + n_levels - 1;
+
+      job.n_tiles += ((prev->xsize + job.tile_size - 1) / job.tile_size)
+                   * ((prev->ysize + job.tile_size - 1) / job.tile_size);
+      if( n_levels == MAX_LEVELS || downsample( levels + n_levels, prev))
+         {
+         fprintf( stderr, "Out of memory\n");
+         return( -3);
+         }
+      n_levels++;
+      }
+   job.levels = levels;
+   job.n_levels = n_levels;
+   job.next_tile = job.n_failed = 0;
+   pthread_mutex_init( &job.mutex, NULL);
+   for( i = 0; i < n_threads; i++)
+      if( pthread_create( threads + i, NULL, tile_thread, &job))
+         break;
+   if( !i)                 /* couldn't start any threads;  do it ourselves */
+      tile_thread( &job);
+   while( i--)
+      pthread_join( threads[i], NULL);
+   pthread_mutex_destroy( &job.mutex);
+   printf( "%d levels,  %d tiles written\n", n_levels,
+                     job.n_tiles - job.n_failed);
+   if( job.n_failed)
+      printf( "%d tiles couldn't be written\n", job.n_failed);
+   for( i = 0; i < n_levels; i++)
+      free( levels[i].pixels);
+   return( job.n_failed ? -4 : 0);
+}
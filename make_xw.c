@@ -0,0 +1,594 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "ucac4.h"
+#include "urat1.h"
+#include "ucac3.h"
+#include "ucac2.h"
+#include "tmass_xw.h"
+
+/* Makes the 2MASS-keyed crosswalk described in 'tmass_xw.h'.  Run as
+
+./make_xw ucac4=(path) urat1=(path) ucac3=(path) ucac2=(path) -o(file)
+
+   Give paths only for the catalogs you have;  the others will simply
+have zero locations in the output.  Each catalog is read through once,
+in its own thread,  so the total time is about that for reading the
+largest catalog (UCAC4,  9 GBytes).  Every star with a 2MASS ID goes
+into an array of (ID, location) pairs,  packed into uint64_ts so they
+sort on ID;  the sorted arrays are then merged to make the output.  That
+does take some memory :  eight bytes a star,  or about 2.4 GBytes if you
+have all four catalogs.  The output defaults to 'tmass_xw.bin'.  After
+writing,  the file is read back and its checksum verified;  a sample of
+records is looked up with the functions in 'tmass_xw.c';  and the stars
+they point to are read from the catalogs,  to make sure they have the
+right 2MASS IDs.  Run as
+
+./make_xw -v (file) ucac4=(path) ...
+
+   to just verify an existing file (the catalog paths are optional;
+catalogs not given aren't checked).
+
+   A few 2MASS IDs appear twice within the same catalog (a 2MASS source
+matched to two stars).  Only the first (lowest zone and offset) is kept,
+and the number of such duplicates is shown.  */
+
+static const char *catalog_names[TMASS_XW_N_CATALOGS] = {
+                   "ucac4", "urat1", "ucac3", "ucac2" };
+static const int n_zones[TMASS_XW_N_CATALOGS] = { 900, 900, 360, 288 };
+
+typedef struct
+   {
+   int catalog;
+   const char *path;
+   uint64_t *pairs;
+   size_t n_pairs, n_alloced;
+   long n_stars, n_zones_read;
+   int err;
+   } xw_thread_t;
+
+static int add_pair( xw_thread_t *t, const uint32_t tmass_id, const int zone,
+                     const uint32_t offset)
+{
+   if( !tmass_id)
+      return( 0);
+   if( t->n_pairs == t->n_alloced)
+      {
+      const size_t new_size = (t->n_alloced ? t->n_alloced * 2 : 1 << 20);
+      uint64_t *new_pairs = (uint64_t *)realloc( t->pairs,
+                                           new_size * sizeof( uint64_t));
+
+      if( !new_pairs)
+         {
+         t->err = -1;
+         return( -1);
+         }
+      t->pairs = new_pairs;
+      t->n_alloced = new_size;
+      }
+   t->pairs[t->n_pairs++] = ((uint64_t)tmass_id << 32)
+                                 | TMASS_XW_LOC( zone, offset + 1);
+   return( 0);
+}
+
+static int add_ucac4( void *context, const int zone, const uint32_t offset,
+                      const UCAC4_STAR *star)
+{
+   return( add_pair( (xw_thread_t *)context, star->twomass_id, zone, offset));
+}
+
+static int add_urat1( void *context, const int zone, const uint32_t offset,
+                      const URAT1_STAR *star)
+{
+   return( add_pair( (xw_thread_t *)context, (uint32_t)star->id2, zone, offset));
+}
+
+static int add_ucac3( void *context, const int zone, const uint32_t offset,
+                      const UCAC3_STAR *star)
+{
+   return( add_pair( (xw_thread_t *)context, (uint32_t)star->twomass_id,
+                                 zone, offset));
+}
+
+static int add_ucac2( void *context, const int zone, const uint32_t offset,
+                      const UCAC2_STAR *star)
+{
+   return( add_pair( (xw_thread_t *)context, (uint32_t)star->twomass_id,
+                                 zone, offset));
+}
+
+static int compare_uint64( const void *a, const void *b)
+{
+   const uint64_t a1 = *(const uint64_t *)a, b1 = *(const uint64_t *)b;
+
+   return( a1 > b1 ? 1 : (a1 < b1 ? -1 : 0));
+}
+
+static void *read_catalog( void *arg)
+{
+   xw_thread_t *t = (xw_thread_t *)arg;
+   ucac4_catalog_t *cat = NULL;
+   int zone;
+
+   if( t->catalog == TMASS_XW_UCAC4)
+      {
+      cat = open_ucac4_catalog( t->path);
+      if( !cat)
+         return( NULL);
+      }
+   for( zone = 1; zone <= n_zones[t->catalog] && !t->err; zone++)
+      {
+      int n_found = 0;
+
+      switch( t->catalog)
+         {
+         case TMASS_XW_UCAC4:
+            n_found = for_each_ucac4_star_in_zone( cat, zone, t, add_ucac4);
+            break;
+         case TMASS_XW_URAT1:
+            n_found = for_each_urat1_star_in_zone( zone, t->path, t, add_urat1);
+            break;
+         case TMASS_XW_UCAC3:
+            n_found = for_each_ucac3_star_in_zone( zone, t->path, t, add_ucac3);
+            break;
+         case TMASS_XW_UCAC2:
+            n_found = for_each_ucac2_star_in_zone( zone, t->path, t, add_ucac2);
+            break;
+         }
+      if( n_found >= 0)
+         {
+         t->n_stars += n_found;
+         t->n_zones_read++;
+         }
+      }
+   if( cat)
+      close_ucac4_catalog( cat);
+   qsort( t->pairs, t->n_pairs, sizeof( uint64_t), compare_uint64);
+   return( NULL);
+}
+
+/* Checks that the lookup functions in 'tmass_xw.c' find a sample of
+the records (at most about MAX_CHECKED of them),  and don't find IDs that
+aren't there,  both one at a time and in bulk (in scrambled order).  If
+we've been given paths to the catalogs,  we also look up each sampled
+star in each catalog and make sure it has the right 2MASS ID.  Returns
+the number of problems found,  or -1 if memory ran out.  */
+
+#define MAX_CHECKED     100000
+
+typedef union     /* big enough for a star from any of the catalogs */
+   {
+   UCAC4_STAR ucac4;
+   URAT1_STAR urat1;
+   UCAC3_STAR ucac3;
+   UCAC2_STAR ucac2;
+   } any_star_t;
+
+static long check_catalog_locations( const tmass_xw_rec_t *recs,
+                  const size_t n_recs, const xw_thread_t *t)
+{
+   int *zones = (int *)malloc( n_recs * sizeof( int) + 1);
+   long *offsets = (long *)malloc( n_recs * sizeof( long) + 1);
+   uint32_t *ids = (uint32_t *)malloc( n_recs * sizeof( uint32_t) + 1);
+   char *stars = (char *)malloc( n_recs * sizeof( any_star_t) + 1);
+   long n_bad = 0;
+   int cat_num;
+
+   if( !zones || !offsets || !ids || !stars)
+      n_bad = -1;
+   for( cat_num = 0; n_bad >= 0 && cat_num < TMASS_XW_N_CATALOGS; cat_num++)
+      if( t[cat_num].path)
+         {
+         size_t i, n = 0;
+         int rval = -1;
+
+         for( i = 0; i < n_recs; i++)
+            if( recs[i].loc[cat_num])
+               {
+               zones[n] = (int)TMASS_XW_ZONE( recs[i].loc[cat_num]);
+               offsets[n] = (long)TMASS_XW_OFFSET( recs[i].loc[cat_num]);
+               ids[n++] = recs[i].tmass_id;
+               }
+         switch( cat_num)
+            {
+            case TMASS_XW_UCAC4:
+               {
+               ucac4_catalog_t *cat = open_ucac4_catalog( t[cat_num].path);
+
+               if( cat)
+                  {
+                  rval = extract_ucac4_info_bulk( cat, n, zones, offsets,
+                                    (UCAC4_STAR *)stars, NULL);
+                  close_ucac4_catalog( cat);
+                  }
+               }
+               break;
+            case TMASS_XW_URAT1:
+               rval = extract_urat1_info_bulk( n, zones, offsets,
+                              (URAT1_STAR *)stars, NULL, t[cat_num].path);
+               break;
+            case TMASS_XW_UCAC3:
+               rval = extract_ucac3_info_bulk( n, zones, offsets,
+                              (UCAC3_STAR *)stars, NULL, t[cat_num].path);
+               break;
+            case TMASS_XW_UCAC2:
+               for( i = 0; i < n; i++)
+                  offsets[i] = ucac2_star_number( zones[i], offsets[i]);
+               rval = extract_ucac2_info_bulk( n, offsets,
+                              (UCAC2_STAR *)stars, NULL, t[cat_num].path);
+               break;
+            }
+         if( rval < 0)
+            {
+            fprintf( stderr, "Couldn't read %s\n", catalog_names[cat_num]);
+            n_bad++;
+            }
+         for( i = 0; rval >= 0 && i < n; i++)
+            {
+            uint32_t id = 0;
+
+            switch( cat_num)
+               {
+               case TMASS_XW_UCAC4:
+                  id = ((const UCAC4_STAR *)stars)[i].twomass_id;
+                  break;
+               case TMASS_XW_URAT1:
+                  id = (uint32_t)((const URAT1_STAR *)stars)[i].id2;
+                  break;
+               case TMASS_XW_UCAC3:
+                  id = (uint32_t)((const UCAC3_STAR *)stars)[i].twomass_id;
+                  break;
+               case TMASS_XW_UCAC2:
+                  id = (uint32_t)((const UCAC2_STAR *)stars)[i].twomass_id;
+                  break;
+               }
+            if( id != ids[i])
+               {
+               fprintf( stderr, "2MASS %lu : %s star has 2MASS ID %lu\n",
+                        (unsigned long)ids[i], catalog_names[cat_num],
+                        (unsigned long)id);
+               n_bad++;
+               }
+            }
+         printf( "%lu %s locations checked\n", (unsigned long)n,
+                                                catalog_names[cat_num]);
+         }
+   free( zones);
+   free( offsets);
+   free( ids);
+   free( stars);
+   return( n_bad);
+}
+
+static long check_lookups( const char *filename, const tmass_xw_rec_t *recs,
+                  const size_t n_recs, const xw_thread_t *t)
+{
+   tmass_xw_t *xw = open_tmass_xw( filename);
+   const size_t step = n_recs / MAX_CHECKED + 1;
+   const size_t n_sample = (n_recs + step - 1) / step;
+   tmass_xw_rec_t *sample, *results;
+   uint32_t *ids;
+   size_t i, n_ids = 0, n_found = 0;
+   long n_bad = 0;
+
+   if( !xw)
+      {
+      fprintf( stderr, "open_tmass_xw() couldn't open '%s'\n", filename);
+      return( 1);
+      }
+   if( get_tmass_xw_n_records( xw) != n_recs)
+      {
+      fprintf( stderr, "get_tmass_xw_n_records() is wrong\n");
+      n_bad++;
+      }
+   sample = (tmass_xw_rec_t *)malloc( n_sample * sizeof( tmass_xw_rec_t) + 1);
+   results = (tmass_xw_rec_t *)malloc( 3 * n_sample * sizeof( tmass_xw_rec_t) + 1);
+   ids = (uint32_t *)malloc( 3 * n_sample * sizeof( uint32_t) + 1);
+   if( !sample || !results || !ids)
+      n_bad = -1;
+   for( i = 0; n_bad >= 0 && i < n_recs; i += step)
+      {
+      const uint32_t id = recs[i].tmass_id;
+      const tmass_xw_rec_t *rec = find_tmass_xw( xw, id);
+
+      sample[i / step] = recs[i];
+      if( !rec || memcmp( rec, recs + i, sizeof( tmass_xw_rec_t)))
+         {
+         fprintf( stderr, "find_tmass_xw() didn't find %lu\n",
+                           (unsigned long)id);
+         n_bad++;
+         }
+      ids[n_ids++] = id;
+      if( id > 0 && (!i || recs[i - 1].tmass_id != id - 1))
+         ids[n_ids++] = id - 1;        /* these shouldn't be found */
+      if( id < 0xffffffffu
+               && (i == n_recs - 1 || recs[i + 1].tmass_id != id + 1))
+         ids[n_ids++] = id + 1;
+      }
+   srand( 1);
+   for( i = n_ids; i > 1; i--)        /* scramble the order */
+      {
+      const size_t j = (size_t)rand( ) % i;
+      const uint32_t tval = ids[i - 1];
+
+      ids[i - 1] = ids[j];
+      ids[j] = tval;
+      }
+   if( n_bad >= 0
+         && find_tmass_xw_bulk( xw, n_ids, ids, results) != (long)n_sample)
+      {
+      fprintf( stderr, "find_tmass_xw_bulk() found the wrong number\n");
+      n_bad++;
+      }
+   for( i = 0; n_bad >= 0 && i < n_ids; i++)
+      {
+      const tmass_xw_rec_t *rec = find_tmass_xw( xw, ids[i]);
+
+      if( rec)
+         n_found++;
+      if( rec ? memcmp( rec, results + i, sizeof( tmass_xw_rec_t))
+              : results[i].tmass_id != 0)
+         {
+         fprintf( stderr, "find_tmass_xw_bulk() differs for %lu\n",
+                           (unsigned long)ids[i]);
+         n_bad++;
+         }
+      }
+   if( n_bad >= 0 && n_found != n_sample)
+      {
+      fprintf( stderr, "find_tmass_xw() found IDs that aren't there\n");
+      n_bad++;
+      }
+   if( n_bad >= 0)
+      printf( "%lu lookups checked (%lu not in the crosswalk)\n",
+                  (unsigned long)n_ids, (unsigned long)( n_ids - n_sample));
+   if( n_bad >= 0)
+      {
+      const long n_bad_locs = check_catalog_locations( sample, n_sample, t);
+
+      n_bad = (n_bad_locs < 0 ? -1 : n_bad + n_bad_locs);
+      }
+   close_tmass_xw( xw);
+   free( sample);
+   free( results);
+   free( ids);
+   return( n_bad);
+}
+
+/* Reads back a crosswalk and checks its header and checksum,  then
+checks that lookups work (see above).  Returns 0 if all is well. */
+
+static int verify_xw( const char *filename, const xw_thread_t *t)
+{
+   FILE *ifile = fopen( filename, "rb");
+   uint32_t header[8];
+   tmass_xw_rec_t *recs = NULL;
+   int rval = 0;
+
+   if( !ifile)
+      {
+      fprintf( stderr, "Couldn't open '%s'\n", filename);
+      return( -1);
+      }
+   if( fread( header, sizeof( uint32_t), 8, ifile) != 8
+               || header[0] != TMASS_XW_MAGIC
+               || header[1] != TMASS_XW_VERSION
+               || header[3] != TMASS_XW_N_CATALOGS)
+      {
+      fprintf( stderr, "'%s' has a bad header\n", filename);
+      rval = -3;
+      }
+   else if( (recs = (tmass_xw_rec_t *)malloc( header[2] * sizeof( tmass_xw_rec_t) + 1)) == NULL)
+      {
+      fprintf( stderr, "Out of memory\n");
+      rval = -5;
+      }
+   else if( fread( recs, sizeof( tmass_xw_rec_t), header[2], ifile) != header[2])
+      {
+      fprintf( stderr, "'%s' is too short\n", filename);
+      rval = -2;
+      }
+   else if( header[4] != tmass_xw_checksum( recs, header[2]))
+      {
+      fprintf( stderr, "'%s' has a bad checksum\n", filename);
+      rval = -4;
+      }
+   else
+      {
+      uint32_t i;
+
+      for( i = 1; i < header[2] && !rval; i++)
+         if( recs[i].tmass_id <= recs[i - 1].tmass_id)
+            {
+            fprintf( stderr, "'%s' isn't sorted (record %lu)\n", filename,
+                                 (unsigned long)i);
+            rval = -6;
+            }
+      if( !rval && check_lookups( filename, recs, (size_t)header[2], t))
+         rval = -7;
+      }
+   fclose( ifile);
+   free( recs);
+   return( rval);
+}
+
+/* Merges the sorted (ID, location) arrays into records,  writing them out
+in blocks as we go.  Returns the number of records written;  the header
+(written first as a placeholder) is then rewritten with the real counts.  */
+
+#define OUT_BLOCK 4096
+
+static long merge_and_write( FILE *ofile, xw_thread_t *t,
+                             uint32_t *checksum, long *n_dups)
+{
+   size_t idx[TMASS_XW_N_CATALOGS];
+   tmass_xw_rec_t block[OUT_BLOCK];
+   const uint32_t header[8] = { 0 };
+   size_t n_in_block = 0;
+   long n_written = 0;
+   int i;
+
+   fwrite( header, sizeof( uint32_t), 8, ofile);
+   memset( idx, 0, sizeof( idx));
+   *n_dups = 0;
+   *checksum = tmass_xw_checksum( NULL, 0);
+   while( 1)
+      {
+      uint32_t lowest = 0;
+      int any_left = 0;
+      tmass_xw_rec_t *rec = block + n_in_block;
+
+      for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+         if( idx[i] < t[i].n_pairs)
+            {
+            const uint32_t id = (uint32_t)( t[i].pairs[idx[i]] >> 32);
+
+            if( !any_left || id < lowest)
+               lowest = id;
+            any_left = 1;
+            }
+      if( any_left)
+         {
+         rec->tmass_id = lowest;
+         for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+            {
+            rec->loc[i] = 0;
+            while( idx[i] < t[i].n_pairs
+                     && (uint32_t)( t[i].pairs[idx[i]] >> 32) == lowest)
+               {
+               if( rec->loc[i])
+                  (*n_dups)++;
+               else
+                  rec->loc[i] = (uint32_t)t[i].pairs[idx[i]];
+               idx[i]++;
+               }
+            }
+         n_in_block++;
+         }
+      if( n_in_block == OUT_BLOCK || (!any_left && n_in_block))
+         {
+         size_t j;
+
+               /* checksum must match tmass_xw_checksum() over the whole */
+               /* file,  so we continue it record by record :            */
+         for( j = 0; j < n_in_block; j++)
+            {
+            *checksum ^= block[j].tmass_id;
+            *checksum *= 16777619u;
+            for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+               {
+               *checksum ^= block[j].loc[i];
+               *checksum *= 16777619u;
+               }
+            }
+         fwrite( block, sizeof( tmass_xw_rec_t), n_in_block, ofile);
+         n_written += (long)n_in_block;
+         n_in_block = 0;
+         }
+      if( !any_left)
+         break;
+      }
+   return( n_written);
+}
+
+int main( const int argc, const char **argv)
+{
+   const char *output_filename = "tmass_xw.bin", *verify_filename = NULL;
+   xw_thread_t t[TMASS_XW_N_CATALOGS];
+   pthread_t threads[TMASS_XW_N_CATALOGS];
+   uint32_t header[8];
+   FILE *ofile;
+   int i, j, n_catalogs = 0;
+   long n_recs, n_dups;
+
+   memset( t, 0, sizeof( t));
+   for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+      t[i].catalog = i;
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] == 'o')
+         output_filename = (argv[i][2] ? argv[i] + 2 : argv[++i]);
+      else if( argv[i][0] == '-' && argv[i][1] == 'v')
+         verify_filename = (argv[i][2] ? argv[i] + 2 : argv[++i]);
+      else
+         {
+         for( j = 0; j < TMASS_XW_N_CATALOGS; j++)
+            {
+            const size_t len = strlen( catalog_names[j]);
+
+            if( !memcmp( argv[i], catalog_names[j], len) && argv[i][len] == '=')
+               t[j].path = argv[i] + len + 1;
+            }
+         }
+   if( verify_filename)
+      {
+      if( verify_xw( verify_filename, t))
+         return( -1);
+      printf( "'%s' is a valid crosswalk\n", verify_filename);
+      return( 0);
+      }
+   for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+      if( t[i].path)
+         n_catalogs++;
+   if( !n_catalogs || !output_filename)
+      {
+      fprintf( stderr, "Usage : make_xw ucac4=(path) urat1=(path) ucac3=(path)"
+                       " ucac2=(path) -o(output file)\n"
+                       "  (give paths only for the catalogs you have)\n"
+                       "    or  make_xw -v (crosswalk file to verify)"
+                       " [catalog paths]\n");
+      return( -1);
+      }
+   for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+      if( t[i].path && pthread_create( threads + i, NULL, read_catalog, t + i))
+         {
+         fprintf( stderr, "Couldn't create thread\n");
+         return( -2);
+         }
+   for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+      if( t[i].path)
+         {
+         pthread_join( threads[i], NULL);
+         if( t[i].err)
+            {
+            fprintf( stderr, "Out of memory reading %s\n", catalog_names[i]);
+            return( -3);
+            }
+         printf( "%s : %ld zones,  %ld stars,  %lu with 2MASS IDs\n",
+                  catalog_names[i], t[i].n_zones_read, t[i].n_stars,
+                  (unsigned long)t[i].n_pairs);
+         if( !t[i].n_zones_read)
+            fprintf( stderr, "No %s data found in '%s'\n", catalog_names[i],
+                           t[i].path);
+         }
+   ofile = fopen( output_filename, "wb");
+   if( !ofile)
+      {
+      fprintf( stderr, "Couldn't create '%s'\n", output_filename);
+      return( -4);
+      }
+   memset( header, 0, sizeof( header));
+   n_recs = merge_and_write( ofile, t, header + 4, &n_dups);
+   for( i = 0; i < TMASS_XW_N_CATALOGS; i++)
+      free( t[i].pairs);
+   header[0] = TMASS_XW_MAGIC;
+   header[1] = TMASS_XW_VERSION;
+   header[2] = (uint32_t)n_recs;
+   header[3] = TMASS_XW_N_CATALOGS;
+   fseek( ofile, 0L, SEEK_SET);
+   fwrite( header, sizeof( uint32_t), 8, ofile);
+   if( fclose( ofile))
+      {
+      fprintf( stderr, "Error writing '%s'\n", output_filename);
+      return( -5);
+      }
+   if( n_dups)
+      printf( "%ld duplicate 2MASS IDs within a catalog;  first kept\n",
+                        n_dups);
+   if( verify_xw( output_filename, t))
+      return( -6);
+   printf( "'%s' written and verified :  %ld 2MASS IDs\n",
+               output_filename, n_recs);
+   return( 0);
+}
@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "mem_map.h"
+
+#if defined( _WIN32) || defined( _WIN64)
+#include <windows.h>
+
+/* The view keeps the mapping (and the file) open,  so both handles can
+be closed right away;  UnmapViewOfFile() then releases everything.  */
+
+const void *map_file_into_memory( const char *filename, size_t *size)
+{
+   HANDLE file = CreateFileA( filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+   LARGE_INTEGER file_size;
+   const void *rval = NULL;
+
+   if( file == INVALID_HANDLE_VALUE)
+      return( NULL);
+   if( GetFileSizeEx( file, &file_size) && file_size.QuadPart > 0
+            && (ULONGLONG)file_size.QuadPart <= (ULONGLONG)(size_t)-1)
+      {
+      HANDLE mapping = CreateFileMappingA( file, NULL, PAGE_READONLY,
+                                           0, 0, NULL);
+
+      if( mapping)
+         {
+         rval = MapViewOfFile( mapping, FILE_MAP_READ, 0, 0, 0);
+         CloseHandle( mapping);
+         if( rval && size)
+            *size = (size_t)file_size.QuadPart;
+         }
+      }
+   CloseHandle( file);
+   return( rval);
+}
+
+void unmap_file( const void *addr, const size_t size)
+{
+   (void)size;
+   if( addr)
+      UnmapViewOfFile( addr);
+}
+#elif defined( MEM_MAP_EMULATED)
+
+/* No mmap();  we just read the file in.   */
+
+const void *map_file_into_memory( const char *filename, size_t *size)
+{
+   FILE *ifile = fopen( filename, "rb");
+   char *rval = NULL;
+   long len;
+
+   if( !ifile)
+      return( NULL);
+   fseek( ifile, 0L, SEEK_END);
+   len = ftell( ifile);
+   fseek( ifile, 0L, SEEK_SET);
+   if( len > 0 && (rval = (char *)malloc( (size_t)len)) != NULL)
+      if( fread( rval, 1, (size_t)len, ifile) != (size_t)len)
+         {
+         free( rval);
+         rval = NULL;
+         }
+   fclose( ifile);
+   if( rval && size)
+      *size = (size_t)len;
+   return( rval);
+}
+
+void unmap_file( const void *addr, const size_t size)
+{
+   (void)size;
+   free( (void *)addr);
+}
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+const void *map_file_into_memory( const char *filename, size_t *size)
+{
+   const int fd = open( filename, O_RDONLY);
+   struct stat file_info;
+   void *rval = NULL;
+
+   if( fd < 0)
+      return( NULL);
+   if( !fstat( fd, &file_info) && file_info.st_size > 0)
+      {
+      rval = mmap( NULL, (size_t)file_info.st_size, PROT_READ, MAP_SHARED,
+                     fd, 0);
+      if( rval == MAP_FAILED)
+         rval = NULL;
+      else if( size)
+         *size = (size_t)file_info.st_size;
+      }
+   close( fd);          /* the mapping stays valid after closing */
+   return( rval);
+}
+
+void unmap_file( const void *addr, const size_t size)
+{
+   if( addr)
+      munmap( (void *)addr, size);
+}
+#endif
@@ -0,0 +1,30 @@
+#ifndef MEM_MAP_H_INCLUDED
+#define MEM_MAP_H_INCLUDED
+
+/* Read-only memory mapping of files.  On POSIX systems,  this is done
+with mmap(),  and on Windows with CreateFileMapping(),  so "loading" a
+file costs nothing until pages are touched.  Elsewhere,  the file is
+simply read into an allocated buffer.  That still works,  but means
+reading the whole file;  MEM_MAP_EMULATED is defined in that case,  so
+code that would only look at a small part of a big file can read that
+part instead.  Public domain.  */
+
+#include <stddef.h>
+
+#if !defined( _WIN32) && !defined( _WIN64) && defined( __WATCOMC__)
+   #define MEM_MAP_EMULATED
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+         /* Returns NULL if the file can't be opened or is empty. */
+const void *map_file_into_memory( const char *filename, size_t *size);
+void unmap_file( const void *addr, const size_t size);
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef MEM_MAP_H_INCLUDED */
@@ -0,0 +1,262 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include "out_sink.h"
+
+#if defined( _WIN32) || defined( _WIN64) || defined( __WATCOMC__)
+   #include <io.h>
+   #define write_to_fd( fd, data, n)  _write( fd, data, (unsigned)(n))
+   #define get_fd( ofile)             _fileno( ofile)
+#else
+   #include <unistd.h>
+   #include <sys/uio.h>
+   #define HAVE_WRITEV
+   #define write_to_fd( fd, data, n)  write( fd, data, n)
+   #define get_fd( ofile)             fileno( ofile)
+#endif
+
+/* See 'out_sink.h' for what this is for and how it's used.  */
+
+#define SINK_FD          0
+#define SINK_MEMORY      1
+#define SINK_CALLBACK    2
+
+struct out_sink
+   {
+   int type, fd, err;
+   void *context;
+   int (*callback_fn)( void *, const char *, const size_t);
+   char *buff;
+   size_t n_used, buff_size;
+   };
+
+static out_sink_t *alloc_sink( const int type, const size_t buff_size)
+{
+   out_sink_t *rval = (out_sink_t *)calloc( 1, sizeof( out_sink_t));
+
+   if( rval)
+      {
+      rval->type = type;
+      rval->fd = -1;
+      rval->buff_size = buff_size;
+      rval->buff = (char *)malloc( buff_size);
+      if( !rval->buff)
+         {
+         free( rval);
+         rval = NULL;
+         }
+      }
+   return( rval);
+}
+
+out_sink_t *open_fd_sink( const int fd)
+{
+   out_sink_t *rval = alloc_sink( SINK_FD, OUT_SINK_BUFFER_SIZE);
+
+   if( rval)
+      rval->fd = fd;
+   return( rval);
+}
+
+out_sink_t *open_callback_sink( void *context,
+               int (*callback_fn)( void *, const char *, const size_t))
+{
+   out_sink_t *rval = alloc_sink( SINK_CALLBACK, OUT_SINK_BUFFER_SIZE);
+
+   if( rval)
+      {
+      rval->context = context;
+      rval->callback_fn = callback_fn;
+      }
+   return( rval);
+}
+
+out_sink_t *open_memory_sink( void)
+{
+   return( alloc_sink( SINK_MEMORY, 65536));
+}
+
+static int fwrite_callback( void *context, const char *data,
+                                          const size_t n_bytes)
+{
+   return( fwrite( data, 1, n_bytes, (FILE *)context) != n_bytes);
+}
+
+out_sink_t *open_file_sink( FILE *ofile)
+{
+   const int fd = get_fd( ofile);
+
+            /* Anything already fwrite()n has to go out before we write */
+            /* to the descriptor.  If that fails,  we stick with stdio,  */
+            /* so the error stays with the FILE where the caller sees it. */
+   if( fd < 0 || fflush( ofile))
+      return( open_callback_sink( ofile, fwrite_callback));
+   return( open_fd_sink( fd));
+}
+
+/* write() can write less than was asked for (e.g.,  to a pipe),  or be
+interrupted,  so we keep at it until it's all out.  If it writes nothing
+at all,  though,  something's wrong (a full disk,  say),  and retrying
+would just loop forever.  */
+
+static int write_all( const int fd, const char *data, size_t n_bytes)
+{
+   while( n_bytes)
+      {
+      const long n_written = (long)write_to_fd( fd, data, n_bytes);
+
+      if( n_written > 0)
+         {
+         data += n_written;
+         n_bytes -= (size_t)n_written;
+         }
+      else if( !n_written || errno != EINTR)
+         return( OUT_SINK_WRITE_FAILED);
+      }
+   return( 0);
+}
+
+/* Sends the buffered data,  then 'n_bytes' of 'data',  to the output.
+For descriptors,  this is done with a single writev() call if we can
+(falling back to write() for whatever it didn't get to).   */
+
+static int send_data( out_sink_t *sink, const char *data,
+                                                  const size_t n_bytes)
+{
+   if( sink->err)
+      return( sink->err);
+   if( sink->type == SINK_FD)
+      {
+      size_t n_buffered = sink->n_used, n_extra = n_bytes;
+      const char *buffered = sink->buff;
+
+#ifdef HAVE_WRITEV
+      if( n_buffered && n_extra)
+         {
+         struct iovec iov[2];
+         long n_written;
+
+         iov[0].iov_base = sink->buff;
+         iov[0].iov_len = n_buffered;
+         iov[1].iov_base = (void *)data;
+         iov[1].iov_len = n_extra;
+         do
+            {
+            n_written = (long)writev( sink->fd, iov, 2);
+            }
+            while( n_written < 0 && errno == EINTR);
+         if( n_written < 0)
+            sink->err = OUT_SINK_WRITE_FAILED;
+         else if( (size_t)n_written < n_buffered)
+            {
+            buffered += n_written;
+            n_buffered -= (size_t)n_written;
+            }
+         else
+            {
+            data += (size_t)n_written - n_buffered;
+            n_extra -= (size_t)n_written - n_buffered;
+            n_buffered = 0;
+            }
+         }
+#endif
+      if( !sink->err)
+         sink->err = write_all( sink->fd, buffered, n_buffered);
+      if( !sink->err)
+         sink->err = write_all( sink->fd, data, n_extra);
+      }
+   else if( sink->type == SINK_CALLBACK)
+      {
+      if( sink->n_used && sink->callback_fn( sink->context, sink->buff,
+                                                  sink->n_used))
+         sink->err = OUT_SINK_CALLBACK_FAILED;
+      else if( n_bytes && sink->callback_fn( sink->context, data, n_bytes))
+         sink->err = OUT_SINK_CALLBACK_FAILED;
+      }
+   sink->n_used = 0;
+   return( sink->err);
+}
+
+/* Makes sure there's room for 'n_bytes' more in the buffer.  Memory
+sinks grow;  the others flush,  and grow only if a single request is
+bigger than the buffer.  */
+
+static int make_room( out_sink_t *sink, const size_t n_bytes)
+{
+   if( sink->n_used + n_bytes > sink->buff_size && sink->type != SINK_MEMORY)
+      send_data( sink, NULL, 0);
+   if( !sink->err && sink->n_used + n_bytes > sink->buff_size)
+      {
+      size_t new_size = sink->buff_size * 2;
+      char *new_buff;
+
+      while( new_size < sink->n_used + n_bytes)
+         new_size *= 2;
+      new_buff = (char *)realloc( sink->buff, new_size);
+      if( !new_buff)
+         sink->err = OUT_SINK_ALLOC_FAILED;
+      else
+         {
+         sink->buff = new_buff;
+         sink->buff_size = new_size;
+         }
+      }
+   return( sink->err);
+}
+
+int sink_write( out_sink_t *sink, const void *data, const size_t n_bytes)
+{
+   if( sink->err)
+      return( sink->err);
+   if( sink->n_used + n_bytes > sink->buff_size
+                  && sink->type != SINK_MEMORY
+                  && n_bytes >= sink->buff_size / 2)
+      return( send_data( sink, (const char *)data, n_bytes));
+   if( !make_room( sink, n_bytes))
+      {
+      memcpy( sink->buff + sink->n_used, data, n_bytes);
+      sink->n_used += n_bytes;
+      }
+   return( sink->err);
+}
+
+char *sink_reserve( out_sink_t *sink, const size_t max_bytes)
+{
+   if( sink->err || make_room( sink, max_bytes))
+      return( NULL);
+   return( sink->buff + sink->n_used);
+}
+
+void sink_commit( out_sink_t *sink, const size_t n_bytes)
+{
+   sink->n_used += n_bytes;
+}
+
+int flush_sink( out_sink_t *sink)
+{
+   if( !sink)
+      return( 0);
+   if( sink->type == SINK_MEMORY)
+      return( sink->err);
+   return( send_data( sink, NULL, 0));
+}
+
+int close_sink( out_sink_t *sink)
+{
+   const int rval = flush_sink( sink);
+
+   if( sink)
+      {
+      free( sink->buff);
+      free( sink);
+      }
+   return( rval);
+}
+
+const char *get_sink_data( const out_sink_t *sink, size_t *n_bytes)
+{
+   if( n_bytes)
+      *n_bytes = sink->n_used;
+   return( sink->buff);
+}
@@ -0,0 +1,67 @@
+#ifndef OUT_SINK_H_INCLUDED
+#define OUT_SINK_H_INCLUDED
+
+/* Buffered output for star extraction.  The extraction functions used to
+fwrite() each star as it was found,  which (for a few million stars)
+meant a few million trips through stdio's locking and bookkeeping.  An
+'out_sink_t' instead collects output in one large buffer,  which is
+handed off in a single write() (or writev(),  if it's combined with a
+large block of new data) when full.
+
+   Output can go to a file descriptor,  to a (growing) memory buffer,  or
+to a callback function.  open_file_sink() is a convenience for the common
+case of an already-open FILE :  it flushes the FILE,  then writes to its
+descriptor.  (If the FILE has no descriptor,  e.g.,  it's a memory stream,
+output goes through fwrite() instead.)  Don't write to the FILE yourself
+until the sink has been closed.  Public domain.  */
+
+#include <stdio.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+typedef struct out_sink out_sink_t;
+
+out_sink_t *open_fd_sink( const int fd);
+out_sink_t *open_file_sink( FILE *ofile);
+out_sink_t *open_memory_sink( void);
+         /* The callback gets each buffer-full of data;  if it returns */
+         /* non-zero,  that's treated as a write error.                */
+out_sink_t *open_callback_sink( void *context,
+               int (*callback_fn)( void *, const char *, const size_t));
+
+         /* The following return 0 on success,  or one of the negative    */
+         /* error codes below.  Errors are "sticky" :  once one occurs,  */
+         /* further output is discarded and every later call returns it. */
+int sink_write( out_sink_t *sink, const void *data, const size_t n_bytes);
+int flush_sink( out_sink_t *sink);
+         /* Flushes and frees the sink (but doesn't close the descriptor */
+         /* or FILE it was writing to.)  As with free(),  a NULL sink is */
+         /* quietly ignored (as it is by flush_sink()).                  */
+int close_sink( out_sink_t *sink);
+
+         /* To format text directly into the sink's buffer,  saving a    */
+         /* copy :  sink_reserve() returns a pointer to at least         */
+         /* 'max_bytes' of space (or NULL on error);  once you've written */
+         /* to it,  sink_commit() says how many bytes were actually used. */
+char *sink_reserve( out_sink_t *sink, const size_t max_bytes);
+void sink_commit( out_sink_t *sink, const size_t n_bytes);
+
+         /* For memory sinks,  returns everything written so far.  The    */
+         /* data remains valid until the next write or until the sink is */
+         /* closed.                                                      */
+const char *get_sink_data( const out_sink_t *sink, size_t *n_bytes);
+
+#define OUT_SINK_WRITE_FAILED        -1
+#define OUT_SINK_ALLOC_FAILED        -2
+#define OUT_SINK_CALLBACK_FAILED     -3
+
+#define OUT_SINK_BUFFER_SIZE     (1 << 18)
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef OUT_SINK_H_INCLUDED */
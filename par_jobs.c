@@ -0,0 +1,192 @@
+#include <stdlib.h>
+#include "par_jobs.h"
+
+/* See 'par_jobs.h' for what this does and why.  */
+
+#ifndef _MSC_VER
+#include <pthread.h>
+
+#define JOBS_AHEAD_PER_THREAD    4
+
+typedef struct
+   {
+   out_sink_t *sink;
+   int rval, done;
+   } job_slot_t;
+
+typedef struct
+   {
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   job_slot_t *slots;
+   int n_jobs, next_job, n_merged, max_ahead, failed;
+   out_sink_t *output;
+   void *context;
+   par_job_fn job_fn;
+   } job_queue_t;
+
+typedef struct
+   {
+   job_queue_t *q;
+   int thread_num;
+   } worker_t;
+
+static void *job_worker( void *arg)
+{
+   const worker_t *w = (const worker_t *)arg;
+   job_queue_t *q = w->q;
+
+   while( 1)
+      {
+      out_sink_t *sink = NULL;
+      int job, rval;
+
+      pthread_mutex_lock( &q->mutex);
+      while( !q->failed && q->next_job < q->n_jobs
+                        && q->next_job >= q->n_merged + q->max_ahead)
+         pthread_cond_wait( &q->cond, &q->mutex);
+      if( q->failed || q->next_job >= q->n_jobs)
+         {
+         pthread_mutex_unlock( &q->mutex);
+         return( NULL);
+         }
+      job = q->next_job++;
+      pthread_mutex_unlock( &q->mutex);
+
+      if( q->output && (sink = open_memory_sink( )) == NULL)
+         rval = OUT_SINK_ALLOC_FAILED;
+      else
+         rval = q->job_fn( q->context, w->thread_num, job, sink);
+      if( rval >= 0 && sink)
+         {
+         const int err = flush_sink( sink);  /* memory ran out somewhere? */
+
+         if( err)
+            rval = err;
+         }
+
+      pthread_mutex_lock( &q->mutex);
+      q->slots[job].sink = sink;
+      q->slots[job].rval = rval;
+      q->slots[job].done = 1;
+      if( rval < 0)
+         q->failed = 1;
+      pthread_cond_broadcast( &q->cond);
+      pthread_mutex_unlock( &q->mutex);
+      }
+}
+
+/* The calling thread does the merging :  it waits for each job in turn
+to finish,  copies its output,  and lets the workers know they can get
+a bit further ahead.  */
+
+static int run_threaded( out_sink_t *output, const int n_jobs,
+                  const int n_threads, void *context, par_job_fn job_fn)
+{
+   job_queue_t q;
+   worker_t *workers = (worker_t *)calloc( n_threads, sizeof( worker_t));
+   pthread_t *threads = (pthread_t *)calloc( n_threads, sizeof( pthread_t));
+   int i, n_started = 0, rval = 0;
+
+   q.slots = (job_slot_t *)calloc( n_jobs, sizeof( job_slot_t));
+   if( !workers || !threads || !q.slots)
+      {
+      free( workers);
+      free( threads);
+      free( q.slots);
+      return( OUT_SINK_ALLOC_FAILED);
+      }
+   pthread_mutex_init( &q.mutex, NULL);
+   pthread_cond_init( &q.cond, NULL);
+   q.n_jobs = n_jobs;
+   q.next_job = q.n_merged = q.failed = 0;
+   q.max_ahead = n_threads * JOBS_AHEAD_PER_THREAD;
+   q.output = output;
+   q.context = context;
+   q.job_fn = job_fn;
+   for( i = 0; i < n_threads; i++)
+      {
+      workers[i].q = &q;
+      workers[i].thread_num = i;
+      if( !pthread_create( threads + i, NULL, job_worker, workers + i))
+         n_started++;
+      else
+         break;
+      }
+   if( !n_started)
+      rval = PAR_JOBS_THREAD_FAILED;
+   for( i = 0; i < n_jobs && n_started && rval >= 0; i++)
+      {
+      job_slot_t *slot = q.slots + i;
+
+      pthread_mutex_lock( &q.mutex);
+      while( !slot->done && !(q.failed && i >= q.next_job))
+         pthread_cond_wait( &q.cond, &q.mutex);
+      pthread_mutex_unlock( &q.mutex);
+      if( !slot->done)        /* a later job failed;  this one never ran */
+         break;
+      if( slot->rval < 0)
+         rval = slot->rval;
+      else
+         {
+         rval += slot->rval;
+         if( slot->sink)
+            {
+            size_t n_bytes;
+            const char *data = get_sink_data( slot->sink, &n_bytes);
+            const int err = sink_write( output, data, n_bytes);
+
+            if( err)          /* can't write the output;  give up */
+               rval = err;
+            }
+         }
+      if( slot->sink)
+         {
+         close_sink( slot->sink);
+         slot->sink = NULL;
+         }
+      pthread_mutex_lock( &q.mutex);
+      q.n_merged = i + 1;
+      pthread_cond_broadcast( &q.cond);
+      pthread_mutex_unlock( &q.mutex);
+      }
+   pthread_mutex_lock( &q.mutex);
+   q.failed = 1;           /* in case we stopped early,  stop the workers */
+   pthread_cond_broadcast( &q.cond);
+   pthread_mutex_unlock( &q.mutex);
+   for( i = 0; i < n_started; i++)
+      pthread_join( threads[i], NULL);
+   for( i = 0; i < n_jobs; i++)    /* find any failure,  free leftovers */
+      {
+      if( rval >= 0 && q.slots[i].done && q.slots[i].rval < 0)
+         rval = q.slots[i].rval;
+      if( q.slots[i].sink)
+         close_sink( q.slots[i].sink);
+      }
+   pthread_mutex_destroy( &q.mutex);
+   pthread_cond_destroy( &q.cond);
+   free( q.slots);
+   free( workers);
+   free( threads);
+   return( rval);
+}
+#endif         /* #ifndef _MSC_VER */
+
+int run_ordered_jobs( out_sink_t *output, const int n_jobs,
+                  const int n_threads, void *context, par_job_fn job_fn)
+{
+   int i, rval = 0;
+
+#ifndef _MSC_VER
+   if( n_threads > 1 && n_jobs > 1)
+      return( run_threaded( output, n_jobs,
+                  (n_threads < n_jobs ? n_threads : n_jobs), context, job_fn));
+#endif
+   for( i = 0; i < n_jobs && rval >= 0; i++)
+      {
+      const int job_rval = job_fn( context, 0, i, output);
+
+      rval = (job_rval < 0 ? job_rval : rval + job_rval);
+      }
+   return( rval);
+}
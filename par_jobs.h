@@ -0,0 +1,41 @@
+#ifndef PAR_JOBS_H_INCLUDED
+#define PAR_JOBS_H_INCLUDED
+
+/* Runs a numbered series of jobs on several threads,  with the output
+coming out in job order,  exactly as if they'd been run one after
+another.  This is used to extract stars from several zones at once :
+each zone is a job,  writing its stars to its own memory sink,  and the
+sinks are copied to the real output (in order) as they're finished.
+
+   To keep memory use down for huge extractions,  threads don't get more
+than a few jobs ahead of the oldest job whose output hasn't yet been
+copied.  If any job fails (returns a negative value),  no further jobs
+are started,  and that error is returned.  Otherwise,  the return value
+is the sum of the jobs' return values.
+
+   Each job is told which thread (0 to n_threads - 1) it's running on,
+so that per-thread data (a catalog handle,  say) can be used without
+locking.  With 'n_threads' of one or less,  or if built without
+pthreads (MSVC),  jobs are simply run in order in the calling thread,
+writing directly to 'output'.  'output' can be NULL,  in which case so
+is the sink each job gets.  Public domain.  */
+
+#include "out_sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+typedef int (*par_job_fn)( void *context, const int thread_num,
+                           const int job_num, out_sink_t *sink);
+
+int run_ordered_jobs( out_sink_t *output, const int n_jobs,
+                  const int n_threads, void *context, par_job_fn job_fn);
+
+#define PAR_JOBS_THREAD_FAILED      -4
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef PAR_JOBS_H_INCLUDED */
@@ -0,0 +1,112 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "smooth.h"
+#include "sky_map.h"
+
+/* Demonstration/test of the sky map lookup code in 'sky_map.c'.  Run as
+
+./sky_look (map file) (RA) (dec) [options]
+
+   to get the value at a point,  or without an RA and dec to read RA/dec
+pairs (degrees) from stdin.  Options are :
+
+   -b       Use bilinear interpolation
+   -n       Normalize to counts per 0.1 x 0.1 degree area
+   -g(sig)  Pre-smooth the map with a Gaussian of the given sigma (pixels)
+   -o(n)    Use HEALPix order n (for .hpx maps)
+   -r(n)    Time n lookups at random points          */
+
+int main( const int argc, const char **argv)
+{
+   sky_map_t *map;
+   int i, flags = 0, n_args = 0, order = -1;
+   long n_random = 0;
+   double sigma = 0., coords[2];
+
+   if( argc < 2)
+      {
+      fprintf( stderr, "'sky_look' needs the name of a map file.  See\n"
+                       "'sky_look.c' for usage.\n");
+      return( -1);
+      }
+   for( i = 2; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] > '9')
+         switch( argv[i][1])
+            {
+            case 'b':
+               flags |= SKY_MAP_BILINEAR;
+               break;
+            case 'n':
+               flags |= SKY_MAP_NORMALIZE;
+               break;
+            case 'g':
+               sigma = atof( argv[i] + 2);
+               break;
+            case 'o':
+               order = atoi( argv[i] + 2);
+               break;
+            case 'r':
+               n_random = atol( argv[i] + 2);
+               break;
+            default:
+               printf( "%s is an unrecognized option\n", argv[i]);
+               return( -1);
+            }
+      else if( n_args < 2)
+         coords[n_args++] = atof( argv[i]);
+   map = open_sky_map( argv[1]);
+   if( !map)
+      {
+      fprintf( stderr, "Couldn't open '%s' as a sky map\n", argv[1]);
+      return( -2);
+      }
+   if( order >= 0 && sky_map_set_healpix_order( map, order))
+      fprintf( stderr, "Couldn't select HEALPix order %d\n", order);
+   if( sigma > 0.)
+      {
+      const int err = sky_map_smooth( map, SMOOTH_GAUSSIAN, sigma, 4);
+
+      if( err)
+         fprintf( stderr, "Smoothing failed (%d)\n", err);
+      }
+   if( n_random)
+      {
+      double *ra = (double *)malloc( 3 * n_random * sizeof( double));
+      double *dec = ra + n_random, *values = dec + n_random;
+      clock_t t0;
+
+      for( i = 0; i < n_random; i++)
+         {
+         ra[i] = 360. * (double)rand( ) / (double)RAND_MAX;
+         dec[i] = 180. * (double)rand( ) / (double)RAND_MAX - 90.;
+         }
+      t0 = clock( );
+      sky_map_lookup( map, (size_t)n_random, ra, dec, values, flags);
+      printf( "%ld lookups in %.3f seconds\n", n_random,
+                  (double)( clock( ) - t0) / (double)CLOCKS_PER_SEC);
+      free( ra);
+      }
+   else if( n_args == 2)
+      {
+      double value;
+
+      sky_map_lookup( map, 1, coords, coords + 1, &value, flags);
+      printf( "%.4f\n", value);
+      }
+   else
+      {
+      char buff[200];
+
+      while( fgets( buff, sizeof( buff), stdin))
+         if( sscanf( buff, "%lf %lf", coords, coords + 1) == 2)
+            {
+            double value;
+
+            sky_map_lookup( map, 1, coords, coords + 1, &value, flags);
+            printf( "%.4f\n", value);
+            }
+      }
+   close_sky_map( map);
+   return( 0);
+}
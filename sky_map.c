@@ -0,0 +1,337 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "mem_map.h"
+#include "healpix.h"
+#include "smooth.h"
+#include "sky_map.h"
+
+/* See 'sky_map.h' for the file formats.  Lookups are done in batches of
+LOOKUP_CHUNK points :  first,  a loop converts (RA, dec) to fractional
+pixel coordinates.  That loop has no branches or lookups in it,  so
+gcc/clang at -O3 can (and do) turn it into SIMD code.  Then a second
+loop fetches pixel values,  which is inherently a gather and is done
+point by point.  */
+
+#define PI 3.1415926535897932384626433832795028841971693993751058209749445923
+
+#define SKY_MAP_RAW         0
+#define SKY_MAP_PGM         1
+#define SKY_MAP_HEALPIX     2
+
+struct sky_map
+   {
+   const void *mapped;
+   size_t mapped_size;
+   int type;
+   int xsize, ysize;
+   const int32_t *ivals;      /* raw maps,  and smoothed copies of any map */
+   const uint8_t *bvals;      /* PGM maps,  north up,  RA increasing left */
+   int32_t *smoothed;
+   int hpx_max_order, hpx_n_levels, hpx_order, hpx_flags;
+   const int32_t *hpx_level;
+   };
+
+#define LOOKUP_CHUNK 256
+
+static int parse_pgm_header( sky_map_t *map)
+{
+   char buff[80];
+   const size_t len = (map->mapped_size < sizeof( buff) - 1 ?
+                       map->mapped_size : sizeof( buff) - 1);
+   int xsize, ysize, maxval, bytes_read;
+
+   memcpy( buff, map->mapped, len);
+   buff[len] = '\0';
+   if( sscanf( buff, "P5 %d %d %d%n", &xsize, &ysize, &maxval,
+                                       &bytes_read) != 3
+            || maxval > 255 || xsize <= 0 || ysize <= 0)
+      return( -1);
+   bytes_read++;           /* skip the single whitespace after 'maxval' */
+   if( (size_t)bytes_read + (size_t)xsize * (size_t)ysize > map->mapped_size)
+      return( -1);
+   map->xsize = xsize;
+   map->ysize = ysize;
+   map->bvals = (const uint8_t *)map->mapped + bytes_read;
+   return( 0);
+}
+
+static int parse_healpix_header( sky_map_t *map)
+{
+   const int32_t *header = (const int32_t *)map->mapped;
+   int64_t total = 0;
+   int i;
+
+   map->hpx_max_order = header[1];
+   map->hpx_n_levels = header[2];
+   map->hpx_flags = header[3];
+   if( map->hpx_max_order < 0 || map->hpx_max_order > HEALPIX_MAX_ORDER
+            || map->hpx_n_levels < 1
+            || map->hpx_n_levels > map->hpx_max_order + 1)
+      return( -1);
+   for( i = 0; i < map->hpx_n_levels; i++)
+      total += healpix_n_pixels( map->hpx_max_order - i);
+   if( HEALPIX_MAP_HEADER_SIZE + (size_t)total * sizeof( int32_t)
+                              > map->mapped_size)
+      return( -1);
+   return( sky_map_set_healpix_order( map, map->hpx_max_order));
+}
+
+/* Raw maps have no header;  we just insist on 2N x N pixels. */
+
+static int parse_raw_map( sky_map_t *map)
+{
+   const size_t n_pixels = map->mapped_size / sizeof( int32_t);
+   const int ysize = (int)floor( sqrt( (double)n_pixels / 2.) + .5);
+
+   if( (size_t)ysize * (size_t)ysize * 2 * sizeof( int32_t)
+                                       != map->mapped_size)
+      return( -1);
+   map->ysize = ysize;
+   map->xsize = ysize * 2;
+   map->ivals = (const int32_t *)map->mapped;
+   return( 0);
+}
+
+sky_map_t *open_sky_map( const char *filename)
+{
+   sky_map_t *map = (sky_map_t *)calloc( 1, sizeof( sky_map_t));
+   int err;
+
+   if( !map)
+      return( NULL);
+   map->mapped = map_file_into_memory( filename, &map->mapped_size);
+   if( !map->mapped || map->mapped_size < HEALPIX_MAP_HEADER_SIZE)
+      err = -1;
+   else if( !memcmp( map->mapped, "P5", 2))
+      {
+      map->type = SKY_MAP_PGM;
+      err = parse_pgm_header( map);
+      }
+   else if( *(const int32_t *)map->mapped == HEALPIX_MAP_MAGIC)
+      {
+      map->type = SKY_MAP_HEALPIX;
+      err = parse_healpix_header( map);
+      }
+   else
+      {
+      map->type = SKY_MAP_RAW;
+      err = parse_raw_map( map);
+      }
+   if( err)
+      {
+      close_sky_map( map);
+      map = NULL;
+      }
+   return( map);
+}
+
+void close_sky_map( sky_map_t *map)
+{
+   if( map)
+      {
+      if( map->mapped)
+         unmap_file( map->mapped, map->mapped_size);
+      free( map->smoothed);
+      free( map);
+      }
+}
+
+int sky_map_set_healpix_order( sky_map_t *map, const int order)
+{
+   const int32_t *level;
+   int i;
+
+   if( map->type != SKY_MAP_HEALPIX)
+      return( SKY_MAP_WRONG_TYPE);
+   if( order > map->hpx_max_order
+            || order <= map->hpx_max_order - map->hpx_n_levels)
+      return( SKY_MAP_BAD_ORDER);
+   level = (const int32_t *)( (const char *)map->mapped
+                                          + HEALPIX_MAP_HEADER_SIZE);
+   for( i = map->hpx_max_order; i > order; i--)
+      level += healpix_n_pixels( i);
+   map->hpx_level = level;
+   map->hpx_order = order;
+   return( 0);
+}
+
+void sky_map_get_size( const sky_map_t *map, int *xsize, int *ysize)
+{
+   if( map->type == SKY_MAP_HEALPIX)
+      {
+      *xsize = (int)healpix_n_pixels( map->hpx_order);
+      *ysize = 1;
+      }
+   else
+      {
+      *xsize = map->xsize;
+      *ysize = map->ysize;
+      }
+}
+
+int sky_map_get_healpix_order( const sky_map_t *map)
+{
+   return( map->type == SKY_MAP_HEALPIX ? map->hpx_order
+                                        : SKY_MAP_WRONG_TYPE);
+}
+
+/* Smoothing needs a writable copy,  in raw-map order.  After this,  PGM
+maps are looked up just as raw ones are (though 'type' is left alone, so
+we still know not to normalize them.)  */
+
+int sky_map_smooth( sky_map_t *map, const int kernel_type,
+                  const double size, const int n_threads)
+{
+   const int xsize = map->xsize, ysize = map->ysize;
+   int32_t *copy;
+   int x, y, rval;
+
+   if( map->type == SKY_MAP_HEALPIX)
+      return( SKY_MAP_WRONG_TYPE);
+   copy = (int32_t *)malloc( (size_t)xsize * (size_t)ysize * sizeof( int32_t));
+   if( !copy)
+      return( SKY_MAP_ALLOC_FAILED);
+   if( map->ivals)
+      memcpy( copy, map->ivals, (size_t)xsize * (size_t)ysize * sizeof( int32_t));
+   else
+      for( y = 0; y < ysize; y++)
+         {
+         const uint8_t *bptr = map->bvals + (size_t)( ysize - 1 - y) * xsize;
+
+         for( x = 0; x < xsize; x++)
+            copy[x + (size_t)y * xsize] = bptr[xsize - 1 - x];
+         }
+   rval = smooth_map( copy, xsize, ysize, kernel_type, size, n_threads);
+   if( rval)
+      free( copy);
+   else
+      {
+      free( map->smoothed);
+      map->smoothed = copy;
+      map->ivals = copy;
+      map->bvals = NULL;
+      }
+   return( rval);
+}
+
+static inline double pixel_value( const sky_map_t *map, const int x,
+                                                        const int y)
+{
+   if( map->ivals)
+      return( (double)map->ivals[x + (size_t)y * map->xsize]);
+   else
+      return( (double)map->bvals[(map->xsize - 1 - x)
+                        + (size_t)( map->ysize - 1 - y) * map->xsize]);
+}
+
+static int healpix_lookup( const sky_map_t *map, const size_t n_points,
+                  const double *ra, const double *dec, double *values,
+                  const int flags)
+{
+   const double deg_to_rad = PI / 180.;
+   double scale = 1.;
+   size_t i;
+
+   if( flags & SKY_MAP_NORMALIZE)
+      {           /* star counts are per pixel at each level;  brightness */
+                  /* levels are all per finest-level pixel (healpix.h)   */
+      const double sq_degrees_on_sky = 129600. / PI;
+      const int order = ((map->hpx_flags & HEALPIX_MAP_STAR_COUNTS) ?
+                              map->hpx_order : map->hpx_max_order);
+
+      scale = .01 * (double)healpix_n_pixels( order) / sq_degrees_on_sky;
+      }
+   for( i = 0; i < n_points; i++)
+      {
+      double tdec = dec[i];
+
+      if( tdec > 90.)
+         tdec = 90.;
+      if( tdec < -90.)
+         tdec = -90.;
+      values[i] = scale * (double)map->hpx_level[healpix_ang2pix_nest(
+                     map->hpx_order, ra[i] * deg_to_rad, tdec * deg_to_rad)];
+      }
+   return( 0);
+}
+
+int sky_map_lookup( const sky_map_t *map, const size_t n_points,
+                  const double *ra, const double *dec, double *values,
+                  const int flags)
+{
+   const int xsize = map->xsize, ysize = map->ysize;
+   const double x_scale = (double)xsize / 360.;
+   const double y_scale = (double)ysize / 180.;
+   const double offset = ((flags & SKY_MAP_BILINEAR) ? .5 : 0.);
+   const int normalize = ((flags & SKY_MAP_NORMALIZE)
+                              && map->type == SKY_MAP_RAW);
+   double fx[LOOKUP_CHUNK], fy[LOOKUP_CHUNK];
+   size_t start;
+
+   if( map->type == SKY_MAP_HEALPIX)
+      return( healpix_lookup( map, n_points, ra, dec, values, flags));
+   for( start = 0; start < n_points; start += LOOKUP_CHUNK)
+      {
+      const size_t n = (n_points - start < LOOKUP_CHUNK ?
+                        n_points - start : LOOKUP_CHUNK);
+      size_t i;
+                  /* the vectorizable part : */
+      for( i = 0; i < n; i++)
+         {
+         fx[i] = ra[start + i] * x_scale - offset;
+         fy[i] = (dec[start + i] + 90.) * y_scale - offset;
+         }
+      for( i = 0; i < n; i++)
+         {
+         const double x_floor = floor( fx[i]), y_floor = floor( fy[i]);
+         int x0 = (int)fmod( x_floor, (double)xsize);
+         int y0 = (int)y_floor;
+         double rval;
+
+         if( x0 < 0)
+            x0 += xsize;
+         if( !(flags & SKY_MAP_BILINEAR))
+            {
+            if( y0 < 0)
+               y0 = 0;
+            if( y0 >= ysize)
+               y0 = ysize - 1;
+            rval = pixel_value( map, x0, y0);
+            }
+         else
+            {
+            const double dx = fx[i] - x_floor;
+            double dy = fy[i] - y_floor;
+            const int x1 = (x0 == xsize - 1 ? 0 : x0 + 1);
+            int y1 = y0 + 1;
+
+            if( y0 < 0)       /* within half a pixel of the south pole */
+               {
+               y0 = y1 = 0;
+               dy = 0.;
+               }
+            if( y1 >= ysize)  /* ...or of the north pole */
+               {
+               y0 = y1 = ysize - 1;
+               dy = 0.;
+               }
+            rval = (1. - dy) * ((1. - dx) * pixel_value( map, x0, y0)
+                                    + dx  * pixel_value( map, x1, y0))
+                      + dy  * ((1. - dx) * pixel_value( map, x0, y1)
+                                    + dx  * pixel_value( map, x1, y1));
+            }
+         if( normalize)
+            {        /* pixel area goes as cos(dec);  scale to 0.1x0.1 deg */
+            const double cos_dec = cos( dec[start + i] * PI / 180.);
+            const double pixel_area = 64800. / ((double)xsize * (double)ysize);
+
+            rval *= .01 / (pixel_area * (cos_dec > 1e-4 ? cos_dec : 1e-4));
+            }
+         values[start + i] = rval;
+         }
+      }
+   return( 0);
+}
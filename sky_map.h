@@ -0,0 +1,75 @@
+#ifndef SKY_MAP_H_INCLUDED
+#define SKY_MAP_H_INCLUDED
+
+/* Code to look up values in the sky brightness maps made by 'bright.c'
+and 'make_map.c'.  The map file is memory-mapped (see mem_map.c),  so
+opening it costs essentially nothing;  only the pages actually looked at
+get read in.  Public domain.  Please contact pluto (at) projectpluto.com
+with comments/bug fixes.
+
+   Three sorts of map are recognized by their contents :
+
+   -- 'bright.zq' : raw 32-bit integers,  (2N) x N pixels (3600 x 1800
+      as 'bright.c' now stands).  Row 0 is the band just north of dec
+      -90,  and column 0 the strip just east of RA=0.
+   -- 'bright2.pgm' (or any binary PGM with 8-bit pixels) : as written by
+      'make_map',  i.e.,  north at the top and RA increasing to the left.
+      These values are already stretched and corrected for pixel area.
+   -- 'bright.hpx' : HEALPix maps,  as described in 'healpix.h'.  These
+      are always looked up at the nearest pixel;  SKY_MAP_BILINEAR is
+      ignored.  By default,  the finest level in the file is used.  */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+typedef struct sky_map sky_map_t;
+
+sky_map_t *open_sky_map( const char *filename);
+void close_sky_map( sky_map_t *map);
+
+         /* Looks up n_points values.  RA and dec are in degrees.  RAs  */
+         /* outside 0 to 360 are wrapped;  decs are clamped to +/- 90.   */
+         /* Returns 0 on success or a negative SKY_MAP_ error code.      */
+int sky_map_lookup( const sky_map_t *map, const size_t n_points,
+                  const double *ra, const double *dec, double *values,
+                  const int flags);
+
+         /* Interpolate between the four surrounding pixel centers,     */
+         /* rather than taking the value of the pixel containing (ra,dec) */
+#define SKY_MAP_BILINEAR            1
+
+         /* Scale raw counts to be per 0.1 x 0.1 degree area at the      */
+         /* equator,  so that values are comparable at all declinations   */
+         /* and at all HEALPix levels.  No effect on PGM maps,  which     */
+         /* make_map has already corrected.                               */
+#define SKY_MAP_NORMALIZE           2
+
+         /* Makes a smoothed copy of an equirectangular map (see smooth.h */
+         /* for the meanings of the arguments);  later lookups use it.    */
+int sky_map_smooth( sky_map_t *map, const int kernel_type,
+                  const double size, const int n_threads);
+
+         /* For HEALPix maps,  selects which level lookups use.          */
+int sky_map_set_healpix_order( sky_map_t *map, const int order);
+
+         /* Gets the map dimensions.  HEALPix maps are one-dimensional :  */
+         /* xsize = number of pixels at the current level,  ysize = 1.    */
+void sky_map_get_size( const sky_map_t *map, int *xsize, int *ysize);
+
+         /* The level set by sky_map_set_healpix_order(),  or the finest  */
+         /* one if it's not been called;  SKY_MAP_WRONG_TYPE if the map   */
+         /* isn't a HEALPix one.                                          */
+int sky_map_get_healpix_order( const sky_map_t *map);
+
+#define SKY_MAP_ALLOC_FAILED       -1
+#define SKY_MAP_WRONG_TYPE         -2
+#define SKY_MAP_BAD_ORDER          -3
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef SKY_MAP_H_INCLUDED */
@@ -0,0 +1,238 @@
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include "smooth.h"
+
+/* The original 'make_map' blur ran a [1 2 1]/4 kernel along each row,
+then down each column,  as many times as requested.  Walking down a
+column meant striding XSIZE int32_ts between pixels,  which is about as
+cache-hostile as one can get.  This code instead :
+
+   -- combines repeated passes into a single kernel;
+   -- works on floats,  with the inner loops running over a row of
+      contiguous pixels for each kernel weight.  gcc and clang at -O3
+      turn these into SIMD loops,  without our having to resort to
+      intrinsics that would tie us to one instruction set;
+   -- does the vertical pass a row at a time,  as a weighted sum of
+      whole input rows.  That touches memory in order,  with no need to
+      transpose the map;
+   -- splits the rows among 'n_threads' threads for each pass.  Each pass
+      reads from one buffer and writes to another,  so threads never
+      step on one another's data.                              */
+
+typedef struct
+   {
+   const float *weights;
+   int radius;
+   int xsize, ysize;
+   int y0, y1;                /* rows handled by this thread */
+   const float *src;
+   float *dest;
+   } smooth_job_t;
+
+/* Each row is copied to a buffer with 'radius' pixels of wrap-around at
+each end,  so the convolution itself needs no special cases. */
+
+static void *horizontal_pass( void *arg)
+{
+   const smooth_job_t *job = (const smooth_job_t *)arg;
+   const int xsize = job->xsize, radius = job->radius;
+   float *padded = (float *)malloc( (xsize + 2 * radius) * sizeof( float));
+   int y, x, k;
+
+   if( !padded)
+      return( arg);
+   for( y = job->y0; y < job->y1; y++)
+      {
+      const float *iline = job->src + (size_t)y * xsize;
+      float * restrict oline = job->dest + (size_t)y * xsize;
+
+      for( x = -radius; x < xsize + radius; x++)
+         padded[x + radius] = iline[(x % xsize + xsize) % xsize];
+      for( x = 0; x < xsize; x++)
+         oline[x] = 0.f;
+      for( k = 0; k <= 2 * radius; k++)
+         {
+         const float * restrict iptr = padded + k;
+         const float weight = job->weights[k];
+
+         for( x = 0; x < xsize; x++)
+            oline[x] += weight * iptr[x];
+         }
+      }
+   free( padded);
+   return( NULL);
+}
+
+static void *vertical_pass( void *arg)
+{
+   const smooth_job_t *job = (const smooth_job_t *)arg;
+   const int xsize = job->xsize, radius = job->radius;
+   int y, x, k;
+
+   for( y = job->y0; y < job->y1; y++)
+      {
+      float * restrict oline = job->dest + (size_t)y * xsize;
+
+      for( x = 0; x < xsize; x++)
+         oline[x] = 0.f;
+      for( k = -radius; k <= radius; k++)
+         {
+         int iy = y + k;
+         const float * restrict iline;
+         const float weight = job->weights[k + radius];
+
+         if( iy < 0)
+            iy = 0;
+         if( iy >= job->ysize)
+            iy = job->ysize - 1;
+         iline = job->src + (size_t)iy * xsize;
+         for( x = 0; x < xsize; x++)
+            oline[x] += weight * iline[x];
+         }
+      }
+   return( NULL);
+}
+
+static int run_pass( void *(*pass_fn)( void *), smooth_job_t *base,
+                      const int n_threads)
+{
+   smooth_job_t jobs[64];
+   pthread_t threads[64];
+   int i, n_jobs = (n_threads < 1 ? 1 : n_threads), rval = 0;
+
+   if( n_jobs > 64)
+      n_jobs = 64;
+   if( n_jobs > base->ysize)
+      n_jobs = base->ysize;
+   for( i = 0; i < n_jobs; i++)
+      {
+      jobs[i] = *base;
+      jobs[i].y0 = (int)( (int64_t)base->ysize * i / n_jobs);
+      jobs[i].y1 = (int)( (int64_t)base->ysize * (i + 1) / n_jobs);
+      }
+   if( n_jobs == 1)
+      return( pass_fn( jobs) ? SMOOTH_ALLOC_FAILED : 0);
+   for( i = 0; i < n_jobs; i++)
+      if( pthread_create( threads + i, NULL, pass_fn, jobs + i))
+         {
+         n_jobs = i;       /* couldn't start all threads */
+         rval = SMOOTH_THREAD_FAILED;
+         }
+   for( i = 0; i < n_jobs; i++)
+      {
+      void *thread_rval;
+
+      pthread_join( threads[i], &thread_rval);
+      if( thread_rval && !rval)
+         rval = SMOOTH_ALLOC_FAILED;
+      }
+   return( rval);
+}
+
+/* Returns the kernel radius,  and fills in the weights (normalized to
+sum to one) if 'weights' is non-NULL. */
+
+static int make_kernel( float *weights, const int kernel_type,
+                               const double size)
+{
+   int radius, i;
+   double total = 0., *tweights;
+
+   switch( kernel_type)
+      {
+      case SMOOTH_BOX:
+      case SMOOTH_BINOMIAL:
+         radius = (int)size;
+         break;
+      case SMOOTH_GAUSSIAN:
+         radius = (int)ceil( size * 3.);
+         break;
+      default:
+         return( SMOOTH_BAD_KERNEL);
+      }
+   if( radius < 0)
+      return( SMOOTH_BAD_KERNEL);
+   if( !weights)
+      return( radius);
+   tweights = (double *)malloc( (2 * radius + 1) * sizeof( double));
+   if( !tweights)
+      return( SMOOTH_ALLOC_FAILED);
+   for( i = -radius; i <= radius; i++)
+      {
+      double wt = 1.;
+
+      if( kernel_type == SMOOTH_GAUSSIAN && size > 0.)
+         wt = exp( -.5 * (double)( i * i) / (size * size));
+      else if( kernel_type == SMOOTH_BINOMIAL)
+         {                        /* C(2r, r+i),  computed as a product */
+         int j;
+
+         for( j = 1; j <= radius - abs( i); j++)
+            wt *= (double)( radius + abs( i) + j) / (double)j;
+         }
+      tweights[i + radius] = wt;
+      total += wt;
+      }
+   for( i = 0; i <= 2 * radius; i++)
+      weights[i] = (float)( tweights[i] / total);
+   free( tweights);
+   return( radius);
+}
+
+int smooth_map( int32_t *map, const int xsize, const int ysize,
+               const int kernel_type, const double size, const int n_threads)
+{
+   const size_t n_pixels = (size_t)xsize * (size_t)ysize;
+   int radius = make_kernel( NULL, kernel_type, size);
+   float *weights, *buff0, *buff1;
+   smooth_job_t job;
+   size_t i;
+   int rval;
+
+   if( radius < 0)
+      return( radius);
+   if( !radius)               /* nothing to do */
+      return( 0);
+   weights = (float *)malloc( (2 * radius + 1) * sizeof( float));
+   buff0 = (float *)malloc( n_pixels * sizeof( float));
+   buff1 = (float *)malloc( n_pixels * sizeof( float));
+   if( !weights || !buff0 || !buff1)
+      rval = SMOOTH_ALLOC_FAILED;
+   else
+      rval = make_kernel( weights, kernel_type, size);
+   if( rval >= 0)
+      {
+      for( i = 0; i < n_pixels; i++)
+         buff0[i] = (float)map[i];
+      job.weights = weights;
+      job.radius = radius;
+      job.xsize = xsize;
+      job.ysize = ysize;
+      job.src = buff0;
+      job.dest = buff1;
+      rval = run_pass( horizontal_pass, &job, n_threads);
+      }
+   if( !rval)
+      {
+      job.src = buff1;
+      job.dest = buff0;
+      rval = run_pass( vertical_pass, &job, n_threads);
+      }
+   if( !rval)            /* floats near INT32_MAX can round past it : */
+      for( i = 0; i < n_pixels; i++)
+         {
+         const double tval = floor( buff0[i] + .5);
+
+         if( tval >= (double)INT32_MAX)
+            map[i] = INT32_MAX;
+         else if( tval <= (double)INT32_MIN)
+            map[i] = INT32_MIN;
+         else
+            map[i] = (int32_t)tval;
+         }
+   free( weights);
+   free( buff0);
+   free( buff1);
+   return( rval);
+}
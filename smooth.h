@@ -0,0 +1,42 @@
+#ifndef SMOOTH_H_INCLUDED
+#define SMOOTH_H_INCLUDED
+
+/* Separable smoothing of equirectangular sky maps,  such as the
+'bright.zq' map made by 'bright.c'.  Public domain.  Please contact
+pluto (at) projectpluto.com with comments/bug fixes.  */
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+         /* Smooths the xsize x ysize map in place.  Rows run in RA,  and */
+         /* wrap around at RA=0/24h;  columns run in dec,  and the edge   */
+         /* values are repeated past the poles.  The meaning of 'size'    */
+         /* depends on the kernel type (see below).  'n_threads' rows are */
+         /* processed at once;  zero or one means "don't use threads".    */
+         /* Returns zero on success,  or a negative SMOOTH_ error code.   */
+int smooth_map( int32_t *map, const int xsize, const int ysize,
+               const int kernel_type, const double size, const int n_threads);
+
+         /* 'size' = radius in pixels;  all 2*radius+1 weights are equal */
+#define SMOOTH_BOX               0
+
+         /* 'size' = sigma in pixels;  kernel is cut off at 3 sigma      */
+#define SMOOTH_GAUSSIAN          1
+
+         /* 'size' = number of passes of the [1 2 1]/4 kernel 'make_map' */
+         /* has always used.  They're done as a single pass of radius n, */
+         /* with binomial weights.                                       */
+#define SMOOTH_BINOMIAL          2
+
+#define SMOOTH_ALLOC_FAILED     -1
+#define SMOOTH_BAD_KERNEL       -2
+#define SMOOTH_THREAD_FAILED    -3
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef SMOOTH_H_INCLUDED */
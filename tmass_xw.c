@@ -0,0 +1,148 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "tmass_xw.h"
+#include "mem_map.h"
+
+/* Code to look up stars in the 2MASS-keyed crosswalk made by 'make_xw.c'.
+See 'tmass_xw.h' for the file format.  Public domain.  */
+
+struct tmass_xw
+   {
+   const void *mapped;
+   size_t mapped_size, n_recs;
+   const tmass_xw_rec_t *recs;
+   };
+
+/* FNV-1a,  done on 32-bit words,  as for the UCAC4 index files. */
+
+uint32_t tmass_xw_checksum( const tmass_xw_rec_t *recs, const size_t n_recs)
+{
+   uint32_t rval = 2166136261u;
+   size_t i;
+   int j;
+
+   for( i = 0; i < n_recs; i++)
+      {
+      rval ^= recs[i].tmass_id;
+      rval *= 16777619u;
+      for( j = 0; j < TMASS_XW_N_CATALOGS; j++)
+         {
+         rval ^= recs[i].loc[j];
+         rval *= 16777619u;
+         }
+      }
+   return( rval);
+}
+
+tmass_xw_t *open_tmass_xw( const char *filename)
+{
+   size_t size;
+   const void *mapped = map_file_into_memory( filename, &size);
+   const uint32_t *header = (const uint32_t *)mapped;
+   tmass_xw_t *rval;
+
+   if( !mapped)
+      return( NULL);
+   if( size < TMASS_XW_HEADER_SIZE || header[0] != TMASS_XW_MAGIC
+               || header[1] != TMASS_XW_VERSION
+               || header[3] != TMASS_XW_N_CATALOGS
+               || size != TMASS_XW_HEADER_SIZE
+                             + (size_t)header[2] * sizeof( tmass_xw_rec_t)
+               || (rval = (tmass_xw_t *)calloc( 1, sizeof( tmass_xw_t))) == NULL)
+      {
+      unmap_file( mapped, size);
+      return( NULL);
+      }
+   rval->mapped = mapped;
+   rval->mapped_size = size;
+   rval->n_recs = header[2];
+   rval->recs = (const tmass_xw_rec_t *)(header + 8);
+   return( rval);
+}
+
+void close_tmass_xw( tmass_xw_t *xw)
+{
+   if( xw)
+      {
+      unmap_file( xw->mapped, xw->mapped_size);
+      free( xw);
+      }
+}
+
+size_t get_tmass_xw_n_records( const tmass_xw_t *xw)
+{
+   return( xw->n_recs);
+}
+
+/* Returns the index of the first record with 2MASS ID >= 'tmass_id',
+searching only from 'lo' onward.  */
+
+static size_t lower_bound( const tmass_xw_t *xw, size_t lo,
+                                          const uint32_t tmass_id)
+{
+   size_t hi = xw->n_recs;
+
+   while( lo < hi)
+      {
+      const size_t mid = (lo + hi) / 2;
+
+      if( xw->recs[mid].tmass_id < tmass_id)
+         lo = mid + 1;
+      else
+         hi = mid;
+      }
+   return( lo);
+}
+
+const tmass_xw_rec_t *find_tmass_xw( const tmass_xw_t *xw,
+                                     const uint32_t tmass_id)
+{
+   const size_t idx = lower_bound( xw, 0, tmass_id);
+
+   if( idx < xw->n_recs && xw->recs[idx].tmass_id == tmass_id)
+      return( xw->recs + idx);
+   return( NULL);
+}
+
+static int compare_uint64( const void *a, const void *b)
+{
+   const uint64_t a1 = *(const uint64_t *)a, b1 = *(const uint64_t *)b;
+
+   return( a1 > b1 ? 1 : (a1 < b1 ? -1 : 0));
+}
+
+/* Each ID is paired with its index in the caller's array,  in one
+uint64_t,  so that after sorting we know where each result goes.  Since
+the IDs are then in order,  each search can start where the previous one
+stopped,  and the parts of the file we touch are touched in order.  */
+
+long find_tmass_xw_bulk( const tmass_xw_t *xw, const size_t n_ids,
+                  const uint32_t *ids, tmass_xw_rec_t *results)
+{
+   uint64_t *keys = (uint64_t *)malloc( n_ids * sizeof( uint64_t) + 1);
+   size_t i, lo = 0;
+   long n_found = 0;
+
+   if( !keys)
+      return( -1);
+   for( i = 0; i < n_ids; i++)
+      keys[i] = ((uint64_t)ids[i] << 32) | (uint64_t)i;
+   qsort( keys, n_ids, sizeof( uint64_t), compare_uint64);
+   for( i = 0; i < n_ids; i++)
+      {
+      const uint32_t tmass_id = (uint32_t)( keys[i] >> 32);
+      tmass_xw_rec_t *result = results + (size_t)( keys[i] & 0xffffffffu);
+
+      lo = lower_bound( xw, lo, tmass_id);
+      if( lo < xw->n_recs && xw->recs[lo].tmass_id == tmass_id)
+         {
+         *result = xw->recs[lo];
+         n_found++;
+         }
+      else
+         memset( result, 0, sizeof( tmass_xw_rec_t));
+      }
+   free( keys);
+   return( n_found);
+}
@@ -0,0 +1,80 @@
+#ifndef TMASS_XW_H_INCLUDED
+#define TMASS_XW_H_INCLUDED
+
+/* A "crosswalk" between catalogs,  keyed by 2MASS ID.  UCAC4,  URAT1,
+UCAC3 and UCAC2 all give the 2MASS pts_key of each star matched to 2MASS
+(which is most of them).  'make_xw.c' reads through whichever of those
+catalogs you have and writes a file listing,  for each 2MASS ID,  where
+that star is in each catalog.  With that,  finding a UCAC4 star in URAT1
+(say) is a lookup rather than a positional search.  Public domain.
+
+   The file starts with eight uint32_ts :  TMASS_XW_MAGIC;  the version
+(currently 1);  the number of records;  the number of catalogs (4);  the
+checksum of the records,  as computed by tmass_xw_checksum( );  and three
+zeroes.  Then come the records,  sorted by 2MASS ID,  each five uint32_ts
+as in 'tmass_xw_rec_t'.  Each catalog's location is zero if the star
+isn't in that catalog (or that catalog wasn't available when the file
+was made),  otherwise the zone times 2^22 plus the one-based offset
+within the zone.  (For UCAC2,  ucac2_star_number( ) will turn that into
+the usual UCAC2 number.)  Everything is in the byte order of the machine
+that made the file;  on a machine with the other byte order,  the magic
+number won't match and the file won't be used.  */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define TMASS_XW_UCAC4        0
+#define TMASS_XW_URAT1        1
+#define TMASS_XW_UCAC3        2
+#define TMASS_XW_UCAC2        3
+#define TMASS_XW_N_CATALOGS   4
+
+typedef struct
+   {
+   uint32_t tmass_id;
+   uint32_t loc[TMASS_XW_N_CATALOGS];
+   } tmass_xw_rec_t;
+
+#define TMASS_XW_MAGIC          0x2a55c0de
+#define TMASS_XW_VERSION        1
+#define TMASS_XW_HEADER_SIZE    (8 * sizeof( uint32_t))
+
+#define TMASS_XW_ZONE( loc)      ((loc) >> 22)
+#define TMASS_XW_OFFSET( loc)    ((loc) & 0x3fffff)
+#define TMASS_XW_LOC( zone, offset)  \
+                     (((uint32_t)(zone) << 22) | (uint32_t)(offset))
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+typedef struct tmass_xw tmass_xw_t;
+
+         /* The file is memory-mapped,  so opening it is nearly free.   */
+         /* Returns NULL if the file can't be found or its header is    */
+         /* wrong.  The checksum isn't checked here ('make_xw -v' will  */
+         /* do that.)                                                   */
+tmass_xw_t *open_tmass_xw( const char *filename);
+void close_tmass_xw( tmass_xw_t *xw);
+size_t get_tmass_xw_n_records( const tmass_xw_t *xw);
+
+         /* Returns NULL if the 2MASS ID isn't in the crosswalk. */
+const tmass_xw_rec_t *find_tmass_xw( const tmass_xw_t *xw,
+                                     const uint32_t tmass_id);
+
+         /* Looks up 'n_ids' 2MASS IDs at once,  filling in 'results'  */
+         /* in the same order as 'ids'.  Any not found get a record of */
+         /* all zeroes.  The IDs are sorted first,  so that the lookups */
+         /* walk through the file in order;  for large batches,  that's */
+         /* much faster than doing them one at a time.  Returns the     */
+         /* number found,  or -1 if memory ran out.                     */
+long find_tmass_xw_bulk( const tmass_xw_t *xw, const size_t n_ids,
+                  const uint32_t *ids, tmass_xw_rec_t *results);
+
+uint32_t tmass_xw_checksum( const tmass_xw_rec_t *recs, const size_t n_recs);
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef TMASS_XW_H_INCLUDED */
@@ -23,12 +23,134 @@ static void show_error_message( void)
            "ucac2 50 -16.3 2 1.5 " example_path "\n\n"
            "would extract a 2-degree wide,  1.5-degree high area centered\n"
            "on RA=50 degrees=3h20m, dec=-16.3,  with the data drawn from\n"
-           "the path " example_path ".  Data will be written to the file 'ucac2.txt'.\n");
+           "the path " example_path ".  Data will be written to the file 'ucac2.txt'.\n"
+           "\nThe main catalog is extracted,  then the Bright Star Supplement.\n"
+           "-b gets both in one pass,  in zone order,  instead.\n"
+           "-c checks that looking up the stars in those zones in bulk gets\n"
+           "the same results as looking them up one at a time.\n");
 }
 
-int main( const int argc, const char **argv)
+/* For '-c' :  the stars in the zones covering the rectangle are looked
+up in a scrambled order (with some repeats and some bad numbers thrown
+in),  using extract_ucac2_info_bulk(),  and the results are compared to
+those from looking the stars up one at a time.  Returns the number of
+stars that didn't match.  */
+
+typedef struct
+   {
+   long *numbers;
+   size_t n, n_alloced;
+   } number_list_t;
+
+static int add_number( number_list_t *list, const long number)
 {
-   int pass, rval = -9;
+   if( list->n == list->n_alloced)
+      {
+      const size_t new_size = list->n_alloced * 2 + 100;
+      long *new_numbers = (long *)realloc( list->numbers,
+                                             new_size * sizeof( long));
+
+      if( !new_numbers)
+         return( -1);
+      list->numbers = new_numbers;
+      list->n_alloced = new_size;
+      }
+   list->numbers[list->n++] = number;
+   return( 0);
+}
+
+static int add_star_number( void *context, const int zone,
+                        const uint32_t offset, const UCAC2_STAR *star)
+{
+   (void)star;
+   return( add_number( (number_list_t *)context,
+                       ucac2_star_number( zone, (long)offset + 1L)));
+}
+
+static long check_bulk_lookups( const double dec, const double height,
+                                const char *path)
+{
+   number_list_t list;
+   int zone = (int)( (dec - height / 2. + 90.) / .5) + 1;
+   int end_zone = (int)( (dec + height / 2. + 90.) / .5) + 1;
+   UCAC2_STAR *stars, star;
+   int *rvals;
+   size_t i, n_real, n_errors = 0;
+   long n_bad = 0;
+
+   memset( &list, 0, sizeof( list));
+   if( zone < 1)
+      zone = 1;
+   if( end_zone > 288)
+      end_zone = 288;
+   for( ; zone <= end_zone; zone++)
+      for_each_ucac2_star_in_zone( zone, path, &list, add_star_number);
+   n_real = list.n;
+   add_number( &list, 0L);                   /* bad numbers */
+   add_number( &list, 99999999L);
+   for( i = 0; i < n_real / 10; i++)         /* a few repeats */
+      add_number( &list, list.numbers[i * 7 % n_real]);
+   srand( 1);
+   for( i = list.n - 1; i > 0; i--)          /* scramble the order */
+      {
+      const size_t j = (size_t)rand( ) % (i + 1);
+      const long tval = list.numbers[i];
+
+      list.numbers[i] = list.numbers[j];
+      list.numbers[j] = tval;
+      }
+   stars = (UCAC2_STAR *)malloc( list.n * sizeof( UCAC2_STAR) + 1);
+   rvals = (int *)malloc( list.n * sizeof( int) + 1);
+   if( !stars || !rvals || list.n < n_real
+          || extract_ucac2_info_bulk( list.n, list.numbers, stars, rvals,
+                                      path) < 0)
+      n_bad = -1;
+   for( i = 0; n_bad >= 0 && i < list.n; i++)
+      {
+      const int rval = extract_ucac2_info( list.numbers[i], &star, path);
+
+      if( rval)
+         n_errors++;
+      if( rval != rvals[i] || (!rval && memcmp( &star, stars + i,
+                                                  sizeof( UCAC2_STAR))))
+         {
+         printf( "Star %ld:  got %d in bulk,  %d singly\n",
+                  list.numbers[i], rvals[i], rval);
+         n_bad++;
+         }
+      }
+   printf( "%lu bulk lookups checked (%lu gave errors);  %ld mismatches\n",
+            (unsigned long)list.n, (unsigned long)n_errors, n_bad);
+   free( stars);
+   free( rvals);
+   free( list.numbers);
+   return( n_bad);
+}
+
+int main( int argc, const char **argv)
+{
+   int pass, rval = -9, i, j, check_bulk = 0, one_pass = 0;
+
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] > '9')
+         {
+         switch( argv[i][1])
+            {
+            case 'b': case 'B':
+               one_pass = 1;
+               break;
+            case 'c': case 'C':
+               check_bulk = 1;
+               break;
+            default:
+               printf( "%s is an unrecognized option\n", argv[i]);
+               break;
+            }
+         for( j = i; j < argc - 1; j++)      /* remove this argument */
+            argv[j] = argv[j + 1];
+         i--;
+         argc--;
+         }
 
    if( argc == 2 || argc == 3)
       {
@@ -53,7 +175,15 @@ int main( const int argc, const char **argv)
       {
       FILE *ofile = fopen( "ucac2.txt", "w");
 
-      for( pass = 0; pass < 2; pass++)
+      if( one_pass)
+         {
+         rval = extract_ucac2_all_stars( ofile, atof( argv[1]),
+                                         atof( argv[2]),
+                                         atof( argv[3]), atof( argv[4]),
+                                         (argc > 5 ? argv[5] : ""));
+         printf( "%d stars extracted\n", rval);
+         }
+      else for( pass = 0; pass < 2; pass++)
          {
          rval = extract_ucac2_stars( ofile, atof( argv[1]), atof( argv[2]),
                                             atof( argv[3]), atof( argv[4]),
@@ -62,6 +192,9 @@ int main( const int argc, const char **argv)
          printf( "%d stars extracted\n", rval);
          }
       fclose( ofile);
+      if( check_bulk && check_bulk_lookups( atof( argv[2]), atof( argv[4]),
+                                            (argc > 5 ? argv[5] : "")))
+         rval = -3;
       }
    return( rval);
 }
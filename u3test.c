@@ -23,6 +23,7 @@ static void show_error_message( void)
    printf( "would extract a 2-degree wide,  1.5-degree high area centered\n");
    printf( "on RA=50 degrees=3h20m, dec=-16.3,  with the data drawn from\n");
    printf( "the path d:\\u3.  Data will be written to the file 'ucac3.txt'.\n");
+   printf( "Add '-b' to get Bright Star Supplement stars as well.\n");
 }
 
 int main( const int argc, const char **argv)
@@ -58,7 +59,7 @@ int main( const int argc, const char **argv)
    else
       {
       FILE *ofile = fopen( "ucac3.txt", "w");
-      int i;
+      int i, include_supplement = 0;
       unsigned format = UCAC3_WRITE_SPACES;
 
       for( i = 5; i < argc; i++)
@@ -82,6 +83,9 @@ catflags g1c1 leda x2m  rn   \n");
                      fprintf( ofile, "running# \n");
                      }
                   break;
+               case 'b': case 'B':
+                  include_supplement = 1;
+                  break;
                case 'f': case 'F':
                   sscanf( argv[i] + 2, "%x", &format);
                   break;
@@ -89,7 +93,13 @@ catflags g1c1 leda x2m  rn   \n");
                   printf( "%s is an unrecognized option\n", argv[i]);
                   break;
                }
-      rval = extract_ucac3_stars( ofile, atof( argv[1]), atof( argv[2]),
+      if( include_supplement)
+         rval = extract_ucac3_all_stars( ofile, atof( argv[1]),
+                                         atof( argv[2]),
+                                         atof( argv[3]), atof( argv[4]),
+                                         (argc > 5 ? argv[5] : ""), format);
+      else
+         rval = extract_ucac3_stars( ofile, atof( argv[1]), atof( argv[2]),
                                          atof( argv[3]), atof( argv[4]),
                                          (argc > 5 ? argv[5] : ""), 0,
                                          format);
@@ -0,0 +1,156 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ucac4.h"
+
+/* Converts the UCAC4 ASCII index 'u4index.asc' to the binary form
+'u4index.bin' described in 'ucac4.h'.  Run as
+
+./u4_index (directory containing u4index.asc) [output file name]
+
+   The output defaults to 'u4index.bin' in the current directory;  you'll
+probably want to move it to wherever 'u4index.asc' lives,  since that's
+where ucac4.c will look for it.  After writing,  the file is read back
+and its checksum verified.  Run as
+
+./u4_index -v (path to u4index.bin)
+
+   to just verify an existing binary index.  */
+
+#if defined( __linux__) || defined( __unix__) || defined( __APPLE__)
+   static const char *path_separator = "/";
+#elif defined( _WIN32) || defined( _WIN64) || defined( __WATCOMC__)
+   static const char *path_separator = "\\";
+#else
+#error "Unknown platform; please report so it can be fixed!"
+#endif
+
+#define N_ZONES     900
+#define N_RA_BINS  1440
+#define N_WORDS    (N_ZONES * N_RA_BINS * 2)
+
+/* Reads back a binary index and checks its header and checksum.
+Returns 0 if all is well. */
+
+static int verify_binary_index( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   uint32_t header[8], *data = (uint32_t *)malloc( N_WORDS * sizeof( uint32_t));
+   int rval = 0;
+
+   if( !ifile)
+      {
+      fprintf( stderr, "Couldn't open '%s'\n", filename);
+      rval = -1;
+      }
+   else if( !data)
+      {
+      fprintf( stderr, "Out of memory\n");
+      rval = -5;
+      }
+   else if( fread( header, sizeof( uint32_t), 8, ifile) != 8
+               || fread( data, sizeof( uint32_t), N_WORDS, ifile) != N_WORDS)
+      {
+      fprintf( stderr, "'%s' is too short\n", filename);
+      rval = -2;
+      }
+   else if( header[0] != UCAC4_BIN_INDEX_MAGIC
+            || header[1] != UCAC4_BIN_INDEX_VERSION
+            || header[2] != N_ZONES || header[3] != N_RA_BINS)
+      {
+      fprintf( stderr, "'%s' has a bad header\n", filename);
+      rval = -3;
+      }
+   else if( header[4] != ucac4_index_checksum( data, N_WORDS))
+      {
+      fprintf( stderr, "'%s' has a bad checksum\n", filename);
+      rval = -4;
+      }
+   if( ifile)
+      fclose( ifile);
+   free( data);
+   return( rval);
+}
+
+int main( const int argc, const char **argv)
+{
+   const char *output_filename = (argc > 2 ? argv[2] : "u4index.bin");
+   uint32_t header[8], *data;
+   char filename[255], buff[50];
+   FILE *ifile, *ofile;
+   int i = 0;
+
+   if( argc < 2)
+      {
+      fprintf( stderr, "Usage : u4_index (u4index.asc directory) [output file]\n"
+                       "    or  u4_index -v (binary index to verify)\n");
+      return( -1);
+      }
+   if( !strcmp( argv[1], "-v"))
+      {
+      if( argc < 3 || verify_binary_index( argv[2]))
+         return( -1);
+      printf( "'%s' is a valid binary index\n", argv[2]);
+      return( 0);
+      }
+   if( strlen( argv[1]) + 13 > sizeof( filename))
+      {
+      fprintf( stderr, "Path '%s' is too long\n", argv[1]);
+      return( -2);
+      }
+   strcpy( filename, argv[1]);
+   if( *filename && filename[strlen( filename) - 1] != path_separator[0])
+      strcat( filename, path_separator);
+   strcat( filename, "u4index.asc");
+   ifile = fopen( filename, "rb");
+   if( !ifile)
+      {
+      fprintf( stderr, "Couldn't open '%s'\n", filename);
+      return( -2);
+      }
+   data = (uint32_t *)malloc( N_WORDS * sizeof( uint32_t));
+   if( !data)
+      {
+      fprintf( stderr, "Out of memory\n");
+      return( -3);
+      }
+            /* Each line has the offset and count,  then stuff we ignore: */
+   while( i < N_WORDS && fgets( buff, sizeof( buff), ifile))
+      {
+      char *endptr;
+
+      data[i] = (uint32_t)strtoul( buff, &endptr, 10);
+      if( endptr == buff)
+         break;
+      data[i + 1] = (uint32_t)strtoul( endptr, NULL, 10);
+      i += 2;
+      }
+   fclose( ifile);
+   if( i != N_WORDS)
+      {
+      fprintf( stderr, "Only %d of %d index lines could be read\n",
+                        i / 2, N_WORDS / 2);
+      return( -4);
+      }
+   memset( header, 0, sizeof( header));
+   header[0] = UCAC4_BIN_INDEX_MAGIC;
+   header[1] = UCAC4_BIN_INDEX_VERSION;
+   header[2] = N_ZONES;
+   header[3] = N_RA_BINS;
+   header[4] = ucac4_index_checksum( data, N_WORDS);
+   ofile = fopen( output_filename, "wb");
+   if( !ofile)
+      {
+      fprintf( stderr, "Couldn't create '%s'\n", output_filename);
+      return( -5);
+      }
+   fwrite( header, sizeof( uint32_t), 8, ofile);
+   fwrite( data, sizeof( uint32_t), N_WORDS, ofile);
+   fclose( ofile);
+   free( data);
+   if( verify_binary_index( output_filename))
+      return( -6);
+   printf( "'%s' written and verified\n", output_filename);
+   return( 0);
+}
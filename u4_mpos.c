@@ -0,0 +1,183 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ucac4.h"
+
+/* Makes 'u4mpos.bin',  the index described in 'ucac4.h' that lets
+find_ucac4_star_by_id() go straight from a star's id_number (MPOS number)
+to its zone and offset.  Run as
+
+./u4_mpos (path to UCAC4 data) [output file name]
+
+   All 900 zones are read,  so this takes as long as it takes to read
+the catalog (about 9 GBytes).  The output defaults to 'u4mpos.bin' in
+the current directory;  move it to wherever 'u4index.asc' lives.  After
+writing,  the file is read back and its checksum verified.  Run as
+
+./u4_mpos -v (path to u4mpos.bin)
+
+   to just verify an existing file.  */
+
+#define N_ZONES     900
+
+typedef struct
+   {
+   uint32_t *table;
+   uint32_t n_entries, n_stars, n_duplicates;
+   } mpos_table_t;
+
+static int add_star( void *context, const int zone, const uint32_t offset,
+                     const UCAC4_STAR *star)
+{
+   mpos_table_t *m = (mpos_table_t *)context;
+   const uint32_t id = star->id_number;
+
+   if( id >= m->n_entries)        /* expand the table */
+      {
+      uint32_t new_size = (m->n_entries ? m->n_entries : 1u << 20);
+      uint32_t *new_table;
+
+      while( new_size <= id)
+         new_size *= 2;
+      new_table = (uint32_t *)realloc( m->table,
+                                       new_size * sizeof( uint32_t));
+      if( !new_table)
+         {
+         fprintf( stderr, "Out of memory\n");
+         exit( -1);
+         }
+      memset( new_table + m->n_entries, 0,
+                     (new_size - m->n_entries) * sizeof( uint32_t));
+      m->table = new_table;
+      m->n_entries = new_size;
+      }
+   if( m->table[id])
+      {
+      if( m->n_duplicates++ < 10)
+         fprintf( stderr, "id_number %lu appears twice\n", (unsigned long)id);
+      }
+   m->table[id] = UCAC4_MPOS_ENTRY( zone, offset + 1);
+   m->n_stars++;
+   return( 0);
+}
+
+/* Reads back an MPOS index and checks its header and checksum.
+Returns 0 if all is well. */
+
+static int verify_mpos_index( const char *filename)
+{
+   FILE *ifile = fopen( filename, "rb");
+   uint32_t header[8], *data = NULL;
+   int rval = 0;
+
+   if( !ifile)
+      {
+      fprintf( stderr, "Couldn't open '%s'\n", filename);
+      return( -1);
+      }
+   if( fread( header, sizeof( uint32_t), 8, ifile) != 8
+               || header[0] != UCAC4_MPOS_MAGIC
+               || header[1] != UCAC4_MPOS_VERSION)
+      {
+      fprintf( stderr, "'%s' has a bad header\n", filename);
+      rval = -3;
+      }
+   else if( (data = (uint32_t *)malloc( header[2] * sizeof( uint32_t))) == NULL)
+      {
+      fprintf( stderr, "Out of memory\n");
+      rval = -5;
+      }
+   else if( fread( data, sizeof( uint32_t), header[2], ifile) != header[2])
+      {
+      fprintf( stderr, "'%s' is too short\n", filename);
+      rval = -2;
+      }
+   else if( header[4] != ucac4_index_checksum( data, header[2]))
+      {
+      fprintf( stderr, "'%s' has a bad checksum\n", filename);
+      rval = -4;
+      }
+   fclose( ifile);
+   free( data);
+   return( rval);
+}
+
+int main( const int argc, const char **argv)
+{
+   const char *output_filename = (argc > 2 ? argv[2] : "u4mpos.bin");
+   ucac4_catalog_t *cat;
+   mpos_table_t m;
+   uint32_t header[8];
+   FILE *ofile;
+   int zone, n_missing = 0;
+
+   if( argc < 2)
+      {
+      fprintf( stderr, "Usage : u4_mpos (path to UCAC4) [output file]\n"
+                       "    or  u4_mpos -v (MPOS index to verify)\n");
+      return( -1);
+      }
+   if( !strcmp( argv[1], "-v"))
+      {
+      if( argc < 3 || verify_mpos_index( argv[2]))
+         return( -1);
+      printf( "'%s' is a valid MPOS index\n", argv[2]);
+      return( 0);
+      }
+   cat = open_ucac4_catalog( argv[1]);
+   if( !cat)
+      {
+      fprintf( stderr, "Couldn't open the catalog\n");
+      return( -2);
+      }
+   memset( &m, 0, sizeof( m));
+   for( zone = 1; zone <= N_ZONES; zone++)
+      {
+      const int n_found = for_each_ucac4_star_in_zone( cat, zone, &m, add_star);
+
+      if( n_found < 0)     /* not fatal;  you may have only part of */
+         n_missing++;      /* the catalog,  and that's fine */
+      if( zone % 50 == 0)
+         printf( "Zone %d : %lu stars so far\n", zone, (unsigned long)m.n_stars);
+      }
+   close_ucac4_catalog( cat);
+   if( n_missing == N_ZONES)
+      {
+      fprintf( stderr, "No UCAC4 data found in '%s'\n", argv[1]);
+      return( -3);
+      }
+   if( n_missing)
+      printf( "%d zones couldn't be read;  their stars aren't indexed\n",
+                              n_missing);
+   if( m.n_duplicates)
+      {
+      fprintf( stderr, "%lu duplicate id_numbers found\n",
+                              (unsigned long)m.n_duplicates);
+      return( -4);
+      }
+   while( m.n_entries && !m.table[m.n_entries - 1])
+      m.n_entries--;          /* trim unused space from the end */
+   memset( header, 0, sizeof( header));
+   header[0] = UCAC4_MPOS_MAGIC;
+   header[1] = UCAC4_MPOS_VERSION;
+   header[2] = m.n_entries;
+   header[3] = m.n_stars;
+   header[4] = ucac4_index_checksum( m.table, m.n_entries);
+   ofile = fopen( output_filename, "wb");
+   if( !ofile)
+      {
+      fprintf( stderr, "Couldn't create '%s'\n", output_filename);
+      return( -5);
+      }
+   fwrite( header, sizeof( uint32_t), 8, ofile);
+   fwrite( m.table, sizeof( uint32_t), m.n_entries, ofile);
+   fclose( ofile);
+   free( m.table);
+   if( verify_mpos_index( output_filename))
+      return( -6);
+   printf( "'%s' written and verified :  %lu stars,  highest ID %lu\n",
+               output_filename, (unsigned long)m.n_stars,
+               (unsigned long)m.n_entries - 1);
+   return( 0);
+}
@@ -0,0 +1,240 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "ucac4.h"
+
+/* Repacks UCAC4 zone files into the 'hot' and 'cold' files described
+in 'ucac4.h'.  Run as
+
+./u4split (path to UCAC4) (output folder) [first zone] [last zone]
+
+   For each zone zNNN found,  hNNN (20 bytes/star) and cNNN (60 bytes/
+star) are written to the output folder.  Each pair is read back and
+checked against the original before going on to the next zone.  Once
+they're in place (in any folder ucac4.c would look for zNNN),  they're
+used instead of the zNNN files,  which you can then delete if you need
+the space.  The index files are unchanged,  since the stars are in the
+same order.
+
+   Zones default to 1 to 900;  missing zones are skipped.  (Running this
+with the output folder the same as the input is fine;  the zone being
+split is always read before its split files are written.)  */
+
+#define N_ZONES     900
+
+typedef struct
+   {
+   UCAC4_STAR *stars;
+   size_t n_stars, n_alloced;
+   } zone_stars_t;
+
+static int add_star( void *context, const int zone, const uint32_t offset,
+                     const UCAC4_STAR *star)
+{
+   zone_stars_t *z = (zone_stars_t *)context;
+
+   if( z->n_stars == z->n_alloced)
+      {
+      const size_t new_size = (z->n_alloced ? z->n_alloced * 2 : 65536);
+      UCAC4_STAR *new_stars = (UCAC4_STAR *)realloc( z->stars,
+                                  new_size * sizeof( UCAC4_STAR));
+
+      if( !new_stars)
+         {
+         fprintf( stderr, "Out of memory\n");
+         exit( -1);
+         }
+      z->stars = new_stars;
+      z->n_alloced = new_size;
+      }
+   z->stars[z->n_stars++] = *star;
+   (void)zone;
+   (void)offset;
+   return( 0);
+}
+
+/* The split files are in the same byte order as the zone files.  On
+big-endian machines,  for_each_ucac4_star_in_zone() gives us flipped
+stars;  the hot 'flags' must be found from the flipped star,  but the
+data written must be unflipped.  */
+
+static void split_star( ucac4_hot_t *hot, ucac4_cold_t *cold,
+                        const UCAC4_STAR *star)
+{
+   split_ucac4_star( hot, cold, star);
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   {
+   const uint8_t flags = hot->flags;
+   UCAC4_STAR raw = *star;
+
+   flip_ucac4_star( &raw);
+   split_ucac4_star( hot, cold, &raw);
+   hot->flags = flags;
+   }
+#endif
+#endif
+}
+
+static void make_filename( char *filename, const char *folder,
+                           const char prefix, const int zone)
+{
+   const size_t len = strlen( folder);
+
+   strcpy( filename, folder);
+   if( len && folder[len - 1] != '/' && folder[len - 1] != '\\')
+      strcat( filename, "/");
+   sprintf( filename + strlen( filename), "%c%03d", prefix, zone);
+}
+
+/* Writes out the hot and cold files for a zone,  then reads them back
+and makes sure joining them gets us the original stars.  ucac4.c will
+use a split pair in preference to zNNN,  so a bad or half-written pair
+would quietly replace good data.  The files are therefore written as
+hNNN.tmp and cNNN.tmp,  and only renamed once they've been verified;
+on any failure,  both are removed.  */
+
+static int write_and_verify( const char *hot_name, const char *cold_name,
+                             const zone_stars_t *z)
+{
+   FILE *hot_file = fopen( hot_name, "wb");
+   FILE *cold_file = fopen( cold_name, "wb");
+   ucac4_hot_t hot;
+   ucac4_cold_t cold;
+   size_t i;
+   int rval = 0;
+
+   if( !hot_file || !cold_file)
+      {
+      fprintf( stderr, "Couldn't create '%s' or '%s'\n", hot_name, cold_name);
+      if( hot_file)
+         fclose( hot_file);
+      if( cold_file)
+         fclose( cold_file);
+      return( -1);
+      }
+   for( i = 0; i < z->n_stars; i++)
+      {
+      split_star( &hot, &cold, z->stars + i);
+      fwrite( &hot, sizeof( ucac4_hot_t), 1, hot_file);
+      fwrite( &cold, sizeof( ucac4_cold_t), 1, cold_file);
+      }
+   if( fclose( hot_file) | fclose( cold_file))
+      {
+      fprintf( stderr, "Error writing '%s' or '%s'\n", hot_name, cold_name);
+      return( -2);
+      }
+   hot_file = fopen( hot_name, "rb");
+   cold_file = fopen( cold_name, "rb");
+   if( !hot_file || !cold_file)
+      {
+      fprintf( stderr, "Couldn't re-open '%s' or '%s'\n", hot_name, cold_name);
+      if( hot_file)
+         fclose( hot_file);
+      if( cold_file)
+         fclose( cold_file);
+      return( -6);
+      }
+   for( i = 0; !rval && i < z->n_stars; i++)
+      {
+      UCAC4_STAR star, orig = z->stars[i];
+
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+      flip_ucac4_star( &orig);
+#endif
+#endif
+      if( fread( &hot, sizeof( ucac4_hot_t), 1, hot_file) != 1
+               || fread( &cold, sizeof( ucac4_cold_t), 1, cold_file) != 1)
+         rval = -3;
+      else
+         {
+         join_ucac4_star( &star, &hot, &cold);
+         if( memcmp( &star, &orig, sizeof( UCAC4_STAR)))
+            rval = -4;
+         }
+      }
+   if( !rval && (fgetc( hot_file) != EOF || fgetc( cold_file) != EOF))
+      rval = -5;
+   fclose( hot_file);
+   fclose( cold_file);
+   return( rval);
+}
+
+static int write_split_zone( const char *folder, const int zone,
+                             const zone_stars_t *z)
+{
+   char hot_name[300], cold_name[300], hot_tmp[310], cold_tmp[310];
+   int rval;
+
+   make_filename( hot_name, folder, 'h', zone);
+   make_filename( cold_name, folder, 'c', zone);
+   sprintf( hot_tmp, "%s.tmp", hot_name);
+   sprintf( cold_tmp, "%s.tmp", cold_name);
+   rval = write_and_verify( hot_tmp, cold_tmp, z);
+   if( !rval)
+      {           /* rename() won't replace existing files on Windows */
+      remove( hot_name);
+      remove( cold_name);
+      if( rename( hot_tmp, hot_name) || rename( cold_tmp, cold_name))
+         {
+         fprintf( stderr, "Couldn't rename '%s' or '%s'\n", hot_tmp, cold_tmp);
+         remove( hot_name);      /* don't leave half a pair */
+         rval = -7;
+         }
+      }
+   if( rval)
+      {
+      fprintf( stderr, "Zone %d wasn't split (%d)\n", zone, rval);
+      remove( hot_tmp);
+      remove( cold_tmp);
+      }
+   return( rval);
+}
+
+int main( const int argc, const char **argv)
+{
+   const int first_zone = (argc > 3 ? atoi( argv[3]) : 1);
+   const int last_zone = (argc > 4 ? atoi( argv[4]) : N_ZONES);
+   ucac4_catalog_t *cat;
+   zone_stars_t z;
+   int zone, n_split = 0;
+   long total_stars = 0;
+
+   if( argc < 3)
+      {
+      fprintf( stderr, "Usage : u4split (path to UCAC4) (output folder)"
+                       " [first zone] [last zone]\n");
+      return( -1);
+      }
+   cat = open_ucac4_catalog( argv[1]);
+   if( !cat)
+      {
+      fprintf( stderr, "Couldn't open the catalog\n");
+      return( -2);
+      }
+   memset( &z, 0, sizeof( z));
+   for( zone = first_zone; zone <= last_zone; zone++)
+      {
+      z.n_stars = 0;
+      if( for_each_ucac4_star_in_zone( cat, zone, &z, add_star) >= 0)
+         {
+         if( write_split_zone( argv[2], zone, &z))
+            return( -3);
+         n_split++;
+         total_stars += (long)z.n_stars;
+         }
+      if( zone % 50 == 0)
+         printf( "Zone %d : %ld stars so far\n", zone, total_stars);
+      }
+   close_ucac4_catalog( cat);
+   free( z.stars);
+   if( !n_split)
+      {
+      fprintf( stderr, "No UCAC4 data found in '%s'\n", argv[1]);
+      return( -4);
+      }
+   printf( "%d zones (%ld stars) split and verified\n", n_split, total_stars);
+   return( 0);
+}
@@ -27,6 +27,13 @@ static void show_error_message( void)
    printf( "\nOptionally, one may add command line options -h to include a header\n");
    printf( "line,  and/or -f4 to get the same output as from the FORTRAN code.\n");
    printf( "Also,  one can optionally add an output file name (default is ucac4.txt).\n");
+   printf( "\nA single star can be shown by giving its zone and offset (e.g.,\n");
+   printf( "u4test 314-159265);  its cumulative number (e.g.,  u4test 27182818);\n");
+   printf( "or,  if you've made 'u4mpos.bin' with u4_mpos,  its MPOS number\n");
+   printf( "(e.g.,  u4test m14142135).\n");
+   printf( "\nFor big areas,  -p4 (say) will use four threads to read zones.\n");
+   printf( "-c checks that looking up the extracted stars in bulk gets the\n");
+   printf( "same results as looking them up one at a time.\n");
 }
 
 static const char *fortran_header = "       ran      spdn  mag1  mag2 smot\
@@ -39,9 +46,117 @@ static const char *usual_header = "  UCAC4        RA             dec     \
   2MASS ID  mag_j  mag_h  mag_k  e2mphos    icq_flag  Bmag   Vmag   gmag   rmag\
    imag  sig_B sig_V sig_g sig_r sig_i catflags  Ya Led 2MX  ID numb  UCAC2 ID";
 
+/* For '-c' :  the stars found in the rectangle are looked up again,
+in a scrambled order (with some repeats and some bad IDs thrown in),
+using extract_ucac4_info_bulk(),  and the results are compared to those
+from looking the stars up one at a time.  Returns the number of stars
+that didn't match.  */
+
+typedef struct
+   {
+   int *zones;
+   long *offsets;
+   size_t n, n_alloced;
+   } id_list_t;
+
+static int add_id( id_list_t *ids, const int zone, const long offset)
+{
+   if( ids->n == ids->n_alloced)
+      {
+      const size_t new_size = ids->n_alloced * 2 + 100;
+      int *new_zones = (int *)realloc( ids->zones, new_size * sizeof( int));
+      long *new_offsets;
+
+      if( !new_zones)
+         return( -1);
+      ids->zones = new_zones;
+      new_offsets = (long *)realloc( ids->offsets, new_size * sizeof( long));
+      if( !new_offsets)
+         return( -1);
+      ids->offsets = new_offsets;
+      ids->n_alloced = new_size;
+      }
+   ids->zones[ids->n] = zone;
+   ids->offsets[ids->n] = offset;
+   ids->n++;
+   return( 0);
+}
+
+static int add_star_id( void *context, const int zone, const uint32_t offset,
+                           const UCAC4_STAR *star)
+{
+   (void)star;
+   return( add_id( (id_list_t *)context, zone, (long)offset + 1L));
+}
+
+static long check_bulk_lookups( ucac4_catalog_t *cat, const double ra,
+               const double dec, const double width, const double height)
+{
+   id_list_t ids;
+   UCAC4_STAR *stars, star;
+   int *rvals;
+   size_t i, n_real, n_errors = 0;
+   long n_bad = 0;
+
+   memset( &ids, 0, sizeof( ids));
+   extract_ucac4_stars_callback_from_catalog( cat, &ids, add_star_id,
+                              ra, dec, width, height, 0);
+   n_real = ids.n;
+   add_id( &ids, 0, 1L);                     /* bad zones */
+   add_id( &ids, 901, 1L);
+   for( i = 0; i < n_real && i < 3; i++)
+      {
+      add_id( &ids, ids.zones[i], 1000000000L);    /* past end of zone */
+      add_id( &ids, ids.zones[i], 0L);             /* bad offset */
+      }
+   for( i = 0; i < n_real / 10; i++)         /* a few repeats */
+      add_id( &ids, ids.zones[i * 7 % n_real], ids.offsets[i * 7 % n_real]);
+   srand( 1);
+   for( i = ids.n - 1; i > 0; i--)           /* scramble the order */
+      {
+      const size_t j = (size_t)rand( ) % (i + 1);
+      const int tzone = ids.zones[i];
+      const long toffset = ids.offsets[i];
+
+      ids.zones[i] = ids.zones[j];
+      ids.offsets[i] = ids.offsets[j];
+      ids.zones[j] = tzone;
+      ids.offsets[j] = toffset;
+      }
+   stars = (UCAC4_STAR *)malloc( ids.n * sizeof( UCAC4_STAR) + 1);
+   rvals = (int *)malloc( ids.n * sizeof( int) + 1);
+   if( !stars || !rvals || ids.n < n_real
+          || extract_ucac4_info_bulk( cat, ids.n, ids.zones, ids.offsets,
+                                      stars, rvals) < 0)
+      n_bad = -1;
+   for( i = 0; n_bad >= 0 && i < ids.n; i++)
+      {
+      const int rval = extract_ucac4_info_from_catalog( cat, ids.zones[i],
+                                       ids.offsets[i], &star);
+
+      if( rval)
+         n_errors++;
+      if( rval != rvals[i] || (!rval && memcmp( &star, stars + i,
+                                                  sizeof( UCAC4_STAR))))
+         {
+         printf( "Star %d-%ld:  got %d in bulk,  %d singly\n",
+                  ids.zones[i], ids.offsets[i], rvals[i], rval);
+         n_bad++;
+         }
+      }
+   printf( "%lu bulk lookups checked (%lu gave errors);  %ld mismatches\n",
+            (unsigned long)ids.n, (unsigned long)n_errors, n_bad);
+   free( stars);
+   free( rvals);
+   free( ids.zones);
+   free( ids.offsets);
+   return( n_bad);
+}
+
 int main( int argc, const char **argv)
 {
-   int rval = -9, i, j, show_debug_data = 0;
+   int rval = -9, i, j, show_debug_data = 0, n_threads = 0;
+   int check_bulk = 0;
    unsigned format = UCAC4_WRITE_SPACES;
    int show_header = 0;
 
@@ -50,6 +165,9 @@ int main( int argc, const char **argv)
          {
          switch( argv[i][1])
             {
+            case 'c': case 'C':
+               check_bulk = 1;
+               break;
             case 'h': case 'H':
                show_header = 1;
                break;
@@ -59,6 +177,9 @@ int main( int argc, const char **argv)
             case 't': case 'T':
                show_debug_data = 1;
                break;
+            case 'p': case 'P':
+               n_threads = atoi( argv[i] + 2);
+               break;
             default:
                printf( "%s is an unrecognized option\n", argv[i]);
                break;
@@ -72,29 +193,36 @@ int main( int argc, const char **argv)
    if( argc == 2 || argc == 3)
       {
       UCAC4_STAR star;
-      int zone;
+      int zone, rval = 0;
       long offset;
+      const char *path = (argc == 2 ? "" : argv[2]);
 
-      if( sscanf( argv[1], "%d-%ld", &zone, &offset) != 2)
-         printf( "Couldn't parse '%s' as a UCAC4 ID\n", argv[1]);
+      if( sscanf( argv[1], "%d-%ld", &zone, &offset) == 2)
+         rval = extract_ucac4_info( zone, offset, &star, path);
+      else if( *argv[1] == 'm' || *argv[1] == 'M')     /* MPOS number */
+         rval = find_ucac4_star_by_id_in_path(
+                     (uint32_t)strtoul( argv[1] + 1, NULL, 10),
+                     &zone, &offset, &star, path);
+      else if( !ucac4_zone_and_offset( (int32_t)atol( argv[1]),
+                                  &zone, &offset))  /* cumulative number */
+         rval = extract_ucac4_info( zone, offset, &star, path);
       else
          {
-         int rval = extract_ucac4_info( zone, offset, &star,
-                                (argc == 2 ? "" : argv[2]));
-
-         if( !rval)
-            {
-            char buff[UCAC4_ASCII_SIZE];
+         printf( "Couldn't parse '%s' as a UCAC4 ID\n", argv[1]);
+         return( -1);
+         }
+      if( !rval)
+         {
+         char buff[UCAC4_ASCII_SIZE];
 
-            write_ucac4_star( zone, offset, buff, &star, format);
-            if( show_header)
-               printf( "%s\n", (format & UCAC4_FORTRAN_STYLE) ?
-                           fortran_header : usual_header);
-            printf( "%s", buff);
-            }
-         else
-            printf( "Couldn't get data: error %d\n", rval);
+         write_ucac4_star( zone, offset, buff, &star, format);
+         if( show_header)
+            printf( "%s\n", (format & UCAC4_FORTRAN_STYLE) ?
+                        fortran_header : usual_header);
+         printf( "%s", buff);
          }
+      else
+         printf( "Couldn't get data: error %d\n", rval);
       }
    else if( argc < 5)
       show_error_message( );
@@ -102,6 +230,7 @@ int main( int argc, const char **argv)
       {
       const char *out_filename = (argc == 6 ? "ucac4.txt" : argv[6]);
       FILE* ofile = fopen( out_filename, "wb");
+      ucac4_catalog_t *cat;
 
       if (!ofile)
       {
@@ -112,20 +241,50 @@ int main( int argc, const char **argv)
       if( show_header)
          fprintf( ofile, "%s\n", (format & UCAC4_FORTRAN_STYLE) ?
                            fortran_header : usual_header);
-      rval = extract_ucac4_stars( ofile, atof( argv[1]), atof( argv[2]),
-                               atof( argv[3]), atof( argv[4]),
-                               (argc == 5 ? "" : argv[5]), format);
+      cat = open_ucac4_catalog( argc == 5 ? "" : argv[5]);
+      if( !cat)
+         {
+         fprintf( stderr, "Couldn't open the catalog\n");
+         return( -2);
+         }
+      if( n_threads)
+         {
+         out_sink_t *sink = open_file_sink( ofile);
+         int err;
+
+         if( !sink)
+            {
+            fprintf( stderr, "Out of memory\n");
+            return( -3);
+            }
+         rval = extract_ucac4_stars_parallel( cat, sink, atof( argv[1]),
+                               atof( argv[2]), atof( argv[3]), atof( argv[4]),
+                               format, n_threads);
+         err = close_sink( sink);
+         if( err)
+            rval = err;
+         }
+      else
+         rval = extract_ucac4_stars_from_catalog( cat, ofile, atof( argv[1]),
+                               atof( argv[2]), atof( argv[3]), atof( argv[4]),
+                               format);
 
       if( show_debug_data)
          {
-         extern clock_t time_searching;
+         ucac4_stats_t stats;
 
+         get_ucac4_stats( cat, &stats);
          printf( "%.2lf seconds elapsed\n",
                (double)clock( ) / (double)CLOCKS_PER_SEC);
-         printf( "%.2lf seconds indexing\n",
-               (double)time_searching / (double)CLOCKS_PER_SEC);
+         printf( "%.4lf seconds indexing\n", stats.seconds_searching);
+         printf( "%ld zones searched,  %ld records read\n",
+               stats.n_zones, stats.n_records_read);
          printf( "%d stars extracted\n", rval);
          }
+      if( check_bulk && rval >= 0 && check_bulk_lookups( cat, atof( argv[1]),
+                     atof( argv[2]), atof( argv[3]), atof( argv[4])))
+         rval = -3;
+      close_ucac4_catalog( cat);
       fclose( ofile);
       }
    return( rval);
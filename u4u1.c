@@ -0,0 +1,387 @@
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "u4u1.h"
+
+/* See 'u4u1.h' for what this does.  For each zone,  the UCAC4 and
+URAT1 stars in the rectangle are copied into lists.  The URAT1 stars
+with 2MASS IDs go into a hash table (open addressing,  linear probing),
+so each UCAC4 star with a 2MASS ID can find its URAT1 counterpart in
+one or two probes.  Memory use is therefore set by the most crowded
+zone in the area,  not by the size of the area.
+
+   For the optional positional match,  the URAT1 stars still unmatched
+are sorted by RA,  and for each unmatched UCAC4 star,  we look through
+those within the match radius (plus however far the star could have
+moved between epochs) in RA.  Stars right at RA=0 won't be matched
+to stars on the other side of it;  a minor flaw.   */
+
+typedef struct
+   {
+   uint32_t offset;
+   UCAC4_STAR star;
+   } u4_rec_t;
+
+typedef struct
+   {
+   uint32_t offset;
+   URAT1_STAR star;
+   } u1_rec_t;
+
+typedef struct
+   {
+   char *data;
+   size_t n, n_alloced, rec_size;
+   int failed;
+   } rec_list_t;
+
+static void *add_rec( rec_list_t *list)
+{
+   if( list->n == list->n_alloced)
+      {
+      const size_t new_size = (list->n_alloced ? list->n_alloced * 2 : 1024);
+      char *new_data = (char *)realloc( list->data, new_size * list->rec_size);
+
+      if( !new_data)
+         {
+         list->failed = 1;
+         return( NULL);
+         }
+      list->data = new_data;
+      list->n_alloced = new_size;
+      }
+   return( list->data + list->rec_size * list->n++);
+}
+
+static int add_ucac4_star( void *context, const int zone,
+                           const uint32_t offset, const UCAC4_STAR *star)
+{
+   u4_rec_t *rec = (u4_rec_t *)add_rec( (rec_list_t *)context);
+
+   if( !rec)
+      return( 1);       /* out of memory;  stop extracting */
+   rec->offset = offset;
+   rec->star = *star;
+   (void)zone;
+   return( 0);
+}
+
+static int add_urat1_star( void *context, const int zone,
+                           const uint32_t offset, const URAT1_STAR *star)
+{
+   u1_rec_t *rec = (u1_rec_t *)add_rec( (rec_list_t *)context);
+
+   if( !rec)
+      return( 1);
+   rec->offset = offset;
+   rec->star = *star;
+   (void)zone;
+   return( 0);
+}
+
+static uint32_t hash_id( const uint32_t id)
+{
+   return( id * 2654435761u);       /* Knuth's multiplicative hash */
+}
+
+/* Sets match[i] to the index of the URAT1 star with the same 2MASS ID
+as UCAC4 star i,  or -1.  Returns -1 if memory ran out. */
+
+static int match_by_2mass( const u4_rec_t *u4, const size_t n4,
+                           const u1_rec_t *u1, const size_t n1,
+                           long *match, char *u1_used)
+{
+   size_t i, mask = 15;
+   long *table;
+
+   while( mask < n1 * 2)
+      mask = mask * 2 + 1;
+   table = (long *)malloc( (mask + 1) * sizeof( long));
+   if( !table)
+      return( -1);
+   for( i = 0; i <= mask; i++)
+      table[i] = -1;
+   for( i = 0; i < n1; i++)
+      if( u1[i].star.id2)
+         {
+         size_t loc = hash_id( (uint32_t)u1[i].star.id2) & mask;
+
+         while( table[loc] >= 0)
+            loc = (loc + 1) & mask;
+         table[loc] = (long)i;
+         }
+   for( i = 0; i < n4; i++)
+      {
+      const uint32_t id = u4[i].star.twomass_id;
+
+      match[i] = -1;
+      if( id)
+         {
+         size_t loc = hash_id( id) & mask;
+
+         while( table[loc] >= 0 && match[i] < 0)
+            {
+            const long j = table[loc];
+
+            if( (uint32_t)u1[j].star.id2 == id && !u1_used[j])
+               {
+               match[i] = j;
+               u1_used[j] = 1;
+               }
+            loc = (loc + 1) & mask;
+            }
+         }
+      }
+   free( table);
+   return( 0);
+}
+
+typedef struct
+   {
+   int32_t ra;
+   long idx;
+   } ra_idx_t;
+
+static int compare_ra_idx( const void *a, const void *b)
+{
+   const ra_idx_t *aptr = (const ra_idx_t *)a;
+   const ra_idx_t *bptr = (const ra_idx_t *)b;
+
+   if( aptr->ra != bptr->ra)
+      return( aptr->ra > bptr->ra ? 1 : -1);
+   return( aptr->idx > bptr->idx ? 1 : -1);
+}
+
+#define PI 3.1415926535897932384626433832795028841971693993751058209749445923
+#define MAS_PER_DEGREE        3600000.
+#define MAX_EPOCH_DIFF        20.     /* years,  ample for URAT1 - UCAC4 */
+
+/* UCAC4 positions are for J2000 (with proper motion given in .1 mas/yr,
+RA motion already multiplied by cos(dec));  URAT1 positions are for
+the mean epoch of observation.  So the UCAC4 star is moved to the URAT1
+epoch before comparing positions.  Returns the squared separation in
+mas^2. */
+
+static double sep_squared( const UCAC4_STAR *s4, const URAT1_STAR *s1,
+                           const double cos_dec)
+{
+   const double dt = (double)s1->epoc / 1000.;       /* years from 2000 */
+   const double dra = ((double)( s1->ra - s4->ra)) * cos_dec
+                                 - (double)s4->pm_ra * .1 * dt;
+   const double ddec = (double)( s1->spd - s4->spd)
+                                 - (double)s4->pm_dec * .1 * dt;
+
+   return( dra * dra + ddec * ddec);
+}
+
+static int match_by_position( const u4_rec_t *u4, const size_t n4,
+                  const u1_rec_t *u1, const size_t n1,
+                  long *match, char *u1_used, const double match_radius)
+{
+   const double radius_mas = match_radius * 1000.;
+   ra_idx_t *cand = (ra_idx_t *)malloc( (n1 + 1) * sizeof( ra_idx_t));
+   size_t i, n_cand = 0;
+
+   if( !cand)
+      return( -1);
+   for( i = 0; i < n1; i++)
+      if( !u1_used[i])
+         {
+         cand[n_cand].ra = u1[i].star.ra;
+         cand[n_cand++].idx = (long)i;
+         }
+   qsort( cand, n_cand, sizeof( ra_idx_t), compare_ra_idx);
+   for( i = 0; i < n4 && n_cand; i++)
+      if( match[i] < 0)
+         {
+         const UCAC4_STAR *s4 = &u4[i].star;
+         const double cos_dec = cos( ((double)s4->spd / MAS_PER_DEGREE - 90.)
+                                                * PI / 180.);
+         const double pm = sqrt( (double)s4->pm_ra * (double)s4->pm_ra
+                        + (double)s4->pm_dec * (double)s4->pm_dec) * .1;
+         const double tol = radius_mas + pm * MAX_EPOCH_DIFF;
+         double best = radius_mas * radius_mas;
+         long lo = 0, hi = (long)n_cand, best_j = -1, j;
+         int32_t max_ra = 0x7fffffff;
+
+         if( cos_dec * 360. * MAS_PER_DEGREE > tol)  /* else,  near a pole */
+            {                                      /* and check them all */
+            const double ra_tol = tol / cos_dec;
+            const int32_t min_ra = (int32_t)( (double)s4->ra - ra_tol);
+
+            max_ra = (int32_t)( (double)s4->ra + ra_tol);
+            while( lo < hi)      /* binary search for first RA >= min_ra */
+               {
+               const long mid = (lo + hi) / 2;
+
+               if( cand[mid].ra < min_ra)
+                  lo = mid + 1;
+               else
+                  hi = mid;
+               }
+            }
+         for( j = lo; j < (long)n_cand && cand[j].ra <= max_ra; j++)
+            {
+            const URAT1_STAR *s1 = &u1[cand[j].idx].star;
+
+            if( !u1_used[cand[j].idx] && !(s4->twomass_id && s1->id2))
+               {
+               const double dist2 = sep_squared( s4, s1, cos_dec);
+
+               if( dist2 <= best)
+                  {
+                  best = dist2;
+                  best_j = cand[j].idx;
+                  }
+               }
+            }
+         if( best_j >= 0)
+            {
+            match[i] = best_j;
+            u1_used[best_j] = 1;
+            }
+         }
+   free( cand);
+   return( 0);
+}
+
+/* URAT1 gives separate sigmas from scatter and from its model;  we take
+the larger.  UCAC4 sigmas are offset by 128 (see 'ucac4.h'). */
+
+static int urat1_is_preferred( const UCAC4_STAR *s4, const URAT1_STAR *s1,
+                               const int flags)
+{
+   if( flags & U4U1_PREFER_URAT1)
+      return( 1);
+   if( flags & U4U1_PREFER_SMALLER_SIGMA)
+      {
+      const int sig4 = 128 + (s4->ra_sigma > s4->dec_sigma ?
+                                 s4->ra_sigma : s4->dec_sigma);
+      const int sig1 = (s1->sigs > s1->sigm ? s1->sigs : s1->sigm);
+
+      return( sig1 < sig4);
+      }
+   return( 0);
+}
+
+static void set_position( u4u1_star_t *ostar, const int32_t ra,
+                          const int32_t spd)
+{
+   ostar->ra = (double)ra / MAS_PER_DEGREE;
+   ostar->dec = (double)spd / MAS_PER_DEGREE - 90.;
+}
+
+int extract_u4u1_stars( ucac4_catalog_t *ucac4, urat1_catalog_t *urat1,
+                  void *context,
+                  int (*callback_fn)( void *, const u4u1_star_t *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int flags, const double match_radius)
+{
+   const double zone_height = .2;    /* zones are .2 degrees each */
+   int zone = (int)( (dec - height / 2. + 90.) / zone_height) + 1;
+   int end_zone = (int)( (dec + height / 2. + 90.) / zone_height) + 1;
+   const int ucac4_filters = flags & (UCAC4_OMIT_TYCHO_STARS
+                                         | UCAC4_INCLUDE_DOUBTFULS);
+   rec_list_t list4, list1;
+   long *match = NULL;
+   char *u1_used = NULL;
+   int rval = 0, keep_going = 1;
+
+   memset( &list4, 0, sizeof( rec_list_t));
+   memset( &list1, 0, sizeof( rec_list_t));
+   list4.rec_size = sizeof( u4_rec_t);
+   list1.rec_size = sizeof( u1_rec_t);
+   if( zone < 1)
+      zone = 1;
+   if( end_zone > 900)
+      end_zone = 900;
+   for( ; zone <= end_zone && keep_going; zone++)
+      {
+      const u4_rec_t *u4;
+      const u1_rec_t *u1;
+      u4u1_star_t ostar;
+      size_t i;
+      int err;
+
+      list4.n = list1.n = 0;
+      err = extract_ucac4_zone_stars_callback( ucac4, zone, &list4,
+               add_ucac4_star, ra, dec, width, height, ucac4_filters);
+      if( err >= 0)
+         err = extract_urat1_zone_stars_callback( urat1, zone, &list1,
+                        add_urat1_star, ra, dec, width, height);
+      if( err < 0 || list4.failed || list1.failed)
+         {
+         rval = (err < 0 ? err : U4U1_ALLOC_FAILED);
+         break;
+         }
+      u4 = (const u4_rec_t *)list4.data;
+      u1 = (const u1_rec_t *)list1.data;
+      free( match);
+      free( u1_used);
+      match = (long *)malloc( (list4.n + 1) * sizeof( long));
+      u1_used = (char *)calloc( list1.n + 1, 1);
+      if( !match || !u1_used
+               || match_by_2mass( u4, list4.n, u1, list1.n, match, u1_used)
+               || (match_radius > 0. && match_by_position( u4, list4.n,
+                              u1, list1.n, match, u1_used, match_radius)))
+         {
+         rval = U4U1_ALLOC_FAILED;
+         break;
+         }
+      memset( &ostar, 0, sizeof( u4u1_star_t));
+      ostar.zone = zone;
+      for( i = 0; i < list4.n && keep_going; i++)
+         {
+         ostar.ucac4_offset = u4[i].offset;
+         ostar.ucac4 = u4[i].star;
+         ostar.sources = U4U1_FROM_UCAC4;
+         ostar.preferred = U4U1_FROM_UCAC4;
+         ostar.match_type = U4U1_MATCH_NONE;
+         set_position( &ostar, u4[i].star.ra, u4[i].star.spd);
+         if( match[i] >= 0)
+            {
+            const u1_rec_t *rec = u1 + match[i];
+
+            ostar.urat1_offset = rec->offset;
+            ostar.urat1 = rec->star;
+            ostar.sources |= U4U1_FROM_URAT1;
+            ostar.match_type = (u4[i].star.twomass_id
+                       && (uint32_t)rec->star.id2 == u4[i].star.twomass_id ?
+                       U4U1_MATCH_2MASS : U4U1_MATCH_POSITION);
+            if( urat1_is_preferred( &u4[i].star, &rec->star, flags))
+               {
+               ostar.preferred = U4U1_FROM_URAT1;
+               set_position( &ostar, rec->star.ra, rec->star.spd);
+               }
+            }
+         else
+            {
+            ostar.urat1_offset = 0;
+            memset( &ostar.urat1, 0, sizeof( URAT1_STAR));
+            }
+         rval++;
+         if( callback_fn( context, &ostar))
+            keep_going = 0;
+         }
+      memset( &ostar.ucac4, 0, sizeof( UCAC4_STAR));
+      ostar.ucac4_offset = 0;
+      for( i = 0; i < list1.n && keep_going; i++)
+         if( !u1_used[i])
+            {
+            ostar.urat1_offset = u1[i].offset;
+            ostar.urat1 = u1[i].star;
+            ostar.sources = ostar.preferred = U4U1_FROM_URAT1;
+            ostar.match_type = U4U1_MATCH_NONE;
+            set_position( &ostar, u1[i].star.ra, u1[i].star.spd);
+            rval++;
+            if( callback_fn( context, &ostar))
+               keep_going = 0;
+            }
+      }
+   free( match);
+   free( u1_used);
+   free( list4.data);
+   free( list1.data);
+   return( rval);
+}
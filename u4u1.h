@@ -0,0 +1,70 @@
+#ifndef U4U1_H_INCLUDED
+#define U4U1_H_INCLUDED
+
+/* Merged extraction from UCAC4 and URAT1,  giving one record per star
+rather than one from each catalog.  Both catalogs are divided into the
+same 900 zones,  each .2 degrees high,  so we go through the area zone
+by zone,  get the stars from both catalogs for that zone,  and join them
+on their 2MASS IDs.  Optionally,  stars that couldn't be matched that
+way (usually because one or both lack a 2MASS ID) can be matched by
+position.  Public domain.  */
+
+#include "ucac4.h"
+#include "urat1.h"
+
+typedef struct
+   {
+   double ra, dec;         /* degrees,  from the preferred source */
+   int zone;               /* same in both catalogs */
+   int sources;            /* U4U1_FROM_UCAC4 and/or U4U1_FROM_URAT1 */
+   int preferred;          /* U4U1_FROM_UCAC4 or U4U1_FROM_URAT1 */
+   int match_type;         /* U4U1_MATCH_(NONE, 2MASS, POSITION) */
+   uint32_t ucac4_offset, urat1_offset;      /* zero-based */
+   UCAC4_STAR ucac4;       /* these are only meaningful if 'sources' */
+   URAT1_STAR urat1;       /* says the star was in that catalog      */
+   } u4u1_star_t;
+
+#define U4U1_FROM_UCAC4              1
+#define U4U1_FROM_URAT1              2
+
+#define U4U1_MATCH_NONE              0
+#define U4U1_MATCH_2MASS             1
+#define U4U1_MATCH_POSITION          2
+
+         /* 'flags' bits.  By default,  the UCAC4 position is used for  */
+         /* stars in both catalogs.  You can ask for URAT1's instead,   */
+         /* or for whichever has the smaller positional sigma.  The     */
+         /* UCAC4_OMIT_TYCHO_STARS and UCAC4_INCLUDE_DOUBTFULS flags    */
+         /* can also be set;  they apply to UCAC4 as usual.             */
+#define U4U1_PREFER_URAT1            0x100
+#define U4U1_PREFER_SMALLER_SIGMA    0x200
+
+#define U4U1_ALLOC_FAILED          -100
+
+#ifdef __cplusplus
+extern "C" {
+#endif /* #ifdef __cplusplus */
+
+         /* Each star in the RA/dec rectangle (all in degrees) is passed  */
+         /* to the callback.  Within each zone,  UCAC4 stars (matched or  */
+         /* not) come first,  in the order UCAC4 gives them;  then URAT1  */
+         /* stars that had no UCAC4 match.  If 'match_radius' (arcsec) is */
+         /* non-zero,  stars left unmatched after the 2MASS join are      */
+         /* matched by position,  after moving the UCAC4 star to the      */
+         /* URAT1 star's epoch.  Stars with two different 2MASS IDs are   */
+         /* never matched.  If the callback returns non-zero,  we stop.   */
+         /* Returns the number of stars passed to the callback;  or, on  */
+         /* failure,  U4U1_ALLOC_FAILED or the (negative) error code from */
+         /* the UCAC4 or URAT1 extraction.                                */
+int extract_u4u1_stars( ucac4_catalog_t *ucac4, urat1_catalog_t *urat1,
+                  void *context,
+                  int (*callback_fn)( void *, const u4u1_star_t *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int flags, const double match_radius);
+
+#ifdef __cplusplus
+}
+#endif  /* #ifdef __cplusplus */
+
+#endif  /* #ifndef U4U1_H_INCLUDED */
@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "u4u1.h"
+
+      /* Shows how 'u4u1.c' can be used.  Run it as
+
+         u4u1test (RA) (dec) (width) (height) (UCAC4 path) (URAT1 path)
+
+         (all angles in decimal degrees) and it will write one line for
+         each star in the rectangle found in UCAC4,  URAT1,  or both,
+         to the file 'u4u1.txt'.  */
+
+static void show_error_message( void)
+{
+   printf( "'u4u1test' takes as command-line arguments the RA/dec of the\n");
+   printf( "center of the region to be extracted;  its width and height;\n");
+   printf( "and the paths to the UCAC4 and URAT1 data.  All angles are in\n");
+   printf( "decimal degrees.  For example:\n\n");
+   printf( "u4u1test 50 16.3 2 1.5 d:\\u4 d:\\ur1\n\n");
+   printf( "Stars found in both catalogs (matched by 2MASS ID) are listed\n");
+   printf( "once.  Output goes to 'u4u1.txt'.  Options are :\n\n");
+   printf( "   -u    Use URAT1 positions for stars in both catalogs\n");
+   printf( "   -s    Use the position with the smaller sigma\n");
+   printf( "   -m(n) Match stars lacking 2MASS IDs within n arcseconds\n");
+   printf( "   -t    Show timing and counts\n");
+}
+
+typedef struct
+   {
+   FILE *ofile;
+   long n_found[4];     /* indexed by 'sources' */
+   long n_matched_by_position;
+   } merge_output_t;
+
+static int output_merged_star( void *context, const u4u1_star_t *star)
+{
+   merge_output_t *m = (merge_output_t *)context;
+   char u4_id[20], u1_id[20];
+   uint32_t twomass_id = 0;
+
+   *u4_id = *u1_id = '\0';
+   if( star->sources & U4U1_FROM_UCAC4)
+      {
+      snprintf( u4_id, sizeof( u4_id), "%03d-%06u", star->zone,
+                                 star->ucac4_offset + 1);
+      twomass_id = star->ucac4.twomass_id;
+      }
+   if( star->sources & U4U1_FROM_URAT1)
+      {
+      snprintf( u1_id, sizeof( u1_id), "%03d-%06u", star->zone,
+                                 star->urat1_offset + 1);
+      if( !twomass_id)
+         twomass_id = (uint32_t)star->urat1.id2;
+      }
+   fprintf( m->ofile, "%c %-10s %-10s %11.7f %+11.7f %10u %c\n",
+            (star->preferred == U4U1_FROM_UCAC4 ? '4' : '1'),
+            u4_id, u1_id, star->ra, star->dec, twomass_id,
+            " MP"[star->match_type]);
+   m->n_found[star->sources]++;
+   if( star->match_type == U4U1_MATCH_POSITION)
+      m->n_matched_by_position++;
+   return( 0);
+}
+
+int main( int argc, const char **argv)
+{
+   int i, j, flags = 0, show_debug_data = 0, rval;
+   double match_radius = 0.;
+   ucac4_catalog_t *ucac4;
+   urat1_catalog_t *urat1;
+   merge_output_t m;
+
+   for( i = 1; i < argc; i++)
+      if( argv[i][0] == '-' && argv[i][1] > '9')
+         {
+         switch( argv[i][1])
+            {
+            case 'u': case 'U':
+               flags |= U4U1_PREFER_URAT1;
+               break;
+            case 's': case 'S':
+               flags |= U4U1_PREFER_SMALLER_SIGMA;
+               break;
+            case 'm': case 'M':
+               match_radius = (argv[i][2] ? atof( argv[i] + 2) : 1.);
+               break;
+            case 't': case 'T':
+               show_debug_data = 1;
+               break;
+            default:
+               printf( "%s is an unrecognized option\n", argv[i]);
+               break;
+            }
+         for( j = i; j < argc - 1; j++)      /* remove this argument */
+            argv[j] = argv[j + 1];
+         i--;
+         argc--;
+         }
+   if( argc < 7)
+      {
+      show_error_message( );
+      return( -1);
+      }
+   ucac4 = open_ucac4_catalog( argv[5]);
+   urat1 = open_urat1_catalog( argv[6]);
+   memset( &m, 0, sizeof( m));
+   m.ofile = fopen( "u4u1.txt", "wb");
+   if( !ucac4 || !urat1 || !m.ofile)
+      {
+      fprintf( stderr, "Couldn't open the catalogs or 'u4u1.txt'\n");
+      return( -2);
+      }
+   rval = extract_u4u1_stars( ucac4, urat1, &m, output_merged_star,
+               atof( argv[1]), atof( argv[2]), atof( argv[3]), atof( argv[4]),
+               flags, match_radius);
+   fclose( m.ofile);
+   close_ucac4_catalog( ucac4);
+   close_urat1_catalog( urat1);
+   if( show_debug_data)
+      {
+      printf( "%.2f seconds elapsed\n",
+               (double)clock( ) / (double)CLOCKS_PER_SEC);
+      printf( "%d stars : %ld in both (%ld by position),  %ld UCAC4 only,"
+              "  %ld URAT1 only\n", rval,
+               m.n_found[U4U1_FROM_UCAC4 | U4U1_FROM_URAT1],
+               m.n_matched_by_position,
+               m.n_found[U4U1_FROM_UCAC4], m.n_found[U4U1_FROM_URAT1]);
+      }
+   return( rval < 0 ? rval : 0);
+}
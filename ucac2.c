@@ -3,6 +3,8 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include "ucac2.h"
+#include "out_sink.h"
+#include "bulk_req.h"
 
 /* History: */
 
@@ -31,7 +33,8 @@
 
       Also,  the test main() routine now has to call extract_ucac2_stars()
    twice:  once to get 'normal' UCAC-2 stars,  then a second time to get
-   supplement stars.  Most programs using this source ought to do the same. */
+   supplement stars.  Most programs using this source ought to do the same.
+   (Or,  now,  call extract_ucac2_all_stars(),  which does both in one pass.) */
 
 /*    24 Oct 2003:  (BJG)  While running a little program to extract
    data for high proper-motion stars from UCAC2,  I learned that in
@@ -69,7 +72,7 @@
 /* On non-Intel-ordered (big-Endian) machines,  we need the 'swap_32',
    'swap_16', and 'flip_ucac2_star' functions. */
 
-static long ucac2_offsets[289] = {
+static const long ucac2_offsets[289] = {
         0,      875,     3545,     8116,    14437,    22600,
     32331,    43410,    56200,    70717,    86739,   104139,
    122349,   142651,   164289,   187090,   211870,   238034,
@@ -242,47 +245,177 @@ static FILE *get_ucac2_zone_file( const int zone_number,
 #define UCAC2_BAD_FREAD             -3
 #define UCAC2_BAD_FREAD2            -4
 #define UCAC2_FILE_NOT_FOUND        -5
+#define UCAC2_ALLOC_FAILED          -6
+#define UCAC2_BAD_ZONE              -7
+
+/* Returns the (one-based) zone containing a given UCAC2 number,  or zero
+if there's no such star.  ucac2_offsets[] is sorted,  so we can do a
+binary search for the last zone starting before the star.  */
+
+static int ucac2_zone_of_number( const long ucac2_number)
+{
+   int lo = 0, hi = 288;
+
+   if( ucac2_number < 1 || ucac2_number > ucac2_offsets[288])
+      return( 0);
+   while( hi - lo > 1)
+      {
+      const int mid = (lo + hi) / 2;
+
+      if( ucac2_offsets[mid] < ucac2_number)
+         lo = mid;
+      else
+         hi = mid;
+      }
+   return( lo + 1);
+}
 
 int extract_ucac2_info( const long ucac2_number, UCAC2_STAR *star,
                      const char *path)
 {
-   int zone, rval = 0;
+   const int zone = ucac2_zone_of_number( ucac2_number);
+   int rval = 0;
    FILE *ifile;
 
-   for( zone = 288; zone && ucac2_offsets[zone] + 1 > ucac2_number; zone--)
-      ;
-   if( zone == 288 || ucac2_number < 1)
+   if( !zone)
       return( UCAC2_BAD_STAR_NUMBER);
-   ifile = get_ucac2_zone_file( zone + 1, 0, path);
+   ifile = get_ucac2_zone_file( zone, 0, path);
    if( !ifile)
       rval = UCAC2_FILE_NOT_FOUND;
    else
       {
-      const long star_in_zone = ucac2_number - (ucac2_offsets[zone] + 1);
+      const long star_in_zone = ucac2_number - (ucac2_offsets[zone - 1] + 1);
 
       if( fseek( ifile, star_in_zone * sizeof( UCAC2_STAR), SEEK_SET))
          rval = UCAC2_BAD_FSEEK;
       else if( fread( star, sizeof( UCAC2_STAR), 1, ifile) != 1)
          rval = UCAC2_BAD_FREAD;
 #ifdef WRONG_ENDIAN
-      flip_ucac2_star( &star);
+      flip_ucac2_star( star);
 #endif
       fclose( ifile);
       }
    return( rval);
 }
 
-int extract_ucac2_stars( FILE *ofile, const double ra, const double dec,
-                  const double width, const double height, const char *path,
-                  const int is_supplement)
+static long read_bulk_ucac2_stars( void *context, const int zone,
+                  const long offset, const size_t n_stars, void *buff)
+{
+   bulk_reader_t *r = (bulk_reader_t *)context;
+   UCAC2_STAR *stars = (UCAC2_STAR *)buff;
+   size_t n_read;
+
+   if( zone != r->zone)
+      {
+      if( r->ifile)
+         fclose( r->ifile);
+      r->ifile = NULL;
+      if( zone >= 1 && zone <= 288)
+         r->ifile = get_ucac2_zone_file( zone, 0, r->path);
+      r->zone = zone;
+      }
+   if( zone < 1 || zone > 288)
+      return( UCAC2_BAD_STAR_NUMBER);
+   if( !r->ifile)
+      return( UCAC2_FILE_NOT_FOUND);
+   if( offset < 1
+          || fseek( r->ifile, (offset - 1) * sizeof( UCAC2_STAR), SEEK_SET))
+      return( UCAC2_BAD_FSEEK);
+   n_read = fread( stars, sizeof( UCAC2_STAR), n_stars, r->ifile);
+#ifdef WRONG_ENDIAN
+   {
+   size_t i;
+
+   for( i = 0; i < n_read; i++)
+      flip_ucac2_star( stars + i);
+   }
+#endif
+   return( (long)n_read);
+}
+
+int extract_ucac2_info_bulk( const size_t n_stars, const long *ucac2_numbers,
+                  UCAC2_STAR *stars, int *rvals, const char *path)
+{
+   long *offsets = (long *)malloc( n_stars * (sizeof( long) + sizeof( int))
+                                                                  + 1);
+   int *zones = (int *)( offsets + n_stars);
+   bulk_reader_t r;
+   size_t i;
+   int rval;
+
+   if( !offsets)
+      return( UCAC2_ALLOC_FAILED);
+   for( i = 0; i < n_stars; i++)
+      {
+      zones[i] = ucac2_zone_of_number( ucac2_numbers[i]);
+      offsets[i] = (zones[i] ? ucac2_numbers[i]
+                               - ucac2_offsets[zones[i] - 1] : 0L);
+      }
+   r.path = path;
+   r.ifile = NULL;
+   r.zone = 0;
+   rval = run_bulk_requests( n_stars, zones, offsets, stars,
+                  sizeof( UCAC2_STAR), rvals, UCAC2_BAD_FREAD,
+                  &r, read_bulk_ucac2_stars);
+   if( r.ifile)
+      fclose( r.ifile);
+   free( offsets);
+   return( rval == BULK_REQ_ALLOC_FAILED ? UCAC2_ALLOC_FAILED : rval);
+}
+
+/* for_each_ucac2_star_in_zone() reads through the zone with the bulk
+reader above;  see run_zone_loop() in 'bulk_req.h'.  */
+
+typedef struct
+   {
+   void *context;
+   int (*callback_fn)( void *, const int, const uint32_t, const UCAC2_STAR *);
+   } zone_loop_t;
+
+static int pass_ucac2_star( void *context, const int zone, const long offset,
+                  const void *star)
+{
+   zone_loop_t *z = (zone_loop_t *)context;
+
+   return( z->callback_fn( z->context, zone, (uint32_t)offset,
+                  (const UCAC2_STAR *)star));
+}
+
+int for_each_ucac2_star_in_zone( const int zone, const char *path,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC2_STAR *))
+{
+   bulk_reader_t r;
+   zone_loop_t z;
+   int rval;
+
+   if( zone < 1 || zone > 288)
+      return( UCAC2_BAD_ZONE);
+   r.path = path;
+   r.ifile = NULL;
+   r.zone = 0;
+   z.context = context;
+   z.callback_fn = callback_fn;
+   rval = run_zone_loop( zone, sizeof( UCAC2_STAR), &r, read_bulk_ucac2_stars,
+                  &z, pass_ucac2_star, UCAC2_ALLOC_FAILED);
+   if( r.ifile)
+      fclose( r.ifile);
+   return( rval);
+}
+
+/* Converts a zone (1 to 288) and one-based offset within it to a UCAC2
+number,  or returns -1 if there's no such star.  */
+
+long ucac2_star_number( const int zone, const long offset)
+{
+   if( zone < 1 || zone > 288 || offset < 1
+                || offset > ucac2_offsets[zone] - ucac2_offsets[zone - 1])
+      return( -1L);
+   return( ucac2_offsets[zone - 1] + offset);
+}
+
+static FILE *get_ucac2_index_file( const char *path, const int is_supplement)
 {
-   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
-   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
-   const double zone_height = (is_supplement ? 5. : .5);
-   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
-   int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
-   int ra_start = (int)( ra1 / 1.5);
-   int rval = 0;
    FILE *index_file;
    const char *idx_filename = (is_supplement ? "bsindex.da" : "u2index.da");
 
@@ -300,76 +433,124 @@ int extract_ucac2_stars( FILE *ofile, const double ra, const double dec,
       strcat( filename, idx_filename);
       index_file = fopen( filename, read_only_permits);
       }
+   return( index_file);
+}
+
+/* Extracts the stars in the rectangle from one zone of either the main
+catalog or the Bright Star Supplement,  using the (already opened) index
+file for that part of the catalog if we have it.  Supplement stars get
+numbers starting at BSS_OFFSET,  which is how write_ucac2_star() knows
+to treat them as such. */
+
+static int extract_ucac2_zone( out_sink_t *sink, FILE *index_file,
+                  const int zone, const double ra1, const double ra2,
+                  const double dec1, const double dec2,
+                  const char *path, const int is_supplement)
+{
+   FILE *ifile = get_ucac2_zone_file( zone, is_supplement, path);
+   int ra_start = (int)( ra1 / 1.5);
+   int rval = 0;
 
-   if( zone < 0)
-      zone = 0;
    if( ra_start < 0)
       ra_start = 0;
-   while( rval >= 0 && zone <= end_zone)
+   if( ifile)
       {
-      FILE *ifile = get_ucac2_zone_file( zone, is_supplement, path);
-
-      if( ifile)
-         {
-         int keep_going = 1;
-         UCAC2_STAR star;
-         const long ra2_in_mas = (long)( ra2 * 3600. * 1000.);
-         int32_t offset0, offset;
-
-         if( !index_file)
-            offset0 = offset = 0;
+      int keep_going = 1;
+      UCAC2_STAR star;
+      const long ra2_in_mas = (long)( ra2 * 3600. * 1000.);
+      int32_t offset0, offset;
+
+      if( !index_file)
+         offset0 = offset = 0;
+      else
+         {           /* 'u2index.da' gives the _ending_ offset for each */
+                     /* zone.  So we have to do some odd things to find  */
+                     /* the _beginning_ offset for each zone.            */
+         if( zone == 1)
+            offset0 = 0;
          else
-            {           /* 'u2index.da' gives the _ending_ offset for each */
-                        /* zone.  So we have to do some odd things to find  */
-                        /* the _beginning_ offset for each zone.            */
-            if( zone == 1)
-               offset0 = 0;
-            else
-               {
-               fseek( index_file, ((zone - 1L) * 240L - 1L) * sizeof( int32_t),
-                       SEEK_SET);
-               if( fread( &offset0, sizeof( int32_t), 1, index_file) != 1)
-                  rval = UCAC2_BAD_FREAD;
-               }
-            if( !ra_start)
-               offset = offset0;
-            else
-               {
-               fseek( index_file, ((zone - 1L) * 240L + ra_start - 1L) * sizeof( int32_t),
-                       SEEK_SET);
-               if( fread( &offset, sizeof( int32_t), 1, index_file) != 1)
-                  rval = UCAC2_BAD_FREAD2;
-               }
+            {
+            fseek( index_file, ((zone - 1L) * 240L - 1L) * sizeof( int32_t),
+                    SEEK_SET);
+            if( fread( &offset0, sizeof( int32_t), 1, index_file) != 1)
+               rval = UCAC2_BAD_FREAD;
+            }
+         if( !ra_start)
+            offset = offset0;
+         else
+            {
+            fseek( index_file, ((zone - 1L) * 240L + ra_start - 1L) * sizeof( int32_t),
+                    SEEK_SET);
+            if( fread( &offset, sizeof( int32_t), 1, index_file) != 1)
+               rval = UCAC2_BAD_FREAD2;
+            }
 
 #ifdef WRONG_ENDIAN
-            swap_32( &offset0);
-            swap_32( &offset);
+         swap_32( &offset0);
+         swap_32( &offset);
 #endif
-            }
+         }
+      if( rval < 0)
+         keep_going = 0;
+      else
          fseek( ifile, (offset - offset0) * sizeof( UCAC2_STAR), SEEK_SET);
 
-         while( fread( &star, 1, sizeof( UCAC2_STAR), ifile) && keep_going)
-            {
+      while( keep_going && fread( &star, 1, sizeof( UCAC2_STAR), ifile))
+         {
 #ifdef WRONG_ENDIAN
-            flip_ucac2_star( &star);
+         flip_ucac2_star( &star);
 #endif
-            if( star.ra > ra2_in_mas)
+         if( star.ra > ra2_in_mas)
+            keep_going = 0;
+         else if( star.ra > (long)( ra1 * 3600. * 1000.) &&
+                  star.dec > (long)( dec1 * 3600. * 1000.) &&
+                  star.dec < (long)( dec2 * 3600. * 1000.))
+            {
+            char *buff = (sink ? sink_reserve( sink, 200) : NULL);
+
+            if( sink && !buff)      /* sink error;  stop with it */
+               {
+               rval = flush_sink( sink);
                keep_going = 0;
-            else if( star.ra > (long)( ra1 * 3600. * 1000.) &&
-                     star.dec > (long)( dec1 * 3600. * 1000.) &&
-                     star.dec < (long)( dec2 * 3600. * 1000.))
+               }
+            else
                {
-               char buff[200];
-
-               write_ucac2_star( offset + 1L + (is_supplement ? BSS_OFFSET : 0),
-                                       buff, &star);
-               fwrite( buff, 1, strlen( buff), ofile);
+               if( buff)
+                  {
+                  write_ucac2_star( offset + 1L
+                           + (is_supplement ? BSS_OFFSET : 0), buff, &star);
+                  sink_commit( sink, strlen( buff));
+                  }
                rval++;
                }
-            offset++;
             }
-         fclose( ifile);
+         offset++;
          }
+      fclose( ifile);
+      }
+   return( rval);
+}
+
+int extract_ucac2_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int is_supplement)
+{
+   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
+   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
+   const double zone_height = (is_supplement ? 5. : .5);
+   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
+   int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
+   int rval = 0;
+   FILE *index_file = get_ucac2_index_file( path, is_supplement);
+
+   if( zone < 0)
+      zone = 0;
+   while( rval >= 0 && zone <= end_zone)
+      {
+      const int zone_rval = extract_ucac2_zone( sink, index_file, zone,
+                        ra1, ra2, dec1, dec2, path, is_supplement);
+
+      rval = (zone_rval < 0 ? zone_rval : rval + zone_rval);
       zone++;
       }
    if( index_file)
@@ -380,11 +561,112 @@ int extract_ucac2_stars( FILE *ofile, const double ra, const double dec,
    if( rval >= 0 && ra > 0. && ra < 360.)
       {
       if( ra1 < 0.)      /* left side crosses over RA=0h */
-         rval += extract_ucac2_stars( ofile, ra+360., dec, width, height,
-                                                      path, is_supplement);
+         rval += extract_ucac2_stars_to_sink( sink, ra+360., dec, width,
+                                             height, path, is_supplement);
       if( ra2 > 360.)    /* right side crosses over RA=24h */
-         rval += extract_ucac2_stars( ofile, ra-360., dec, width, height,
-                                                      path, is_supplement);
+         rval += extract_ucac2_stars_to_sink( sink, ra-360., dec, width,
+                                             height, path, is_supplement);
+      }
+   return( rval);
+}
+
+/* The Bright Star Supplement zones are 5 degrees high,  exactly ten of
+the half-degree main zones.  So to get both in one pass,  we go through
+the main zones in order,  and when we reach the first main zone within a
+supplement zone,  we do that supplement zone first.  Each index file
+is opened once for the whole extraction,  rather than once per call as
+would happen if one called extract_ucac2_stars_to_sink() twice.  */
+
+#define UCAC2_MAIN_ZONES_PER_SUPP_ZONE    10
+
+int extract_ucac2_all_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path)
+{
+   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
+   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
+   int zone = (int)( (dec1  + 90.) / .5) + 1;
+   const int end_zone = (int)( (dec2 + 90.) / .5) + 1;
+   int rval = 0, prev_supp_zone = 0;
+   FILE *index_file[2];
+
+   index_file[0] = get_ucac2_index_file( path, 0);
+   index_file[1] = get_ucac2_index_file( path, 1);
+   if( zone < 1)
+      zone = 1;
+   while( rval >= 0 && zone <= end_zone)
+      {
+      const int supp_zone = (zone - 1) / UCAC2_MAIN_ZONES_PER_SUPP_ZONE + 1;
+      int zone_rval = 0;
+
+      if( supp_zone != prev_supp_zone)
+         {
+         zone_rval = extract_ucac2_zone( sink, index_file[1], supp_zone,
+                        ra1, ra2, dec1, dec2, path, 1);
+         prev_supp_zone = supp_zone;
+         }
+      if( zone_rval >= 0)
+         {
+         const int main_rval = extract_ucac2_zone( sink, index_file[0], zone,
+                        ra1, ra2, dec1, dec2, path, 0);
+
+         zone_rval = (main_rval < 0 ? main_rval : zone_rval + main_rval);
+         }
+      rval = (zone_rval < 0 ? zone_rval : rval + zone_rval);
+      zone++;
+      }
+   if( index_file[0])
+      fclose( index_file[0]);
+   if( index_file[1])
+      fclose( index_file[1]);
+
+   if( rval >= 0 && ra > 0. && ra < 360.)
+      {
+      if( ra1 < 0.)      /* left side crosses over RA=0h */
+         rval += extract_ucac2_all_stars_to_sink( sink, ra+360., dec, width,
+                                             height, path);
+      if( ra2 > 360.)    /* right side crosses over RA=24h */
+         rval += extract_ucac2_all_stars_to_sink( sink, ra-360., dec, width,
+                                             height, path);
+      }
+   return( rval);
+}
+
+int extract_ucac2_all_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = -1;
+
+   if( sink || !ofile)
+      rval = extract_ucac2_all_stars_to_sink( sink, ra, dec, width, height,
+                                          path);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
+      }
+   return( rval);
+}
+
+int extract_ucac2_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int is_supplement)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = -1;
+
+   if( sink || !ofile)
+      rval = extract_ucac2_stars_to_sink( sink, ra, dec, width, height,
+                                          path, is_supplement);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
       }
    return( rval);
 }
@@ -1,3 +1,6 @@
+#include <stdint.h>
+#include "out_sink.h"
+
       /* Forcing byte-aligned packing is probably not _essential_,  but... */
 #pragma pack( 1)
 
@@ -35,7 +38,34 @@ void flip_ucac2_star( UCAC2_STAR *star);
 int extract_ucac2_stars( FILE *ofile, const double ra, const double dec,
                   const double width, const double height, const char *path,
                   const int is_supplement);
+int extract_ucac2_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int is_supplement);
+         /* Gets stars from both the main catalog and the Bright Star     */
+         /* Supplement in one pass,  opening each index once.  Output is  */
+         /* in zone order,  each five-degree supplement zone coming just  */
+         /* before the ten main zones it overlaps.  Supplement stars are  */
+         /* numbered from 50000001 on,  so you can tell them apart.       */
+int extract_ucac2_all_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path);
+int extract_ucac2_all_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path);
 int extract_ucac2_info( const long ucac2_number, UCAC2_STAR *star,
                      const char *path);
+         /* Gets 'n_stars' stars at once,  given their UCAC2 numbers,    */
+         /* much faster than extract_ucac2_info() for a long list.  See  */
+         /* 'bulk_req.h' for how it's done and what comes back;  errors  */
+         /* are as extract_ucac2_info() would give.                      */
+int extract_ucac2_info_bulk( const size_t n_stars, const long *ucac2_numbers,
+                  UCAC2_STAR *stars, int *rvals, const char *path);
+         /* Hands every star in a zone to the callback,  with its zone  */
+         /* and zero-based offset,  for tools that go through the whole */
+         /* catalog.  If the callback returns non-zero,  we stop.        */
+         /* Returns the number of stars passed,  or a negative error.    */
+int for_each_ucac2_star_in_zone( const int zone, const char *path,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC2_STAR *));
+long ucac2_star_number( const int zone, const long offset);
 int write_ucac2_star( const long offset, char *obuff,
                                           const UCAC2_STAR *star);
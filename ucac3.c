@@ -2,6 +2,8 @@
 #include <string.h>
 #include <stdlib.h>
 #include "ucac3.h"
+#include "out_sink.h"
+#include "bulk_req.h"
 
 /* History: */
 
@@ -88,7 +90,8 @@
 corresponding table for UCAC-2!  That's what was supplied with UCAC-3...
 and it happens to make things just slightly easier: */
 
-static long ucac3_offsets[361] = {
+#ifdef NOW_OBSOLETE   /* zone sizes now come from the files themselves */
+static const long ucac3_offsets[361] = {
         1,      1259,      5087,     11572,     20547,     31955,
     45619,     61631,     80399,    102269,    126197,    152603,
    180958,    212191,    245313,    280385,    318125,    358548,
@@ -150,6 +153,7 @@ static long ucac3_offsets[361] = {
 100643307, 100664312, 100683511, 100701141, 100715633, 100727974,
 100738493, 100746909, 100753745, 100759267, 100763371, 100765503,
 100766421 };
+#endif
 
 #ifdef __BYTE_ORDER
 #if __BYTE_ORDER == __BIG_ENDIAN
@@ -382,6 +386,7 @@ int write_ucac3_star( const int zone, const long offset, char *obuff,
 #error "Unknown platform; please report so it can be fixed!"
 #endif
 
+
 static FILE *get_ucac3_zone_file( const int zone_number,
               const int is_supplement, const char *path)
 {
@@ -406,6 +411,7 @@ static FILE *get_ucac3_zone_file( const int zone_number,
 #define UCAC3_BAD_FSEEK             -2
 #define UCAC3_BAD_FREAD             -3
 #define UCAC3_FILE_NOT_FOUND        -4
+#define UCAC3_ALLOC_FAILED          -5
 
 int extract_ucac3_info( const int zone, const long offset, UCAC3_STAR *star,
                      const char *path)
@@ -441,6 +447,99 @@ int extract_ucac3_info( const int zone, const long offset, UCAC3_STAR *star,
    return( rval);
 }
 
+static long read_bulk_ucac3_stars( void *context, const int zone,
+                  const long offset, const size_t n_stars, void *buff)
+{
+   bulk_reader_t *r = (bulk_reader_t *)context;
+   UCAC3_STAR *stars = (UCAC3_STAR *)buff;
+   size_t n_read;
+
+   if( zone != r->zone)
+      {
+      if( r->ifile)
+         fclose( r->ifile);
+      r->ifile = NULL;
+      if( zone >= 1 && zone <= 360)
+         r->ifile = get_ucac3_zone_file( zone, 0, r->path);
+      r->zone = zone;
+      }
+   if( zone < 1 || zone > 360)
+      return( UCAC3_BAD_ZONE);
+   if( !r->ifile)
+      return( UCAC3_FILE_NOT_FOUND);
+   if( offset < 1
+          || fseek( r->ifile, (offset - 1) * sizeof( UCAC3_STAR), SEEK_SET))
+      return( UCAC3_BAD_FSEEK);
+   n_read = fread( stars, sizeof( UCAC3_STAR), n_stars, r->ifile);
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   {
+   size_t i;
+
+   for( i = 0; i < n_read; i++)
+      flip_ucac3_star( stars + i);
+   }
+#endif
+#endif
+   return( (long)n_read);
+}
+
+int extract_ucac3_info_bulk( const size_t n_stars, const int *zones,
+                  const long *offsets, UCAC3_STAR *stars, int *rvals,
+                  const char *path)
+{
+   bulk_reader_t r;
+   int rval;
+
+   r.path = path;
+   r.ifile = NULL;
+   r.zone = 0;
+   rval = run_bulk_requests( n_stars, zones, offsets, stars,
+                  sizeof( UCAC3_STAR), rvals, UCAC3_BAD_FREAD,
+                  &r, read_bulk_ucac3_stars);
+   if( r.ifile)
+      fclose( r.ifile);
+   return( rval == BULK_REQ_ALLOC_FAILED ? UCAC3_ALLOC_FAILED : rval);
+}
+
+/* for_each_ucac3_star_in_zone() reads through the zone with the bulk
+reader above;  see run_zone_loop() in 'bulk_req.h'.  */
+
+typedef struct
+   {
+   void *context;
+   int (*callback_fn)( void *, const int, const uint32_t, const UCAC3_STAR *);
+   } zone_loop_t;
+
+static int pass_ucac3_star( void *context, const int zone, const long offset,
+                  const void *star)
+{
+   zone_loop_t *z = (zone_loop_t *)context;
+
+   return( z->callback_fn( z->context, zone, (uint32_t)offset,
+                  (const UCAC3_STAR *)star));
+}
+
+int for_each_ucac3_star_in_zone( const int zone, const char *path,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC3_STAR *))
+{
+   bulk_reader_t r;
+   zone_loop_t z;
+   int rval;
+
+   r.path = path;
+   r.ifile = NULL;
+   r.zone = 0;
+   z.context = context;
+   z.callback_fn = callback_fn;
+   rval = run_zone_loop( zone, sizeof( UCAC3_STAR), &r, read_bulk_ucac3_stars,
+                  &z, pass_ucac3_star, UCAC3_ALLOC_FAILED);
+   if( r.ifile)
+      fclose( r.ifile);
+   return( rval);
+}
+
 static FILE *get_ucac3_index_file( const char *path, const int is_supplement)
 {
    FILE *index_file;
@@ -463,137 +562,456 @@ static FILE *get_ucac3_index_file( const char *path, const int is_supplement)
    return( index_file);
 }
 
-#define UCAC3_FSEEK_FAILED          -1
-#define UCAC3_READ1_FAILED          -2
-#define UCAC3_READ2_FAILED          -3
 #define UCAC3_READ3_FAILED          -4
 
-int extract_ucac3_stars( FILE *ofile, const double ra, const double dec,
-                  const double width, const double height, const char *path,
+/* A catalog keeps the indices in memory.  u3index.bin holds, for each
+of the 360 half-degree zones,  241 offsets:  the start of each of 240
+RA bins (each 1.5 degrees wide),  plus the end of the last one.  So bin
+'b' of a zone runs from entry b to entry b+1.  bs3idx.bin is the same
+for the 36 five-degree zones of the Bright Star Supplement.  Both are
+small (348 and 35 KBytes),  so we just read them in at the start.
+
+   Without a catalog,  the index is read as needed,  a bin at a time,
+with the last bin read kept in case it's wanted again (it will be,  if
+the extraction is less than 1.5 degrees wide and several zones high).
+If there's no index,  the whole zone is searched. */
+
+#define UCAC3_N_ZONES               360
+#define UCAC3_N_SUPP_ZONES           36
+#define UCAC3_RA_BINS               240
+#define UCAC3_ZONE_INDEX_SIZE       (UCAC3_RA_BINS + 1)
+#define UCAC3_BUFFSIZE              400   /* read this many stars at a try */
+
+struct ucac3_catalog
+   {
+   char *path;
+   uint32_t *index[2];     /* u3index.bin,  bs3idx.bin;  NULL if not loaded */
+   FILE *index_file[2];    /* used only if the index isn't loaded */
+   long cached_index_data[2][3];    /* last bin read from 'index_file' */
+   UCAC3_STAR *stars;               /* buffer of UCAC3_BUFFSIZE stars */
+   };
+
+static uint32_t *load_ucac3_index( FILE *index_file, const int n_zones)
+{
+   const size_t n_entries = (size_t)n_zones * UCAC3_ZONE_INDEX_SIZE;
+   uint32_t *index = (uint32_t *)malloc( n_entries * sizeof( uint32_t));
+
+   if( index)
+      {
+      fseek( index_file, 0L, SEEK_SET);
+      if( fread( index, sizeof( uint32_t), n_entries, index_file)
+                                 != n_entries)
+         {
+         free( index);        /* short index;  just don't use it */
+         index = NULL;
+         }
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+      else
+         {
+         size_t i;
+
+         for( i = 0; i < n_entries; i++)
+            swap_32( (int32_t *)( index + i));
+         }
+#endif
+#endif
+      }
+   return( index);
+}
+
+#define INDEX_READ_AS_NEEDED       1
+#define INDEX_LOADED               2
+
+static ucac3_catalog_t *init_ucac3_catalog( const char *path,
+                                            const int index_usage)
+{
+   ucac3_catalog_t *cat = (ucac3_catalog_t *)calloc( 1,
+                                             sizeof( ucac3_catalog_t));
+   int i;
+
+   if( cat)
+      {
+      cat->path = (char *)malloc( strlen( path) + 1);
+      cat->stars = (UCAC3_STAR *)calloc( UCAC3_BUFFSIZE, sizeof( UCAC3_STAR));
+      if( !cat->path || !cat->stars)
+         {
+         free( cat->path);
+         free( cat->stars);
+         free( cat);
+         return( NULL);
+         }
+      strcpy( cat->path, path);
+      for( i = 0; i < 2; i++)
+         {
+         cat->cached_index_data[i][0] = -1L;
+         cat->index_file[i] = get_ucac3_index_file( path, i);
+         if( cat->index_file[i] && index_usage == INDEX_LOADED)
+            {
+            cat->index[i] = load_ucac3_index( cat->index_file[i],
+                           (i ? UCAC3_N_SUPP_ZONES : UCAC3_N_ZONES));
+            if( cat->index[i])
+               {
+               fclose( cat->index_file[i]);
+               cat->index_file[i] = NULL;
+               }
+            }
+         }
+      }
+   return( cat);
+}
+
+ucac3_catalog_t *open_ucac3_catalog( const char *path)
+{
+   return( init_ucac3_catalog( path, INDEX_LOADED));
+}
+
+void close_ucac3_catalog( ucac3_catalog_t *cat)
+{
+   if( cat)
+      {
+      int i;
+
+      for( i = 0; i < 2; i++)
+         {
+         if( cat->index_file[i])
+            fclose( cat->index_file[i]);
+         free( cat->index[i]);
+         }
+      free( cat->stars);
+      free( cat->path);
+      free( cat);
+      }
+}
+
+/* Sets the range of offsets within a zone for an RA bin,  either from
+the in-memory index or by reading the index file.  Returns -1 if there's
+no index,  or it couldn't be read. */
+
+static int get_bin_range( ucac3_catalog_t *cat, const int zone,
+                  const int is_supplement, const int ra_start,
+                  uint32_t *offset, uint32_t *end_offset)
+{
+   const long loc = (zone - 1L) * UCAC3_ZONE_INDEX_SIZE + ra_start;
+   long *cache = cat->cached_index_data[is_supplement];
+   FILE *index_file = cat->index_file[is_supplement];
+   uint32_t range[2];
+
+   if( cat->index[is_supplement])
+      {
+      *offset = cat->index[is_supplement][loc];
+      *end_offset = cat->index[is_supplement][loc + 1];
+      return( 0);
+      }
+   if( loc == cache[0])
+      {
+      *offset = (uint32_t)cache[1];
+      *end_offset = (uint32_t)cache[2];
+      return( 0);
+      }
+   if( !index_file || fseek( index_file, loc * sizeof( uint32_t), SEEK_SET)
+               || fread( range, sizeof( uint32_t), 2, index_file) != 2)
+      return( -1);
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   swap_32( (int32_t *)range);
+   swap_32( (int32_t *)( range + 1));
+#endif
+#endif
+   cache[0] = loc;
+   cache[1] = (long)( *offset = range[0]);
+   cache[2] = (long)( *end_offset = range[1]);
+   return( 0);
+}
+
+/* As with UCAC4 and URAT1,  we use a secant search within the index
+bin to get within 'acceptable_limit' records of the first star we want,
+modified so that each step knocks off at least 1/8 of the range (which
+keeps it from crawling along in the occasional bad case).  Stars are
+then read 'UCAC3_BUFFSIZE' at a time.  */
+
+static int extract_ucac3_zone( ucac3_catalog_t *cat, out_sink_t *sink,
+                  const int zone, const double ra, const double dec,
+                  const double width, const double height,
                   const int is_supplement, const int output_format)
 {
    const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
    const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
-   const double zone_height = (is_supplement ? 5. : .5);
-   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
-   const int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
    int ra_start = (int)( ra1 / 1.5);
+   FILE *ifile;
    int rval = 0;
-   static long cached_index_data[3] = {-1L, 0L, 0L};
-   FILE *index_file = NULL;
 
-   if( zone < 1)
-      zone = 1;
    if( ra_start < 0)
       ra_start = 0;
-   while( rval >= 0 && zone <= end_zone)
+   if( ra_start >= UCAC3_RA_BINS)
+      ra_start = UCAC3_RA_BINS - 1;
+   ifile = get_ucac3_zone_file( zone, is_supplement, cat->path);
+   if( ifile)
       {
-      FILE *ifile = get_ucac3_zone_file( zone, is_supplement, path);
-
-      if( ifile)
+      int keep_going = 1, i, n_read;
+      const int32_t max_ra  = (int32_t)( ra2 * 3600. * 1000.);
+      const int32_t min_ra  = (int32_t)( ra1 * 3600. * 1000.);
+      const int32_t min_spd = (int32_t)( (dec1 + 90.) * 3600. * 1000.);
+      const int32_t max_spd = (int32_t)( (dec2 + 90.) * 3600. * 1000.);
+      const uint32_t ra_range = (uint32_t)( 360 * 3600 * 1000);
+      uint32_t ra_lo = (uint32_t)ra_start * (ra_range / UCAC3_RA_BINS);
+      uint32_t ra_hi = ra_lo + ra_range / UCAC3_RA_BINS;
+      uint32_t offset, end_offset, n_stars;
+      const long acceptable_limit = 40;
+      UCAC3_STAR *stars = cat->stars;
+
+      fseek( ifile, 0L, SEEK_END);
+      n_stars = (uint32_t)( ftell( ifile) / sizeof( UCAC3_STAR));
+      if( get_bin_range( cat, zone, is_supplement, ra_start,
+                                  &offset, &end_offset))
+         {     /* no index:  search within entire zone: */
+         offset = 0;
+         end_offset = n_stars;
+         ra_lo = 0;
+         ra_hi = ra_range;
+         }
+      if( end_offset > n_stars)        /* index doesn't match the data */
+         end_offset = n_stars;
+      if( offset > end_offset)
+         offset = end_offset;
+                  /* Secant-search within the known limits: */
+      while( (long)( end_offset - offset) > acceptable_limit)
          {
-         int keep_going = 1;
+         const long delta = (long)( end_offset - offset);
+         const long minimum_bite = delta / 8 + 1;
+         long tval = (long)( (int64_t)delta * (int64_t)( min_ra - (int32_t)ra_lo)
+                       / (int64_t)( ra_hi - ra_lo));
+         uint32_t toffset;
          UCAC3_STAR star;
-         const int32_t max_ra  = (int32_t)( ra2 * 3600. * 1000.);
-         const int32_t min_ra  = (int32_t)( ra1 * 3600. * 1000.);
-         const int32_t min_spd = (int32_t)( (dec1 + 90.) * 3600. * 1000.);
-         const int32_t max_spd = (int32_t)( (dec2 + 90.) * 3600. * 1000.);
-         uint32_t offset, end_offset, toffset, step;
-         const long index_offset = ((zone - 1L) * 241L + ra_start) * sizeof( uint32_t);
-
-         if( index_offset == cached_index_data[0])
+
+         if( tval < minimum_bite)
+            tval = minimum_bite;
+         else if( tval > delta - minimum_bite)
+            tval = delta - minimum_bite;
+         toffset = offset + (uint32_t)tval;
+         fseek( ifile, (long)toffset * (long)sizeof( UCAC3_STAR), SEEK_SET);
+         if( !fread( &star, sizeof( UCAC3_STAR), 1, ifile))
             {
-            offset = cached_index_data[1];
-            end_offset = cached_index_data[2];
+            rval = UCAC3_READ3_FAILED;
+            break;
             }
-         else
-            {
-            if( !index_file)
-               index_file = get_ucac3_index_file( path, is_supplement);
-            if( index_file)
-               {
-               if( fseek( index_file, index_offset, SEEK_SET))
-                  rval = UCAC3_FSEEK_FAILED;
-               if( !fread( &offset, sizeof( uint32_t), 1, index_file))
-                  rval = UCAC3_READ1_FAILED;
-               if( !fread( &end_offset, 1, sizeof( uint32_t), index_file))
-                  rval = UCAC3_READ2_FAILED;
 #ifdef __BYTE_ORDER
 #if __BYTE_ORDER == __BIG_ENDIAN
-               swap_32( &offset);
-               swap_32( &end_offset);
+         swap_32( &star.ra);
 #endif
 #endif
-               cached_index_data[0] = index_offset;
-               cached_index_data[1] = offset;
-               cached_index_data[2] = end_offset;
-               }
-            else     /* no index:  binary-search within entire zone: */
-               {
-               offset = 0;
-               end_offset = ucac3_offsets[zone] - ucac3_offsets[zone - 1];
-               }
+         if( star.ra < min_ra)
+            {
+            offset = toffset;
+            ra_lo = (uint32_t)star.ra;
             }
-                     /* Binary-search within the known limits: */
-         for( step = 0x800000; step; step >>= 1)
-            if( (toffset = offset + step) < end_offset)
-               {
-               fseek( ifile, toffset * sizeof( UCAC3_STAR), SEEK_SET);
-               if( !fread( &star, sizeof( UCAC3_STAR), 1, ifile))
-                  rval = UCAC3_READ3_FAILED;
-               if( star.ra < min_ra)
-                  offset = toffset;
-//             printf( "Offset now %ld (tried %ld)\n",
-//                       (long)( offset + offset0),
-//                       (long)( toffset + offset0));
-               }
-         fseek( ifile, offset * sizeof( UCAC3_STAR), SEEK_SET);
+         else
+            {
+            end_offset = toffset;
+            ra_hi = (uint32_t)star.ra;
+            }
+         }
+      fseek( ifile, (long)offset * (long)sizeof( UCAC3_STAR), SEEK_SET);
 
-         while( fread( &star, 1, sizeof( UCAC3_STAR), ifile) && keep_going)
+      while( rval >= 0 && keep_going && (n_read = (int)fread( stars,
+                        sizeof( UCAC3_STAR), UCAC3_BUFFSIZE, ifile)) > 0)
+         for( i = 0; i < n_read && keep_going; i++, offset++)
             {
+            UCAC3_STAR *star = stars + i;
+
 #ifdef __BYTE_ORDER
 #if __BYTE_ORDER == __BIG_ENDIAN
-            flip_ucac3_star( &star);
+            flip_ucac3_star( star);
 #endif
 #endif
-            if( star.ra > max_ra)
+            if( star->ra > max_ra)
                keep_going = 0;
-            else if( star.ra > min_ra && star.spd > min_spd
-                                        && star.spd < max_spd)
+            else if( star->ra > min_ra && star->spd > min_spd
+                                        && star->spd < max_spd)
                if( !(output_format & UCAC3_OMIT_TYCHO_STARS) ||
-                        !star.catflag[UCAC3_CATFLAG_TYCHO])
-                  if( star.twomass_id ||
+                        !star->catflag[UCAC3_CATFLAG_TYCHO])
+                  if( star->twomass_id ||
                         (output_format & UCAC3_INCLUDE_DOUBTFULS))
                      {
-                     rval++;
-                     if( ofile)
-                        {
-                        char buff[UCAC3_ASCII_SIZE];
+                     char *buff = (sink ?
+                              sink_reserve( sink, UCAC3_ASCII_SIZE) : NULL);
 
-                        write_ucac3_star( zone, offset + 1, buff, &star,
+                     if( sink && !buff)      /* sink error;  stop with it */
+                        {
+                        rval = flush_sink( sink);
+                        keep_going = 0;
+                        }
+                     else
+                        rval++;
+                     if( buff)
+                        {
+                        write_ucac3_star( zone, offset + 1, buff, star,
                                                          output_format);
-                        fwrite( buff, 1, strlen( buff), ofile);
+                        if( is_supplement
+                                 && (output_format & UCAC3_TAG_SUPPLEMENT)
+                                 && !(output_format & UCAC3_FORTRAN_STYLE))
+                           *buff = 's';      /* '011-...' -> 's11-...' */
+                        sink_commit( sink, strlen( buff));
                         }
                      }
-            offset++;
             }
-         fclose( ifile);
-         }
+      fclose( ifile);
+      }
+   return( rval);
+}
+
+int extract_ucac3_stars_from_catalog( ucac3_catalog_t *cat,
+                  out_sink_t *sink, const double ra, const double dec,
+                  const double width, const double height,
+                  const int is_supplement, const int output_format)
+{
+   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
+   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
+   const double zone_height = (is_supplement ? 5. : .5);
+   const int n_zones = (is_supplement ? UCAC3_N_SUPP_ZONES : UCAC3_N_ZONES);
+   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
+   int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
+   int rval = 0;
+
+   if( zone < 1)
+      zone = 1;
+   if( end_zone > n_zones)
+      end_zone = n_zones;
+   while( rval >= 0 && zone <= end_zone)
+      {
+      const int zone_rval = extract_ucac3_zone( cat, sink, zone, ra, dec,
+                        width, height, is_supplement, output_format);
+
+      rval = (zone_rval < 0 ? zone_rval : rval + zone_rval);
       zone++;
       }
-   if( index_file)
-      fclose( index_file);
 
             /* We need some special handling for cases where the area
                to be extracted crosses RA=0 or RA=24: */
    if( rval >= 0 && ra > 0. && ra < 360.)
       {
       if( ra1 < 0.)      /* left side crosses over RA=0h */
-         rval += extract_ucac3_stars( ofile, ra+360., dec, width, height,
-                                          path, is_supplement, output_format);
+         rval += extract_ucac3_stars_from_catalog( cat, sink, ra+360., dec,
+                             width, height, is_supplement, output_format);
       if( ra2 > 360.)    /* right side crosses over RA=24h */
-         rval += extract_ucac3_stars( ofile, ra-360., dec, width, height,
-                                          path, is_supplement, output_format);
+         rval += extract_ucac3_stars_from_catalog( cat, sink, ra-360., dec,
+                             width, height, is_supplement, output_format);
+      }
+   return( rval);
+}
+
+/* Gets supplement and main stars in one pass,  just as UCAC2's
+extract_ucac2_all_stars_to_sink() does;  see the comments before it in
+'ucac2.c'.  Here,  the catalog holds both indices,  so they're only
+loaded (or opened) once.  */
+
+#define UCAC3_MAIN_ZONES_PER_SUPP_ZONE    10
+
+int extract_ucac3_all_stars_from_catalog( ucac3_catalog_t *cat,
+                  out_sink_t *sink, const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
+   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
+   int zone = (int)( (dec1  + 90.) / .5) + 1;
+   int end_zone = (int)( (dec2 + 90.) / .5) + 1;
+   int rval = 0, prev_supp_zone = 0;
+   const int format = output_format | UCAC3_TAG_SUPPLEMENT;
+
+   if( zone < 1)
+      zone = 1;
+   if( end_zone > UCAC3_N_ZONES)
+      end_zone = UCAC3_N_ZONES;
+   while( rval >= 0 && zone <= end_zone)
+      {
+      const int supp_zone = (zone - 1) / UCAC3_MAIN_ZONES_PER_SUPP_ZONE + 1;
+      int zone_rval = 0;
+
+      if( supp_zone != prev_supp_zone)
+         {
+         zone_rval = extract_ucac3_zone( cat, sink, supp_zone, ra, dec,
+                        width, height, 1, format);
+         prev_supp_zone = supp_zone;
+         }
+      if( zone_rval >= 0)
+         {
+         const int main_rval = extract_ucac3_zone( cat, sink, zone, ra, dec,
+                        width, height, 0, format);
+
+         zone_rval = (main_rval < 0 ? main_rval : zone_rval + main_rval);
+         }
+      rval = (zone_rval < 0 ? zone_rval : rval + zone_rval);
+      zone++;
+      }
+
+   if( rval >= 0 && ra > 0. && ra < 360.)
+      {
+      if( ra1 < 0.)      /* left side crosses over RA=0h */
+         rval += extract_ucac3_all_stars_from_catalog( cat, sink, ra+360.,
+                             dec, width, height, output_format);
+      if( ra2 > 360.)    /* right side crosses over RA=24h */
+         rval += extract_ucac3_all_stars_from_catalog( cat, sink, ra-360.,
+                             dec, width, height, output_format);
+      }
+   return( rval);
+}
+
+int extract_ucac3_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int is_supplement,
+                  const int output_format)
+{
+   ucac3_catalog_t *cat = init_ucac3_catalog( path, INDEX_READ_AS_NEEDED);
+   int rval = UCAC3_ALLOC_FAILED;
+
+   if( cat)
+      {
+      rval = extract_ucac3_stars_from_catalog( cat, sink, ra, dec,
+                        width, height, is_supplement, output_format);
+      close_ucac3_catalog( cat);
+      }
+   return( rval);
+}
+
+int extract_ucac3_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int is_supplement, const int output_format)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = -1;
+
+   if( sink || !ofile)
+      rval = extract_ucac3_stars_to_sink( sink, ra, dec, width, height,
+                                    path, is_supplement, output_format);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
+      }
+   return( rval);
+}
+
+int extract_ucac3_all_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int output_format)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   ucac3_catalog_t *cat = init_ucac3_catalog( path, INDEX_READ_AS_NEEDED);
+   int rval = UCAC3_ALLOC_FAILED;
+
+   if( cat && (sink || !ofile))
+      rval = extract_ucac3_all_stars_from_catalog( cat, sink, ra, dec,
+                        width, height, output_format);
+   close_ucac3_catalog( cat);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
       }
    return( rval);
 }
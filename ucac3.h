@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include "out_sink.h"
 
       /* Forcing byte-aligned packing is probably not _essential_,  but... */
 #pragma pack( 1)
@@ -56,8 +57,56 @@ int extract_ucac3_stars( FILE *ofile, const double ra, const double dec,
                   const double width, const double height, const char *path,
                   const int is_supplement, const int output_format);
 
+         /* Same,  except output goes to an 'out_sink_t' ('out_sink.h'), */
+         /* which can write to a file descriptor,  memory,  or callback. */
+int extract_ucac3_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int is_supplement,
+                  const int output_format);
+
+         /* If you're doing more than one extraction,  it's faster to   */
+         /* open the catalog once.  This loads the indices (u3index.bin */
+         /* and bs3idx.bin) into memory,  so finding where to start in  */
+         /* each zone needs no index reads.  A catalog shouldn't be     */
+         /* used by more than one thread at a time.                     */
+typedef struct ucac3_catalog ucac3_catalog_t;
+
+ucac3_catalog_t *open_ucac3_catalog( const char *path);
+void close_ucac3_catalog( ucac3_catalog_t *cat);
+int extract_ucac3_stars_from_catalog( ucac3_catalog_t *cat,
+                  out_sink_t *sink, const double ra, const double dec,
+                  const double width, const double height,
+                  const int is_supplement, const int output_format);
+         /* Gets stars from both the main catalog and the Bright Star     */
+         /* Supplement in one pass.  Output is in zone order,  each five- */
+         /* degree supplement zone coming just before the ten main zones  */
+         /* it overlaps.  Supplement stars are tagged,  with IDs of the   */
+         /* form 'snn-nnnnnn' (see UCAC3_TAG_SUPPLEMENT below),  except   */
+         /* with UCAC3_FORTRAN_STYLE output,  which has no ID to tag.     */
+int extract_ucac3_all_stars_from_catalog( ucac3_catalog_t *cat,
+                  out_sink_t *sink, const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+int extract_ucac3_all_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int output_format);
+
 int extract_ucac3_info( const int zone, const long offset, UCAC3_STAR *star,
                      const char *path);
+         /* Gets 'n_stars' stars at once,  given their zones and (one-   */
+         /* based) offsets;  much faster than extract_ucac3_info() for a */
+         /* long list.  See 'bulk_req.h' for how it's done and what      */
+         /* comes back;  errors are as extract_ucac3_info() would give.  */
+int extract_ucac3_info_bulk( const size_t n_stars, const int *zones,
+                  const long *offsets, UCAC3_STAR *stars, int *rvals,
+                  const char *path);
+         /* Hands every star in a zone to the callback,  with its zone  */
+         /* and zero-based offset,  for tools that go through the whole */
+         /* catalog.  If the callback returns non-zero,  we stop.        */
+         /* Returns the number of stars passed,  or a negative error.    */
+int for_each_ucac3_star_in_zone( const int zone, const char *path,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC3_STAR *));
 int write_ucac3_star( const int zone, const long offset, char *obuff,
                      const UCAC3_STAR *star, const int output_format);
 
@@ -81,6 +130,13 @@ int write_ucac3_star( const int zone, const long offset, char *obuff,
          /* you wish,  using the following flag.                         */
 #define UCAC3_INCLUDE_DOUBTFULS           0x8
 
+         /* Supplement stars are normally written with IDs just like those */
+         /* of main catalog stars,  which is ambiguous if you're getting   */
+         /* both.  With this flag,  they're written as 'snn-nnnnnn',  to   */
+         /* match the file names.  extract_ucac3_all_stars() sets it.      */
+         /* It's ignored for UCAC3_FORTRAN_STYLE output (no ID is written). */
+#define UCAC3_TAG_SUPPLEMENT              0x10
+
 #define UCAC3_CATFLAG_HIP           0
 #define UCAC3_CATFLAG_TYCHO         1
 #define UCAC3_CATFLAG_AC2000        2
@@ -2,7 +2,14 @@
 #include <string.h>
 #include <stdlib.h>
 #include <assert.h>
+#include <time.h>
+#include <errno.h>
 #include "ucac4.h"
+#include "mem_map.h"
+#include "fmt_num.h"
+#include "out_sink.h"
+#include "par_jobs.h"
+#include "bulk_req.h"
 
 /* Basic access functions for UCAC-4.  Public domain.  Please contact
 pluto (at) projectpluto.com with comments/bug fixes.  */
@@ -22,15 +29,12 @@ pluto (at) projectpluto.com with comments/bug fixes.  */
 
    UCAC4 consists of 900 zones,  each .2 degrees high in declination.  */
 
-#ifdef CUMULATIVE_DESIGNATORS_USED
-      /* ...unless we end up with a designation system that is a */
-      /* cumulative count across the entire catalog,  instead of */
-      /* a zone/number-within-zone designation scheme.  I don't  */
-      /* know which will be used yet,  so I've #ifdeffed this    */
-      /* out but am not deleting it yet.  (Updated 2012 Oct 6    */
-      /* after Thomas Meyer pointed out that the counts changed  */
-      /* in "final" UCAC4... I'd thought they were the same as   */
-      /* for the last beta UCAC4.)                                */
+/* UCAC4 stars are designated by zone and offset within the zone.  But
+one can also number them cumulatively across the entire catalog,  from
+1 to 113780093;  the following table gives the number of stars before
+each zone,  and lets us convert back and forth.  (Updated 2012 Oct 6
+after Thomas Meyer pointed out that the counts changed in "final" UCAC4
+... I'd thought they were the same as for the last beta UCAC4.) */
 
 static const int32_t ucac4_offsets[901] = {
         0,       206,       866,      2009,      3622,      5571,
@@ -184,7 +188,37 @@ static const int32_t ucac4_offsets[901] = {
 113758958, 113761983, 113764935, 113767665, 113770070, 113772225,
 113774103, 113775753, 113777249, 113778576, 113779410, 113779922,
 113780093 };
-#endif     // CUMULATIVE_DESIGNATORS_USED
+
+int32_t ucac4_cumulative_number( const int zone, const long offset)
+{
+   if( zone < 1 || zone > 900 || offset < 1
+                || offset > ucac4_offsets[zone] - ucac4_offsets[zone - 1])
+      return( 0);
+   return( ucac4_offsets[zone - 1] + (int32_t)offset);
+}
+
+int ucac4_zone_and_offset( const int32_t cumulative_number, int *zone,
+                                          long *offset)
+{
+   int lo = 0, hi = 900;
+
+   if( cumulative_number < 1 || cumulative_number > ucac4_offsets[900])
+      return( -1);
+               /* find the zone 'lo + 1' such that        */
+               /* ucac4_offsets[lo] < n <= ucac4_offsets[lo + 1] : */
+   while( hi - lo > 1)
+      {
+      const int mid = (lo + hi) / 2;
+
+      if( ucac4_offsets[mid] < cumulative_number)
+         lo = mid;
+      else
+         hi = mid;
+      }
+   *zone = lo + 1;
+   *offset = (long)( cumulative_number - ucac4_offsets[lo]);
+   return( 0);
+}
 
 #ifdef __BYTE_ORDER
 #if __BYTE_ORDER == __BIG_ENDIAN
@@ -232,15 +266,167 @@ void flip_ucac4_star( UCAC4_STAR *star)
    swap_16( &star->ucac2_zone);
    swap_32( &star->ucac2_number);
 }
+
+static void flip_ucac4_hot( ucac4_hot_t *hot)
+{
+   swap_32( &hot->ra);
+   swap_32( &hot->spd);
+   swap_16( (int16_t *)&hot->mag1);
+   swap_16( (int16_t *)&hot->epoch_ra);
+   swap_16( (int16_t *)&hot->epoch_dec);
+   swap_16( &hot->pm_ra);
+   swap_16( &hot->pm_dec);
+}
 #endif                   // #if __BYTE_ORDER == __BIG_ENDIAN
 #endif                   // #ifdef __BYTE_ORDER
 
+/* Splitting and joining just copy fields,  so they don't care about
+byte order;  the exception is the hot 'flags' byte,  set by looking at
+'twomass_id' and 'catalog_flags',  which must be in native order.  */
+
+void split_ucac4_star( ucac4_hot_t *hot, ucac4_cold_t *cold,
+                                    const UCAC4_STAR *star)
+{
+   hot->ra = star->ra;
+   hot->spd = star->spd;
+   hot->mag1 = star->mag1;
+   hot->epoch_ra = star->epoch_ra;
+   hot->epoch_dec = star->epoch_dec;
+   hot->pm_ra = star->pm_ra;
+   hot->pm_dec = star->pm_dec;
+   hot->flags = 0;
+   if( star->twomass_id)
+      hot->flags |= UCAC4_HOT_HAS_2MASS;
+   if( ucac4_tycho_catflag( star->catalog_flags))
+      hot->flags |= UCAC4_HOT_TYCHO;
+   hot->reserved = 0;
+   if( cold)
+      {
+      cold->mag2 = star->mag2;
+      cold->mag_sigma = star->mag_sigma;
+      cold->obj_type = star->obj_type;
+      cold->double_star_flag = star->double_star_flag;
+      cold->ra_sigma = star->ra_sigma;
+      cold->dec_sigma = star->dec_sigma;
+      cold->n_ucac_total = star->n_ucac_total;
+      cold->n_ucac_used = star->n_ucac_used;
+      cold->n_cats_used = star->n_cats_used;
+      cold->pm_ra_sigma = star->pm_ra_sigma;
+      cold->pm_dec_sigma = star->pm_dec_sigma;
+      cold->twomass_id = star->twomass_id;
+      cold->mag_j = star->mag_j;
+      cold->mag_h = star->mag_h;
+      cold->mag_k = star->mag_k;
+      memcpy( cold->icq_flag, star->icq_flag, 3);
+      memcpy( cold->e2mpho, star->e2mpho, 3);
+      memcpy( cold->apass_mag, star->apass_mag, 5 * sizeof( uint16_t));
+      memcpy( cold->apass_mag_sigma, star->apass_mag_sigma, 5);
+      cold->yale_gc_flags = star->yale_gc_flags;
+      cold->catalog_flags = star->catalog_flags;
+      cold->leda_flag = star->leda_flag;
+      cold->twomass_ext_flag = star->twomass_ext_flag;
+      cold->id_number = star->id_number;
+      cold->ucac2_zone = star->ucac2_zone;
+      cold->ucac2_number = star->ucac2_number;
+      }
+}
+
+void join_ucac4_star( UCAC4_STAR *star, const ucac4_hot_t *hot,
+                                    const ucac4_cold_t *cold)
+{
+   star->ra = hot->ra;
+   star->spd = hot->spd;
+   star->mag1 = hot->mag1;
+   star->epoch_ra = hot->epoch_ra;
+   star->epoch_dec = hot->epoch_dec;
+   star->pm_ra = hot->pm_ra;
+   star->pm_dec = hot->pm_dec;
+   star->mag2 = cold->mag2;
+   star->mag_sigma = cold->mag_sigma;
+   star->obj_type = cold->obj_type;
+   star->double_star_flag = cold->double_star_flag;
+   star->ra_sigma = cold->ra_sigma;
+   star->dec_sigma = cold->dec_sigma;
+   star->n_ucac_total = cold->n_ucac_total;
+   star->n_ucac_used = cold->n_ucac_used;
+   star->n_cats_used = cold->n_cats_used;
+   star->pm_ra_sigma = cold->pm_ra_sigma;
+   star->pm_dec_sigma = cold->pm_dec_sigma;
+   star->twomass_id = cold->twomass_id;
+   star->mag_j = cold->mag_j;
+   star->mag_h = cold->mag_h;
+   star->mag_k = cold->mag_k;
+   memcpy( star->icq_flag, cold->icq_flag, 3);
+   memcpy( star->e2mpho, cold->e2mpho, 3);
+   memcpy( star->apass_mag, cold->apass_mag, 5 * sizeof( uint16_t));
+   memcpy( star->apass_mag_sigma, cold->apass_mag_sigma, 5);
+   star->yale_gc_flags = cold->yale_gc_flags;
+   star->catalog_flags = cold->catalog_flags;
+   star->leda_flag = cold->leda_flag;
+   star->twomass_ext_flag = cold->twomass_ext_flag;
+   star->id_number = cold->id_number;
+   star->ucac2_zone = cold->ucac2_zone;
+   star->ucac2_number = cold->ucac2_number;
+}
+
     /* Storing proper motions in a 16-bit int in units of .1 mas/year */
     /* allows storing of proper motions of up to 3.2766"/year.  But   */
     /* 25 stars in UCAC4 are faster than this.  For them,  the proper */
     /* motion is stored as 32767 in one or both axes,  and one must   */
     /* look up the real proper motion using the following function.   */
 
+/* The table is copied from /u4i/u4hpm.dat of the first DVD,  but is
+arranged as a perfect hash :  star n is in slot (n * HPM_MULTIPLIER) >> 27
+(with 32-bit arithmetic),  and no two stars land in the same slot.  The
+multiplier was found by trying random odd numbers until one worked.
+The table was formerly searched linearly,  which made decoding every
+star in a batch (see below) rather slow if many were high-PM stars. */
+
+#define HPM_MULTIPLIER 0xcf37ce9bu
+#define HPM_SHIFT 27
+
+static const int32_t hpm_table[32][3] = {
+      {    201349,   22819,   53694 },      /*  0 */
+      {    200168,  -36004,    9521 },      /*  1 */
+      {    200530,   67682,   13275 },      /*  2 */
+      {         0,       0,       0 },      /*  3 */
+      {  93157181,  -22393,  -34199 },      /*  4 */
+      {  80118783,   32962,    5639 },      /*  5 */
+      {    200503,   56347,  -23377 },      /*  6 */
+      {         0,       0,       0 },      /*  7 */
+      {    201526,   -5803,  -47659 },      /*  8 */
+      {    268357,    5713,  -36943 },      /*  9 */
+      {         0,       0,       0 },      /* 10 */
+      {    249984,   -9994,  -35419 },      /* 11 */
+      {    249921,  -10015,  -35427 },      /* 12 */
+      {    200229,   39624,  -25374 },      /* 13 */
+      {    201567,   41683,   32691 },      /* 14 */
+      {    201803,   34222,  -15989 },      /* 15 */
+      {    200895,  -22401,  -34203 },      /* 16 */
+      { 110589580,  -38420,  -27250 },      /* 17 */
+      {         0,       0,       0 },      /* 18 */
+      {         2,   41558,   32586 },      /* 19 */
+      {         0,       0,       0 },      /* 20 */
+      { 106363470,  -37060,  -11490 },      /* 21 */
+      {    201550,   40033,  -58151 },      /* 22 */
+      { 113038183,   10990,  -51230 },      /* 23 */
+      {         0,       0,       0 },      /* 24 */
+      {         1,   41087,   31413 },      /* 25 */
+      {    200400,   65051,  -57308 },      /* 26 */
+      {    200169,  -36782,    4818 },      /* 27 */
+      {    201633,  -44099,    9416 },      /* 28 */
+      {         0,       0,       0 },      /* 29 */
+      {    200137,  -37758,    7655 },      /* 30 */
+      {    201050,   -7986,  103281 } };    /* 31 */
+
+static const int32_t *find_high_pm_star( const uint32_t id_number)
+{
+   const int32_t *entry = hpm_table[(uint32_t)( id_number * HPM_MULTIPLIER)
+                                             >> HPM_SHIFT];
+
+   return( (uint32_t)entry[0] == id_number ? entry : NULL);
+}
+
 int32_t get_actual_proper_motion( const UCAC4_STAR *star, const int get_dec_pm)
 {
    int32_t rval = 0;
@@ -248,39 +434,12 @@ int32_t get_actual_proper_motion( const UCAC4_STAR *star, const int get_dec_pm)
    if( star->pm_ra != 32767 && star->pm_dec != 32767)
       rval = (get_dec_pm ? star->pm_dec : star->pm_ra);
    else
-      {           /* table copied from /u4i/u4hpm.dat of first DVD */
-      const int32_t pm_lookup_table[] = {
-                       1,    41087,   31413,
-                       2,    41558,   32586,
-                  200137,   -37758,    7655,
-                  200168,   -36004,    9521,
-                  200169,   -36782,    4818,
-                  200229,    39624,  -25374,
-                  200400,    65051,  -57308,
-                  200503,    56347,  -23377,
-                  200530,    67682,   13275,
-                  200895,   -22401,  -34203,
-                  201050,    -7986,  103281,
-                  201349,    22819,   53694,
-                  201526,    -5803,  -47659,
-                  201550,    40033,  -58151,
-                  201567,    41683,   32691,
-                  201633,   -44099,    9416,
-                  201803,    34222,  -15989,
-                  249921,   -10015,  -35427,
-                  249984,    -9994,  -35419,
-                  268357,     5713,  -36943,
-                80118783,    32962,    5639,
-                93157181,   -22393,  -34199,
-               106363470,   -37060,  -11490,
-               110589580,   -38420,  -27250,
-               113038183,    10990,  -51230, 0 };
-      int i;
+      {
+      const int32_t *entry = find_high_pm_star( star->id_number);
 
-      for( i = 0; pm_lookup_table[i]; i += 3)
-         if( pm_lookup_table[i] == (int32_t)star->id_number)
-            rval = pm_lookup_table[i + (get_dec_pm ? 2 : 1)];
-      assert( rval);
+      assert( entry);
+      if( entry)
+         rval = entry[get_dec_pm ? 2 : 1];
       }
    return( rval);
 }
@@ -295,6 +454,191 @@ int get_actual_proper_motion_sigma( const int8_t pm_sigma)
    return( rval);
 }
 
+/* Batch decoding of UCAC4 stars into arrays,  in "real" units.  Stars
+are handled DECODE_CHUNK at a time :  each field is first copied from the
+(packed,  78-byte) records into a contiguous array of int32_ts,  then
+converted in a separate loop.  That second loop is a plain multiply-add
+over contiguous data,  which the compiler turns into SIMD code.  The
+first can't be vectorized,  because of the 78-byte stride,  but at
+least it's straightforward and branch-free,  except for the rare
+high proper motion stars.  */
+
+#define DECODE_CHUNK 256
+
+static void scale_to_float( float *ovals, const int32_t *ivals,
+                  const size_t n, const float scale, const float offset)
+{
+   size_t i;
+
+   for( i = 0; i < n; i++)
+      ovals[i] = (float)ivals[i] * scale + offset;
+}
+
+static void scale_to_double( double *ovals, const int32_t *ivals,
+                  const size_t n, const double scale, const double offset)
+{
+   size_t i;
+
+   for( i = 0; i < n; i++)
+      ovals[i] = (double)ivals[i] * scale + offset;
+}
+
+size_t decode_ucac4_stars( ucac4_decoded_t *out, const UCAC4_STAR *stars,
+                                          const size_t n_stars)
+{
+   int32_t tvals[DECODE_CHUNK], tvals2[DECODE_CHUNK];
+   size_t start, i, n_bad_pms = 0;
+
+   for( start = 0; start < n_stars; start += DECODE_CHUNK)
+      {
+      const size_t n = (n_stars - start < DECODE_CHUNK ?
+                                  n_stars - start : DECODE_CHUNK);
+      const UCAC4_STAR *src = stars + start;
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+      UCAC4_STAR flipped[DECODE_CHUNK];
+
+      memcpy( flipped, src, n * sizeof( UCAC4_STAR));
+      for( i = 0; i < n; i++)
+         flip_ucac4_star( flipped + i);
+      src = flipped;
+#endif
+#endif
+
+      if( out->ra)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].ra;
+         scale_to_double( out->ra + start, tvals, n, 1. / 3600000., 0.);
+         }
+      if( out->dec)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].spd;
+         scale_to_double( out->dec + start, tvals, n, 1. / 3600000., -90.);
+         }
+      if( out->mag1)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].mag1;
+         scale_to_float( out->mag1 + start, tvals, n, .001f, 0.f);
+         }
+      if( out->mag2)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].mag2;
+         scale_to_float( out->mag2 + start, tvals, n, .001f, 0.f);
+         }
+      if( out->mag_sigma)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].mag_sigma;
+         scale_to_float( out->mag_sigma + start, tvals, n, .01f, 0.f);
+         }
+      if( out->ra_sigma)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].ra_sigma;
+         scale_to_float( out->ra_sigma + start, tvals, n, 1.f, 128.f);
+         }
+      if( out->dec_sigma)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].dec_sigma;
+         scale_to_float( out->dec_sigma + start, tvals, n, 1.f, 128.f);
+         }
+      if( out->pm_ra || out->pm_dec)
+         {
+         for( i = 0; i < n; i++)
+            {
+            tvals[i] = src[i].pm_ra;
+            tvals2[i] = src[i].pm_dec;
+            if( tvals[i] == 32767 || tvals2[i] == 32767)
+               {
+               const int32_t *entry = find_high_pm_star( src[i].id_number);
+
+               if( entry)
+                  {
+                  tvals[i] = entry[1];
+                  tvals2[i] = entry[2];
+                  }
+               else     /* shouldn't happen;  zero it,  as */
+                  {     /* get_actual_proper_motion() does */
+                  tvals[i] = tvals2[i] = 0;
+                  n_bad_pms++;
+                  }
+               }
+            }
+         if( out->pm_ra)
+            scale_to_float( out->pm_ra + start, tvals, n, .1f, 0.f);
+         if( out->pm_dec)
+            scale_to_float( out->pm_dec + start, tvals2, n, .1f, 0.f);
+         }
+      if( out->pm_ra_sigma)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = get_actual_proper_motion_sigma( src[i].pm_ra_sigma);
+         scale_to_float( out->pm_ra_sigma + start, tvals, n, .1f, 0.f);
+         }
+      if( out->pm_dec_sigma)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = get_actual_proper_motion_sigma( src[i].pm_dec_sigma);
+         scale_to_float( out->pm_dec_sigma + start, tvals, n, .1f, 0.f);
+         }
+      if( out->epoch_ra)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].epoch_ra;
+         scale_to_float( out->epoch_ra + start, tvals, n, .01f, 1900.f);
+         }
+      if( out->epoch_dec)
+         {
+         for( i = 0; i < n; i++)
+            tvals[i] = src[i].epoch_dec;
+         scale_to_float( out->epoch_dec + start, tvals, n, .01f, 1900.f);
+         }
+      if( out->id_number)
+         for( i = 0; i < n; i++)
+            out->id_number[start + i] = src[i].id_number;
+      }
+   return( n_bad_pms);
+}
+
+/* Allocates the structure and all its arrays in one block,  so a single
+free() releases everything.  The doubles come first,  right after the
+structure (which consists only of pointers),  so everything is aligned. */
+
+ucac4_decoded_t *alloc_ucac4_decoded( const size_t max_stars)
+{
+   const size_t n_floats = 11, n_doubles = 2;
+   ucac4_decoded_t *rval = (ucac4_decoded_t *)malloc( sizeof( ucac4_decoded_t)
+               + max_stars * (n_doubles * sizeof( double)
+                          + n_floats * sizeof( float) + sizeof( uint32_t)));
+
+   if( rval)
+      {
+      float *fptr;
+
+      rval->ra = (double *)( rval + 1);
+      rval->dec = rval->ra + max_stars;
+      fptr = (float *)( rval->dec + max_stars);
+      rval->mag1 = fptr;
+      rval->mag2 = (fptr += max_stars);
+      rval->mag_sigma = (fptr += max_stars);
+      rval->ra_sigma = (fptr += max_stars);
+      rval->dec_sigma = (fptr += max_stars);
+      rval->pm_ra = (fptr += max_stars);
+      rval->pm_dec = (fptr += max_stars);
+      rval->pm_ra_sigma = (fptr += max_stars);
+      rval->pm_dec_sigma = (fptr += max_stars);
+      rval->epoch_ra = (fptr += max_stars);
+      rval->epoch_dec = (fptr += max_stars);
+      rval->id_number = (uint32_t *)( fptr + max_stars);
+      }
+   return( rval);
+}
+
 
 /* The following function writes out a UCAC4 star in the same ASCII */
 /* format as the FORTRAN code.                                      */
@@ -307,41 +651,61 @@ int write_ucac4_star_fortran_style( char *obuff, const UCAC4_STAR *star)
 
  451313731,   544918,16176,16187,12,0, 0, 58, 76, 4, 4, 2, 9762, 9709,   -47,   121,139,140, 863323727,13612,12869,12680, 5, 5, 5, 3, 3, 3,20000,20000,20000,20000,20000,  0,  0,  0,  0,  0,4,0,0,0,0,0,0,0,0,1, 0, 0,  1000284,  0,     0
 
+   Unsigned 32-bit values are written as (signed) ints,  as the
+sprintf( "%d") that used to be used here would have done.
 */
    int i;
-   char *tptr;
-
-   sprintf( obuff, "%10d%10d%6d%6d%3d%2d%3d%4d%4d%3d%3d%3d%6d%6d%7d%7d%4d%4d",
-        star->ra, star->spd, star->mag1, star->mag2,
-        star->mag_sigma, star->obj_type, star->double_star_flag,
-        star->ra_sigma + 128, star->dec_sigma + 128, star->n_ucac_total,
-        star->n_ucac_used, star->n_cats_used,
-        star->epoch_ra, star->epoch_dec,
-        get_actual_proper_motion( star, 0),
-        get_actual_proper_motion( star, 1),
-        get_actual_proper_motion_sigma( star->pm_ra_sigma),
-        get_actual_proper_motion_sigma( star->pm_dec_sigma));
-   sprintf( obuff + strlen( obuff), "%11d%6d%6d%6d%3d%3d%3d%3d%3d%3d",
-        star->twomass_id, star->mag_j, star->mag_h, star->mag_k,
-        star->icq_flag[0], star->icq_flag[1], star->icq_flag[2],
-        star->e2mpho[0], star->e2mpho[1], star->e2mpho[2]);
+   char *optr = obuff, flags[24];
+
+   optr = fmt_int( optr, star->ra, 10);
+   optr = fmt_int( optr, star->spd, 10);
+   optr = fmt_int( optr, star->mag1, 6);
+   optr = fmt_int( optr, star->mag2, 6);
+   optr = fmt_int( optr, star->mag_sigma, 3);
+   optr = fmt_int( optr, star->obj_type, 2);
+   optr = fmt_int( optr, star->double_star_flag, 3);
+   optr = fmt_int( optr, star->ra_sigma + 128, 4);
+   optr = fmt_int( optr, star->dec_sigma + 128, 4);
+   optr = fmt_int( optr, star->n_ucac_total, 3);
+   optr = fmt_int( optr, star->n_ucac_used, 3);
+   optr = fmt_int( optr, star->n_cats_used, 3);
+   optr = fmt_int( optr, star->epoch_ra, 6);
+   optr = fmt_int( optr, star->epoch_dec, 6);
+   optr = fmt_int( optr, get_actual_proper_motion( star, 0), 7);
+   optr = fmt_int( optr, get_actual_proper_motion( star, 1), 7);
+   optr = fmt_int( optr,
+                   get_actual_proper_motion_sigma( star->pm_ra_sigma), 4);
+   optr = fmt_int( optr,
+                   get_actual_proper_motion_sigma( star->pm_dec_sigma), 4);
+   optr = fmt_int( optr, (int32_t)star->twomass_id, 11);
+   optr = fmt_int( optr, star->mag_j, 6);
+   optr = fmt_int( optr, star->mag_h, 6);
+   optr = fmt_int( optr, star->mag_k, 6);
+   for( i = 0; i < 3; i++)
+      optr = fmt_int( optr, star->icq_flag[i], 3);
+   for( i = 0; i < 3; i++)
+      optr = fmt_int( optr, star->e2mpho[i], 3);
    for( i = 0; i < 5; i++)
-      sprintf( obuff + strlen( obuff), "%6d", star->apass_mag[i]);
+      optr = fmt_int( optr, star->apass_mag[i], 6);
    for( i = 0; i < 5; i++)
-      sprintf( obuff + strlen( obuff), "%4d", star->apass_mag_sigma[i]);
-   sprintf( obuff + strlen( obuff), "%2d ", star->yale_gc_flags);
+      optr = fmt_int( optr, star->apass_mag_sigma[i], 4);
+   optr = fmt_int( optr, star->yale_gc_flags, 2);
+   *optr++ = ' ';
                /* Show catalog flags as separate digits: */
-   tptr = obuff + strlen( obuff);
-   sprintf( tptr, "%09d", star->catalog_flags);
-   for( i = 8; i >= 0; i--)
+   fmt_int0( flags, (int32_t)star->catalog_flags, 9);
+   for( i = 0; i < 9; i++)
       {
-      tptr[i + i] = tptr[i];
-      tptr[i + i + 1] = ' ';
+      *optr++ = flags[i];
+      if( i < 8)
+         *optr++ = ' ';
       }
-   tptr[17] = '\0';
-   sprintf( obuff + strlen( obuff), "%3d%3d%10d%4d%7d\n",
-       star->leda_flag, star->twomass_ext_flag,
-       star->id_number, star->ucac2_zone, star->ucac2_number);
+   optr = fmt_int( optr, star->leda_flag, 3);
+   optr = fmt_int( optr, star->twomass_ext_flag, 3);
+   optr = fmt_int( optr, (int32_t)star->id_number, 10);
+   optr = fmt_int( optr, star->ucac2_zone, 4);
+   optr = fmt_int( optr, (int32_t)star->ucac2_number, 7);
+   *optr++ = '\n';
+   fmt_end( optr);
    return( 0);
 }
 
@@ -353,85 +717,153 @@ int write_ucac4_star( const int zone, const long offset, char *obuff,
 {
    const long epoch_ra  = 190000 + star->epoch_ra;
    const long epoch_dec = 190000 + star->epoch_dec;
+   const int write_spaces = (output_format & UCAC4_WRITE_SPACES);
+   char *optr = obuff;
    int i;
 
    if( output_format & UCAC4_FORTRAN_STYLE)
       return( write_ucac4_star_fortran_style( obuff, star));
 
-   sprintf( obuff, "%03d-%06ld %12.8lf %12.8lf %2d.%03d %2d.%03d %3d ",
-               zone, offset,
-               (double)star->ra / 3600000., (double)star->spd / 3600000. - 90.,
-               star->mag1 / 1000, abs( star->mag1 % 1000),
-               star->mag2 / 1000, abs( star->mag2 % 1000),
-               star->mag_sigma);
-
-   sprintf( obuff + strlen( obuff), "%2d %2d ",
-               star->obj_type, star->double_star_flag);
-
-   sprintf( obuff + strlen( obuff), "%4d.%02d %4d.%02d ",
-               (int)epoch_ra / 100, (int)epoch_ra % 100,
-               (int)epoch_dec / 100, (int)epoch_dec % 100);
-
-   sprintf( obuff + strlen( obuff),
-            "%3d %3d %2d %2d %2d ",
-            star->ra_sigma + 128, star->dec_sigma + 128,
-            (int)star->n_ucac_total, (int)star->n_ucac_used,
-            (int)star->n_cats_used);
-
-   if( star->pm_ra || star->pm_dec || !(output_format & UCAC4_WRITE_SPACES))
-      sprintf( obuff + strlen( obuff), "%6d %6d %3d %3d ",
-            get_actual_proper_motion( star, 0),
-            get_actual_proper_motion( star, 1),
-            get_actual_proper_motion_sigma( star->pm_ra_sigma),
-            get_actual_proper_motion_sigma( star->pm_dec_sigma));
+   optr = fmt_int0( optr, zone, 3);
+   *optr++ = '-';
+   optr = fmt_int0( optr, offset, 6);
+   *optr++ = ' ';
+   optr = fmt_mas_as_degrees( optr, star->ra, 12, 0);
+   *optr++ = ' ';
+   optr = fmt_mas_as_degrees( optr, (int64_t)star->spd - 90 * 3600000, 12, 0);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mag1 / 1000, 2);
+   *optr++ = '.';
+   optr = fmt_int0( optr, abs( star->mag1 % 1000), 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mag2 / 1000, 2);
+   *optr++ = '.';
+   optr = fmt_int0( optr, abs( star->mag2 % 1000), 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mag_sigma, 3);
+   *optr++ = ' ';
+
+   optr = fmt_int( optr, star->obj_type, 2);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->double_star_flag, 2);
+   *optr++ = ' ';
+
+   optr = fmt_int( optr, (int)epoch_ra / 100, 4);
+   *optr++ = '.';
+   optr = fmt_int0( optr, (int)epoch_ra % 100, 2);
+   *optr++ = ' ';
+   optr = fmt_int( optr, (int)epoch_dec / 100, 4);
+   *optr++ = '.';
+   optr = fmt_int0( optr, (int)epoch_dec % 100, 2);
+   *optr++ = ' ';
+
+   optr = fmt_int( optr, star->ra_sigma + 128, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->dec_sigma + 128, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->n_ucac_total, 2);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->n_ucac_used, 2);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->n_cats_used, 2);
+   *optr++ = ' ';
+
+   if( star->pm_ra || star->pm_dec || !write_spaces)
+      {
+      optr = fmt_int( optr, get_actual_proper_motion( star, 0), 6);
+      *optr++ = ' ';
+      optr = fmt_int( optr, get_actual_proper_motion( star, 1), 6);
+      *optr++ = ' ';
+      optr = fmt_int( optr,
+                  get_actual_proper_motion_sigma( star->pm_ra_sigma), 3);
+      *optr++ = ' ';
+      optr = fmt_int( optr,
+                  get_actual_proper_motion_sigma( star->pm_dec_sigma), 3);
+      *optr++ = ' ';
+      }
    else        /* no proper motion given,  keep these fields blank */
-      strcat( obuff, "                      ");
+      optr = fmt_spaces( optr, 22);
 
-   if( star->twomass_id || !(output_format & UCAC4_WRITE_SPACES))
+   if( star->twomass_id || !write_spaces)
       {
-      sprintf( obuff + strlen( obuff),
-            "%10ld %2d.%03d %2d.%03d %2d.%03d ",
-            (long)star->twomass_id,
-            star->mag_j / 1000, abs( star->mag_j % 1000),
-            star->mag_h / 1000, abs( star->mag_h % 1000),
-            star->mag_k / 1000, abs( star->mag_k % 1000));
-
-      sprintf( obuff + strlen( obuff), "%03d %03d %03d %02d %02d %02d ",
-            star->e2mpho[0], star->e2mpho[1], star->e2mpho[2],
-            star->icq_flag[0], star->icq_flag[1], star->icq_flag[2]);
+      optr = fmt_int( optr, star->twomass_id, 10);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->mag_j / 1000, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, abs( star->mag_j % 1000), 3);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->mag_h / 1000, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, abs( star->mag_h % 1000), 3);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->mag_k / 1000, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, abs( star->mag_k % 1000), 3);
+      *optr++ = ' ';
+
+      for( i = 0; i < 3; i++)
+         {
+         optr = fmt_int0( optr, star->e2mpho[i], 3);
+         *optr++ = ' ';
+         }
+      for( i = 0; i < 3; i++)
+         {
+         optr = fmt_int0( optr, star->icq_flag[i], 2);
+         *optr++ = ' ';
+         }
       }
    else        /* no 2MASS data given;  keep these fields blank */
       {
       memset( obuff + 116, ' ', 53);
-      obuff[169] = '\0';
+      optr = obuff + 169;
       }
 
    for( i = 0; i < 5; i++)
       if( (star->apass_mag[i] && star->apass_mag[i] != 20000)
-                   || !(output_format & UCAC4_WRITE_SPACES))
-         sprintf( obuff + strlen( obuff), "%2d.%03d ",
-                star->apass_mag[i] / 1000, star->apass_mag[i] % 1000);
-         else
-            strcat( obuff, "       ");
+                   || !write_spaces)
+         {
+         optr = fmt_int( optr, star->apass_mag[i] / 1000, 2);
+         *optr++ = '.';
+         optr = fmt_int0( optr, star->apass_mag[i] % 1000, 3);
+         *optr++ = ' ';
+         }
+      else
+         optr = fmt_spaces( optr, 7);
    for( i = 0; i < 5; i++)
-      if( star->apass_mag_sigma[i] != 99
-                          || !(output_format & UCAC4_WRITE_SPACES))
-         sprintf( obuff + strlen( obuff), "%c%d.%02d ",
-                   (star->apass_mag_sigma[i] < 0 ? '-' : ' '),
-                   abs( star->apass_mag_sigma[i]) / 100,
-                   abs( star->apass_mag_sigma[i]) % 100);
+      if( star->apass_mag_sigma[i] != 99 || !write_spaces)
+         {
+         *optr++ = (star->apass_mag_sigma[i] < 0 ? '-' : ' ');
+         optr = fmt_int( optr, abs( star->apass_mag_sigma[i]) / 100, 0);
+         *optr++ = '.';
+         optr = fmt_int0( optr, abs( star->apass_mag_sigma[i]) % 100, 2);
+         *optr++ = ' ';
+         }
       else
-         strcat( obuff, "      ");
-
-   sprintf( obuff + strlen( obuff), "%09d", star->catalog_flags);
-   sprintf( obuff + strlen( obuff),
-            " %2d %03d %03d %9d", star->yale_gc_flags,
-            star->leda_flag, star->twomass_ext_flag, star->id_number);
-   if( star->ucac2_zone || !(output_format & UCAC4_WRITE_SPACES))
-      sprintf( obuff + strlen( obuff), " %03d-%06d\n",
-               star->ucac2_zone, star->ucac2_number);
+         optr = fmt_spaces( optr, 6);
+
+   optr = fmt_int0( optr, (int32_t)star->catalog_flags, 9);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->yale_gc_flags, 2);
+   *optr++ = ' ';
+   optr = fmt_int0( optr, star->leda_flag, 3);
+   *optr++ = ' ';
+   optr = fmt_int0( optr, star->twomass_ext_flag, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, (int32_t)star->id_number, 9);
+   if( star->ucac2_zone || !write_spaces)
+      {
+      *optr++ = ' ';
+      optr = fmt_int0( optr, star->ucac2_zone, 3);
+      *optr++ = '-';
+      optr = fmt_int0( optr, (int32_t)star->ucac2_number, 6);
+      *optr++ = '\n';
+      }
    else
-      strcat( obuff, "           \n");
+      {
+      optr = fmt_spaces( optr, 11);
+      *optr++ = '\n';
+      }
+   fmt_end( optr);
    return( 0);
 }
 
@@ -443,12 +875,51 @@ int write_ucac4_star( const int zone, const long offset, char *obuff,
 #error "Unknown platform; please report so it can be fixed!"
 #endif
 
+#define UCAC4_N_ZONES              900
+#define UCAC4_INDEX_RA_BINS       1440      /* = .25 degrees */
+
+/* A 'ucac4_catalog_t' holds what we'd otherwise have to find out again
+for each extraction :  where the zone files are,  the open zone files
+themselves,  and the index.  open_ucac4_catalog() reads the entire index
+into memory,  as a 900 x 1440 array of (start, count) pairs,  so that
+extractions do no index I/O at all.  The "old" extract_ucac4_stars()
+and extract_ucac4_info() functions make a temporary catalog that reads
+index entries from the file as they're needed,  just as before.
+
+   If the binary index 'u4index.bin' is available,  it's mapped into
+memory instead.  That's essentially free,  so both sorts of catalog use
+it,  and an index lookup becomes a single array access.  */
+
+struct ucac4_catalog
+   {
+   char *path;
+   int layout;          /* see get_ucac4_zone_file();  -1 = not known yet */
+   FILE *zone_file[UCAC4_N_ZONES];  /* zNNN,  or hNNN if zone is split */
+   FILE *cold_file[UCAC4_N_ZONES];  /* cNNN;  NULL if zone isn't split */
+   char zone_missing[UCAC4_N_ZONES];
+   unsigned long last_used[UCAC4_N_ZONES];   /* for closing least-recently */
+   unsigned long use_count;                  /* used zone files */
+   int n_open_files;
+   const uint32_t *index;  /* NULL if index wasn't (or couldn't be) loaded */
+   uint32_t *loaded_index;       /* if read from u4index.asc */
+   const void *mapped_index;     /* if u4index.bin was mapped */
+   size_t mapped_size;
+   FILE *index_file;    /* used only if 'index' is NULL */
+   long cached_index_data[3];    /* last entry read from 'index_file' */
+   const uint32_t *mpos_index;   /* u4mpos.bin,  mapped when first needed */
+   const void *mapped_mpos;
+   size_t mapped_mpos_size;
+   int mpos_tried;
+   int scan_stopped;             /* set when a callback asks us to stop */
+   ucac4_stats_t stats;          /* for the most recent extraction */
+   };
+
 /* The layout of UCAC-4 is such that data files are in the 'u4b'
 folders of the two DVDs. People may copy these retaining the path
 structure,  or maybe they'll put all 900 files in one folder.  So if
 you ask this function for,  say, zone_number = 314 and files in the
 folder /data/ucac4,  the function will look for the data under the
-following four names:
+following four names ("layouts" 0 to 3):
 
 z314         (i.e.,  all data copied to the current folder)
 u4b/z314     (i.e.,  you've copied everything to the u4b subfolder)
@@ -457,56 +928,213 @@ u4b/z314     (i.e.,  you've copied everything to the u4b subfolder)
 
    ...stopping when it finds a file.  This will,  I hope,  cover all
 likely situations.  If you make things any more complicated,  you've
-only yourself to blame.  Note that the index file 'u4index.asc' is
-similarly looked for in various possible folders;  and the code will
-still work even if the index isn't found -- the result will just be
-a tiny bit slower. */
+only yourself to blame.  Once a zone has been found,  the layout is
+remembered and tried first for later zones,  so we usually get the file
+on the first try.  The hot and cold files made by 'u4split.c' (hNNN and
+cNNN) are looked for in the same way.  Note that the index file
+'u4index.asc' is similarly looked for in various possible folders;  and
+the code will still work even if the index isn't found -- the result
+will just be a tiny bit slower. */
+
+static FILE *try_ucac4_zone_layout( const int zone_number, const char *path,
+                                    const int layout, const char prefix)
+{
+   char filename[255];
+
+   *filename = '\0';
+   if( layout >= 2)
+      {
+      if( !*path || strlen( path) > sizeof( filename) - 10)
+         return( NULL);
+      strcpy( filename, path);
+      if( filename[strlen( filename) - 1] != *path_separator)
+         strcat( filename, path_separator);
+      }
+   if( layout & 1)
+      {
+      strcat( filename, "u4b");
+      strcat( filename, path_separator);
+      }
+   sprintf( filename + strlen( filename), "%c%03d", prefix, zone_number);
+   return( fopen( filename, read_only_permits));
+}
 
-static FILE *get_ucac4_zone_file( const int zone_number, const char *path)
+static FILE *get_ucac4_zone_file( const int zone_number, const char *path,
+                                  int *layout, const char prefix)
 {
-   FILE *ifile;
-   char filename[80];
+   FILE *ifile = NULL;
+   int i;
 
-   sprintf( filename, "u4b%sz%03d", path_separator, zone_number);
-            /* First,  look for file in current path: */
-   ifile = fopen( filename + 4, read_only_permits);
-   if( !ifile)
-      ifile = fopen( filename, read_only_permits);
-         /* If file isn't there,  use the 'path' passed in as an argument: */
-   if( !ifile && *path)
+   if( *layout >= 0)
+      ifile = try_ucac4_zone_layout( zone_number, path, *layout, prefix);
+   for( i = 0; !ifile && i < 4; i++)
+      if( i != *layout)
+         if( (ifile = try_ucac4_zone_layout( zone_number, path, i,
+                                             prefix)) != NULL)
+            *layout = i;
+   return( ifile);
+}
+
+/* Zone files are opened when first needed,  and then kept open until
+the catalog is closed,  or until we'd have more than UCAC4_MAX_OPEN_FILES
+open (counting both hot and cold files for split zones).  (Some C
+runtimes,  notably Microsoft's,  won't let you have all 900 open at
+once.)  In that case,  the least recently used zone is closed.  We also
+remember which zones couldn't be found,  so we don't keep looking for
+them;  but only if the file really isn't there,  not if (say) we just
+ran out of file handles.
+
+   A split zone (hot and cold files) is preferred to the zNNN file,  if
+both are present.  Once we know where the zones are,  hNNN is only
+looked for in that one place,  so an unsplit catalog costs one failed
+fopen() per zone rather than four.  If the hot file is there but the
+cold one can't be opened for some reason other than not existing,
+that's an error;  'u4split' lets you delete zNNN,  so we don't fall back
+to it.  The returned file is whichever one holds the RA/dec;  check
+ZONE_IS_SPLIT to see which. */
+
+#define ZONE_IS_SPLIT( cat, zone)   ((cat)->cold_file[(zone) - 1] != NULL)
+
+#define UCAC4_MAX_OPEN_FILES       200
+
+static void close_catalog_zone( ucac4_catalog_t *cat, const int zone)
+{
+   if( cat->zone_file[zone - 1])
       {
-      char filename2[80], *endptr;
-      int i;
+      fclose( cat->zone_file[zone - 1]);
+      cat->zone_file[zone - 1] = NULL;
+      cat->n_open_files--;
+      }
+   if( cat->cold_file[zone - 1])
+      {
+      fclose( cat->cold_file[zone - 1]);
+      cat->cold_file[zone - 1] = NULL;
+      cat->n_open_files--;
+      }
+}
 
-      strcpy( filename2, path);
-      endptr = filename2 + strlen( filename2);
-      if( endptr[-1] != *path_separator)
-         *endptr++ = *path_separator;
-      for( i = 0; !ifile && i < 2; i++)
+static void close_least_recently_used_zone( ucac4_catalog_t *cat)
+{
+   int i, zone = 0;
+
+   for( i = 1; i <= UCAC4_N_ZONES; i++)
+      if( cat->zone_file[i - 1] && (!zone
+                  || cat->last_used[i - 1] < cat->last_used[zone - 1]))
+         zone = i;
+   if( zone)
+      close_catalog_zone( cat, zone);
+}
+
+static FILE *get_catalog_zone_file( ucac4_catalog_t *cat, const int zone)
+{
+   FILE **ifile = cat->zone_file + zone - 1;
+
+   if( !*ifile && !cat->zone_missing[zone - 1])
+      {
+      int layout = cat->layout;
+
+      while( cat->n_open_files > UCAC4_MAX_OPEN_FILES - 2)
+         close_least_recently_used_zone( cat);    /* room for hot & cold */
+      errno = 0;
+      if( layout >= 0)     /* look for split files only where the zones are */
+         *ifile = try_ucac4_zone_layout( zone, cat->path, layout, 'h');
+      else
+         *ifile = get_ucac4_zone_file( zone, cat->path, &layout, 'h');
+      if( *ifile)
+         {
+         errno = 0;
+         cat->cold_file[zone - 1] = try_ucac4_zone_layout( zone, cat->path,
+                                                   layout, 'c');
+         if( cat->cold_file[zone - 1])
+            cat->n_open_files++;
+         else        /* hot without cold is useless */
+            {
+            fclose( *ifile);
+            *ifile = NULL;
+            if( errno != ENOENT)    /* cNNN is there,  but won't open; */
+               return( NULL);       /* zNNN may well have been deleted */
+            }
+         }
+      if( !*ifile)
+         {
+         layout = cat->layout;
+         *ifile = get_ucac4_zone_file( zone, cat->path, &layout, 'z');
+         }
+      if( *ifile)
          {
-         strcpy( endptr, filename + 4 * (1 - i));
-         ifile = fopen( filename2, read_only_permits);
+         cat->layout = layout;
+         cat->n_open_files++;
          }
+      else if( errno == ENOENT)
+         cat->zone_missing[zone - 1] = 1;
       }
-   return( ifile);
+   cat->last_used[zone - 1] = ++cat->use_count;
+   return( *ifile);
 }
 
-int extract_ucac4_info( const int zone, const long offset, UCAC4_STAR *star,
-                     const char *path)
+/* Reads 'n_stars' full records,  starting at the (zero-based) 'offset',
+joining hot and cold data if the zone is split.  No byte flipping is
+done.  Returns the number of stars read,  or -1 if the seek failed.  */
+
+#define JOIN_CHUNK   64
+
+static long read_catalog_stars( ucac4_catalog_t *cat, const int zone,
+                  const uint32_t offset, const size_t n_stars,
+                  UCAC4_STAR *stars)
+{
+   FILE *ifile = cat->zone_file[zone - 1];
+   FILE *cold_file = cat->cold_file[zone - 1];
+   ucac4_hot_t hot[JOIN_CHUNK];
+   ucac4_cold_t cold[JOIN_CHUNK];
+   size_t n_read = 0;
+
+   if( !cold_file)
+      {
+      if( fseek( ifile, (long)offset * (long)sizeof( UCAC4_STAR), SEEK_SET))
+         return( -1L);
+      return( (long)fread( stars, sizeof( UCAC4_STAR), n_stars, ifile));
+      }
+   if( fseek( ifile, (long)offset * (long)sizeof( ucac4_hot_t), SEEK_SET)
+         || fseek( cold_file, (long)offset * (long)sizeof( ucac4_cold_t),
+                                                      SEEK_SET))
+      return( -1L);
+   while( n_read < n_stars)
+      {
+      const size_t n_wanted = (n_stars - n_read < JOIN_CHUNK ?
+                                       n_stars - n_read : JOIN_CHUNK);
+      const size_t n_hot = fread( hot, sizeof( ucac4_hot_t), n_wanted, ifile);
+      const size_t n_cold = fread( cold, sizeof( ucac4_cold_t), n_hot,
+                                                      cold_file);
+      size_t i;
+
+      for( i = 0; i < n_cold; i++)
+         join_ucac4_star( stars + n_read + i, hot + i, cold + i);
+      n_read += n_cold;
+      if( n_cold < n_wanted)
+         break;
+      }
+   return( (long)n_read);
+}
+
+int extract_ucac4_info_from_catalog( ucac4_catalog_t *cat, const int zone,
+                              const long offset, UCAC4_STAR *star)
 {
    int rval;
 
-   if( zone < 1 || zone > 900)     /* not a valid sequential number */
+   if( zone < 1 || zone > UCAC4_N_ZONES)   /* not a valid sequential number */
       rval = -1;
    else
       {
-      FILE *ifile = get_ucac4_zone_file( zone, path);
+      FILE *ifile = get_catalog_zone_file( cat, zone);
 
       if( ifile)
          {
-         if( fseek( ifile, (offset - 1) * sizeof( UCAC4_STAR), SEEK_SET))
+         const long n_read = (offset < 1 ? -1L :
+                      read_catalog_stars( cat, zone, offset - 1, 1, star));
+
+         if( n_read < 0)
             rval = -2;
-         else if( !fread( star, sizeof( UCAC4_STAR), 1, ifile))
+         else if( !n_read)
             rval = -3;
          else           /* success! */
             {
@@ -517,7 +1145,6 @@ int extract_ucac4_info( const int zone, const long offset, UCAC4_STAR *star,
 #endif
 #endif
             }
-         fclose( ifile);
          }
       else
          rval = -4;
@@ -525,22 +1152,24 @@ int extract_ucac4_info( const int zone, const long offset, UCAC4_STAR *star,
    return( rval);
 }
 
-/* This looks for the index file u4index.asc first in the current
-directory;  then in 'path';  then in the u4i subdirectory under 'path'.
-One of the three will probably work... */
+/* This looks for the index file (u4index.asc or u4index.bin) first in
+the current directory;  then in 'path';  then in the u4i subdirectory
+under 'path'.  One of the three will probably work... 'filename' is
+filled with the name of the file found.  */
 
-static FILE *get_ucac4_index_file( const char *path)
+static FILE *get_ucac4_index_file( const char *path, const char *idx_filename,
+                                   char *filename)
 {
    FILE *index_file;
-   const char *idx_filename = "u4index.asc";
 
+   strcpy( filename, idx_filename);
                      /* Look for the index file in the local directory... */
-   index_file = fopen( idx_filename, read_only_permits);
+   index_file = fopen( filename, read_only_permits);
                      /* ...and if it's not there,  look for it in the same */
                      /* directory as the data: */
-   if( !index_file)
+   if( !index_file && *path && strlen( path) < 80)
       {
-      char filename[100], *tptr;
+      char *tptr;
       int i;
 
       strcpy( filename, path);
@@ -562,6 +1191,112 @@ static FILE *get_ucac4_index_file( const char *path)
    return( index_file);
 }
 
+/* The checksum is FNV-1a,  done on 32-bit words rather than bytes. */
+
+uint32_t ucac4_index_checksum( const uint32_t *data, const size_t n_words)
+{
+   uint32_t rval = 2166136261u;
+   size_t i;
+
+   for( i = 0; i < n_words; i++)
+      {
+      rval ^= data[i];
+      rval *= 16777619u;
+      }
+   return( rval);
+}
+
+/* Maps u4index.bin into memory,  if it can be found and has a header
+that makes sense.  (The checksum isn't verified here,  because that
+would mean reading the entire file;  'u4_index -v' will check it.) */
+
+static int map_ucac4_binary_index( ucac4_catalog_t *cat)
+{
+   const size_t expected_size = UCAC4_BIN_INDEX_HEADER_SIZE
+          + UCAC4_N_ZONES * UCAC4_INDEX_RA_BINS * 2 * sizeof( uint32_t);
+   char filename[100];
+   FILE *ifile = get_ucac4_index_file( cat->path, "u4index.bin", filename);
+   const uint32_t *header;
+
+   if( !ifile)
+      return( -1);
+   fclose( ifile);
+   cat->mapped_index = map_file_into_memory( filename, &cat->mapped_size);
+   header = (const uint32_t *)cat->mapped_index;
+   if( header && (cat->mapped_size != expected_size
+               || header[0] != UCAC4_BIN_INDEX_MAGIC
+               || header[1] != UCAC4_BIN_INDEX_VERSION
+               || header[2] != UCAC4_N_ZONES
+               || header[3] != UCAC4_INDEX_RA_BINS))
+      {
+      unmap_file( cat->mapped_index, cat->mapped_size);
+      cat->mapped_index = NULL;
+      }
+   if( !cat->mapped_index)
+      return( -2);
+   cat->index = header + UCAC4_BIN_INDEX_HEADER_SIZE / sizeof( uint32_t);
+   return( 0);
+}
+
+/* 'u4mpos.bin',  made by 'u4_mpos.c',  gives the zone and offset of
+each star,  indexed by its 'id_number' (the MPOS number).  It's looked
+for in the same places as the other index files,  and mapped into memory
+the first time someone asks for a star by its ID.  (It's about 450
+MBytes,  so we don't want to do that unless asked to!)  */
+
+static int map_ucac4_mpos_index( ucac4_catalog_t *cat)
+{
+   char filename[100];
+   FILE *ifile;
+   const uint32_t *header;
+
+   if( cat->mpos_tried)
+      return( cat->mpos_index ? 0 : -1);
+   cat->mpos_tried = 1;
+   ifile = get_ucac4_index_file( cat->path, "u4mpos.bin", filename);
+   if( !ifile)
+      return( -1);
+   fclose( ifile);
+   cat->mapped_mpos = map_file_into_memory( filename, &cat->mapped_mpos_size);
+   header = (const uint32_t *)cat->mapped_mpos;
+   if( header && (cat->mapped_mpos_size < UCAC4_MPOS_HEADER_SIZE
+               || header[0] != UCAC4_MPOS_MAGIC
+               || header[1] != UCAC4_MPOS_VERSION
+               || cat->mapped_mpos_size != UCAC4_MPOS_HEADER_SIZE
+                                 + header[2] * sizeof( uint32_t)))
+      {
+      unmap_file( cat->mapped_mpos, cat->mapped_mpos_size);
+      cat->mapped_mpos = NULL;
+      }
+   if( !cat->mapped_mpos)
+      return( -2);
+   cat->mpos_index = header + UCAC4_MPOS_HEADER_SIZE / sizeof( uint32_t);
+   return( 0);
+}
+
+int find_ucac4_star_by_id( ucac4_catalog_t *cat, const uint32_t id_number,
+                  int *zone, long *offset, UCAC4_STAR *star)
+{
+   const uint32_t *header;
+   uint32_t loc;
+   int rval = 0;
+
+   if( map_ucac4_mpos_index( cat))
+      return( UCAC4_NO_MPOS_INDEX);
+   header = (const uint32_t *)cat->mapped_mpos;
+   if( id_number >= header[2] || !(loc = cat->mpos_index[id_number]))
+      return( UCAC4_ID_NOT_FOUND);
+   *zone = (int)UCAC4_MPOS_ZONE( loc);
+   *offset = (long)UCAC4_MPOS_OFFSET( loc);
+   if( star)
+      {
+      rval = extract_ucac4_info_from_catalog( cat, *zone, *offset, star);
+      if( !rval && star->id_number != id_number)
+         rval = UCAC4_ID_NOT_FOUND;    /* index doesn't match the data */
+      }
+   return( rval);
+}
+
 /* The layout of the ASCII index is a bit peculiar.  There are 1440
 lines per dec zone (of which there are,  of course,  900). Each line
 contains 21 bytes,  except for the first,  which includes the dec
@@ -576,6 +1311,167 @@ static long get_index_file_offset( const int zone, const int ra_start)
    return( rval);
 }
 
+/* Reads the whole ASCII index,  line by line.  Each line starts with
+the offset and number of stars for that RA bin;  anything after that
+(such as the dec on the first line of each zone) is ignored.  If the
+index is short or garbled,  we return NULL and just don't use it.  */
+
+static uint32_t *load_ucac4_index( FILE *index_file)
+{
+   const size_t n_entries = UCAC4_N_ZONES * UCAC4_INDEX_RA_BINS;
+   uint32_t *index = (uint32_t *)malloc( n_entries * 2 * sizeof( uint32_t));
+   char buff[50];
+   size_t i = 0;
+
+   if( index)
+      {
+      fseek( index_file, 0L, SEEK_SET);
+      while( i < n_entries && fgets( buff, sizeof( buff), index_file))
+         {
+         char *endptr;
+
+         index[i * 2] = (uint32_t)strtoul( buff, &endptr, 10);
+         if( endptr == buff)
+            break;
+         index[i * 2 + 1] = (uint32_t)strtoul( endptr, &endptr, 10);
+         i++;
+         }
+      if( i != n_entries)
+         {
+         free( index);
+         index = NULL;
+         }
+      }
+   return( index);
+}
+
+#define INDEX_NOT_USED             0
+#define INDEX_READ_AS_NEEDED       1
+#define INDEX_LOADED               2
+
+static ucac4_catalog_t *init_ucac4_catalog( const char *path,
+                                            const int index_usage)
+{
+   ucac4_catalog_t *cat = (ucac4_catalog_t *)calloc( 1,
+                                             sizeof( ucac4_catalog_t));
+
+   if( cat)
+      {
+      char filename[100];
+      int use_binary_index = (index_usage != INDEX_NOT_USED);
+
+      cat->path = (char *)malloc( strlen( path) + 1);
+      if( !cat->path)
+         {
+         free( cat);
+         return( NULL);
+         }
+      strcpy( cat->path, path);
+      cat->layout = -1;
+      cat->cached_index_data[0] = -1L;
+#ifdef MEM_MAP_EMULATED        /* "mapping" would read all 10 MBytes */
+      if( index_usage == INDEX_READ_AS_NEEDED)
+         use_binary_index = 0;
+#endif
+      if( index_usage != INDEX_NOT_USED
+               && (!use_binary_index || map_ucac4_binary_index( cat)))
+         cat->index_file = get_ucac4_index_file( path, "u4index.asc",
+                                                      filename);
+      if( cat->index_file && index_usage == INDEX_LOADED)
+         {
+         cat->index = cat->loaded_index = load_ucac4_index( cat->index_file);
+         fclose( cat->index_file);
+         cat->index_file = NULL;
+         }
+      }
+   return( cat);
+}
+
+ucac4_catalog_t *open_ucac4_catalog( const char *path)
+{
+   return( init_ucac4_catalog( path, INDEX_LOADED));
+}
+
+void close_ucac4_catalog( ucac4_catalog_t *cat)
+{
+   if( cat)
+      {
+      int i;
+
+      for( i = 1; i <= UCAC4_N_ZONES; i++)
+         close_catalog_zone( cat, i);
+      if( cat->index_file)
+         fclose( cat->index_file);
+      free( cat->loaded_index);
+      if( cat->mapped_index)
+         unmap_file( cat->mapped_index, cat->mapped_size);
+      if( cat->mapped_mpos)
+         unmap_file( cat->mapped_mpos, cat->mapped_mpos_size);
+      free( cat->path);
+      free( cat);
+      }
+}
+
+#define UCAC4_FGETS_FAILED         -1
+#define UCAC4_FREAD_FAILED         -2
+#define UCAC4_FSEEK_FAILED         -3
+#define UCAC4_FSEEK2_FAILED        -4
+#define UCAC4_FSEEK3_FAILED        -5
+#define UCAC4_SSCANF_FAILED        -6
+#define UCAC4_ALLOC_FAILED         -7
+#define UCAC4_ZONE_OPEN_FAILED    -10
+
+/* Gets the offset of the first star in the given zone and RA bin,  and
+the offset just past the last one.  Returns 0 if that worked,  1 if
+there's no index,  or a negative error code. */
+
+static int get_ucac4_index_entry( ucac4_catalog_t *cat, const int zone,
+                  int ra_start, uint32_t *offset, uint32_t *end_offset)
+{
+   long *cached_index_data = cat->cached_index_data;
+   long index_file_offset;
+   int rval = 0;
+
+   if( cat->index)
+      {
+      const uint32_t *entry;
+
+      if( ra_start >= UCAC4_INDEX_RA_BINS)
+         ra_start = UCAC4_INDEX_RA_BINS - 1;
+      entry = cat->index + 2 * ((zone - 1) * UCAC4_INDEX_RA_BINS + ra_start);
+      *offset = entry[0];
+      *end_offset = entry[0] + entry[1];
+      return( 0);
+      }
+   if( !cat->index_file)
+      return( 1);
+   index_file_offset = get_index_file_offset( zone, ra_start);
+   if( index_file_offset == cached_index_data[0])
+      {
+      *offset = cached_index_data[1];
+      *end_offset = cached_index_data[2];
+      }
+   else
+      {
+      char ibuff[50];
+      unsigned long ul_offset, ul_end_offset;
+
+      if( fseek( cat->index_file, index_file_offset, SEEK_SET))
+         rval = UCAC4_FSEEK_FAILED;
+      if( !fgets( ibuff, sizeof( ibuff), cat->index_file))
+         rval = UCAC4_FGETS_FAILED;
+      if( sscanf( ibuff, "%lu%lu", &ul_offset, &ul_end_offset) != 2)
+         rval = UCAC4_SSCANF_FAILED;
+      *offset = (uint32_t)ul_offset;
+      *end_offset = (uint32_t)ul_end_offset;
+      *end_offset += *offset;
+      cached_index_data[0] = index_file_offset;
+      cached_index_data[1] = *offset;
+      cached_index_data[2] = *end_offset;
+      }
+   return( rval);
+}
+
 /* RA, dec, width, height are in degrees */
 
 /* A note on indexing:  within each zone,  we want to locate the stars
@@ -591,46 +1487,100 @@ is slightly modified to ensure that each iteration knocks off at
 least 1/8 of the current range.
 
    Records are then read in 'buffsize' stars at a time and,  if
-they're in the desired RA/dec rectangle,  written out to 'ofile'. */
+they're in the desired RA/dec rectangle (and pass the Tycho and
+"doubtful" filters),  handed to the callback function.  If that returns
+a non-zero value,  we stop looking (including in the pieces on the far
+side of RA=0,  if the rectangle straddles it). */
 
-#include <time.h>
+/* Used only for the 'seconds_searching' statistic.  Wall-clock time is
+used if available,  since clock() gives processor time for the whole
+process and is therefore meaningless if several threads are running. */
 
-clock_t time_searching = 0;
+static double current_time( void)
+{
+#ifdef TIME_UTC
+   struct timespec t;
 
-#define UCAC4_FGETS_FAILED         -1
-#define UCAC4_FREAD_FAILED				     -2
-#define UCAC4_FSEEK_FAILED         -3
-#define UCAC4_FSEEK2_FAILED        -4
-#define UCAC4_FSEEK3_FAILED        -5
-#define UCAC4_SSCANF_FAILED        -6
-#define UCAC4_ALLOC_FAILED         -7
+   timespec_get( &t, TIME_UTC);
+   return( (double)t.tv_sec + (double)t.tv_nsec * 1e-9);
+#else
+   return( (double)clock( ) / (double)CLOCKS_PER_SEC);
+#endif
+}
 
-int extract_ucac4_stars( FILE *ofile, const double ra, const double dec,
-                  const double width, const double height, const char *path,
-                  const int output_format)
+/* For split zones,  the secant search and the filtering are done using
+only the hot records.  The hot record is copied and (if need be) flipped
+before looking at it,  leaving the original in file order so that it
+can be joined to its cold data later.  */
+
+static void get_native_hot( ucac4_hot_t *hot, const ucac4_hot_t *raw)
+{
+   *hot = *raw;
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   flip_ucac4_hot( hot);
+#endif
+#endif
+}
+
+static int hot_star_wanted( const ucac4_hot_t *hot, const int32_t min_ra,
+            const int32_t min_spd, const int32_t max_spd,
+            const int output_format)
+{
+   return( hot->ra > min_ra && hot->spd > min_spd && hot->spd < max_spd
+            && (!(output_format & UCAC4_OMIT_TYCHO_STARS)
+                           || !(hot->flags & UCAC4_HOT_TYCHO))
+            && ((hot->flags & UCAC4_HOT_HAS_2MASS)
+                           || (output_format & UCAC4_INCLUDE_DOUBTFULS)));
+}
+
+/* Exactly one of 'callback_fn' (for full stars) and 'hot_callback_fn'
+is used;  if both are NULL,  stars are just counted.  If 'only_zone' is
+non-zero,  only that zone is searched,  and the pieces on the far side
+of RA=0 aren't (this is for parallel extraction,  where each zone and
+piece is done separately).  */
+
+static int extract_stars( ucac4_catalog_t *cat, void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+     int (*hot_callback_fn)( void *, const int, const uint32_t,
+                             const ucac4_hot_t *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format, const int only_zone)
 {
    const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
    const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
    const double zone_height = .2;    /* zones are .2 degrees each */
-   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
-   const int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
-   const int index_ra_resolution = 1440;  /* = .25 degrees */
+   int zone = (only_zone ? only_zone
+                         : (int)( (dec1  + 90.) / zone_height) + 1);
+   const int end_zone = (only_zone ? only_zone :
+                               (int)( (dec2 + 90.) / zone_height) + 1);
+   const int index_ra_resolution = UCAC4_INDEX_RA_BINS;
    int ra_start = (int)( ra1 * (double)index_ra_resolution / 360.);
    int rval = 0;
    const int buffsize = 400;     /* read this many stars at a try */
-   FILE *index_file = get_ucac4_index_file( path);
-   UCAC4_STAR *stars = (UCAC4_STAR *)calloc( buffsize, sizeof( UCAC4_STAR));
-
-   if( !stars)
+               /* one allocation holds the buffers for full stars,  and */
+               /* for hot and cold data from split zones.  All are packed */
+               /* structures,  so alignment isn't an issue.              */
+   char *buffers = (char *)calloc( buffsize, sizeof( UCAC4_STAR)
+                          + sizeof( ucac4_hot_t) + sizeof( ucac4_cold_t));
+   UCAC4_STAR *stars = (UCAC4_STAR *)buffers;
+   ucac4_hot_t *hot = (ucac4_hot_t *)( stars + buffsize);
+   ucac4_cold_t *cold = (ucac4_cold_t *)( hot + buffsize);
+
+   if( !buffers)
       rval = UCAC4_ALLOC_FAILED;
    if( zone < 1)
       zone = 1;
    if( ra_start < 0)
       ra_start = 0;
-   while( rval >= 0 && zone <= end_zone)
+   while( rval >= 0 && zone <= end_zone && zone <= UCAC4_N_ZONES
+                  && !cat->scan_stopped)
       {
-      FILE *ifile = get_ucac4_zone_file( zone, path);
+      FILE *ifile = get_catalog_zone_file( cat, zone);
 
+      if( !ifile && !cat->zone_missing[zone - 1])
+         rval = UCAC4_ZONE_OPEN_FAILED;     /* there,  but couldn't open it */
       if( ifile)
          {
          int keep_going = 1;
@@ -639,57 +1589,36 @@ int extract_ucac4_stars( FILE *ofile, const double ra, const double dec,
          const int32_t min_ra  = (int32_t)( ra1 * 3600. * 1000.);
          const int32_t min_spd = (int32_t)( (dec1 + 90.) * 3600. * 1000.);
          const int32_t max_spd = (int32_t)( (dec2 + 90.) * 3600. * 1000.);
+         const int is_split = ZONE_IS_SPLIT( cat, zone);
+         const long recsize = (long)( is_split ? sizeof( ucac4_hot_t)
+                                               : sizeof( UCAC4_STAR));
          uint32_t offset, end_offset;
          const uint32_t acceptable_limit = 40;
-         long index_file_offset = get_index_file_offset( zone, ra_start);
-         clock_t t0 = clock( );
-         static long cached_index_data[5] = {-1L, 0L, 0L, 0L, 0L};
+         const double t0 = current_time( );
          const uint32_t ra_range = (uint32_t)( 360 * 3600 * 1000);
          uint32_t ra_lo = (uint32_t)( ra_start * (ra_range / index_ra_resolution));
          uint32_t ra_hi = ra_lo + ra_range / index_ra_resolution;
+         const int index_rval = get_ucac4_index_entry( cat, zone, ra_start,
+                                                &offset, &end_offset);
 
-         if( index_file_offset == cached_index_data[0])
-            {
-            offset = cached_index_data[1];
-            end_offset = cached_index_data[2];
-            }
-         else
+         if( index_rval < 0)
+            rval = index_rval;
+         else if( index_rval)    /* no index:  search the entire zone: */
             {
-            if( index_file)
-               {
-               char ibuff[50];
-               unsigned long ul_offset, ul_end_offset;
-
-               if( fseek( index_file, index_file_offset, SEEK_SET))
-                  rval = UCAC4_FSEEK_FAILED;
-               if( !fgets( ibuff, sizeof( ibuff), index_file))
-                  rval = UCAC4_FGETS_FAILED;
-               if( sscanf( ibuff, "%lu%lu", &ul_offset, &ul_end_offset) != 2)
-                  rval = UCAC4_SSCANF_FAILED;
-               offset = (uint32_t)ul_offset;
-               end_offset = (uint32_t)ul_end_offset;
-               end_offset += offset;
-               cached_index_data[0] = index_file_offset;
-               cached_index_data[1] = offset;
-               cached_index_data[2] = end_offset;
-               }
-            else     /* no index:  binary-search within entire zone: */
-               {
-               offset = 0;
-               if( fseek( ifile, 0L, SEEK_END))
-                  rval = UCAC4_FSEEK2_FAILED;
-               end_offset = ftell( ifile) / sizeof( UCAC4_STAR);
-//             end_offset = ucac4_offsets[zone] - ucac4_offsets[zone - 1];
-               ra_lo = 0;
-               ra_hi = ra_range;
-               }
+            offset = 0;
+            if( fseek( ifile, 0L, SEEK_END))
+               rval = UCAC4_FSEEK2_FAILED;
+            end_offset = ftell( ifile) / recsize;
+//          end_offset = ucac4_offsets[zone] - ucac4_offsets[zone - 1];
+            ra_lo = 0;
+            ra_hi = ra_range;
             }
 //       printf( "Seeking RA=%u between offsets %u to %u (%u)\n",
 //                   min_ra, offset, end_offset, end_offset - offset);
 //                   /* Secant-search within the known limits: */
          while( rval >= 0 && end_offset - offset > acceptable_limit)
             {
-            UCAC4_STAR star;
+            int32_t star_ra = 0;     /* RA comes first in either record */
             uint32_t delta = end_offset - offset, toffset;
             uint32_t minimum_bite = delta / 8 + 1;
             uint64_t tval = (uint64_t)delta *
@@ -700,26 +1629,31 @@ int extract_ucac4_stars( FILE *ofile, const double ra, const double dec,
             else if( tval > delta - minimum_bite)
                tval = delta - minimum_bite;
             toffset = offset + (uint32_t)tval;
-            if( fseek( ifile, toffset * sizeof( UCAC4_STAR), SEEK_SET))
+            if( fseek( ifile, (long)toffset * recsize, SEEK_SET))
                rval = UCAC4_FSEEK3_FAILED;
-            if( fread( &star, sizeof( UCAC4_STAR), 1, ifile) != 1)
+            if( fread( &star_ra, sizeof( int32_t), 1, ifile) != 1)
                rval = UCAC4_FREAD_FAILED;
-            if( star.ra < min_ra)
+            cat->stats.n_records_read++;
+            if( star_ra < min_ra)
                {
                offset = toffset;
-               ra_lo = star.ra;
+               ra_lo = star_ra;
                }
             else
                {
                end_offset = toffset;
-               ra_hi = star.ra;
+               ra_hi = star_ra;
                }
             }
-         time_searching += clock( ) - t0;
-         fseek( ifile, offset * sizeof( UCAC4_STAR), SEEK_SET);
+         cat->stats.seconds_searching += current_time( ) - t0;
+         cat->stats.n_zones++;
+         if( rval >= 0)
+            fseek( ifile, (long)offset * recsize, SEEK_SET);
 
-         while( rval >= 0 && keep_going &&
+         while( !is_split && rval >= 0 && keep_going &&
                   (n_read = fread( stars, sizeof( UCAC4_STAR), buffsize, ifile)) > 0)
+            {
+            cat->stats.n_records_read += n_read;
             for( i = 0; i < n_read && keep_going; i++)
                {
                UCAC4_STAR star = stars[i];
@@ -738,41 +1672,535 @@ int extract_ucac4_stars( FILE *ofile, const double ra, const double dec,
                      if( star.twomass_id ||
                            (output_format & UCAC4_INCLUDE_DOUBTFULS))
                         {
+                        int stop = 0;
+
                         rval++;
-                        if( ofile)
+                        if( callback_fn)
+                           stop = (callback_fn)( context, zone, offset, &star);
+                        else if( hot_callback_fn)
+                           {
+                           ucac4_hot_t hot_star;
+
+                           split_ucac4_star( &hot_star, NULL, &star);
+                           stop = (hot_callback_fn)( context, zone, offset,
+                                                         &hot_star);
+                           }
+                        if( stop)
                            {
-                           if( output_format & UCAC4_RAW_BINARY)
-                              fwrite( &star, 1, sizeof( UCAC4_STAR), ofile);
-                           else
-                              {
-                              char buff[UCAC4_ASCII_SIZE];
-
-                              write_ucac4_star( zone, offset + 1, buff, &star,
-                                                            output_format);
-                              fwrite( buff, 1, strlen( buff), ofile);
-                              }
+                           keep_going = 0;
+                           cat->scan_stopped = 1;
                            }
                         }
                offset++;
                }
-         fclose( ifile);
+            }
+
+               /* For split zones,  we find which stars in each buffer-full */
+               /* of hot records are wanted,  then (if full stars are to be */
+               /* passed back) read the cold data for them in one go.       */
+         while( is_split && rval >= 0 && keep_going && (n_read =
+                  (int)fread( hot, sizeof( ucac4_hot_t), buffsize, ifile)) > 0)
+            {
+            FILE *cold_file = cat->cold_file[zone - 1];
+            int first = -1, last = -1, n_cold = 0;
+            ucac4_hot_t hot_star;
+
+            cat->stats.n_records_read += n_read;
+            for( i = 0; i < n_read; i++)
+               {
+               get_native_hot( &hot_star, hot + i);
+               if( hot_star.ra > max_ra)
+                  {
+                  n_read = i;
+                  keep_going = 0;
+                  }
+               else if( hot_star_wanted( &hot_star, min_ra, min_spd, max_spd,
+                                                output_format))
+                  {
+                  if( first < 0)
+                     first = i;
+                  last = i;
+                  }
+               }
+            if( first >= 0 && callback_fn)
+               {
+               if( fseek( cold_file, (long)( offset + first)
+                                  * (long)sizeof( ucac4_cold_t), SEEK_SET))
+                  rval = UCAC4_FSEEK_FAILED;
+               else
+                  n_cold = (int)fread( cold, sizeof( ucac4_cold_t),
+                                        last - first + 1, cold_file);
+               }
+            for( i = first; first >= 0 && i <= last && rval >= 0
+                                       && !cat->scan_stopped; i++)
+               {
+               int stop = 0;
+
+               get_native_hot( &hot_star, hot + i);
+               if( !hot_star_wanted( &hot_star, min_ra, min_spd, max_spd,
+                                                output_format))
+                  continue;
+               if( callback_fn)
+                  {
+                  UCAC4_STAR star;
+
+                  if( i - first >= n_cold)
+                     {
+                     rval = UCAC4_FREAD_FAILED;
+                     break;
+                     }
+                  join_ucac4_star( &star, hot + i, cold + i - first);
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+                  flip_ucac4_star( &star);
+#endif
+#endif
+                  stop = (callback_fn)( context, zone, offset + i, &star);
+                  }
+               else if( hot_callback_fn)
+                  stop = (hot_callback_fn)( context, zone, offset + i,
+                                                      &hot_star);
+               rval++;
+               if( stop)
+                  {
+                  keep_going = 0;
+                  cat->scan_stopped = 1;
+                  }
+               }
+            offset += n_read;
+            }
          }
       zone++;
       }
-   if( index_file)
-      fclose( index_file);
-   free( stars);
+   free( buffers);
 
             /* We need some special handling for cases where the area
                to be extracted crosses RA=0 or RA=24: */
+   if( rval >= 0 && ra >= 0. && ra < 360. && !only_zone)
+      {
+      if( ra1 < 0. && !cat->scan_stopped)    /* left side crosses RA=0h */
+         rval += extract_stars( cat, context, callback_fn, hot_callback_fn,
+                           ra+360., dec, width, height, output_format, 0);
+      if( ra2 > 360. && !cat->scan_stopped)  /* right side crosses RA=24h */
+         rval += extract_stars( cat, context, callback_fn, hot_callback_fn,
+                           ra-360., dec, width, height, output_format, 0);
+      }
+   return( rval);
+}
+
+int extract_ucac4_stars_callback_from_catalog( ucac4_catalog_t *cat,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   int rval;
+
+   memset( &cat->stats, 0, sizeof( ucac4_stats_t));
+   cat->scan_stopped = 0;
+   rval = extract_stars( cat, context, callback_fn, NULL, ra, dec,
+                                  width, height, output_format, 0);
+   if( rval > 0)
+      cat->stats.n_stars_found = rval;
+   return( rval);
+}
+
+/* As above,  but for just one zone of the rectangle (including,  if it
+crosses RA=0,  the piece of that zone on the far side).  Lets one go
+through a big area a zone at a time,  alongside another catalog. */
+
+int extract_ucac4_zone_stars_callback( ucac4_catalog_t *cat, const int zone,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   int rval;
+
+   if( zone < 1 || zone > UCAC4_N_ZONES)
+      return( -1);
+   memset( &cat->stats, 0, sizeof( ucac4_stats_t));
+   cat->scan_stopped = 0;
+   rval = extract_stars( cat, context, callback_fn, NULL, ra, dec,
+                                  width, height, output_format, zone);
    if( rval >= 0 && ra >= 0. && ra < 360.)
       {
-      if( ra1 < 0.)      /* left side crosses over RA=0h */
-         rval += extract_ucac4_stars( ofile, ra+360., dec, width, height,
-                                          path, output_format);
-      if( ra2 > 360.)    /* right side crosses over RA=24h */
-         rval += extract_ucac4_stars( ofile, ra-360., dec, width, height,
-                                          path, output_format);
+      if( ra - width / 2. < 0. && !cat->scan_stopped)
+         rval += extract_stars( cat, context, callback_fn, NULL, ra + 360.,
+                            dec, width, height, output_format, zone);
+      if( ra + width / 2. > 360. && !cat->scan_stopped)
+         rval += extract_stars( cat, context, callback_fn, NULL, ra - 360.,
+                            dec, width, height, output_format, zone);
+      }
+   if( rval > 0)
+      cat->stats.n_stars_found = rval;
+   return( rval);
+}
+
+int extract_ucac4_hot_stars_callback_from_catalog( ucac4_catalog_t *cat,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t,
+                         const ucac4_hot_t *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   int rval;
+
+   memset( &cat->stats, 0, sizeof( ucac4_stats_t));
+   cat->scan_stopped = 0;
+   rval = extract_stars( cat, context, NULL, callback_fn, ra, dec,
+                                  width, height, output_format, 0);
+   if( rval > 0)
+      cat->stats.n_stars_found = rval;
+   return( rval);
+}
+
+typedef struct
+   {
+   out_sink_t *sink;
+   int output_format;
+   int err;
+   } sink_output_t;
+
+/* If the sink fails,  we return its (sticky) error,  which stops the
+extraction.  flush_sink() of a failed sink just returns that error. */
+
+static int output_a_ucac4_star( void *context, const int zone,
+               const uint32_t offset, const UCAC4_STAR *star)
+{
+   sink_output_t *f = (sink_output_t *)context;
+
+   if( f->sink)
+      {
+      if( f->output_format & UCAC4_RAW_BINARY)
+         f->err = sink_write( f->sink, star, sizeof( UCAC4_STAR));
+      else
+         {
+         char *buff = sink_reserve( f->sink, UCAC4_ASCII_SIZE);
+
+         if( buff)
+            {
+            write_ucac4_star( zone, offset + 1, buff, star, f->output_format);
+            sink_commit( f->sink, strlen( buff));
+            }
+         else
+            f->err = flush_sink( f->sink);
+         }
+      }
+   return( f->err);
+}
+
+int extract_ucac4_stars_to_sink( ucac4_catalog_t *cat, out_sink_t *sink,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   sink_output_t f;
+   int rval;
+
+   f.sink = sink;
+   f.output_format = output_format;
+   f.err = 0;
+   rval = extract_ucac4_stars_callback_from_catalog( cat, &f,
+               output_a_ucac4_star, ra, dec, width, height, output_format);
+   return( f.err ? f.err : rval);
+}
+
+int extract_ucac4_stars_from_catalog( ucac4_catalog_t *cat, FILE *ofile,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = UCAC4_ALLOC_FAILED;
+
+   if( sink || !ofile)
+      rval = extract_ucac4_stars_to_sink( cat, sink, ra, dec, width, height,
+                                          output_format);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
       }
    return( rval);
 }
+
+/* For parallel extraction,  each thread needs its own catalog,  since a
+catalog can't be used by two threads at once.  The copies share the
+original's index (if it has one loaded or mapped),  so making them is
+cheap;  they must be closed before the original is.  */
+
+static ucac4_catalog_t *clone_ucac4_catalog( const ucac4_catalog_t *cat)
+{
+   ucac4_catalog_t *rval = init_ucac4_catalog( cat->path, INDEX_NOT_USED);
+
+   if( rval)
+      {
+      rval->layout = cat->layout;
+      rval->index = cat->index;        /* shared,  not owned */
+      if( !rval->index && cat->index_file)
+         {
+         char filename[100];
+
+         rval->index_file = get_ucac4_index_file( cat->path, "u4index.asc",
+                                                      filename);
+         }
+      }
+   return( rval);
+}
+
+/* Each job is one zone of one piece of the rectangle (there may be two
+or three pieces if it crosses RA=0),  in the order extract_stars() would
+do them,  so the output is the same as for a one-thread extraction. */
+
+typedef struct
+   {
+   ucac4_catalog_t **cats;
+   double piece_ra[3], dec, width, height;
+   int first_zone, n_zones, output_format;
+   } par_extract_t;
+
+static int extract_zone_job( void *context, const int thread_num,
+                             const int job_num, out_sink_t *sink)
+{
+   const par_extract_t *p = (const par_extract_t *)context;
+   sink_output_t f;
+   int rval;
+
+   f.sink = sink;
+   f.output_format = p->output_format;
+   f.err = 0;
+   rval = extract_stars( p->cats[thread_num], &f, output_a_ucac4_star, NULL,
+               p->piece_ra[job_num / p->n_zones], p->dec, p->width, p->height,
+               p->output_format, p->first_zone + job_num % p->n_zones);
+   return( f.err ? f.err : rval);
+}
+
+int extract_ucac4_stars_parallel( ucac4_catalog_t *cat, out_sink_t *sink,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format, const int n_threads)
+{
+   const double zone_height = .2;
+   int last_zone = (int)( (dec + height / 2. + 90.) / zone_height) + 1;
+   int i, n_pieces = 1, n_cats, rval;
+   par_extract_t p;
+
+   memset( &cat->stats, 0, sizeof( ucac4_stats_t));
+   cat->scan_stopped = 0;
+   p.first_zone = (int)( (dec - height / 2. + 90.) / zone_height) + 1;
+   if( p.first_zone < 1)
+      p.first_zone = 1;
+   if( last_zone > UCAC4_N_ZONES)
+      last_zone = UCAC4_N_ZONES;
+   p.n_zones = last_zone - p.first_zone + 1;
+   if( p.n_zones <= 0)
+      return( 0);
+   p.piece_ra[0] = ra;
+   if( ra >= 0. && ra < 360.)
+      {
+      if( ra - width / 2. < 0.)
+         p.piece_ra[n_pieces++] = ra + 360.;
+      if( ra + width / 2. > 360.)
+         p.piece_ra[n_pieces++] = ra - 360.;
+      }
+   p.dec = dec;
+   p.width = width;
+   p.height = height;
+   p.output_format = output_format;
+   n_cats = (n_threads > 1 ? n_threads : 1);
+   p.cats = (ucac4_catalog_t **)calloc( n_cats, sizeof( ucac4_catalog_t *));
+   if( !p.cats)
+      return( UCAC4_ALLOC_FAILED);
+   p.cats[0] = cat;
+   for( i = 1; i < n_cats; i++)
+      if( (p.cats[i] = clone_ucac4_catalog( cat)) == NULL)
+         n_cats = i;       /* out of memory;  just use fewer threads */
+   rval = run_ordered_jobs( sink, n_pieces * p.n_zones, n_cats, &p,
+                            extract_zone_job);
+   for( i = 1; i < n_cats; i++)
+      {
+      cat->stats.seconds_searching += p.cats[i]->stats.seconds_searching;
+      cat->stats.n_zones += p.cats[i]->stats.n_zones;
+      cat->stats.n_records_read += p.cats[i]->stats.n_records_read;
+      close_ucac4_catalog( p.cats[i]);
+      }
+   free( p.cats);
+   if( rval > 0)
+      cat->stats.n_stars_found = rval;
+   return( rval);
+}
+
+void get_ucac4_stats( const ucac4_catalog_t *cat, ucac4_stats_t *stats)
+{
+   *stats = cat->stats;
+}
+
+/* The original,  handle-less API.  These make a catalog for the
+duration of the call,  without loading the index (which would take much
+longer than the extraction itself).   */
+
+int extract_ucac4_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int output_format)
+{
+   ucac4_catalog_t *cat = init_ucac4_catalog( path,
+                                                INDEX_READ_AS_NEEDED);
+   int rval = UCAC4_ALLOC_FAILED;
+
+   if( cat)
+      {
+      rval = extract_ucac4_stars_from_catalog( cat, ofile, ra, dec,
+                              width, height, output_format);
+      close_ucac4_catalog( cat);
+      }
+   return( rval);
+}
+
+int extract_ucac4_stars_callback( void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int output_format)
+{
+   ucac4_catalog_t *cat = init_ucac4_catalog( path,
+                                                INDEX_READ_AS_NEEDED);
+   int rval = UCAC4_ALLOC_FAILED;
+
+   if( cat)
+      {
+      rval = extract_ucac4_stars_callback_from_catalog( cat, context,
+               callback_fn, ra, dec, width, height, output_format);
+      close_ucac4_catalog( cat);
+      }
+   return( rval);
+}
+
+int extract_ucac4_info( const int zone, const long offset, UCAC4_STAR *star,
+                     const char *path)
+{
+   ucac4_catalog_t *cat = init_ucac4_catalog( path, INDEX_NOT_USED);
+   int rval = UCAC4_ALLOC_FAILED;
+
+   if( cat)
+      {
+      rval = extract_ucac4_info_from_catalog( cat, zone, offset, star);
+      close_ucac4_catalog( cat);
+      }
+   return( rval);
+}
+
+/* For a single lookup,  there's no point in mapping all 450 MBytes of
+'u4mpos.bin' (which,  where mapping is emulated,  would mean reading
+it all in);  we just read the header and the one entry we need.  */
+
+int find_ucac4_star_by_id_in_path( const uint32_t id_number, int *zone,
+                  long *offset, UCAC4_STAR *star, const char *path)
+{
+   char filename[100];
+   FILE *ifile = get_ucac4_index_file( path, "u4mpos.bin", filename);
+   uint32_t header[UCAC4_MPOS_HEADER_SIZE / sizeof( uint32_t)], loc = 0;
+   int rval = UCAC4_NO_MPOS_INDEX;
+
+   if( !ifile)
+      return( rval);
+   if( fread( header, sizeof( header), 1, ifile) == 1
+               && header[0] == UCAC4_MPOS_MAGIC
+               && header[1] == UCAC4_MPOS_VERSION)
+      {
+      rval = UCAC4_ID_NOT_FOUND;
+      if( id_number < header[2] && !fseek( ifile,
+               (long)( UCAC4_MPOS_HEADER_SIZE + id_number * sizeof( uint32_t)),
+               SEEK_SET)
+               && fread( &loc, sizeof( uint32_t), 1, ifile) == 1 && loc)
+         rval = 0;
+      }
+   fclose( ifile);
+   if( !rval)
+      {
+      *zone = (int)UCAC4_MPOS_ZONE( loc);
+      *offset = (long)UCAC4_MPOS_OFFSET( loc);
+      if( star)
+         {
+         rval = extract_ucac4_info( *zone, *offset, star, path);
+         if( !rval && star->id_number != id_number)
+            rval = UCAC4_ID_NOT_FOUND;    /* index doesn't match the data */
+         }
+      }
+   return( rval);
+}
+
+static long read_bulk_ucac4_stars( void *context, const int zone,
+                  const long offset, const size_t n_stars, void *buff)
+{
+   ucac4_catalog_t *cat = (ucac4_catalog_t *)context;
+   long n_read;
+
+   if( zone < 1 || zone > UCAC4_N_ZONES)
+      return( -1);
+   if( !get_catalog_zone_file( cat, zone))
+      return( -4);
+   if( offset < 1)
+      return( -2);
+   n_read = read_catalog_stars( cat, zone, (uint32_t)( offset - 1), n_stars,
+                                 (UCAC4_STAR *)buff);
+   if( n_read < 0)
+      return( -2);
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   {
+   long i;
+
+   for( i = 0; i < n_read; i++)
+      flip_ucac4_star( (UCAC4_STAR *)buff + i);
+   }
+#endif
+#endif
+   return( n_read);
+}
+
+int extract_ucac4_info_bulk( ucac4_catalog_t *cat, const size_t n_stars,
+                  const int *zones, const long *offsets,
+                  UCAC4_STAR *stars, int *rvals)
+{
+   const int rval = run_bulk_requests( n_stars, zones, offsets, stars,
+                  sizeof( UCAC4_STAR), rvals, -3, cat, read_bulk_ucac4_stars);
+
+   return( rval == BULK_REQ_ALLOC_FAILED ? UCAC4_ALLOC_FAILED : rval);
+}
+
+/* for_each_ucac4_star_in_zone() reads through the zone with the bulk
+reader above;  see run_zone_loop() in 'bulk_req.h'.  */
+
+typedef struct
+   {
+   void *context;
+   int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *);
+   } zone_loop_t;
+
+static int pass_ucac4_star( void *context, const int zone, const long offset,
+                  const void *star)
+{
+   zone_loop_t *z = (zone_loop_t *)context;
+
+   return( z->callback_fn( z->context, zone, (uint32_t)offset,
+                  (const UCAC4_STAR *)star));
+}
+
+int for_each_ucac4_star_in_zone( ucac4_catalog_t *cat, const int zone,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *))
+{
+   zone_loop_t z;
+
+   z.context = context;
+   z.callback_fn = callback_fn;
+   return( run_zone_loop( zone, sizeof( UCAC4_STAR), cat,
+                  read_bulk_ucac4_stars, &z, pass_ucac4_star,
+                  UCAC4_ALLOC_FAILED));
+}
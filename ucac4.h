@@ -5,6 +5,7 @@
 pluto (at) projectpluto.com with comments/bug fixes.  */
 
 #include <stdint.h>
+#include "out_sink.h"
 
       /* Raw structures are read herein,  so the following structure  */
       /* must be packed on byte boundaries:                           */
@@ -50,9 +51,60 @@ UCAC4_STAR
    uint16_t ucac2_zone;
    uint32_t ucac2_number;
    };
+
+/* 'u4split.c' can repack each zone into a 'hot' file (hNNN) of the 20
+bytes per star most extractions need -- position,  magnitude,  proper
+motion,  and flags for the Tycho and "doubtful" filters -- and a 'cold'
+file (cNNN) of the remaining 60 bytes.  Records are in the same order
+as in the zone files,  so 'u4index.asc' applies unchanged.  If hNNN and
+cNNN are found (in the places zNNN would be looked for),  they're used
+instead of zNNN.  Extractions then scan only the hot file,  reading cold
+data just for the stars actually output;  and the 'hot' extraction
+functions below never read cold data at all.
+
+   Fields have the same meanings as in UCAC4_STAR.  Note that a proper
+motion of 32767 means one of the few stars too fast to fit;  for those,
+get the full record and use get_actual_proper_motion().  */
+
+typedef struct
+   {
+   int32_t ra, spd;
+   uint16_t mag1;
+   uint16_t epoch_ra, epoch_dec;
+   int16_t pm_ra, pm_dec;
+   uint8_t flags;             /* UCAC4_HOT_HAS_2MASS | UCAC4_HOT_TYCHO */
+   uint8_t reserved;
+   } ucac4_hot_t;
+
+typedef struct
+   {
+   uint16_t mag2;
+   uint8_t mag_sigma;
+   uint8_t obj_type, double_star_flag;
+   int8_t ra_sigma, dec_sigma;
+   uint8_t n_ucac_total, n_ucac_used, n_cats_used;
+   int8_t pm_ra_sigma, pm_dec_sigma;
+   uint32_t twomass_id;
+   uint16_t mag_j, mag_h, mag_k;
+   uint8_t icq_flag[3];
+   uint8_t e2mpho[3];
+   uint16_t apass_mag[5];
+   int8_t apass_mag_sigma[5];
+   uint8_t yale_gc_flags;
+   uint32_t catalog_flags;
+   uint8_t leda_flag;
+   uint8_t twomass_ext_flag;
+   uint32_t id_number;
+   uint16_t ucac2_zone;
+   uint32_t ucac2_number;
+   } ucac4_cold_t;
 #pragma pack( )
 
-/* Note: sizeof( UCAC4_STAR) = 78 bytes */
+/* Note: sizeof( UCAC4_STAR) = 78 bytes,  sizeof( ucac4_hot_t) = 20,
+sizeof( ucac4_cold_t) = 60 */
+
+#define UCAC4_HOT_HAS_2MASS      1
+#define UCAC4_HOT_TYCHO          2
 
 #ifdef __cplusplus
 extern "C" {
@@ -67,14 +119,195 @@ extern "C" {
 void flip_ucac4_star( UCAC4_STAR *star);
 #endif
 
+         /* Conversion between full records and hot/cold pairs.  'cold' */
+         /* can be NULL when splitting,  if you only want the hot part. */
+void split_ucac4_star( ucac4_hot_t *hot, ucac4_cold_t *cold,
+                                    const UCAC4_STAR *star);
+void join_ucac4_star( UCAC4_STAR *star, const ucac4_hot_t *hot,
+                                    const ucac4_cold_t *cold);
+
          /* Extracts data for a give RA/dec rectangle,  writes out result */
          /* as ASCII text to 'ofile'.  RA, dec, width, height in degrees. */
+         /* These keep no state between calls,  so they can safely be     */
+         /* called from several threads at once.                          */
 int extract_ucac4_stars( FILE *ofile, const double ra, const double dec,
                   const double width, const double height, const char *path,
                   const int output_format);
 
+         /* Same,  except each star is passed to a callback function,   */
+         /* along with its zone and (zero-based) offset within the zone. */
+         /* Note that designations such as '455-004973',  and functions */
+         /* such as extract_ucac4_info(),  use one-based offsets;  add  */
+         /* one to what the callback gets.  (The Gaia,  UCAC2,  UCAC3   */
+         /* and URAT1 callbacks work the same way.)                     */
+         /* Only stars passing the filters set by 'output_format' (i.e., */
+         /* UCAC4_OMIT_TYCHO_STARS and UCAC4_INCLUDE_DOUBTFULS) are      */
+         /* passed.  If the callback returns a non-zero value,  the      */
+         /* extraction stops there.  The return value is the number of   */
+         /* stars passed to the callback.                                */
+int extract_ucac4_stars_callback( void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int output_format);
+
 int extract_ucac4_info( const int zone, const long offset, UCAC4_STAR *star,
                      const char *path);
+
+         /* If you're doing more than one extraction,  it's faster to   */
+         /* open the catalog once.  This finds the data,  loads the     */
+         /* index into memory,  and keeps zone files open as they're    */
+         /* used,  until the catalog is closed.  A catalog shouldn't be */
+         /* used by more than one thread at a time.                     */
+typedef struct ucac4_catalog ucac4_catalog_t;
+
+ucac4_catalog_t *open_ucac4_catalog( const char *path);
+void close_ucac4_catalog( ucac4_catalog_t *cat);
+int extract_ucac4_stars_from_catalog( ucac4_catalog_t *cat, FILE *ofile,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+int extract_ucac4_stars_callback_from_catalog( ucac4_catalog_t *cat,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+         /* As above,  but only stars from one zone of the rectangle.  */
+         /* Lets you go through a large area a zone at a time.  Returns */
+         /* -1 if the zone number is out of range.                      */
+int extract_ucac4_zone_stars_callback( ucac4_catalog_t *cat, const int zone,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+         /* Output can also go to an 'out_sink_t' (see 'out_sink.h'),    */
+         /* which can write to a file descriptor,  memory,  or callback. */
+         /* The FILE versions above do this for you.  Write errors show  */
+         /* up when the sink is flushed or closed;  the FILE versions    */
+         /* then return the (negative) OUT_SINK_ error code.             */
+int extract_ucac4_stars_to_sink( ucac4_catalog_t *cat, out_sink_t *sink,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+int extract_ucac4_info_from_catalog( ucac4_catalog_t *cat, const int zone,
+                  const long offset, UCAC4_STAR *star);
+         /* Same output as extract_ucac4_stars_to_sink(),  but with the */
+         /* zones divided among 'n_threads' threads.  Each thread writes */
+         /* to its own buffer;  the buffers are then written out in zone */
+         /* order,  so you get exactly what the one-thread version would */
+         /* give.  Worth doing for large areas (a 10-degree-high one     */
+         /* covers fifty zones.)  See 'par_jobs.h' for details.          */
+int extract_ucac4_stars_parallel( ucac4_catalog_t *cat, out_sink_t *sink,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format, const int n_threads);
+         /* Gets 'n_stars' stars at once,  given their zones and (one-   */
+         /* based) offsets;  much faster than the above for a long list. */
+         /* See 'bulk_req.h' for how it's done and what comes back;      */
+         /* errors are as extract_ucac4_info_from_catalog() would give.  */
+int extract_ucac4_info_bulk( ucac4_catalog_t *cat, const size_t n_stars,
+                  const int *zones, const long *offsets,
+                  UCAC4_STAR *stars, int *rvals);
+
+         /* As extract_ucac4_stars_callback_from_catalog(),  but passing */
+         /* only the hot part of each star.  With split zones,  this      */
+         /* never reads the cold files;  with unsplit ones,  it works,    */
+         /* but saves nothing.                                           */
+int extract_ucac4_hot_stars_callback_from_catalog( ucac4_catalog_t *cat,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const ucac4_hot_t *),
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+
+         /* Statistics for the most recent extraction from a catalog.   */
+         /* These replace the old global 'time_searching'.  Since each  */
+         /* catalog keeps its own,  threads using separate catalogs     */
+         /* don't interfere with one another.                           */
+typedef struct
+   {
+   double seconds_searching;  /* wall-clock time spent finding start points */
+   long n_zones;              /* zones actually searched */
+   long n_records_read;       /* while searching as well as extracting */
+   long n_stars_found;
+   } ucac4_stats_t;
+
+void get_ucac4_stats( const ucac4_catalog_t *cat, ucac4_stats_t *stats);
+
+/* 'u4index.bin',  made from 'u4index.asc' by 'u4_index.c',  holds the
+same index in binary form.  If found (in the same places 'u4index.asc'
+would be looked for),  it's memory-mapped and used instead of the ASCII
+file.  It consists of eight uint32_ts :  UCAC4_BIN_INDEX_MAGIC;  the
+version (currently 1);  the number of zones (900) and of RA bins per
+zone (1440);  the checksum of the data following the header,  as
+computed by ucac4_index_checksum( );  and three zeroes,  reserved for
+future use.  Then come 900 x 1440 pairs of uint32_ts giving the offset
+of the first star in each zone/RA bin,  and the number of stars in that
+bin.  Everything is in the byte order of the machine that made the
+file;  on a machine with the other byte order,  the magic number won't
+match and the file will be ignored.        */
+
+#define UCAC4_BIN_INDEX_MAGIC        0x0ca4b1d0
+#define UCAC4_BIN_INDEX_VERSION      1
+#define UCAC4_BIN_INDEX_HEADER_SIZE  (8 * sizeof( uint32_t))
+
+uint32_t ucac4_index_checksum( const uint32_t *data, const size_t n_words);
+
+         /* Every star in a zone,  with no filtering,  for tools that */
+         /* need to go through the whole catalog (building indices and */
+         /* crosswalks and such).  The zone is read in large blocks,   */
+         /* which makes that about as fast as the disk allows.  (The   */
+         /* UCAC2,  UCAC3 and URAT1 versions work the same way.)  The  */
+         /* callback is as for extract_ucac4_stars_callback().  Returns */
+         /* the number of stars passed,  or a negative error code.     */
+int for_each_ucac4_star_in_zone( ucac4_catalog_t *cat, const int zone,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const UCAC4_STAR *));
+
+         /* Stars can also be numbered cumulatively across the catalog, */
+         /* from 1 to 113780093.  These convert to and from the usual   */
+         /* zone and (one-based) offset.  ucac4_cumulative_number()     */
+         /* returns 0,  and ucac4_zone_and_offset() -1,  if given a     */
+         /* star that doesn't exist.                                    */
+int32_t ucac4_cumulative_number( const int zone, const long offset);
+int ucac4_zone_and_offset( const int32_t cumulative_number, int *zone,
+                                          long *offset);
+
+/* Each star also has an 'id_number' (the MPOS number).  'u4mpos.bin',
+made by 'u4_mpos.c' and looked for in the same places as 'u4index.bin',
+maps these to zones and offsets.  It consists of eight uint32_ts :
+UCAC4_MPOS_MAGIC;  the version (currently 1);  the number of entries
+(one more than the highest id_number);  the number of stars;  the
+checksum of the entries,  computed by ucac4_index_checksum( );  and
+three zeroes.  Then come the entries,  one uint32_t per id_number :
+zero if there's no such star,  otherwise the zone times 2^22 plus the
+(one-based) offset within the zone.  As with 'u4index.bin',  it's
+mapped into memory,  so lookups are O(1) and nearly free.  */
+
+#define UCAC4_MPOS_MAGIC             0x0ca4305d
+#define UCAC4_MPOS_VERSION           1
+#define UCAC4_MPOS_HEADER_SIZE       (8 * sizeof( uint32_t))
+#define UCAC4_MPOS_ZONE( entry)      ((entry) >> 22)
+#define UCAC4_MPOS_OFFSET( entry)    ((entry) & 0x3fffff)
+#define UCAC4_MPOS_ENTRY( zone, offset)  \
+                     (((uint32_t)(zone) << 22) | (uint32_t)(offset))
+
+         /* Finds a star by its id_number.  'star' can be NULL if you   */
+         /* just want the zone and offset.  Returns 0 if the star was   */
+         /* found,  UCAC4_NO_MPOS_INDEX if 'u4mpos.bin' couldn't be     */
+         /* found or used,  UCAC4_ID_NOT_FOUND if there's no such star, */
+         /* or an error code from extract_ucac4_info_from_catalog().    */
+int find_ucac4_star_by_id( ucac4_catalog_t *cat, const uint32_t id_number,
+                  int *zone, long *offset, UCAC4_STAR *star);
+         /* As above,  for a one-off lookup without a catalog handle. */
+int find_ucac4_star_by_id_in_path( const uint32_t id_number, int *zone,
+                  long *offset, UCAC4_STAR *star, const char *path);
+
+#define UCAC4_NO_MPOS_INDEX          -8
+#define UCAC4_ID_NOT_FOUND           -9
+
 int write_ucac4_star_fortran_style( char *obuff, const UCAC4_STAR *star);
 int write_ucac4_star( const int zone, const long offset, char *obuff,
                      const UCAC4_STAR *star, const int output_format);
@@ -86,6 +319,31 @@ int write_ucac4_star( const int zone, const long offset, char *obuff,
 int32_t get_actual_proper_motion( const UCAC4_STAR *star, const int get_dec_pm);
 int get_actual_proper_motion_sigma( const int8_t pm_sigma);
 
+      /* Decodes a batch of stars into arrays,  one per field,  in     */
+      /* "real" units :  RA and dec in degrees;  magnitudes and their  */
+      /* sigmas in magnitudes;  RA/dec sigmas in mas;  proper motions  */
+      /* and their sigmas in mas/year (with the above tricks undone);  */
+      /* and epochs in years.  Arrays left NULL are skipped.  Any     */
+      /* arrays can be supplied,  or alloc_ucac4_decoded() will make   */
+      /* room for all of them (free() the result when done.)          */
+typedef struct
+   {
+   double *ra, *dec;
+   float *mag1, *mag2, *mag_sigma;
+   float *ra_sigma, *dec_sigma;
+   float *pm_ra, *pm_dec;
+   float *pm_ra_sigma, *pm_dec_sigma;
+   float *epoch_ra, *epoch_dec;
+   uint32_t *id_number;
+   } ucac4_decoded_t;
+
+      /* Returns the number of stars flagged as high-PM (32767) for    */
+      /* which no real proper motion could be found.  That "can't      */
+      /* happen" with the real catalog;  their PMs are set to zero.    */
+size_t decode_ucac4_stars( ucac4_decoded_t *out, const UCAC4_STAR *stars,
+                                          const size_t n_stars);
+ucac4_decoded_t *alloc_ucac4_decoded( const size_t max_stars);
+
 #define UCAC4_ASCII_SIZE 280
 
          /* This flag suppresses stars that were matched with Tycho       */
@@ -3,6 +3,11 @@
 #include <stdlib.h>
 #include <assert.h>
 #include "urat1.h"
+#include "fmt_num.h"
+#include "out_sink.h"
+#include "par_jobs.h"
+#include "bulk_req.h"
+#include "mem_map.h"
 
 /* Basic access functions for URAT1.  Please contact
 pluto (at) projectpluto.com with comments/bug fixes.
@@ -76,42 +81,53 @@ void flip_urat1_star( URAT1_STAR *star)
 static int write_urat1_star_fortran_style( const int zone, const long offset,
                char *obuff, const URAT1_STAR *star, const int output_format)
 {
-   sprintf( obuff, "%10d%10d%4d%4d%3d%4d%6d%6d%4d%3d%2d%4d%4d%4d%4d%6d%6d%4d",
-            star->ra, star->spd, star->sigs, star->sigm,    /* 10 10 4 4;  1 11 21 25 */
-            star->nst, star->nsu, star->epoc, star->mmag,   /*  3  4 6 6; 29 32 36 42 */
-            star->sigp, star->nsm, star->ref,               /*  4  3 2  ; 48 52 55 */
-            star->nit, star->niu, star->ngt, star->ngu,     /*  4  4 4 4; 57 61 65 69 */
-            star->pmr, star->pmd, star->pme);               /*  6  6 4  ; 73 79 85 */
-
-
-   sprintf( obuff + strlen( obuff),
-            "%3d%3d%11d%6d%6d%6d%5d%5d%5d%2d%2d%2d%2d%2d%2d",
-            star->mfm, star->mfa, star->id2,                /*  3  3 11; 89 92 95 */
-            star->twomass_mag[0], star->twomass_mag[1],     /* 6 6 6; 106 112 118 */
-            star->twomass_mag[2],
-            star->twomass_mag_sigma[0],                     /* 5 5 5; 124 129 134 */
-            star->twomass_mag_sigma[1],
-            star->twomass_mag_sigma[2],
-            star->icc_flag[0], star->icc_flag[1], star->icc_flag[2], /* 2 2 2: 139 141 143 */
-            star->photo_flag[0], star->photo_flag[1], star->photo_flag[2]);
-                                                                     /* 2 2 2: 145 147 149 */
-   sprintf( obuff + strlen( obuff),
-               "%6d%6d%6d%6d%6d%5d%5d%5d%5d%5d%4d%4d",
-            star->apass_mag[0],        /* 6 6 6 6 6: 151 157 163 169 175 */
-            star->apass_mag[1],
-            star->apass_mag[2],
-            star->apass_mag[3],
-            star->apass_mag[4],
-            star->apass_mag_sigma[0],  /* 5 5 5 5 5: 181 186 191 196 201 */
-            star->apass_mag_sigma[1],
-            star->apass_mag_sigma[2],
-            star->apass_mag_sigma[3],
-            star->apass_mag_sigma[4],
-            star->ann, star->ano);     /* 4 4: 206 210 (ending at 214) */
-   if( output_format & 0x8)
-      sprintf( obuff + strlen( obuff), " %03d-%06ld", zone, offset);
+   char *optr = obuff;
+   int i;
 
-   strcat( obuff, "\n");
+   optr = fmt_int( optr, star->ra, 10);      /* 10 10 4 4;  1 11 21 25 */
+   optr = fmt_int( optr, star->spd, 10);
+   optr = fmt_int( optr, star->sigs, 4);
+   optr = fmt_int( optr, star->sigm, 4);
+   optr = fmt_int( optr, star->nst, 3);      /*  3  4 6 6; 29 32 36 42 */
+   optr = fmt_int( optr, star->nsu, 4);
+   optr = fmt_int( optr, star->epoc, 6);
+   optr = fmt_int( optr, star->mmag, 6);
+   optr = fmt_int( optr, star->sigp, 4);     /*  4  3 2  ; 48 52 55 */
+   optr = fmt_int( optr, star->nsm, 3);
+   optr = fmt_int( optr, star->ref, 2);
+   optr = fmt_int( optr, star->nit, 4);      /*  4  4 4 4; 57 61 65 69 */
+   optr = fmt_int( optr, star->niu, 4);
+   optr = fmt_int( optr, star->ngt, 4);
+   optr = fmt_int( optr, star->ngu, 4);
+   optr = fmt_int( optr, star->pmr, 6);      /*  6  6 4  ; 73 79 85 */
+   optr = fmt_int( optr, star->pmd, 6);
+   optr = fmt_int( optr, star->pme, 4);
+   optr = fmt_int( optr, star->mfm, 3);      /*  3  3 11; 89 92 95 */
+   optr = fmt_int( optr, star->mfa, 3);
+   optr = fmt_int( optr, star->id2, 11);
+   for( i = 0; i < 3; i++)                   /* 6 6 6; 106 112 118 */
+      optr = fmt_int( optr, star->twomass_mag[i], 6);
+   for( i = 0; i < 3; i++)                   /* 5 5 5; 124 129 134 */
+      optr = fmt_int( optr, star->twomass_mag_sigma[i], 5);
+   for( i = 0; i < 3; i++)                   /* 2 2 2: 139 141 143 */
+      optr = fmt_int( optr, star->icc_flag[i], 2);
+   for( i = 0; i < 3; i++)                   /* 2 2 2: 145 147 149 */
+      optr = fmt_int( optr, star->photo_flag[i], 2);
+   for( i = 0; i < 5; i++)          /* 6 6 6 6 6: 151 157 163 169 175 */
+      optr = fmt_int( optr, star->apass_mag[i], 6);
+   for( i = 0; i < 5; i++)          /* 5 5 5 5 5: 181 186 191 196 201 */
+      optr = fmt_int( optr, star->apass_mag_sigma[i], 5);
+   optr = fmt_int( optr, star->ann, 4);      /* 4 4: 206 210 (ending at 214) */
+   optr = fmt_int( optr, star->ano, 4);
+   if( output_format & 0x8)
+      {
+      *optr++ = ' ';
+      optr = fmt_int0( optr, zone, 3);
+      *optr++ = '-';
+      optr = fmt_int0( optr, offset, 6);
+      }
+   *optr++ = '\n';
+   fmt_end( optr);
    return( 0);
 }
 
@@ -121,55 +137,96 @@ static int write_urat1_star_fortran_style( const int zone, const long offset,
 int write_urat1_star( const int zone, const long offset, char *obuff,
                      const URAT1_STAR *star, const int output_format)
 {
+   char *optr = obuff;
    size_t i;
 
    if( output_format & URAT1_FORTRAN_STYLE)
       return( write_urat1_star_fortran_style( zone, offset, obuff, star,
                      output_format));
 
-   sprintf( obuff, "%03d-%06ld %12.8f %12.8f",
-               zone, offset,
-               (double)star->ra / 3600000., (double)star->spd / 3600000. - 90.);
-
-   sprintf( obuff + strlen( obuff), " %3d %3d %2d %2d %4d.%03d %2d.%03d %3d",
-               star->sigs, star->sigm,    /* two different posn sigmas */
-               star->nst, star->nsu,      /* total sets/n of sets used */
-               2000 + star->epoc / 1000, star->epoc % 1000,
-               star->mmag / 1000, abs( star->mmag % 1000),
-               star->sigp);
-
-   sprintf( obuff + strlen( obuff), " %2d %2d %3d %3d %2d %2d",
-               star->nsm,   /*  number of sets used for URAT magnitude  */
-               star->ref,   /*  largest reference star flag             */
-               star->nit,   /*  total number of images (observations)   */
-               star->niu,   /*  number of images used for mean position */
-               star->ngt,   /*  total number of 1st order grating obs.  */
-               star->ngu);  /*  number of 1st order grating pairs used  */
-
-   sprintf( obuff + strlen( obuff), " %5d %5d %4d %2d %2d %10d",
-        star->pmr,   /* proper motion RA*cosDec (from 2MASS)    */
-        star->pmd,   /* proper motion Dec                       */
-        star->pme,   /* proper motion error per coordinate      */
-        star->mfm,   /* match flag URAT with 2MASS              */
-        star->mfa,   /* match flag URAT with APASS              */
-        star->id2);  /* unique 2MASS star identification number */
+   optr = fmt_int0( optr, zone, 3);
+   *optr++ = '-';
+   optr = fmt_int0( optr, offset, 6);
+   *optr++ = ' ';
+   optr = fmt_mas_as_degrees( optr, star->ra, 12, 0);
+   *optr++ = ' ';
+   optr = fmt_mas_as_degrees( optr, (int64_t)star->spd - 90 * 3600000, 12, 0);
+
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->sigs, 3);   /* two different posn sigmas */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->sigm, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->nst, 2);    /* total sets/n of sets used */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->nsu, 2);
+   *optr++ = ' ';
+   optr = fmt_int( optr, 2000 + star->epoc / 1000, 4);
+   *optr++ = '.';
+   optr = fmt_int0( optr, star->epoc % 1000, 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mmag / 1000, 2);
+   *optr++ = '.';
+   optr = fmt_int0( optr, abs( star->mmag % 1000), 3);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->sigp, 3);
+
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->nsm, 2);  /* number of sets used for URAT mag */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->ref, 2);  /* largest reference star flag   */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->nit, 3);  /* total number of images (obs)  */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->niu, 3);  /* n images used for mean posn  */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->ngt, 2);  /* total 1st order grating obs.  */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->ngu, 2);  /* 1st order grating pairs used */
+
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->pmr, 5);  /* proper motion RA*cosDec       */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->pmd, 5);  /* proper motion Dec             */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->pme, 4);  /* proper motion error per coord */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mfm, 2);  /* match flag URAT with 2MASS    */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->mfa, 2);  /* match flag URAT with APASS    */
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->id2, 10); /* unique 2MASS star id number   */
 
    for( i = 0; i < 3; i++)
-      sprintf( obuff + strlen( obuff), " %2u.%03u %4d %02x %02x",
-               star->twomass_mag[i] / 1000,
-               star->twomass_mag[i] % 1000,
-               star->twomass_mag_sigma[i],
-               star->icc_flag[i],
-               star->photo_flag[i]);
+      {
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->twomass_mag[i] / 1000, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, star->twomass_mag[i] % 1000, 3);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->twomass_mag_sigma[i], 4);
+      *optr++ = ' ';          /* flags are written as %02x would do,  */
+      optr = fmt_hex0( optr,  /* i.e.,  negative ones come out as ints */
+                     (uint32_t)(int)star->icc_flag[i], 2);
+      *optr++ = ' ';
+      optr = fmt_hex0( optr, (uint32_t)(int)star->photo_flag[i], 2);
+      }
 
    for( i = 0; i < 5; i++)
-      sprintf( obuff + strlen( obuff), " %2u.%03u %4d",
-               star->apass_mag[i] / 1000,
-               star->apass_mag[i] % 1000,
-               star->apass_mag_sigma[i]);
+      {
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->apass_mag[i] / 1000, 2);
+      *optr++ = '.';
+      optr = fmt_int0( optr, star->apass_mag[i] % 1000, 3);
+      *optr++ = ' ';
+      optr = fmt_int( optr, star->apass_mag_sigma[i], 4);
+      }
 
-   sprintf( obuff + strlen( obuff), "%2d %2d\n",
-            star->ann, star->ano);
+   optr = fmt_int( optr, star->ann, 2);
+   *optr++ = ' ';
+   optr = fmt_int( optr, star->ano, 2);
+   *optr++ = '\n';
+   fmt_end( optr);
 
    if( output_format & URAT1_WRITE_SPACES)
       {
@@ -214,7 +271,8 @@ similarly looked for in various possible folders;  and the code will
 still work even if the index isn't found -- the result will just be
 a tiny bit slower. */
 
-static FILE *get_urat1_zone_file( const int zone_number, const char *path)
+static FILE *find_urat1_zone_file( const int zone_number, const char *path,
+                                   char *filename_used)
 {
    FILE *ifile;
    char filename[80];
@@ -222,8 +280,10 @@ static FILE *get_urat1_zone_file( const int zone_number, const char *path)
    sprintf( filename, "ur1%sz%03d", path_separator, zone_number);
             /* First,  look for file in current path: */
    ifile = fopen( filename + 4, read_only_permits);
-   if( !ifile)
-      ifile = fopen( filename, read_only_permits);
+   if( ifile)
+      strcpy( filename_used, filename + 4);
+   else if( (ifile = fopen( filename, read_only_permits)) != NULL)
+      strcpy( filename_used, filename);
          /* If file isn't there,  use the 'path' passed in as an argument: */
    if( !ifile && *path)
       {
@@ -239,14 +299,24 @@ static FILE *get_urat1_zone_file( const int zone_number, const char *path)
          strcpy( endptr, filename + 4 * (1 - i));
          ifile = fopen( filename2, read_only_permits);
          }
+      if( ifile)
+         strcpy( filename_used, filename2);
       }
    return( ifile);
 }
 
+static FILE *get_urat1_zone_file( const int zone_number, const char *path)
+{
+   char filename[80];
+
+   return( find_urat1_zone_file( zone_number, path, filename));
+}
+
 #define URAT1_FILE_NOT_FOUND        -1
 #define URAT1_BAD_ZONE_NUMBER       -2
 #define URAT1_BAD_OFFSET            -3
 #define URAT1_FREAD_FAILED          -4
+#define URAT1_ALLOC_FAILED          -5
 
 int extract_urat1_info( const int zone, const long offset, URAT1_STAR *star,
                      const char *path)
@@ -282,6 +352,99 @@ int extract_urat1_info( const int zone, const long offset, URAT1_STAR *star,
    return( rval);
 }
 
+static long read_bulk_urat1_stars( void *context, const int zone,
+                  const long offset, const size_t n_stars, void *buff)
+{
+   bulk_reader_t *r = (bulk_reader_t *)context;
+   URAT1_STAR *stars = (URAT1_STAR *)buff;
+   size_t n_read;
+
+   if( zone != r->zone)
+      {
+      if( r->ifile)
+         fclose( r->ifile);
+      r->ifile = NULL;
+      if( zone >= 1 && zone <= 900)
+         r->ifile = get_urat1_zone_file( zone, r->path);
+      r->zone = zone;
+      }
+   if( zone < 1 || zone > 900)
+      return( URAT1_BAD_ZONE_NUMBER);
+   if( !r->ifile)
+      return( URAT1_FILE_NOT_FOUND);
+   if( offset < 1
+          || fseek( r->ifile, (offset - 1) * sizeof( URAT1_STAR), SEEK_SET))
+      return( URAT1_BAD_OFFSET);
+   n_read = fread( stars, sizeof( URAT1_STAR), n_stars, r->ifile);
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   {
+   size_t i;
+
+   for( i = 0; i < n_read; i++)
+      flip_urat1_star( stars + i);
+   }
+#endif
+#endif
+   return( (long)n_read);
+}
+
+int extract_urat1_info_bulk( const size_t n_stars, const int *zones,
+                  const long *offsets, URAT1_STAR *stars, int *rvals,
+                  const char *path)
+{
+   bulk_reader_t r;
+   int rval;
+
+   r.path = path;
+   r.ifile = NULL;
+   r.zone = 0;
+   rval = run_bulk_requests( n_stars, zones, offsets, stars,
+                  sizeof( URAT1_STAR), rvals, URAT1_FREAD_FAILED,
+                  &r, read_bulk_urat1_stars);
+   if( r.ifile)
+      fclose( r.ifile);
+   return( rval == BULK_REQ_ALLOC_FAILED ? URAT1_ALLOC_FAILED : rval);
+}
+
+/* for_each_urat1_star_in_zone() reads through the zone with the bulk
+reader above;  see run_zone_loop() in 'bulk_req.h'.  */
+
+typedef struct
+   {
+   void *context;
+   int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *);
+   } zone_loop_t;
+
+static int pass_urat1_star( void *context, const int zone, const long offset,
+                  const void *star)
+{
+   zone_loop_t *z = (zone_loop_t *)context;
+
+   return( z->callback_fn( z->context, zone, (uint32_t)offset,
+                  (const URAT1_STAR *)star));
+}
+
+int for_each_urat1_star_in_zone( const int zone, const char *path,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *))
+{
+   bulk_reader_t r;
+   zone_loop_t z;
+   int rval;
+
+   r.path = path;
+   r.ifile = NULL;
+   r.zone = 0;
+   z.context = context;
+   z.callback_fn = callback_fn;
+   rval = run_zone_loop( zone, sizeof( URAT1_STAR), &r, read_bulk_urat1_stars,
+                  &z, pass_urat1_star, URAT1_ALLOC_FAILED);
+   if( r.ifile)
+      fclose( r.ifile);
+   return( rval);
+}
+
 /* This looks for the index file v1index.unf first in the current
 directory;  then in 'path';  then in the ur1 subdirectory under 'path'.
 One of the three will probably work... */
@@ -326,6 +489,192 @@ static long get_index_file_offset( const int zone, const int ra_start)
    return( rval * sizeof( int32_t));
 }
 
+#define URAT1_N_ZONES            900
+#define URAT1_INDEX_RA_BINS     1440      /* = .25 degrees */
+#define URAT1_BUFFSIZE           400      /* read this many stars at a try */
+
+/* A catalog keeps the index in memory,  so that finding where an RA bin
+starts and ends is just arithmetic.  The first half of v1index.unf is
+1440 sets of 900 cumulative counts (see the note below);  we rearrange
+that by zone,  with an extra zero at the start of each,  so that the
+(start, end) offsets for bin 'b' of a zone are entries b and b+1.
+That's 1441 entries per zone,  about 5.2 MBytes in all.  (The second
+half of the file,  giving the number of stars in each bin,  doesn't
+tell us anything the first half doesn't.)
+
+   Catalogs can be cloned for use in other threads;  the clone shares
+the index,  but has its own star buffer (and index file,  if the index
+couldn't be loaded).  Zone files used by the callback extractor are
+memory-mapped when first needed,  and stay mapped until the catalog is
+closed.  */
+
+#define URAT1_ZONE_INDEX_SIZE    (URAT1_INDEX_RA_BINS + 1)
+
+struct urat1_catalog
+   {
+   char *path;
+   const uint32_t *index;  /* NULL if the index wasn't (or couldn't be) loaded */
+   uint32_t *loaded_index;       /* NULL for clones */
+   FILE *index_file;    /* used only if 'index' is NULL */
+   long cached_index_data[3];    /* last entry read from 'index_file' */
+   URAT1_STAR *stars;            /* buffer of URAT1_BUFFSIZE stars */
+   const URAT1_STAR *mapped_zone[URAT1_N_ZONES];
+   size_t mapped_size[URAT1_N_ZONES];
+   unsigned long last_used[URAT1_N_ZONES];   /* for unmapping old zones */
+   unsigned long use_count;
+   int n_mapped;
+   char zone_missing[URAT1_N_ZONES];
+   int scan_stopped;             /* set when a callback asks us to stop */
+   };
+
+static uint32_t *load_urat1_index( FILE *index_file)
+{
+   uint32_t *index = (uint32_t *)malloc( URAT1_N_ZONES
+                            * URAT1_ZONE_INDEX_SIZE * sizeof( uint32_t));
+   uint32_t row[URAT1_N_ZONES];
+   int bin, zone;
+
+   if( index)
+      {
+      fseek( index_file, 0L, SEEK_SET);
+      for( zone = 0; zone < URAT1_N_ZONES; zone++)
+         index[zone * URAT1_ZONE_INDEX_SIZE] = 0;
+      for( bin = 0; bin < URAT1_INDEX_RA_BINS && index; bin++)
+         if( fread( row, sizeof( uint32_t), URAT1_N_ZONES, index_file)
+                              != URAT1_N_ZONES)
+            {
+            free( index);        /* short index;  just don't use it */
+            index = NULL;
+            }
+         else
+            for( zone = 0; zone < URAT1_N_ZONES; zone++)
+               index[zone * URAT1_ZONE_INDEX_SIZE + bin + 1] = row[zone];
+      }
+   return( index);
+}
+
+#define INDEX_NOT_USED             0
+#define INDEX_READ_AS_NEEDED       1
+#define INDEX_LOADED               2
+
+static urat1_catalog_t *init_urat1_catalog( const char *path,
+                                            const int index_usage)
+{
+   urat1_catalog_t *cat = (urat1_catalog_t *)calloc( 1,
+                                             sizeof( urat1_catalog_t));
+
+   if( cat)
+      {
+      cat->path = (char *)malloc( strlen( path) + 1);
+      cat->stars = (URAT1_STAR *)calloc( URAT1_BUFFSIZE, sizeof( URAT1_STAR));
+      if( !cat->path || !cat->stars)
+         {
+         free( cat->path);
+         free( cat->stars);
+         free( cat);
+         return( NULL);
+         }
+      strcpy( cat->path, path);
+      cat->cached_index_data[0] = -1L;
+      if( index_usage != INDEX_NOT_USED)
+         cat->index_file = get_urat1_index_file( path);
+      if( cat->index_file && index_usage == INDEX_LOADED)
+         {
+         cat->index = cat->loaded_index = load_urat1_index( cat->index_file);
+         if( cat->index)
+            {
+            fclose( cat->index_file);
+            cat->index_file = NULL;
+            }
+         }
+      }
+   return( cat);
+}
+
+urat1_catalog_t *open_urat1_catalog( const char *path)
+{
+   return( init_urat1_catalog( path, INDEX_LOADED));
+}
+
+void close_urat1_catalog( urat1_catalog_t *cat)
+{
+   if( cat)
+      {
+      int i;
+
+      for( i = 0; i < URAT1_N_ZONES; i++)
+         if( cat->mapped_zone[i])
+            unmap_file( cat->mapped_zone[i], cat->mapped_size[i]);
+      if( cat->index_file)
+         fclose( cat->index_file);
+      free( cat->loaded_index);
+      free( cat->stars);
+      free( cat->path);
+      free( cat);
+      }
+}
+
+/* A clone for use in another thread.  It shares the parent's index (so
+it mustn't outlive the parent),  or gets its own index file if the
+parent's index isn't in memory. */
+
+static urat1_catalog_t *clone_urat1_catalog( const urat1_catalog_t *cat)
+{
+   urat1_catalog_t *rval = init_urat1_catalog( cat->path,
+                  cat->index ? INDEX_NOT_USED : INDEX_READ_AS_NEEDED);
+
+   if( rval)
+      rval->index = cat->index;        /* shared,  not owned */
+   return( rval);
+}
+
+/* Sets the range of offsets within a zone for an RA bin,  either from the
+in-memory index or by reading v1index.unf.  Returns -1 if we've no index
+at all,  in which case the whole zone must be searched. */
+
+static int get_bin_range( urat1_catalog_t *cat, const int zone,
+                          const int ra_start, long *offset, long *end_offset)
+{
+   const long index_file_offset = get_index_file_offset( zone, ra_start);
+   uint32_t loc;
+   size_t count;
+
+   if( cat->index)
+      {
+      const uint32_t *zone_index = cat->index
+                                 + (zone - 1) * URAT1_ZONE_INDEX_SIZE;
+
+      *offset = (long)zone_index[ra_start];
+      *end_offset = (long)zone_index[ra_start + 1];
+      return( 0);
+      }
+   if( !cat->index_file)
+      return( -1);
+   if( index_file_offset == cat->cached_index_data[0])
+      {
+      *offset = cat->cached_index_data[1];
+      *end_offset = cat->cached_index_data[2];
+      return( 0);
+      }
+   cat->cached_index_data[0] = index_file_offset;
+   if( !ra_start)
+      *offset = 0;
+   else
+      {
+      fseek( cat->index_file,
+                  index_file_offset - 900 * sizeof( int32_t), SEEK_SET);
+      count = fread( &loc, sizeof( int32_t), 1, cat->index_file);
+      assert( count == 1);
+      *offset = (long)loc;
+      }
+   cat->cached_index_data[1] = *offset;
+   fseek( cat->index_file, index_file_offset, SEEK_SET);
+   count = fread( &loc, sizeof( int32_t), 1, cat->index_file);
+   assert( count == 1);
+   cat->cached_index_data[2] = *end_offset = (long)loc;
+   return( 0);
+}
+
 /* RA, dec, width, height are in degrees */
 
 /* A note on indexing:  within each zone,  we want to locate the stars
@@ -362,172 +711,548 @@ the end of that block.  This leaves us,  on average,  with only
 1/1440 of the zone file to search.  (In practice,  I don't think
 it makes a lot of difference,  but doing the binary search in a
 smaller section of the zone file may speed matters up slightly.)
+With a catalog opened by open_urat1_catalog(),  the index is already
+in memory (see above),  and none of this file-reading is needed.
 */
 
-int extract_urat1_stars( FILE *ofile, const double ra, const double dec,
-                  const double width, const double height, const char *path,
-                  const int output_format)
+typedef int (*urat1_callback_fn)( void *, const int, const uint32_t,
+                                  const URAT1_STAR *);
+
+/* Extracts stars from one zone.  Returns the number of stars found.
+They go to 'sink' or,  if 'callback_fn' isn't NULL,  to the callback
+(see extract_urat1_zone_callback() below).  */
+
+static int extract_urat1_zone( urat1_catalog_t *cat, out_sink_t *sink,
+                  const int zone, const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format,
+                  void *context, urat1_callback_fn callback_fn)
 {
    const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
    const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
-   const double zone_height = .2;    /* zones are .2 degrees each */
-   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
-   const int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
-   const int index_ra_resolution = 1440;  /* = .25 degrees */
+   const int index_ra_resolution = URAT1_INDEX_RA_BINS;
    int ra_start = (int)( ra1 * (double)index_ra_resolution / 360.);
+   const int buffsize = URAT1_BUFFSIZE;
+   URAT1_STAR *stars = cat->stars;
+   FILE *ifile = get_urat1_zone_file( zone, cat->path);
    int rval = 0;
-   const int buffsize = 400;     /* read this many stars at a try */
-   FILE *index_file = get_urat1_index_file( path);
-   URAT1_STAR *stars = (URAT1_STAR *)calloc( buffsize, sizeof( URAT1_STAR));
 
-   if( !stars)
-      rval = -1;
-   if( zone < 1)
-      zone = 1;
    if( ra_start < 0)
       ra_start = 0;
-   while( rval >= 0 && zone <= end_zone)
+   if( ra_start >= index_ra_resolution)
+      ra_start = index_ra_resolution - 1;
+   if( ifile)
       {
-      FILE *ifile = get_urat1_zone_file( zone, path);
+      int keep_going = 1;
+      int i, n_read;
+      const int32_t max_ra  = (int32_t)( ra2 * 3600. * 1000.);
+      const int32_t min_ra  = (int32_t)( ra1 * 3600. * 1000.);
+      const int32_t min_spd = (int32_t)( (dec1 + 90.) * 3600. * 1000.);
+      const int32_t max_spd = (int32_t)( (dec2 + 90.) * 3600. * 1000.);
+      long offset, end_offset;
+      const long acceptable_limit = 40;
+      const uint32_t ra_range = (uint32_t)( 360 * 3600 * 1000);
+      uint32_t ra_lo = (uint32_t)( ra_start * (ra_range / index_ra_resolution));
+      uint32_t ra_hi = ra_lo + ra_range / index_ra_resolution;
 
-      if( ifile)
+      if( get_bin_range( cat, zone, ra_start, &offset, &end_offset))
+         {     /* no index:  binary-search within entire zone: */
+         offset = 0;
+         fseek( ifile, 0L, SEEK_END);
+         end_offset = ftell( ifile) / sizeof( URAT1_STAR);
+         ra_lo = 0;
+         ra_hi = ra_range;
+         }
+                  /* Secant-search within the known limits: */
+      while( end_offset - offset > acceptable_limit)
          {
-         int keep_going = 1;
-         int i, n_read;
-         const int32_t max_ra  = (int32_t)( ra2 * 3600. * 1000.);
-         const int32_t min_ra  = (int32_t)( ra1 * 3600. * 1000.);
-         const int32_t min_spd = (int32_t)( (dec1 + 90.) * 3600. * 1000.);
-         const int32_t max_spd = (int32_t)( (dec2 + 90.) * 3600. * 1000.);
-         long offset, end_offset;
-         const long acceptable_limit = 40;
-         long index_file_offset = get_index_file_offset( zone, ra_start);
-         static long cached_index_data[3] = {-1L, 0L, 0L};
-         const uint32_t ra_range = (uint32_t)( 360 * 3600 * 1000);
-         uint32_t ra_lo = (uint32_t)( ra_start * (ra_range / index_ra_resolution));
-         uint32_t ra_hi = ra_lo + ra_range / index_ra_resolution;
-
-         if( index_file_offset == cached_index_data[0])
+         size_t count;
+         URAT1_STAR star;
+         long delta = end_offset - offset, toffset;
+         long minimum_bite = delta / 8 + 1;
+         long tval = (long)( (int64_t)delta * (int64_t)( min_ra - ra_lo)
+                       / (int64_t)( ra_hi - ra_lo));
+                           /* the above could overflow 32 bits */
+
+         if( tval < minimum_bite)
+            tval = minimum_bite;
+         else if( tval > delta - minimum_bite)
+            tval = delta - minimum_bite;
+         toffset = offset + (uint32_t)tval;
+         fseek( ifile, toffset * sizeof( URAT1_STAR), SEEK_SET);
+         count = fread( &star, sizeof( URAT1_STAR), 1, ifile);
+         assert( count == 1);
+         if( star.ra < min_ra)
             {
-            offset = cached_index_data[1];
-            end_offset = cached_index_data[2];
+            offset = toffset;
+            ra_lo = star.ra;
             }
          else
             {
-            if( index_file)
-               {
-               uint32_t loc;
-               size_t count;
-
-               cached_index_data[0] = index_file_offset;
-               if( !ra_start)
-                  offset = 0;
-               else
-                  {
-                  fseek( index_file,
-                              index_file_offset - 900 * sizeof( int32_t),
-                              SEEK_SET);
-                  count = fread( &loc, sizeof( int32_t), 1, index_file);
-                  assert( count == 1);
-                  offset = (long)loc;
-                  }
-               cached_index_data[1] = offset;
-               fseek( index_file, index_file_offset, SEEK_SET);
-               count = fread( &loc, sizeof( int32_t), 1, index_file);
-               assert( count == 1);
-               cached_index_data[2] = end_offset = (long)loc;
-               }
-            else     /* no index:  binary-search within entire zone: */
-               {
-               offset = 0;
-               fseek( ifile, 0L, SEEK_END);
-               end_offset = ftell( ifile) / sizeof( URAT1_STAR);
-               ra_lo = 0;
-               ra_hi = ra_range;
-               }
+            end_offset = toffset;
+            ra_hi = star.ra;
             }
-                     /* Secant-search within the known limits: */
-         while( end_offset - offset > acceptable_limit)
-            {
-            size_t count;
-            URAT1_STAR star;
-            long delta = end_offset - offset, toffset;
-            long minimum_bite = delta / 8 + 1;
-            long tval = (long)( (int64_t)delta * (int64_t)( min_ra - ra_lo)
-                          / (int64_t)( ra_hi - ra_lo));
-                              /* the above could overflow 32 bits */
-
-            if( tval < minimum_bite)
-               tval = minimum_bite;
-            else if( tval > delta - minimum_bite)
-               tval = delta - minimum_bite;
-            toffset = offset + (uint32_t)tval;
-            fseek( ifile, toffset * sizeof( URAT1_STAR), SEEK_SET);
-            count = fread( &star, sizeof( URAT1_STAR), 1, ifile);
-            assert( count == 1);
-            if( star.ra < min_ra)
-               {
-               offset = toffset;
-               ra_lo = star.ra;
-               }
-            else
-               {
-               end_offset = toffset;
-               ra_hi = star.ra;
-               }
-            }
-         fseek( ifile, offset * sizeof( URAT1_STAR), SEEK_SET);
+         }
+      fseek( ifile, offset * sizeof( URAT1_STAR), SEEK_SET);
 
-         while( (n_read = (int)fread( stars, sizeof( URAT1_STAR), buffsize, ifile)) > 0
-                                                   && keep_going)
-            for( i = 0; i < n_read && keep_going; i++)
-               {
-               URAT1_STAR star = stars[i];
+      while( (n_read = (int)fread( stars, sizeof( URAT1_STAR), buffsize, ifile)) > 0
+                                                && keep_going)
+         for( i = 0; i < n_read && keep_going; i++)
+            {
+            URAT1_STAR star = stars[i];
 
 #ifdef __BYTE_ORDER
 #if __BYTE_ORDER == __BIG_ENDIAN
-               flip_urat1_star( &star);
+            flip_urat1_star( &star);
 #endif
 #endif
-               if( star.ra > max_ra)
-                  keep_going = 0;
-               else if( star.ra > min_ra && star.spd > min_spd
-                                           && star.spd < max_spd)
+            if( star.ra > max_ra)
+               keep_going = 0;
+            else if( star.ra > min_ra && star.spd > min_spd
+                                        && star.spd < max_spd)
+               {
+               int err = 0;
+
+               if( callback_fn)
                   {
-                  rval++;
-                  if( ofile)
+                  if( callback_fn( context, zone, (uint32_t)offset, &star))
                      {
-                     if( output_format & URAT1_RAW_BINARY)
-                        fwrite( &star, 1, sizeof( URAT1_STAR), ofile);
-                     else
-                        {
-                        char buff[URAT1_ASCII_SIZE];
+                     cat->scan_stopped = 1;
+                     keep_going = 0;
+                     }
+                  }
+               else if( sink)
+                  {
+                  if( output_format & URAT1_RAW_BINARY)
+                     err = sink_write( sink, &star, sizeof( URAT1_STAR));
+                  else
+                     {
+                     char *buff = sink_reserve( sink, URAT1_ASCII_SIZE);
 
+                     if( buff)
+                        {
                         write_urat1_star( zone, offset + 1, buff, &star,
-                                                      output_format);
-                        fwrite( buff, 1, strlen( buff), ofile);
+                                                   output_format);
+                        sink_commit( sink, strlen( buff));
                         }
+                     else
+                        err = -1;
                      }
                   }
-               offset++;
+               if( err)          /* sink failed;  its error is sticky, */
+                  keep_going = 0;   /* and shows up when it's closed */
+               else
+                  rval++;
                }
-         fclose( ifile);
-         }
+            offset++;
+            }
+      fclose( ifile);
+      }
+   return( rval);
+}
+
+int extract_urat1_stars_from_catalog( urat1_catalog_t *cat,
+                  out_sink_t *sink, const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format)
+{
+   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
+   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
+   const double zone_height = .2;    /* zones are .2 degrees each */
+   int zone = (int)( (dec1  + 90.) / zone_height) + 1;
+   int end_zone = (int)( (dec2 + 90.) / zone_height) + 1;
+   int rval = 0;
+
+   if( zone < 1)
+      zone = 1;
+   if( end_zone > URAT1_N_ZONES)
+      end_zone = URAT1_N_ZONES;
+   while( zone <= end_zone)
+      {
+      rval += extract_urat1_zone( cat, sink, zone, ra, dec, width, height,
+                                  output_format, NULL, NULL);
       zone++;
       }
-   if( index_file)
-      fclose( index_file);
-   free( stars);
 
             /* We need some special handling for cases where the area
                to be extracted crosses RA=0 or RA=24: */
-   if( rval >= 0 && ra > 0. && ra < 360.)
+   if( ra >= 0. && ra < 360.)
       {
       if( ra1 < 0.)      /* left side crosses over RA=0h */
-         rval += extract_urat1_stars( ofile, ra+360., dec, width, height,
-                                          path, output_format);
+         rval += extract_urat1_stars_from_catalog( cat, sink, ra+360., dec,
+                                          width, height, output_format);
       if( ra2 > 360.)    /* right side crosses over RA=24h */
-         rval += extract_urat1_stars( ofile, ra-360., dec, width, height,
+         rval += extract_urat1_stars_from_catalog( cat, sink, ra-360., dec,
+                                          width, height, output_format);
+      }
+   return( rval);
+}
+
+/* Each job is one zone of one piece of the rectangle (two or three
+pieces if it crosses RA=0),  in the order extract_urat1_stars_from_catalog()
+does them.  Each thread gets its own clone of the catalog.  */
+
+typedef struct
+   {
+   urat1_catalog_t **cats;
+   double piece_ra[3], dec, width, height;
+   int first_zone, n_zones, output_format;
+   } urat1_par_t;
+
+static int urat1_zone_job( void *context, const int thread_num,
+                           const int job_num, out_sink_t *sink)
+{
+   const urat1_par_t *p = (const urat1_par_t *)context;
+
+   return( extract_urat1_zone( p->cats[thread_num], sink,
+               p->first_zone + job_num % p->n_zones,
+               p->piece_ra[job_num / p->n_zones], p->dec, p->width, p->height,
+               p->output_format, NULL, NULL));
+}
+
+int extract_urat1_stars_parallel( urat1_catalog_t *cat, out_sink_t *sink,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format, const int n_threads)
+{
+   const double zone_height = .2;    /* zones are .2 degrees each */
+   int last_zone = (int)( (dec + height / 2. + 90.) / zone_height) + 1;
+   int i, n_pieces = 1, n_cats, rval;
+   urat1_par_t p;
+
+   p.first_zone = (int)( (dec - height / 2. + 90.) / zone_height) + 1;
+   if( p.first_zone < 1)
+      p.first_zone = 1;
+   if( last_zone > URAT1_N_ZONES)
+      last_zone = URAT1_N_ZONES;
+   p.n_zones = last_zone - p.first_zone + 1;
+   if( p.n_zones <= 0)
+      return( 0);
+   p.piece_ra[0] = ra;
+   if( ra >= 0. && ra < 360.)
+      {
+      if( ra - width / 2. < 0.)
+         p.piece_ra[n_pieces++] = ra + 360.;
+      if( ra + width / 2. > 360.)
+         p.piece_ra[n_pieces++] = ra - 360.;
+      }
+   p.dec = dec;
+   p.width = width;
+   p.height = height;
+   p.output_format = output_format;
+   n_cats = (n_threads > 1 ? n_threads : 1);
+   p.cats = (urat1_catalog_t **)calloc( n_cats, sizeof( urat1_catalog_t *));
+   if( !p.cats)
+      return( -1);
+   p.cats[0] = cat;
+   for( i = 1; i < n_cats; i++)
+      if( (p.cats[i] = clone_urat1_catalog( cat)) == NULL)
+         n_cats = i;       /* out of memory;  just use fewer threads */
+   rval = run_ordered_jobs( sink, n_pieces * p.n_zones, n_cats, &p,
+                            urat1_zone_job);
+   for( i = 1; i < n_cats; i++)
+      close_urat1_catalog( p.cats[i]);
+   free( p.cats);
+   return( rval);
+}
+
+/* The callback extractor works directly on the memory-mapped zone files :
+the secant search probes the mapping,  and the callback gets a pointer
+into it,  so no stars are copied at all.  (Except on big-endian machines,
+where each star has to be copied and flipped first.)  Zones stay mapped
+until the catalog is closed,  or until more than URAT1_MAX_MAPPED_ZONES
+(each about 20 MBytes) would be mapped;  then the least recently used
+one is unmapped.  Where mapping is only emulated by reading the whole
+file (see 'mem_map.h'),  the usual fread() code is used instead.  */
+
+#define URAT1_MAX_MAPPED_ZONES     32
+
+#ifndef MEM_MAP_EMULATED
+static void unmap_least_recently_used_zone( urat1_catalog_t *cat)
+{
+   int i, idx = -1;
+
+   for( i = 0; i < URAT1_N_ZONES; i++)
+      if( cat->mapped_zone[i] && (idx < 0
+                  || cat->last_used[i] < cat->last_used[idx]))
+         idx = i;
+   if( idx >= 0)
+      {
+      unmap_file( cat->mapped_zone[idx], cat->mapped_size[idx]);
+      cat->mapped_zone[idx] = NULL;
+      cat->mapped_size[idx] = 0;
+      cat->n_mapped--;
+      }
+}
+
+static const URAT1_STAR *map_urat1_zone( urat1_catalog_t *cat,
+                                  const int zone, long *n_stars)
+{
+   const int idx = zone - 1;
+
+   if( !cat->mapped_zone[idx] && !cat->zone_missing[idx])
+      {
+      char filename[80];
+      FILE *ifile = find_urat1_zone_file( zone, cat->path, filename);
+
+      if( ifile)
+         {
+         fclose( ifile);
+         while( cat->n_mapped >= URAT1_MAX_MAPPED_ZONES)
+            unmap_least_recently_used_zone( cat);
+         cat->mapped_zone[idx] = (const URAT1_STAR *)map_file_into_memory(
+                                 filename, cat->mapped_size + idx);
+         }
+      if( cat->mapped_zone[idx])
+         cat->n_mapped++;
+      else
+         cat->zone_missing[idx] = 1;
+      }
+   cat->last_used[idx] = ++cat->use_count;
+   *n_stars = (long)( cat->mapped_size[idx] / sizeof( URAT1_STAR));
+   return( cat->mapped_zone[idx]);
+}
+
+static int32_t mapped_ra( const URAT1_STAR *star)
+{
+   int32_t rval = star->ra;
+
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+   swap_32( &rval);
+#endif
+#endif
+   return( rval);
+}
+
+static int extract_mapped_urat1_zone( urat1_catalog_t *cat, const int zone,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  void *context, urat1_callback_fn callback_fn)
+{
+   const double dec1 = dec - height / 2., dec2 = dec + height / 2.;
+   const double ra1 = ra - width / 2., ra2 = ra + width / 2.;
+   const int index_ra_resolution = URAT1_INDEX_RA_BINS;
+   int ra_start = (int)( ra1 * (double)index_ra_resolution / 360.);
+   const int32_t max_ra  = (int32_t)( ra2 * 3600. * 1000.);
+   const int32_t min_ra  = (int32_t)( ra1 * 3600. * 1000.);
+   const int32_t min_spd = (int32_t)( (dec1 + 90.) * 3600. * 1000.);
+   const int32_t max_spd = (int32_t)( (dec2 + 90.) * 3600. * 1000.);
+   const uint32_t ra_range = (uint32_t)( 360 * 3600 * 1000);
+   const long acceptable_limit = 40;
+   long n_stars, offset, end_offset;
+   const URAT1_STAR *stars = map_urat1_zone( cat, zone, &n_stars);
+   uint32_t ra_lo, ra_hi;
+   int rval = 0;
+
+   if( !stars)
+      return( 0);
+   if( ra_start < 0)
+      ra_start = 0;
+   if( ra_start >= index_ra_resolution)
+      ra_start = index_ra_resolution - 1;
+   ra_lo = (uint32_t)( ra_start * (ra_range / index_ra_resolution));
+   ra_hi = ra_lo + ra_range / index_ra_resolution;
+   if( get_bin_range( cat, zone, ra_start, &offset, &end_offset))
+      {     /* no index:  binary-search within entire zone: */
+      offset = 0;
+      end_offset = n_stars;
+      ra_lo = 0;
+      ra_hi = ra_range;
+      }
+   if( end_offset > n_stars)     /* index doesn't match the data */
+      end_offset = n_stars;
+   if( offset > end_offset)
+      offset = end_offset;
+                  /* Secant-search within the known limits: */
+   while( end_offset - offset > acceptable_limit)
+      {
+      long delta = end_offset - offset, toffset;
+      long minimum_bite = delta / 8 + 1;
+      long tval = (long)( (int64_t)delta * (int64_t)( min_ra - ra_lo)
+                    / (int64_t)( ra_hi - ra_lo));
+      int32_t star_ra;
+
+      if( tval < minimum_bite)
+         tval = minimum_bite;
+      else if( tval > delta - minimum_bite)
+         tval = delta - minimum_bite;
+      toffset = offset + (uint32_t)tval;
+      star_ra = mapped_ra( stars + toffset);
+      if( star_ra < min_ra)
+         {
+         offset = toffset;
+         ra_lo = star_ra;
+         }
+      else
+         {
+         end_offset = toffset;
+         ra_hi = star_ra;
+         }
+      }
+
+   for( ; offset < n_stars && !cat->scan_stopped; offset++)
+      {
+      const URAT1_STAR *star = stars + offset;
+#ifdef __BYTE_ORDER
+#if __BYTE_ORDER == __BIG_ENDIAN
+      URAT1_STAR flipped = *star;
+
+      flip_urat1_star( &flipped);
+      star = &flipped;
+#endif
+#endif
+      if( star->ra > max_ra)
+         break;
+      if( star->ra > min_ra && star->spd > min_spd && star->spd < max_spd)
+         {
+         rval++;
+         if( callback_fn( context, zone, (uint32_t)offset, star))
+            cat->scan_stopped = 1;
+         }
+      }
+   return( rval);
+}
+
+#endif      /* #ifndef MEM_MAP_EMULATED */
+
+static int extract_urat1_zone_callback( urat1_catalog_t *cat, const int zone,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  void *context, urat1_callback_fn callback_fn)
+{
+#ifdef MEM_MAP_EMULATED
+   return( extract_urat1_zone( cat, NULL, zone, ra, dec, width, height, 0,
+                               context, callback_fn));
+#else
+   return( extract_mapped_urat1_zone( cat, zone, ra, dec, width, height,
+                                      context, callback_fn));
+#endif
+}
+
+static int extract_urat1_callback_stars( urat1_catalog_t *cat,
+                  void *context, urat1_callback_fn callback_fn,
+                  const double ra, const double dec,
+                  const double width, const double height)
+{
+   const double zone_height = .2;    /* zones are .2 degrees each */
+   int zone = (int)( (dec - height / 2. + 90.) / zone_height) + 1;
+   int end_zone = (int)( (dec + height / 2. + 90.) / zone_height) + 1;
+   int rval = 0;
+
+   if( zone < 1)
+      zone = 1;
+   if( end_zone > URAT1_N_ZONES)
+      end_zone = URAT1_N_ZONES;
+   for( ; zone <= end_zone && !cat->scan_stopped; zone++)
+      rval += extract_urat1_zone_callback( cat, zone, ra, dec, width, height,
+                                           context, callback_fn);
+
+            /* Handle areas crossing RA=0,  as elsewhere: */
+   if( ra >= 0. && ra < 360.)
+      {
+      if( ra - width / 2. < 0.)
+         rval += extract_urat1_callback_stars( cat, context, callback_fn,
+                                          ra + 360., dec, width, height);
+      if( ra + width / 2. > 360.)
+         rval += extract_urat1_callback_stars( cat, context, callback_fn,
+                                          ra - 360., dec, width, height);
+      }
+   return( rval);
+}
+
+int extract_urat1_stars_callback_from_catalog( urat1_catalog_t *cat,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height)
+{
+   cat->scan_stopped = 0;
+   return( extract_urat1_callback_stars( cat, context, callback_fn,
+                                       ra, dec, width, height));
+}
+
+/* As above,  but for just one zone of the rectangle (including any piece
+of it on the far side of RA=0). */
+
+int extract_urat1_zone_stars_callback( urat1_catalog_t *cat, const int zone,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height)
+{
+   int rval;
+
+   if( zone < 1 || zone > URAT1_N_ZONES)
+      return( URAT1_BAD_ZONE_NUMBER);
+   cat->scan_stopped = 0;
+   rval = extract_urat1_zone_callback( cat, zone, ra, dec, width, height,
+                                       context, callback_fn);
+   if( ra >= 0. && ra < 360.)
+      {
+      if( ra - width / 2. < 0.)
+         rval += extract_urat1_zone_callback( cat, zone, ra + 360., dec,
+                                 width, height, context, callback_fn);
+      if( ra + width / 2. > 360.)
+         rval += extract_urat1_zone_callback( cat, zone, ra - 360., dec,
+                                 width, height, context, callback_fn);
+      }
+   return( rval);
+}
+
+/* The original,  handle-less API.  These make a catalog for the duration
+of the call,  reading the index as needed rather than loading all of it
+(which would take longer than a typical extraction).  */
+
+int extract_urat1_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int output_format)
+{
+   urat1_catalog_t *cat = init_urat1_catalog( path, INDEX_READ_AS_NEEDED);
+   int rval = -1;
+
+   if( cat)
+      {
+      rval = extract_urat1_stars_from_catalog( cat, sink, ra, dec,
+                              width, height, output_format);
+      close_urat1_catalog( cat);
+      }
+   return( rval);
+}
+
+int extract_urat1_stars_callback( void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height, const char *path)
+{
+   urat1_catalog_t *cat = init_urat1_catalog( path, INDEX_READ_AS_NEEDED);
+   int rval = URAT1_ALLOC_FAILED;
+
+   if( cat)
+      {
+      rval = extract_urat1_stars_callback_from_catalog( cat, context,
+                  callback_fn, ra, dec, width, height);
+      close_urat1_catalog( cat);
+      }
+   return( rval);
+}
+
+int extract_urat1_stars( FILE *ofile, const double ra, const double dec,
+                  const double width, const double height, const char *path,
+                  const int output_format)
+{
+   out_sink_t *sink = (ofile ? open_file_sink( ofile) : NULL);
+   int rval = -1;
+
+   if( sink || !ofile)
+      rval = extract_urat1_stars_to_sink( sink, ra, dec, width, height,
                                           path, output_format);
+   if( sink)
+      {
+      const int err = close_sink( sink);
+
+      if( err)          /* write errors only show up now */
+         rval = err;
       }
    return( rval);
 }
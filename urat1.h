@@ -5,6 +5,7 @@
 pluto (at) projectpluto.com with comments/bug fixes.  */
 
 #include <stdint.h>
+#include "out_sink.h"
 
       /* Raw structures are read herein,  so the following structure  */
       /* must be packed on byte boundaries:                           */
@@ -89,8 +90,79 @@ int extract_urat1_stars( FILE *ofile, const double ra, const double dec,
                   const double width, const double height, const char *path,
                   const int output_format);
 
+         /* Same,  except output goes to an 'out_sink_t' ('out_sink.h'), */
+         /* which can write to a file descriptor,  memory,  or callback. */
+int extract_urat1_stars_to_sink( out_sink_t *sink, const double ra,
+                  const double dec, const double width, const double height,
+                  const char *path, const int output_format);
+
+         /* Same,  but with the callback interface described for         */
+         /* extract_urat1_stars_callback_from_catalog() below.  Star     */
+         /* pointers are only valid during the callback.                 */
+int extract_urat1_stars_callback( void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height, const char *path);
+
+         /* If you're doing more than one extraction,  it's faster to   */
+         /* open the catalog once.  This finds the data and loads the   */
+         /* index (v1index.unf) into memory,  so finding where to start */
+         /* in each zone needs no further index reads.  A catalog       */
+         /* shouldn't be used by more than one thread at a time.        */
+typedef struct urat1_catalog urat1_catalog_t;
+
+urat1_catalog_t *open_urat1_catalog( const char *path);
+void close_urat1_catalog( urat1_catalog_t *cat);
+int extract_urat1_stars_from_catalog( urat1_catalog_t *cat,
+                  out_sink_t *sink, const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format);
+         /* Each star in the rectangle is passed to a callback,  with    */
+         /* its zone and (zero-based) offset within the zone.  Zone      */
+         /* files are memory-mapped,  and on little-endian machines the  */
+         /* star pointer points into the mapping,  so nothing is copied  */
+         /* and it's valid until the catalog is closed.  On big-endian   */
+         /* machines,  it points to a byte-flipped copy that's only valid */
+         /* during the callback;  copy the star if you want to keep it.  */
+         /* If the callback returns non-zero,  the extraction stops.     */
+         /* Returns the number of stars passed to the callback.          */
+int extract_urat1_stars_callback_from_catalog( urat1_catalog_t *cat,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height);
+         /* As above,  but only stars from one zone of the rectangle.   */
+         /* Lets you go through a large area a zone at a time.           */
+int extract_urat1_zone_stars_callback( urat1_catalog_t *cat, const int zone,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *),
+                  const double ra, const double dec,
+                  const double width, const double height);
+         /* Same output as extract_urat1_stars_from_catalog(),  but with */
+         /* the zones divided among 'n_threads' threads,  each writing   */
+         /* to its own buffer.  The buffers are written out in zone      */
+         /* order,  so the result is just what the one-thread version    */
+         /* would give.  The threads share the catalog's index.          */
+int extract_urat1_stars_parallel( urat1_catalog_t *cat, out_sink_t *sink,
+                  const double ra, const double dec,
+                  const double width, const double height,
+                  const int output_format, const int n_threads);
 int extract_urat1_info( const int zone, const long offset, URAT1_STAR *star,
                      const char *path);
+         /* Gets 'n_stars' stars at once,  given their zones and (one-   */
+         /* based) offsets;  much faster than extract_urat1_info() for a */
+         /* long list.  See 'bulk_req.h' for how it's done and what      */
+         /* comes back;  errors are as extract_urat1_info() would give.  */
+int extract_urat1_info_bulk( const size_t n_stars, const int *zones,
+                  const long *offsets, URAT1_STAR *stars, int *rvals,
+                  const char *path);
+         /* Hands every star in a zone to the callback,  with its zone  */
+         /* and zero-based offset,  for tools that go through the whole */
+         /* catalog.  If the callback returns non-zero,  we stop.        */
+         /* Returns the number of stars passed,  or a negative error.    */
+int for_each_urat1_star_in_zone( const int zone, const char *path,
+     void *context,
+     int (*callback_fn)( void *, const int, const uint32_t, const URAT1_STAR *));
 int write_urat1_star( const int zone, const long offset, char *obuff,
                      const URAT1_STAR *star, const int output_format);
 
@@ -29,6 +29,7 @@ static void show_error_message( void)
    printf( "the path d:\\ur1.  Data will be written to the file 'urat1.txt'.\n");
    printf( "\nOptionally, one may add command line options -h to include a header\n");
    printf( "line,  and/or -f4 to get the same output as from the FORTRAN code.\n");
+   printf( "For big areas,  -p4 (say) will use four threads to read zones.\n");
 }
 
 static const char *fortran_header =
@@ -43,7 +44,7 @@ static const char *usual_header = "  URAT1        RA             dec   sigs\
 
 int main( int argc, const char **argv)
 {
-   int rval = -9, i, j, show_debug_data = 0;
+   int rval = -9, i, j, show_debug_data = 0, n_threads = 0;
    unsigned format = URAT1_WRITE_SPACES;
    bool show_header = false;
 
@@ -61,6 +62,9 @@ int main( int argc, const char **argv)
             case 't': case 'T':
                show_debug_data = 1;
                break;
+            case 'p': case 'P':
+               n_threads = atoi( argv[i] + 2);
+               break;
             default:
                printf( "%s is an unrecognized option\n", argv[i]);
                break;
@@ -113,7 +117,24 @@ int main( int argc, const char **argv)
       if( show_header)
          fprintf( ofile, "%s\n", (format & URAT1_FORTRAN_STYLE) ?
                            fortran_header : usual_header);
-      rval = extract_urat1_stars( ofile, atof( argv[1]), atof( argv[2]),
+      if( n_threads)
+         {
+         out_sink_t *sink = open_file_sink( ofile);
+         urat1_catalog_t *cat = open_urat1_catalog( argc == 5 ? "" : argv[5]);
+         int err;
+
+         rval = -1;
+         if( cat && sink)
+            rval = extract_urat1_stars_parallel( cat, sink, atof( argv[1]),
+                  atof( argv[2]), atof( argv[3]), atof( argv[4]),
+                  format, n_threads);
+         close_urat1_catalog( cat);
+         err = close_sink( sink);
+         if( err)
+            rval = err;
+         }
+      else
+         rval = extract_urat1_stars( ofile, atof( argv[1]), atof( argv[2]),
                                atof( argv[3]), atof( argv[4]),
                                (argc == 5 ? "" : argv[5]), format);
 